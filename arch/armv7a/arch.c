@@ -36,3 +36,45 @@ void arch_sched_start_system_tick(void) {
      */
     chip_sched_start_system_tick();
 }
+
+/*
+ * IRQs are masked throughout the kernel, so an interrupt handler never
+ * preempts kernel code, and deferred work may run immediately.
+ */
+void arch_sched_request_deferred(void) {
+    sched_deferred_work();
+}
+
+/* The system tick is an IRQ, so mask IRQs */
+uint32_t arch_sched_mask(void) {
+    uint32_t cpsr;
+
+    asm volatile ("mrs  %[cpsr], cpsr   \n"
+                  "cpsid    i   \n"
+                  : [cpsr] "=r" (cpsr)
+                  :: "memory");
+
+    return cpsr;
+}
+
+void arch_sched_unmask(uint32_t state) {
+    /* CPSR I bit */
+    if (!(state & (1 << 7))) {
+        asm volatile ("cpsie    i" ::: "memory");
+    }
+}
+
+#ifdef CONFIG_SCHED_TICKLESS
+/* As with the system tick, the chip provides the timer */
+uint32_t arch_sched_tickless_max(void) {
+    return chip_sched_tickless_max();
+}
+
+int arch_sched_tickless_start(uint32_t ticks) {
+    return chip_sched_tickless_start(ticks);
+}
+
+uint32_t arch_sched_tickless_stop(void) {
+    return chip_sched_tickless_stop();
+}
+#endif
@@ -32,3 +32,17 @@ void chip_sched_start_system_tick(void) {
     /* Use DMTimer 1ms to handle system ticks */
     am335x_dmtimer1ms_init_systick();
 }
+
+#ifdef CONFIG_SCHED_TICKLESS
+uint32_t chip_sched_tickless_max(void) {
+    return am335x_dmtimer1ms_tickless_max();
+}
+
+int chip_sched_tickless_start(uint32_t ticks) {
+    return am335x_dmtimer1ms_tickless_start(ticks);
+}
+
+uint32_t chip_sched_tickless_stop(void) {
+    return am335x_dmtimer1ms_tickless_stop();
+}
+#endif
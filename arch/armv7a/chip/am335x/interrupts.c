@@ -91,7 +91,7 @@ static struct am335x_intc *interrupt_parent_regs(const void *fdt,
         return NULL;
     }
 
-    if (fdt_node_check_compatible(fdt, intc, AM335X_INTC_COMPAT)) {
+    if (fdtparse_node_check_compatible(fdt, intc, AM335X_INTC_COMPAT)) {
         /* We don't know how to initialize this! */
         return NULL;
     }
@@ -212,7 +212,7 @@ static int am335x_intc_init(void) {
     const void *fdt = fdtparse_get_blob();
     int root;
 
-    root = fdt_path_offset(fdt, "/");
+    root = fdtparse_path_offset(fdt, "/");
     if (root < 0) {
         return -1;
     }
@@ -53,7 +53,7 @@ static int am335x_prcm_regs_and_offset(const void *fdt, int nodeoffset,
     /* The second cell is the clock controller register offset */
     *regoffset = fdt32_to_cpu(cell[1]);
 
-    controller = fdt_node_offset_by_phandle(fdt, phandle);
+    controller = fdtparse_node_offset_by_phandle(fdt, phandle);
     if (controller < 0) {
         return -1;
     }
@@ -36,6 +36,21 @@
 
 #define TIMER_FREQ  (CLK_M_OSC)
 #define TIMER_CNT_PER_SYSTICK   (TIMER_FREQ/CONFIG_SYSTICK_FREQ)
+#define TIMER_SYSTICK_LOAD      ((uint32_t) ((1LL << 32) - TIMER_CNT_PER_SYSTICK))
+
+#ifdef CONFIG_SCHED_TICKLESS
+/* Timer used for system ticks */
+static struct am335x_dmtimer_1ms *systick_regs;
+
+/* Ticks programmed for the current tickless sleep, 0 if not sleeping */
+static uint32_t tickless_ticks;
+/* Counts of the current tick that had elapsed when the sleep began */
+static uint32_t tickless_offset;
+/* Counter value the tickless sleep began at */
+static uint32_t tickless_start;
+/* Set when the tickless sleep timer overflows */
+static uint8_t tickless_expired;
+#endif
 
 /* Registers passed into handler */
 static void dmtimer1ms_systick_handler(void *data) {
@@ -44,6 +59,12 @@ static void dmtimer1ms_systick_handler(void *data) {
     /* Acknowledge interrupt */
     raw_mem_set_bits(&regs->tisr, AM335X_DMTIMER_TISR_OVF_IT_FLAG);
 
+#ifdef CONFIG_SCHED_TICKLESS
+    if (tickless_ticks) {
+        tickless_expired = 1;
+    }
+#endif
+
     /* Perform OS system tick */
     sched_system_tick();
 }
@@ -58,7 +79,8 @@ void am335x_dmtimer1ms_init_systick(void) {
     uint32_t tldr_val;
 
     /* HACK: Simply use the first DMTimer 1ms */
-    offset = fdt_node_offset_by_compatible(fdt, -1, AM335X_DMTIMER_1MS_COMPAT);
+    offset = fdtparse_node_offset_by_compatible(fdt, -1,
+                                                AM335X_DMTIMER_1MS_COMPAT);
     if (offset < 0) {
         panic_print("DMTimer 1ms not found");
     }
@@ -98,7 +120,7 @@ void am335x_dmtimer1ms_init_systick(void) {
      * We want TIMER_CNT_PER_SYSTICK timer counts between the
      * load value and overflow.
      */
-    tldr_val = (1LL << 32) - TIMER_CNT_PER_SYSTICK;
+    tldr_val = TIMER_SYSTICK_LOAD;
     raw_mem_write(&regs->tldr, tldr_val);
 
     /* Force reload of counter */
@@ -117,7 +139,72 @@ void am335x_dmtimer1ms_init_systick(void) {
         panic_print("Unable to enable DMTimer 1ms interrupt");
     }
 
+#ifdef CONFIG_SCHED_TICKLESS
+    systick_regs = regs;
+#endif
+
     /* Start timer free running */
     raw_mem_write(&regs->tclr, AM335X_DMTIMER_TCLR_ST |
                                AM335X_DMTIMER_TCLR_AR);
 }
+
+#ifdef CONFIG_SCHED_TICKLESS
+uint32_t am335x_dmtimer1ms_tickless_max(void) {
+    /* Leave a tick of headroom for the partial tick at entry */
+    return UINT32_MAX / TIMER_CNT_PER_SYSTICK - 1;
+}
+
+int am335x_dmtimer1ms_tickless_start(uint32_t ticks) {
+    struct am335x_dmtimer_1ms *regs = systick_regs;
+    uint32_t tcrr;
+
+    raw_mem_clear_bits(&regs->tclr, AM335X_DMTIMER_TCLR_ST);
+
+    tcrr = raw_mem_read(&regs->tcrr);
+    tickless_offset = tcrr - TIMER_SYSTICK_LOAD;
+    tickless_ticks = ticks;
+    tickless_expired = 0;
+
+    /*
+     * Overflow on the boundary of the ticks'th tick from now.  Auto-reload
+     * remains enabled, so the timer returns to normal ticks afterwards.
+     */
+    tickless_start = tcrr - (ticks - 1) * TIMER_CNT_PER_SYSTICK;
+    raw_mem_write(&regs->tcrr, tickless_start);
+
+    raw_mem_set_bits(&regs->tclr, AM335X_DMTIMER_TCLR_ST);
+
+    return 0;
+}
+
+uint32_t am335x_dmtimer1ms_tickless_stop(void) {
+    struct am335x_dmtimer_1ms *regs = systick_regs;
+    uint32_t tcrr, elapsed, ticks;
+
+    raw_mem_clear_bits(&regs->tclr, AM335X_DMTIMER_TCLR_ST);
+
+    tcrr = raw_mem_read(&regs->tcrr);
+
+    if (tickless_expired) {
+        /* Counter has reloaded and is counting a normal tick */
+        ticks = tickless_ticks;
+        elapsed = tcrr - TIMER_SYSTICK_LOAD;
+    }
+    else {
+        ticks = 0;
+        elapsed = tickless_offset + (tcrr - tickless_start);
+    }
+
+    ticks += elapsed / TIMER_CNT_PER_SYSTICK;
+
+    /* Resume periodic ticks, keeping the phase of the partial tick */
+    raw_mem_write(&regs->tcrr, TIMER_SYSTICK_LOAD +
+                               elapsed % TIMER_CNT_PER_SYSTICK);
+    raw_mem_set_bits(&regs->tclr, AM335X_DMTIMER_TCLR_ST);
+
+    tickless_ticks = 0;
+    tickless_expired = 0;
+
+    return ticks;
+}
+#endif
@@ -116,4 +116,15 @@ struct am335x_dmtimer_1ms {
  */
 void am335x_dmtimer1ms_init_systick(void);
 
+/**
+ * Tickless sleep on the system tick DMTimer 1ms
+ *
+ * Implementations of chip_sched_tickless_*(), using the timer set up by
+ * am335x_dmtimer1ms_init_systick().  The counter is reprogrammed to overflow
+ * at the end of the sleep, and auto-reload returns it to normal ticks.
+ */
+uint32_t am335x_dmtimer1ms_tickless_max(void);
+int am335x_dmtimer1ms_tickless_start(uint32_t ticks);
+uint32_t am335x_dmtimer1ms_tickless_stop(void);
+
 #endif
@@ -79,6 +79,10 @@ static inline uint32_t atomic_and(uint32_t *ptr, uint32_t val) {
     return __atomic_and_fetch(ptr, val, __ATOMIC_SEQ_CST);
 }
 
+static __always_inline void data_memory_barrier(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 static __always_inline uint32_t load_link32(volatile uint32_t *address) {
     uint32_t val;
 
@@ -23,6 +23,8 @@
 #ifndef ARCH_CHIP_H_INCLUDED
 #define ARCH_CHIP_H_INCLUDED
 
+#include <stdint.h>
+
 /*
  * Perform core chip setup
  *
@@ -58,4 +60,16 @@ void fiq_handler(void) __attribute__((section(".kernel")));
  */
 void chip_sched_start_system_tick(void);
 
+/**
+ * Tickless sleep support
+ *
+ * Implement the system tick timer side of tickless sleep, as described by
+ * the docs for arch_sched_tickless_*() in include/kernel/sched_internals.h.
+ *
+ * Only required when CONFIG_SCHED_TICKLESS is enabled.
+ */
+uint32_t chip_sched_tickless_max(void);
+int chip_sched_tickless_start(uint32_t ticks);
+uint32_t chip_sched_tickless_stop(void);
+
 #endif
@@ -41,7 +41,7 @@
                   "mov  %[ret], r0  \n" \
                   :[ret] "+r" (ret)     \
                   :[code] "I" (call)    \
-                  :"r0");               \
+                  :"r0", "memory");     \
     ret;    \
 })
 
@@ -54,7 +54,7 @@
                   "mov  %[ret], r0  \n" \
                   :[ret] "+r" (ret)     \
                   :[code] "I" (call), [ar] "r" (arg)     \
-                  :"r0");               \
+                  :"r0", "memory");     \
     ret;    \
 })
 
@@ -68,7 +68,7 @@
                   "mov  %[ret], r0  \n" \
                   :[ret] "+r" (ret)     \
                   :[code] "I" (call), [ar1] "r" (arg1), [ar2] "r" (arg2)     \
-                  :"r0", "r1");               \
+                  :"r0", "r1", "memory");     \
     ret;    \
 })
 
@@ -25,6 +25,10 @@
 #include <kernel/sched.h>
 #include <kernel/sched_internals.h>
 #include <kernel/mutex.h>
+#include <kernel/timer.h>
+#include <kernel/sem.h>
+#include <kernel/event.h>
+#include <kernel/msgq.h>
 #include <arch/system_regs.h>
 #include "sched_asm.h"
 
@@ -55,6 +59,9 @@ void __attribute__((section(".kernel"))) svc_handler(struct stacked_registers *r
         case SVC_END_TASK:
         case SVC_REGISTER_TASK:
         case SVC_TASK_SWITCH:
+        case SVC_TASK_SLEEP:
+        case SVC_TICKLESS_ENTER:
+        case SVC_TICKLESS_EXIT:
             registers->r0 = sched_service_call(svc_number, registers->r0,
                                                registers->r1);
             break;
@@ -62,6 +69,26 @@ void __attribute__((section(".kernel"))) svc_handler(struct stacked_registers *r
         case SVC_RELEASE:
             registers->r0 = mutex_service_call(svc_number, registers->r0);
             break;
+        case SVC_TIMER_START:
+        case SVC_TIMER_STOP:
+            registers->r0 = timer_service_call(svc_number, registers->r0,
+                                               registers->r1);
+            break;
+        case SVC_SEM_WAIT:
+        case SVC_SEM_POST:
+            registers->r0 = sem_service_call(svc_number, registers->r0,
+                                             registers->r1);
+            break;
+        case SVC_EVENT_WAIT:
+        case SVC_EVENT_SET:
+            registers->r0 = event_service_call(svc_number, registers->r0,
+                                               registers->r1);
+            break;
+        case SVC_MSGQ_SEND:
+        case SVC_MSGQ_RECEIVE:
+            registers->r0 = msgq_service_call(svc_number, registers->r0,
+                                              registers->r1);
+            break;
         default:
             panic_print("Unknown SVC: %d", svc_number);
             break;
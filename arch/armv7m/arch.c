@@ -54,3 +54,40 @@ void arch_sched_start_system_tick(void) {
     /* The SysTick timer handles system ticks */
     init_systick();
 }
+
+/* PendSV runs once the interrupt, and any kernel code it preempted, returns */
+void arch_sched_request_deferred(void) {
+    *SCB_ICSR = SCB_ICSR_PENDSVSET;
+}
+
+/* SysTick and PendSV are masked along with every other interrupt */
+uint32_t arch_sched_mask(void) {
+    uint32_t primask;
+
+    asm volatile ("mrs  %[primask], primask \n"
+                  "cpsid    i   \n"
+                  : [primask] "=r" (primask)
+                  :: "memory");
+
+    return primask;
+}
+
+void arch_sched_unmask(uint32_t state) {
+    if (!(state & 1)) {
+        asm volatile ("cpsie    i" ::: "memory");
+    }
+}
+
+#ifdef CONFIG_SCHED_TICKLESS
+uint32_t arch_sched_tickless_max(void) {
+    return systick_tickless_max();
+}
+
+int arch_sched_tickless_start(uint32_t ticks) {
+    return systick_tickless_start(ticks);
+}
+
+uint32_t arch_sched_tickless_stop(void) {
+    return systick_tickless_stop();
+}
+#endif
@@ -25,8 +25,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <arch/system.h>
 #include <arch/chip/adc.h>
+#include <arch/chip/dma.h>
 #include <arch/chip/gpio.h>
+#include <arch/chip/rcc.h>
+#include <arch/chip/timer.h>
 #include <dev/fdtparse.h>
 #include <dev/hw/gpio.h>
 #include <dev/hw/adc.h>
@@ -35,6 +39,7 @@
 #include <kernel/fault.h>
 #include <kernel/mutex.h>
 #include <kernel/obj.h>
+#include <kernel/sem.h>
 #include <mm/mm.h>
 
 #define STM32F4_ADC_COMPAT  "stmicro,stm32f407-adc"
@@ -44,10 +49,45 @@ struct adc_channel {
     int channel;
 };
 
+/*
+ * Continuous scan of a converter, paced by a timer and DMA'd into a
+ * circular buffer split into two halves.  Each half is handed to the
+ * reader as a block while the DMA fills the other.
+ */
+struct adc_stream {
+    struct stm32f4_dma *dma;
+    stm32f4_dma_handle_t dma_handle;
+    int dma_irq;
+    uint16_t *buf;              /* Two halves of frames * channels samples */
+    uint32_t frames;
+    uint32_t channels;
+    volatile int ready;         /* Completed half not yet read, or -1 */
+    volatile int held;          /* Half held by the reader, or -1 */
+    volatile uint8_t error;     /* DMA transfer error stopped the stream */
+    volatile uint8_t stopped;   /* Stopped, freed once no readers remain */
+    volatile uint32_t overruns;
+    int readers;                /* Tasks in stream_read(), under state lock */
+    struct semaphore available; /* Posted as each half completes */
+};
+
+/* Timers whose TRGO can trigger regular conversions */
+static const struct adc_trigger {
+    int timer;
+    enum stm32f4_periph_id periph_id;
+    uint32_t extsel;
+} adc_triggers[] = {
+    { 2, STM32F4_PERIPH_TIM2, ADC_EXTSEL_TIM2_TRGO },
+    { 3, STM32F4_PERIPH_TIM3, ADC_EXTSEL_TIM3_TRGO },
+    { 8, STM32F4_PERIPH_TIM8, ADC_EXTSEL_TIM8_TRGO },
+};
+
 struct adc_individual_state {
     int valid;  /* This ADC exists */
     uint8_t ready;
     int periph_id;
+    int offset;         /* FDT node offset */
+    int trigger_timer;  /* Timer to pace streams, 0 if none */
+    struct adc_stream *stream;  /* Active stream, NULL if none */
     struct fdt_gpio channel_gpio[ADC_CHANNELS];
     int channel_in_use[ADC_CHANNELS];
 };
@@ -122,6 +162,20 @@ static int adc_read_sequence_number(struct stm32f4_adc_individual_regs *regs,
     return val;
 }
 
+/* Position of channel in scan sequence, negative if not in sequence */
+static int adc_sequence_index(struct stm32f4_adc_individual_regs *regs,
+                              int channel) {
+    int length = adc_sequence_length(regs);
+
+    for (int i = 1; i <= length; i++) {
+        if (adc_read_sequence_number(regs, i) == channel) {
+            return i - 1;
+        }
+    }
+
+    return -1;
+}
+
 static void adc_set_sequence_number(struct stm32f4_adc_individual_regs *regs,
                                     int sequence_number, int value) {
     if (sequence_number <= 6) {
@@ -212,6 +266,11 @@ static int stm32f4_adc_channel_initialize(struct adc *adc) {
         }
     }
 
+    /* The scan cannot change under a running stream */
+    if (periph->stream) {
+        goto err;
+    }
+
     regs = &stm32f4_adc->state->regs->adc[stm32f4_adc->adc_num];
 
     enabled = raw_mem_read(&regs->CR2) & ADC_CR2_ADON;
@@ -344,6 +403,383 @@ static int remove_from_adc_sequence(struct stm32f4_adc_individual_regs *regs,
     return 0;
 }
 
+static const struct adc_trigger *adc_find_trigger(int timer) {
+    const int num_triggers = sizeof(adc_triggers)/sizeof(adc_triggers[0]);
+
+    for (int i = 0; i < num_triggers; i++) {
+        if (adc_triggers[i].timer == timer) {
+            return &adc_triggers[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Hand a completed half of the stream buffer to the reader
+ *
+ * The DMA has moved on to the other half, so if the reader still holds
+ * it, or never took it, that block is lost.
+ */
+static void adc_stream_complete(struct adc_stream *stream, int half) {
+    if (stream->held == !half || stream->ready == !half) {
+        stream->overruns++;
+    }
+
+    stream->ready = half;
+    sem_post(&stream->available);
+}
+
+static void stm32f4_adc_dma_callback(void *data, uint32_t events) {
+    struct adc_stream *stream = data;
+
+    if (events & STM32F4_DMA_EVENT_TE) {
+        stream->error = 1;
+        sem_post(&stream->available);
+        return;
+    }
+
+    /* Both may be seen at once if the interrupt was held off */
+    if (events & STM32F4_DMA_EVENT_HT) {
+        adc_stream_complete(stream, 0);
+    }
+
+    if (events & STM32F4_DMA_EVENT_TC) {
+        adc_stream_complete(stream, 1);
+    }
+}
+
+static void adc_stream_free(struct adc_stream *stream) {
+    free(stream->buf);
+    kfree(stream);
+}
+
+/*
+ * Stop a converter's stream
+ *
+ * Stops the trigger timer and DMA, returning the converter to software
+ * triggered conversions, and releases the trigger timer.  A reader
+ * waiting in stream_read() is woken to return an error, and the stream
+ * is freed once the last reader leaves.
+ *
+ * The ADC state mutex should be held when calling this function.
+ *
+ * @param periph    Converter state
+ * @param regs      Converter registers
+ */
+static void adc_stream_stop_nolock(struct adc_individual_state *periph,
+                                   struct stm32f4_adc_individual_regs *regs) {
+    struct adc_stream *stream = periph->stream;
+    const struct adc_trigger *trigger;
+    struct stm32f4_timer_regs *timer;
+
+    trigger = adc_find_trigger(periph->trigger_timer);
+    timer = timer_get_regs(trigger->timer);
+
+    raw_mem_clear_bits(&timer->CR1, TIM_CR1_CEN);
+    rcc_set_clock_enable(trigger->periph_id, 0);
+    timer_release(trigger->timer);
+
+    raw_mem_clear_bits(&regs->CR2, ADC_CR2_DMA | ADC_CR2_DDS |
+                       ADC_CR2_EXTEN_MASK | ADC_CR2_EXTSEL_MASK);
+
+    stm32f4_dma_deallocate(stream->dma, stream->dma_handle);
+
+    periph->stream = NULL;
+    stream->stopped = 1;
+
+    if (stream->readers) {
+        sem_post(&stream->available);
+    }
+    else {
+        adc_stream_free(stream);
+    }
+}
+
+/*
+ * Latest streamed sample of a channel
+ *
+ * Reads the channel's sample from the last full scan the DMA wrote.
+ *
+ * @param stream    Active stream
+ * @param index     Index of channel in each scan
+ * @returns latest sample
+ */
+static uint32_t adc_stream_latest(struct adc_stream *stream, int index) {
+    struct stm32f4_dma_ops *dma_ops = stream->dma->obj.ops;
+    uint32_t samples = 2 * stream->frames * stream->channels;
+    int remaining;
+    uint32_t frame;
+
+    remaining = dma_ops->items_remaining(stream->dma, stream->dma_handle);
+    if (remaining < 0) {
+        return 0;
+    }
+
+    frame = (samples - remaining) / stream->channels;
+
+    /* Nothing written on this pass yet, use the end of the last */
+    if (!frame) {
+        frame = 2 * stream->frames;
+    }
+
+    return stream->buf[(frame - 1) * stream->channels + index];
+}
+
+static int stm32f4_adc_stream_start(struct adc *adc, uint32_t rate,
+                                    uint32_t frames) {
+    struct stm32f4_adc *stm32f4_adc;
+    struct adc_individual_state *periph;
+    struct stm32f4_adc_individual_regs *regs;
+    const struct adc_trigger *trigger;
+    struct stm32f4_timer_regs *timer;
+    struct stm32f4_dma_ops *dma_ops;
+    struct stm32f4_dma_config config;
+    struct adc_stream *stream;
+    uint32_t samples, ticks, prescaler;
+    int ret = -1;
+
+    if (!adc || !rate || !frames) {
+        return -1;
+    }
+
+    stm32f4_adc = adc->priv;
+    periph = &stm32f4_adc->state->adc[stm32f4_adc->adc_num];
+    regs = &stm32f4_adc->state->regs->adc[stm32f4_adc->adc_num];
+
+    acquire(&stm32f4_adc->state->lock);
+
+    if (periph->stream) {
+        goto out;
+    }
+
+    if (!stm32f4_adc->ready) {
+        if (stm32f4_adc_init_nolock(adc)) {
+            goto out;
+        }
+    }
+
+    trigger = adc_find_trigger(periph->trigger_timer);
+    if (!trigger) {
+        goto out;
+    }
+
+    /* Timer must count at least two ticks per scan */
+    ticks = timer_clock(trigger->timer) / rate;
+    if (ticks < 2) {
+        goto out;
+    }
+
+    /* Both halves must fit in one DMA transaction */
+    samples = 2 * frames * adc_sequence_length(regs);
+    if (samples > 0xffff) {
+        goto out;
+    }
+
+    /* The timer may be driving PWM outputs or another stream */
+    if (timer_reserve(trigger->timer)) {
+        goto out;
+    }
+
+    stream = kmalloc(sizeof(*stream));
+    if (!stream) {
+        goto err_release_timer;
+    }
+
+    memset(stream, 0, sizeof(*stream));
+
+    stream->buf = malloc(samples * sizeof(uint16_t));
+    if (!stream->buf) {
+        goto err_free_stream;
+    }
+
+    memset(stream->buf, 0, samples * sizeof(uint16_t));
+
+    stream->frames = frames;
+    stream->channels = adc_sequence_length(regs);
+    stream->ready = -1;
+    stream->held = -1;
+    sem_init(&stream->available, 0);
+
+    if (stm32f4_dma_allocate(stm32f4_adc->state->fdt, periph->offset, "rx",
+                             &stream->dma, &stream->dma_handle)) {
+        goto err_free_buf;
+    }
+
+    /* From here, adc_stream_stop_nolock() undoes everything */
+    periph->stream = stream;
+
+    dma_ops = stream->dma->obj.ops;
+    stream->dma_irq = stm32f4_dma_irq(stream->dma, stream->dma_handle);
+
+    config.direction = STM32F4_DMA_DIR_PERIPH_TO_MEM;
+    config.memory_size = 2;
+    config.peripheral_size = 2;
+    config.memory_increment = 1;
+    config.peripheral_increment = 0;
+    config.circular = 1;
+    config.double_buffer = 0;
+    config.peripheral_addr = (uintptr_t) &regs->DR;
+    config.mem0_addr = (uintptr_t) stream->buf;
+    config.mem1_addr = 0;
+
+    if (dma_ops->configure(stream->dma, stream->dma_handle, &config)) {
+        goto err_stop;
+    }
+
+    if (dma_ops->set_callback(stream->dma, stream->dma_handle,
+                              STM32F4_DMA_EVENT_HT | STM32F4_DMA_EVENT_TC |
+                              STM32F4_DMA_EVENT_TE,
+                              stm32f4_adc_dma_callback, stream)) {
+        goto err_stop;
+    }
+
+    if (dma_ops->begin_transaction(stream->dma, stream->dma_handle,
+                                   samples)) {
+        goto err_stop;
+    }
+
+    /* Scan on each timer trigger, requesting DMA for every conversion */
+    raw_mem_clear_bits(&regs->SR, ADC_SR_OVR | ADC_SR_EOC | ADC_SR_STRT);
+    raw_mem_set_mask(&regs->CR2, ADC_CR2_EXTSEL_MASK | ADC_CR2_EXTEN_MASK,
+                     ADC_CR2_EXTSEL(trigger->extsel) | ADC_CR2_EXTEN_RISE);
+    raw_mem_set_bits(&regs->CR2, ADC_CR2_DMA | ADC_CR2_DDS | ADC_CR2_ADON);
+
+    if (rcc_set_clock_enable(trigger->periph_id, 1)) {
+        goto err_stop;
+    }
+
+    timer = timer_get_regs(trigger->timer);
+
+    /* Not all trigger timers are 32-bit, keep the reload in 16 bits */
+    prescaler = ticks / 0x10000 + 1;
+
+    raw_mem_write(&timer->CR1, 0);
+    raw_mem_write(&timer->PSC, prescaler - 1);
+    raw_mem_write(&timer->ARR, ticks / prescaler - 1);
+
+    /* Load prescaler before the update event drives TRGO */
+    raw_mem_write(&timer->EGR, TIM_EGR_UG);
+    raw_mem_set_mask(&timer->CR2, TIM_CR2_MMS_MASK, TIM_CR2_MMS_UP);
+
+    raw_mem_set_bits(&timer->CR1, TIM_CR1_CEN);
+
+    ret = 0;
+    goto out;
+
+err_stop:
+    adc_stream_stop_nolock(periph, regs);
+    goto out;
+err_free_buf:
+    free(stream->buf);
+err_free_stream:
+    kfree(stream);
+err_release_timer:
+    timer_release(trigger->timer);
+out:
+    release(&stm32f4_adc->state->lock);
+    return ret;
+}
+
+static int stm32f4_adc_stream_read(struct adc *adc, struct adc_block *block,
+                                   uint32_t timeout_us) {
+    struct stm32f4_adc *stm32f4_adc;
+    struct stm32f4_adc_individual_regs *regs;
+    struct adc_stream *stream;
+    int half, index;
+    int ret = -1;
+
+    if (!adc || !block) {
+        return -1;
+    }
+
+    stm32f4_adc = adc->priv;
+    regs = &stm32f4_adc->state->regs->adc[stm32f4_adc->adc_num];
+
+    /* Keep the stream alive if it is stopped while we wait */
+    acquire(&stm32f4_adc->state->lock);
+
+    stream = stm32f4_adc->state->adc[stm32f4_adc->adc_num].stream;
+    if (stream) {
+        stream->readers++;
+    }
+
+    release(&stm32f4_adc->state->lock);
+
+    if (!stream) {
+        return -1;
+    }
+
+    index = adc_sequence_index(regs, stm32f4_adc->channel);
+    if (index < 0) {
+        goto out;
+    }
+
+    /* The previous block is done with */
+    stream->held = -1;
+
+    do {
+        if (sem_wait(&stream->available, timeout_us)) {
+            goto out;
+        }
+
+        if (stream->stopped || stream->error) {
+            goto out;
+        }
+
+        /* Extra posts remain for blocks replaced before being read */
+        nvic_disable_irq(stream->dma_irq);
+        half = stream->ready;
+        stream->ready = -1;
+        stream->held = half;
+        nvic_enable_irq(stream->dma_irq);
+    } while (half < 0);
+
+    block->samples = &stream->buf[half * stream->frames * stream->channels];
+    block->frames = stream->frames;
+    block->channels = stream->channels;
+    block->index = index;
+    block->overruns = stream->overruns;
+
+    ret = 0;
+
+out:
+    acquire(&stm32f4_adc->state->lock);
+
+    if (!--stream->readers && stream->stopped) {
+        adc_stream_free(stream);
+    }
+
+    release(&stm32f4_adc->state->lock);
+
+    return ret;
+}
+
+static int stm32f4_adc_stream_stop(struct adc *adc) {
+    struct stm32f4_adc *stm32f4_adc;
+    struct adc_individual_state *periph;
+    int ret = -1;
+
+    if (!adc) {
+        return -1;
+    }
+
+    stm32f4_adc = adc->priv;
+    periph = &stm32f4_adc->state->adc[stm32f4_adc->adc_num];
+
+    acquire(&stm32f4_adc->state->lock);
+
+    if (periph->stream) {
+        adc_stream_stop_nolock(periph,
+                &stm32f4_adc->state->regs->adc[stm32f4_adc->adc_num]);
+        ret = 0;
+    }
+
+    release(&stm32f4_adc->state->lock);
+
+    return ret;
+}
+
 static int stm32f4_adc_dtor(struct adc *adc) {
     struct stm32f4_adc *stm32f4_adc;
     struct adc_individual_state *periph;
@@ -364,6 +800,11 @@ static int stm32f4_adc_dtor(struct adc *adc) {
     if (stm32f4_adc->ready) {
         WARN_ON(!stm32f4_adc->sequence_number);
 
+        /* The scan is changing, so the stream layout is invalid */
+        if (periph->stream) {
+            adc_stream_stop_nolock(periph, regs);
+        }
+
         remove_from_adc_sequence(regs, stm32f4_adc->sequence_number);
         stm32f4_adc->sequence_number = 0;
         stm32f4_adc->ready = 0;
@@ -383,20 +824,14 @@ static int stm32f4_adc_dtor(struct adc *adc) {
 
 static uint32_t stm32f4_adc_read_raw(struct adc *adc) {
     struct stm32f4_adc *stm32f4_adc = adc->priv;
+    struct adc_individual_state *periph;
     struct stm32f4_adc_individual_regs *regs;
     uint32_t val = 0;
     uint32_t saved_sq1, saved_length;
 
+    periph = &stm32f4_adc->state->adc[stm32f4_adc->adc_num];
     regs = &stm32f4_adc->state->regs->adc[stm32f4_adc->adc_num];
 
-    /*
-     * Set our channel as the only channel in the sequence, and perform
-     * a one-shot conversion.
-     *
-     * TODO: use the DMA to read the multichannel sequence set up by the
-     * rest of the driver.
-     */
-
     acquire(&stm32f4_adc->state->lock);
 
     if (!stm32f4_adc->ready) {
@@ -406,6 +841,22 @@ static uint32_t stm32f4_adc_read_raw(struct adc *adc) {
         }
     }
 
+    /* Streaming converters already have a fresh sample */
+    if (periph->stream) {
+        int index = adc_sequence_index(regs, stm32f4_adc->channel);
+
+        if (index >= 0) {
+            val = adc_stream_latest(periph->stream, index);
+        }
+
+        goto out;
+    }
+
+    /*
+     * Set our channel as the only channel in the sequence, and perform
+     * a one-shot conversion.
+     */
+
     saved_length = raw_mem_read(&regs->SQR1) & ADC_SQR1_LEN_MASK;
     saved_sq1 = raw_mem_read(&regs->SQR3) & ADC_SQR3_SQ_MASK(1);
 
@@ -441,6 +892,9 @@ struct adc_ops stm32f4_adc_ops = {
     .init = stm32f4_adc_init,
     .dtor = stm32f4_adc_dtor,
     .read_raw = stm32f4_adc_read_raw,
+    .stream_start = stm32f4_adc_stream_start,
+    .stream_read = stm32f4_adc_stream_read,
+    .stream_stop = stm32f4_adc_stream_stop,
 };
 
 /*
@@ -488,13 +942,14 @@ static struct adc_state *create_adc_state(const void *fdt, int offset) {
         int channels;
         int adc_offset;
 
-        adc_offset = fdt_subnode_offset(fdt, offset, adc_subnodes[i]);
+        adc_offset = fdtparse_subnode_offset(fdt, offset, adc_subnodes[i]);
         if (adc_offset < 0) {
             continue;
         }
 
         adc_found = 1;
         state->adc[i].valid = 1;
+        state->adc[i].offset = adc_offset;
 
         channels = fdtparse_get_gpios(fdt, adc_offset, "stmicro,adc-channels",
                                       state->adc[i].channel_gpio,
@@ -509,6 +964,12 @@ static struct adc_state *create_adc_state(const void *fdt, int offset) {
                              &state->adc[i].periph_id)) {
             goto err_free_path;
         }
+
+        /* Optional, only needed for streaming */
+        if (fdtparse_get_int(fdt, adc_offset, "stmicro,trigger-timer",
+                             &state->adc[i].trigger_timer)) {
+            state->adc[i].trigger_timer = 0;
+        }
     }
 
     /* Make sure we found *something* */
@@ -713,7 +1174,7 @@ struct obj *stm32f4_adc_get(const void *fdt, int offset, struct obj *gpio) {
     struct adc_state *state;
     struct adc_channel adc_channel;
 
-    if (fdt_node_check_compatible(fdt, offset, STM32F4_ADC_COMPAT)) {
+    if (fdtparse_node_check_compatible(fdt, offset, STM32F4_ADC_COMPAT)) {
         goto err;
     }
 
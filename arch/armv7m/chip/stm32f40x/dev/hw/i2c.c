@@ -19,11 +19,12 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
-
 #include <libfdt.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <arch/system.h>
+#include <arch/chip/dma.h>
 #include <arch/chip/gpio.h>
 #include <arch/chip/i2c.h>
 #include <arch/chip/rcc.h>
@@ -35,30 +36,87 @@
 #include <kernel/mutex.h>
 #include <kernel/class.h>
 #include <kernel/init.h>
+#include <kernel/sched.h>
+#include <kernel/sem.h>
+#include <kernel/timer.h>
 #include <mm/mm.h>
 
 #include <dev/hw/i2c.h>
 
 #define STM32F4_I2C_COMPAT "stmicro,stm32f407-i2c"
 
+/* Longest a task will wait for its transfer, including time queued */
+#define STM32F4_I2C_TIMEOUT_US  50000
+
+/* Busy-wait budget, per byte when polling transfers */
+#define STM32F4_I2C_SPIN_COUNT  10000
+
+/* Transfer result while still queued or in progress */
+#define STM32F4_I2C_PENDING     1
+
 enum {
     I2C_GPIO_SCL,
     I2C_GPIO_SDA,
 };
 
+/* Event and error interrupts of each bus */
+static const uint8_t stm32f4_i2c_irqs[3][2] = {
+    {31, 32},   /* I2C1 */
+    {33, 34},   /* I2C2 */
+    {72, 73},   /* I2C3 */
+};
+
+/*
+ * Queued transfer
+ *
+ * Lives on the stack of the task waiting for it.  Once result is no longer
+ * STM32F4_I2C_PENDING, the driver no longer references it.
+ */
+struct stm32f4_i2c_xfer {
+    struct stm32f4_i2c_xfer *next;
+    struct i2c_msg          *msgs;
+    uint32_t                num;
+    volatile int            result;
+    struct semaphore        complete;
+};
+
 struct stm32f4_i2c {
     uint8_t                 ready;
+    /* Bus needs recovery before the next transfer.  Never set while active. */
+    uint8_t                 fault;
     int                     periph_id;
+    const uint8_t           *irqs;      /* Event, then error */
     struct gpio             *gpio[2];   /* SCL, then SDA */
     struct stm32f4_i2c_regs *regs;
+
+    /* Reads of more than one byte use DMA, if a stream was available */
+    struct stm32f4_dma      *rx_dma;
+    stm32f4_dma_handle_t    rx_handle;
+    uint8_t                 dma_busy;
+    volatile uint32_t       dma_events;
+
+    /* Transfer queue, only touched with the bus interrupts masked */
+    struct stm32f4_i2c_xfer *active;
+    struct stm32f4_i2c_xfer *queue_head;
+    struct stm32f4_i2c_xfer *queue_tail;
+    uint32_t                msg;        /* Current message of active */
+    uint32_t                pos;        /* Bytes of current message done */
+
+    /* Retries starting the next transfer once the last STOP is done */
+    struct timer            stop_timer;
 };
 
+/* Buses by number, for the interrupt handlers */
+static struct i2c *stm32f4_i2c_buses[3];
+
 /*
  * I2C peripheral initialization
  *
  * Initialize the I2C peripheral registers to the standard state.
  * For now, all I2C ports are configured the same.
  *
+ * The bus is marked faulted, so it is checked before the first transfer.
+ *
  * The I2C mutex should be held when calling this function.
  *
  * @param i2c   I2C peripheral to initialize
@@ -79,9 +137,13 @@ static int stm32f4_i2c_initialize(struct i2c *i2c) {
     raw_mem_set_mask(&port->regs->CCR, I2C_CCR_CCR_MASK, I2C_CCR_CCR(140));
     raw_mem_write(&port->regs->TRISE, 43);
 
+    /* Transfers are driven by the event and error interrupts */
+    raw_mem_set_bits(&port->regs->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+
     /* Enable */
     raw_mem_set_bits(&port->regs->CR1, I2C_CR1_PE);
 
+    port->fault = 1;
     port->ready = 1;
 
     return 0;
@@ -211,33 +273,355 @@ static int stm32f4_i2c_force_clear_busy(struct i2c *i2c) {
     return 0;
 }
 
-/**
- * Prepare I2C bus for transaction
+/*
+ * Mask bus interrupts
  *
- * Ensures the bus is ready and starts a transaction.
+ * Protects the transfer queue from the interrupt handlers.  Before task
+ * switching, transfers are polled and the interrupts are never unmasked.
+ */
+static void stm32f4_i2c_irq_mask(struct stm32f4_i2c *port) {
+    nvic_disable_irq(port->irqs[0]);
+    nvic_disable_irq(port->irqs[1]);
+}
+
+static void stm32f4_i2c_irq_unmask(struct stm32f4_i2c *port) {
+    if (task_switching) {
+        nvic_enable_irq(port->irqs[0]);
+        nvic_enable_irq(port->irqs[1]);
+    }
+}
+
+/*
+ * Start the next queued transfer
  *
- * This function acquires the I2C bus lock, which must be released
- * when the transaction is complete.
+ * Called with the bus idle and interrupts masked, or from the interrupt
+ * handler.  If the previous STOP is still being sent, the start is retried
+ * from the event interrupt on the next tick.
+ */
+static void stm32f4_i2c_start_next(struct i2c *i2c) {
+    struct stm32f4_i2c *port = i2c->priv;
+    struct stm32f4_i2c_xfer *xfer = port->queue_head;
+    int count = STM32F4_I2C_SPIN_COUNT;
+
+    if (!xfer) {
+        return;
+    }
+
+    /* The STOP ending the previous transfer must finish before a START */
+    if (task_switching && (raw_mem_read(&port->regs->CR1) & I2C_CR1_STOP)) {
+        /* Rather than spin here, perhaps in an interrupt, try next tick */
+        timer_start(&port->stop_timer, 0, 0);
+        return;
+    }
+
+    /* Polling before task switching, so nothing else is waiting */
+    while (raw_mem_read(&port->regs->CR1) & I2C_CR1_STOP) {
+        if (!--count) {
+            /* Leave the transfer queued until the bus is recovered */
+            port->fault = 1;
+            return;
+        }
+    }
+
+    port->queue_head = xfer->next;
+    if (!port->queue_head) {
+        port->queue_tail = NULL;
+    }
+
+    port->active = xfer;
+    port->msg = 0;
+    port->pos = 0;
+
+    raw_mem_set_bits(&port->regs->CR1, I2C_CR1_START);
+}
+
+/*
+ * Finish active transfer
  *
- * @param i2c   I2C bus to prepare
- * @returns 0 if ready, negative on error
+ * Wake the waiting task and start the next transfer, unless the bus needs
+ * recovery first.
  */
-static int stm32f4_i2c_prepare(struct i2c *i2c) {
-    struct stm32f4_i2c *port;
-    int ret, count;
+static void stm32f4_i2c_complete(struct i2c *i2c, int result) {
+    struct stm32f4_i2c *port = i2c->priv;
+    struct stm32f4_i2c_xfer *xfer = port->active;
 
-    if (!i2c) {
-        return -1;
+    raw_mem_clear_bits(&port->regs->CR2,
+                       I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+
+    /* An error may end a read before DMA does */
+    if (port->dma_busy) {
+        struct stm32f4_dma_ops *ops = port->rx_dma->obj.ops;
+        ops->end_transaction(port->rx_dma, port->rx_handle);
     }
 
-    acquire(&i2c->lock);
+    port->dma_busy = 0;
+    port->dma_events = 0;
+    port->active = NULL;
 
-    port = i2c->priv;
-    if (!port->ready) {
-        ret = stm32f4_i2c_initialize(i2c);
-        if (ret) {
-            return ret;
+    xfer->result = result;
+    sem_post(&xfer->complete);
+
+    if (!port->fault) {
+        stm32f4_i2c_start_next(i2c);
+    }
+}
+
+/* End the current message with a repeated start, or a stop after the last */
+static void stm32f4_i2c_end_condition(struct stm32f4_i2c *port) {
+    if (port->msg + 1 < port->active->num) {
+        raw_mem_set_bits(&port->regs->CR1, I2C_CR1_START);
+    }
+    else {
+        raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
+    }
+}
+
+/* Move to the next message, the end condition already requested */
+static void stm32f4_i2c_next_msg(struct i2c *i2c) {
+    struct stm32f4_i2c *port = i2c->priv;
+
+    port->pos = 0;
+
+    if (++port->msg == port->active->num) {
+        stm32f4_i2c_complete(i2c, 0);
+    }
+}
+
+/*
+ * Address acknowledged
+ *
+ * Set up the data phase of the message, then clear ADDR (by reading SR2)
+ * to release the clock.
+ */
+static void stm32f4_i2c_addressed(struct i2c *i2c, struct i2c_msg *msg) {
+    struct stm32f4_i2c *port = i2c->priv;
+    struct stm32f4_i2c_regs *regs = port->regs;
+
+    if (!(msg->flags & I2C_MSG_READ)) {
+        raw_mem_read(&regs->SR2);
+
+        if (!msg->len) {
+            stm32f4_i2c_end_condition(port);
+            stm32f4_i2c_next_msg(i2c);
+            return;
+        }
+
+        raw_mem_set_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+        return;
+    }
+
+    /* A single byte is never ACKed, and the end condition follows ADDR */
+    if (msg->len == 1) {
+        raw_mem_clear_bits(&regs->CR1, I2C_CR1_ACK);
+        raw_mem_read(&regs->SR2);
+        stm32f4_i2c_end_condition(port);
+        raw_mem_set_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+        return;
+    }
+
+    raw_mem_set_bits(&regs->CR1, I2C_CR1_ACK);
+
+    if (port->rx_dma && msg->len <= 0xffff) {
+        struct stm32f4_dma_ops *ops = port->rx_dma->obj.ops;
+        struct stm32f4_dma_config config = {
+            .direction = STM32F4_DMA_DIR_PERIPH_TO_MEM,
+            .memory_size = 1,
+            .peripheral_size = 1,
+            .memory_increment = 1,
+            .peripheral_increment = 0,
+            .circular = 0,
+            .double_buffer = 0,
+            .peripheral_addr = (uintptr_t) &regs->DR,
+            .mem0_addr = (uintptr_t) msg->buf,
+            .mem1_addr = 0,
+        };
+
+        if (!ops->configure(port->rx_dma, port->rx_handle, &config) &&
+            !ops->begin_transaction(port->rx_dma, port->rx_handle,
+                                    msg->len)) {
+            /* LAST NACKs the final byte, the stop comes with DMA complete */
+            port->dma_busy = 1;
+            raw_mem_clear_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+            raw_mem_set_bits(&regs->CR2, I2C_CR2_DMAEN | I2C_CR2_LAST);
+            raw_mem_read(&regs->SR2);
+            return;
+        }
+    }
+
+    /* No DMA, receive a byte per interrupt */
+    raw_mem_read(&regs->SR2);
+    raw_mem_set_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+}
+
+/*
+ * Advance the active transfer
+ *
+ * The bus state machine, run by both the event and error interrupts, and by
+ * the polling loop before task switching.  Does nothing for flags that don't
+ * apply to the current state, so it is safe to call at any time.
+ */
+static void stm32f4_i2c_service(struct i2c *i2c) {
+    struct stm32f4_i2c *port = i2c->priv;
+    struct stm32f4_i2c_regs *regs = port->regs;
+    struct stm32f4_i2c_xfer *xfer = port->active;
+    struct i2c_msg *msg;
+    uint32_t sr1, errors;
+
+    if (!xfer) {
+        raw_mem_clear_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+
+        /* Pended by stop_timer, if the queue was waiting on a STOP */
+        if (!port->fault) {
+            stm32f4_i2c_start_next(i2c);
+        }
+        return;
+    }
+
+    sr1 = raw_mem_read(&regs->SR1);
+
+    errors = sr1 & (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR);
+    if (errors || (port->dma_events & STM32F4_DMA_EVENT_TE)) {
+        raw_mem_clear_bits(&regs->SR1, errors);
+
+        /* Only the current master may stop */
+        if (!(errors & I2C_SR1_ARLO)) {
+            raw_mem_set_bits(&regs->CR1, I2C_CR1_STOP);
+        }
+
+        /* A NACK leaves the bus usable, anything else needs recovery */
+        if ((errors & ~I2C_SR1_AF) ||
+            (port->dma_events & STM32F4_DMA_EVENT_TE)) {
+            port->fault = 1;
+        }
+
+        stm32f4_i2c_complete(i2c, -1);
+        return;
+    }
+
+    msg = &xfer->msgs[port->msg];
+
+    /*
+     * Data first, a repeated start requested for the next message may
+     * already be done by the time the last byte is handled.
+     */
+    if ((msg->flags & I2C_MSG_READ) && (sr1 & I2C_SR1_RXNE) &&
+        !port->dma_busy && port->pos < msg->len) {
+        msg->buf[port->pos++] = raw_mem_read(&regs->DR);
+
+        if (port->pos == msg->len) {
+            raw_mem_clear_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+            stm32f4_i2c_next_msg(i2c);
         }
+        /* NACK and end after second to last receive */
+        else if (port->pos == msg->len - 1) {
+            raw_mem_clear_bits(&regs->CR1, I2C_CR1_ACK);
+            stm32f4_i2c_end_condition(port);
+        }
+
+        return;
+    }
+
+    if (port->dma_busy) {
+        if (port->dma_events & STM32F4_DMA_EVENT_TC) {
+            port->dma_busy = 0;
+            port->dma_events = 0;
+            raw_mem_clear_bits(&regs->CR2, I2C_CR2_DMAEN | I2C_CR2_LAST);
+            stm32f4_i2c_end_condition(port);
+            stm32f4_i2c_next_msg(i2c);
+        }
+        return;
+    }
+
+    if (sr1 & I2C_SR1_SB) {
+        raw_mem_write(&regs->DR,
+                      (msg->addr << 1) | !!(msg->flags & I2C_MSG_READ));
+        return;
+    }
+
+    if (sr1 & I2C_SR1_ADDR) {
+        stm32f4_i2c_addressed(i2c, msg);
+        return;
+    }
+
+    if (msg->flags & I2C_MSG_READ) {
+        return;
+    }
+
+    if ((sr1 & I2C_SR1_TXE) && port->pos < msg->len) {
+        raw_mem_write(&regs->DR, msg->buf[port->pos++]);
+
+        /* Last byte is out, wait for it to finish (BTF) */
+        if (port->pos == msg->len) {
+            raw_mem_clear_bits(&regs->CR2, I2C_CR2_ITBUFEN);
+        }
+    }
+    else if ((sr1 & I2C_SR1_BTF) && port->pos == msg->len) {
+        stm32f4_i2c_end_condition(port);
+        stm32f4_i2c_next_msg(i2c);
+    }
+}
+
+static void stm32f4_i2c_irq(int bus) {
+    struct i2c *i2c = stm32f4_i2c_buses[bus];
+
+    if (i2c) {
+        stm32f4_i2c_service(i2c);
+    }
+}
+
+#define I2C_IRQ_HANDLERS(bus)                                               \
+    void i2c##bus##_ev_handler(void) __attribute__((section(".kernel")));   \
+    void i2c##bus##_er_handler(void) __attribute__((section(".kernel")));   \
+    void i2c##bus##_ev_handler(void) {                                      \
+        stm32f4_i2c_irq(bus - 1);                                           \
+    }                                                                       \
+    void i2c##bus##_er_handler(void) {                                      \
+        stm32f4_i2c_irq(bus - 1);                                           \
+    }
+
+I2C_IRQ_HANDLERS(1)
+I2C_IRQ_HANDLERS(2)
+I2C_IRQ_HANDLERS(3)
+
+/* Run the event interrupt, which starts the next transfer if it can */
+static void stm32f4_i2c_stop_timer(void *data) {
+    struct stm32f4_i2c *port = data;
+
+    nvic_set_pending(port->irqs[0]);
+}
+
+/*
+ * DMA stream callback
+ *
+ * Only records the event, then runs the state machine from the I2C event
+ * interrupt, so the queue is only ever touched by one handler.
+ */
+static void stm32f4_i2c_dma_callback(void *data, uint32_t events) {
+    struct i2c *i2c = data;
+    struct stm32f4_i2c *port = i2c->priv;
+
+    port->dma_events |= events;
+    nvic_set_pending(port->irqs[0]);
+}
+
+/**
+ * Recover faulted bus
+ *
+ * Clears bus errors and a stuck BUSY, then restarts the transfer queue.
+ * Nothing is active while the bus is faulted, so the hardware is ours.
+ *
+ * @param i2c   I2C bus to recover
+ * @returns 0 if the bus is ready, negative otherwise
+ */
+static int stm32f4_i2c_recover(struct i2c *i2c) {
+    struct stm32f4_i2c *port = i2c->priv;
+    int ret = 0, count;
+
+    acquire(&i2c->lock);
+
+    /* Someone else got here first */
+    if (!port->fault) {
+        goto out;
     }
 
     /* Check for bus error */
@@ -249,12 +633,12 @@ static int stm32f4_i2c_prepare(struct i2c *i2c) {
         ret = stm32f4_i2c_reset(i2c);
         if (ret) {
             /* Failed to reset */
-            goto err_release;
+            goto out;
         }
     }
 
     /* Wait until BUSY is reset and previous transaction STOP is complete */
-    count = 10000;
+    count = STM32F4_I2C_SPIN_COUNT;
     while ((raw_mem_read(&port->regs->SR2) & I2C_SR2_BUSY) ||
             (raw_mem_read(&port->regs->CR1) & I2C_CR1_STOP)) {
         if (--count == 0) {
@@ -263,7 +647,7 @@ static int stm32f4_i2c_prepare(struct i2c *i2c) {
             ret = stm32f4_i2c_reset(i2c);
             if (ret) {
                 /* Failed to reset */
-                goto err_release;
+                goto out;
             }
         }
         else if (count < 0) {
@@ -272,175 +656,234 @@ static int stm32f4_i2c_prepare(struct i2c *i2c) {
             ret = stm32f4_i2c_force_clear_busy(i2c);
             if (ret) {
                 /* Failed to clear */
-                goto err_release;
+                goto out;
             }
         }
     }
 
-    raw_mem_set_bits(&port->regs->CR1, I2C_CR1_START);
-
-    count = 10000;
-    while (!(raw_mem_read(&port->regs->SR1) & I2C_SR1_SB)) {
-        if (!count--) {
-            /* Start bit timeout */
-            ret = -1;
-            goto err_stop;
-        }
+    stm32f4_i2c_irq_mask(port);
+    port->fault = 0;
+    if (!port->active) {
+        stm32f4_i2c_start_next(i2c);
     }
+    stm32f4_i2c_irq_unmask(port);
 
-    return 0;
-
-err_stop:
-    raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
-err_release:
+out:
     release(&i2c->lock);
+
     return ret;
 }
 
-static int stm32f4_i2c_write(struct i2c *i2c, uint8_t addr, uint8_t *data,
-                             uint32_t num) {
-    struct stm32f4_i2c *port;
-    int ret, count;
+/*
+ * Abandon transfer
+ *
+ * Remove a transfer that is taking too long from the queue, or stop it
+ * if it is in progress.  The bus is left faulted in the latter case.
+ */
+static void stm32f4_i2c_abort(struct i2c *i2c, struct stm32f4_i2c_xfer *xfer) {
+    struct stm32f4_i2c *port = i2c->priv;
+    struct stm32f4_i2c_xfer **curr;
 
-    if (!data || !num) {
-        return -1;
-    }
+    stm32f4_i2c_irq_mask(port);
 
-    ret = stm32f4_i2c_prepare(i2c);
-    if (ret) {
-        return ret;
+    /* Completed while we weren't looking */
+    if (xfer->result != STM32F4_I2C_PENDING) {
+        goto out;
     }
 
-    port = i2c->priv;
-
-    raw_mem_write(&port->regs->DR, addr << 1);
+    if (port->active == xfer) {
+        raw_mem_clear_bits(&port->regs->CR2,
+                           I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+        raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
 
-    count = 10000;
-    while (!(raw_mem_read(&port->regs->SR1) & I2C_SR1_ADDR)) {
-        if ((raw_mem_read(&port->regs->SR1) & I2C_SR1_AF) || !count--) {
-            /* Clear error */
-            raw_mem_clear_bits(&port->regs->SR1, I2C_SR1_AF);
-            ret = -1;
-            goto out;
+        /* The stream must stop writing to the abandoned buffer */
+        if (port->dma_busy) {
+            struct stm32f4_dma_ops *ops = port->rx_dma->obj.ops;
+            ops->end_transaction(port->rx_dma, port->rx_handle);
         }
+
+        port->dma_busy = 0;
+        port->dma_events = 0;
+        port->active = NULL;
+        port->fault = 1;
     }
+    else {
+        /* Not active, so it must still be queued */
+        for (curr = &port->queue_head; *curr != xfer; curr = &(*curr)->next);
 
-    count = 10000;
-    while (!(raw_mem_read(&port->regs->SR2) & I2C_SR2_MSL)) {
-        if (!count--) {
-            ret = -1;
-            goto out;
+        *curr = xfer->next;
+
+        if (port->queue_tail == xfer) {
+            port->queue_tail = (curr == &port->queue_head) ? NULL :
+                container_of(curr, struct stm32f4_i2c_xfer, next);
         }
     }
 
-    int total = 0;
+    xfer->result = -1;
 
-    while (num--) {
-        /* Make sure shift register is empty */
-        count = 10000;
-        while (!(raw_mem_read(&port->regs->SR1) & I2C_SR1_TXE)) {
-            if (!count--) {
-                ret = total;
-                goto out;
-            }
+out:
+    stm32f4_i2c_irq_unmask(port);
+}
+
+/*
+ * Run transfer without interrupts
+ *
+ * Before task switching, there is no one to block, so the state machine is
+ * polled instead.
+ */
+static void stm32f4_i2c_poll(struct i2c *i2c, struct stm32f4_i2c_xfer *xfer) {
+    struct stm32f4_i2c *port = i2c->priv;
+    struct stm32f4_dma_ops *dma_ops;
+    uint32_t bytes = 0;
+    int count;
+
+    for (uint32_t i = 0; i < xfer->num; i++) {
+        bytes += xfer->msgs[i].len + 1;
+    }
+
+    count = STM32F4_I2C_SPIN_COUNT * bytes;
+
+    while (xfer->result == STM32F4_I2C_PENDING) {
+        if (!count--) {
+            stm32f4_i2c_abort(i2c, xfer);
+            break;
         }
 
-        raw_mem_write(&port->regs->DR, *data++);
+        if (port->dma_busy) {
+            int complete;
 
-        count = 10000;
-        while (!(raw_mem_read(&port->regs->SR1) & I2C_SR1_TXE)) {
-            if (!count--) {
-                ret = total;
-                goto out;
+            dma_ops = port->rx_dma->obj.ops;
+            complete = dma_ops->transaction_complete(port->rx_dma,
+                                                     port->rx_handle);
+            if (complete > 0) {
+                port->dma_events |= STM32F4_DMA_EVENT_TC;
+            }
+            else if (complete < 0) {
+                port->dma_events |= STM32F4_DMA_EVENT_TE;
             }
         }
 
-        total += 1;
+        stm32f4_i2c_service(i2c);
     }
-
-    ret = total;
-
-out:
-    raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
-    release(&i2c->lock);
-
-    return ret;
 }
 
-static int stm32f4_i2c_read(struct i2c *i2c, uint8_t addr, uint8_t *data,
-                            uint32_t num) {
+static int stm32f4_i2c_transfer(struct i2c *i2c, struct i2c_msg *msgs,
+                                uint32_t num) {
     struct stm32f4_i2c *port;
-    int ret, count, total = 0;
+    struct stm32f4_i2c_xfer xfer;
+    int ret = 0;
 
-    if (!data || !num) {
+    if (!i2c || !msgs || !num) {
         return -1;
     }
 
-    ret = stm32f4_i2c_prepare(i2c);
+    for (uint32_t i = 0; i < num; i++) {
+        if (msgs[i].len && !msgs[i].buf) {
+            return -1;
+        }
+
+        /* Reads can't be empty, the address byte always reads one */
+        if ((msgs[i].flags & I2C_MSG_READ) && !msgs[i].len) {
+            return -1;
+        }
+    }
+
+    port = i2c->priv;
+
+    acquire(&i2c->lock);
+    if (!port->ready) {
+        ret = stm32f4_i2c_initialize(i2c);
+    }
+    release(&i2c->lock);
+
     if (ret) {
         return ret;
     }
 
-    port = i2c->priv;
+    xfer.next = NULL;
+    xfer.msgs = msgs;
+    xfer.num = num;
+    xfer.result = STM32F4_I2C_PENDING;
+    sem_init(&xfer.complete, 0);
 
-    raw_mem_write(&port->regs->DR, (addr << 1) | 1);
+    stm32f4_i2c_irq_mask(port);
 
-    count = 10000;
-    while (!(raw_mem_read(&port->regs->SR1) & I2C_SR1_ADDR)) {
-        if ((raw_mem_read(&port->regs->SR1) & I2C_SR1_AF) || !count--) {
-            /* Clear error */
-            raw_mem_clear_bits(&port->regs->SR1, I2C_SR1_AF);
-            goto out_err;
-        }
+    if (port->queue_tail) {
+        port->queue_tail->next = &xfer;
+    }
+    else {
+        port->queue_head = &xfer;
     }
+    port->queue_tail = &xfer;
 
-    uint8_t single_byte = num == 1;
+    if (!port->active && !port->fault) {
+        stm32f4_i2c_start_next(i2c);
+    }
+
+    stm32f4_i2c_irq_unmask(port);
+
+    if (port->fault && stm32f4_i2c_recover(i2c)) {
+        stm32f4_i2c_abort(i2c, &xfer);
+        return -1;
+    }
 
-    if (!single_byte) {
-        raw_mem_set_bits(&port->regs->CR1, I2C_CR1_ACK);
+    if (!task_switching) {
+        stm32f4_i2c_poll(i2c, &xfer);
     }
-    else {  /* In single byte receive, never ACK */
-        raw_mem_clear_bits(&port->regs->CR1, I2C_CR1_ACK);
+    else if (sem_wait(&xfer.complete, STM32F4_I2C_TIMEOUT_US)) {
+        stm32f4_i2c_abort(i2c, &xfer);
     }
 
-    while (num--) {
-        count = 10000;
-        while (!(raw_mem_read(&port->regs->SR2) & I2C_SR2_MSL)) {
-            if (!count--) {
-                goto out_err;
-            }
-        }
+    /* Leave the bus ready for the next transfer */
+    if (port->fault) {
+        stm32f4_i2c_recover(i2c);
+    }
 
-        /* In single byte receive, stop after ADDR clear (SR1 and SR2 read) */
-        if (single_byte) {
-            raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
-        }
+    return xfer.result ? -1 : (int) num;
+}
 
-        count = 10000;
-        while (!(raw_mem_read(&port->regs->SR1) & I2C_SR1_RXNE)) {
-            if (!count--) {
-                goto out_err;
-            }
-        }
+static int stm32f4_i2c_write(struct i2c *i2c, uint8_t addr, uint8_t *data,
+                             uint32_t num) {
+    struct i2c_msg msg = {
+        .addr = addr,
+        .flags = 0,
+        .buf = data,
+        .len = num,
+    };
+    int ret;
 
-        *data++ = raw_mem_read(&port->regs->DR);
-        total++;
+    if (!data || !num) {
+        return -1;
+    }
 
-        /* NACK and STOP after second to last receive */
-        if (num == 1) {
-            raw_mem_clear_bits(&port->regs->CR1, I2C_CR1_ACK);
-            raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
-        }
+    ret = stm32f4_i2c_transfer(i2c, &msg, 1);
+    if (ret < 0) {
+        return ret;
     }
 
-    release(&i2c->lock);
+    return num;
+}
 
-    return total;
+static int stm32f4_i2c_read(struct i2c *i2c, uint8_t addr, uint8_t *data,
+                            uint32_t num) {
+    struct i2c_msg msg = {
+        .addr = addr,
+        .flags = I2C_MSG_READ,
+        .buf = data,
+        .len = num,
+    };
+    int ret;
 
-out_err:
-    raw_mem_set_bits(&port->regs->CR1, I2C_CR1_STOP);
-    release(&i2c->lock);
-    return total;
+    if (!data || !num) {
+        return -1;
+    }
+
+    ret = stm32f4_i2c_transfer(i2c, &msg, 1);
+    if (ret < 0) {
+        return ret;
+    }
+
+    return num;
 }
 
 static struct i2c_ops stm32f4_i2c_ops = {
@@ -448,6 +891,7 @@ static struct i2c_ops stm32f4_i2c_ops = {
     .deinit = stm32f4_i2c_deinit,
     .read = stm32f4_i2c_read,
     .write = stm32f4_i2c_write,
+    .transfer = stm32f4_i2c_transfer,
 };
 
 static int stm32f4_i2c_probe(const char *name) {
@@ -455,13 +899,14 @@ static int stm32f4_i2c_probe(const char *name) {
     int offset;
 
     /* Lookup peripheral node */
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
     /* Check that peripheral is compatible with driver */
-    return fdt_node_check_compatible(blob, offset, STM32F4_I2C_COMPAT) == 0;
+    return fdtparse_node_check_compatible(blob, offset,
+                                          STM32F4_I2C_COMPAT) == 0;
 }
 
 static struct obj *stm32f4_i2c_ctor(const char *name) {
@@ -471,14 +916,14 @@ static struct obj *stm32f4_i2c_ctor(const char *name) {
     struct i2c *i2c;
     struct stm32f4_i2c *port;
     struct stm32f4_i2c_regs *regs;
-    int err, periph_id;
+    int err, periph_id, bus;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, STM32F4_I2C_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, STM32F4_I2C_COMPAT)) {
         return NULL;
     }
 
@@ -492,6 +937,11 @@ static struct obj *stm32f4_i2c_ctor(const char *name) {
         return NULL;
     }
 
+    bus = periph_id - STM32F4_PERIPH_I2C1;
+    if (bus < 0 || bus > 2) {
+        return NULL;
+    }
+
     obj = instantiate(name, &i2c_class, &stm32f4_i2c_ops, struct i2c);
     if (!obj) {
         return NULL;
@@ -512,6 +962,8 @@ static struct obj *stm32f4_i2c_ctor(const char *name) {
     port->ready = 0;
     port->regs = regs;
     port->periph_id = periph_id;
+    port->irqs = stm32f4_i2c_irqs[bus];
+    timer_init(&port->stop_timer, stm32f4_i2c_stop_timer, port);
 
     /* Setup GPIOs */
     for (int i = 0; i < 2; i++) {
@@ -566,6 +1018,27 @@ static struct obj *stm32f4_i2c_ctor(const char *name) {
         }
     }
 
+    /* Reads fall back to a byte per interrupt without DMA */
+    err = stm32f4_dma_allocate(blob, offset, "rx", &port->rx_dma,
+                               &port->rx_handle);
+    if (!err) {
+        struct stm32f4_dma_ops *dma_ops = port->rx_dma->obj.ops;
+
+        err = dma_ops->set_callback(port->rx_dma, port->rx_handle,
+                                    STM32F4_DMA_EVENT_TC |
+                                    STM32F4_DMA_EVENT_TE,
+                                    stm32f4_i2c_dma_callback, i2c);
+        if (err) {
+            stm32f4_dma_deallocate(port->rx_dma, port->rx_handle);
+            port->rx_dma = NULL;
+        }
+    }
+    else {
+        port->rx_dma = NULL;
+    }
+
+    stm32f4_i2c_buses[bus] = i2c;
+
     /* Export to the OS */
     class_export_member(obj);
 
@@ -75,6 +75,10 @@ static void init_tim5(void) {
 }
 
 void init_perfcounter(void) {
+    /* Nothing else runs this early, so these cannot already be taken */
+    timer_reserve(5);
+    timer_reserve(2);
+
     init_tim5();
     init_tim2();
 }
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <arch/system.h>
+#include <arch/chip/dma.h>
 #include <arch/chip/gpio.h>
 #include <arch/chip/rcc.h>
 #include <arch/chip/spi.h>
@@ -38,18 +39,43 @@
 #include <kernel/mutex.h>
 #include <kernel/class.h>
 #include <kernel/init.h>
+#include <kernel/sched.h>
+#include <kernel/sem.h>
 #include <mm/mm.h>
 
 #define STM32F4_SPI_COMPAT "stmicro,stm32f407-spi"
 
+/* Longest a task will wait for its transfer, including time queued */
+#define STM32F4_SPI_TIMEOUT_US  100000
+
+/* Transfer result while still queued or in progress */
+#define STM32F4_SPI_PENDING     1
+
 struct stm32f4_spi {
     uint8_t                 ready;
     int                     periph_id;
     long                    periph_clock;
     struct gpio             *gpio[3];    /* Each SPI port uses 3 GPIOs */
     struct stm32f4_spi_regs *regs;
+
+    /* Transfers use DMA when both streams are available */
+    struct stm32f4_dma      *rx_dma;
+    struct stm32f4_dma      *tx_dma;
+    stm32f4_dma_handle_t    rx_handle;
+    stm32f4_dma_handle_t    tx_handle;
+    int                     rx_irq;
+
+    /* Transfer queue, only touched with the RX stream interrupt masked */
+    struct spi_xfer         *active;
+    struct spi_xfer         *queue_head;
+    struct spi_xfer         *queue_tail;
+    uint32_t                seg;        /* Current segment of active */
 };
 
+/* Source of zeros for segments without tx, and sink for those without rx */
+static uint8_t stm32f4_spi_dummy_tx;
+static uint8_t stm32f4_spi_dummy_rx;
+
 static long get_clock(struct stm32f4_spi *port) {
     switch (raw_mem_read(&port->regs->CR1) & SPI_CR1_BR_MASK) {
     case SPI_CR1_BR_2:
@@ -245,6 +271,332 @@ static int stm32f4_spi_send_receive(struct spi *spi, uint8_t send,
     return 0;
 }
 
+static void stm32f4_spi_cs(struct spi_dev *dev, int active) {
+    struct gpio_ops *cs_ops = (struct gpio_ops *) dev->cs->obj.ops;
+
+    cs_ops->set_output_value(dev->cs, !active);
+}
+
+/*
+ * Run transfer on the CPU
+ *
+ * Used before task switching, or without DMA.  The SPI mutex must be held.
+ */
+static int stm32f4_spi_transfer_polled(struct spi *spi,
+                                       struct spi_xfer *xfer) {
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+    int ret = 0;
+
+    stm32f4_spi_cs(xfer->dev, 1);
+
+    /* Clear overrun by reading old data */
+    if (raw_mem_read(&port->regs->SR) & SPI_SR_OVR) {
+        READ_AND_DISCARD(&port->regs->DR);
+        READ_AND_DISCARD(&port->regs->SR);
+    }
+
+    for (uint32_t i = 0; i < xfer->num && !ret; i++) {
+        struct spi_seg *seg = &xfer->segs[i];
+
+        for (uint32_t j = 0; j < seg->len; j++) {
+            uint8_t send = seg->tx ? seg->tx[j] : 0;
+            uint8_t *receive = seg->rx ? &seg->rx[j] : NULL;
+
+            if (stm32f4_spi_send_receive(spi, send, receive)) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    stm32f4_spi_cs(xfer->dev, 0);
+
+    return ret;
+}
+
+/*
+ * Start DMA for the current segment of the active transfer
+ *
+ * RX is started first, so it is ready for the first byte clocked by TX.
+ */
+static int stm32f4_spi_start_seg(struct spi *spi) {
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+    struct spi_seg *seg = &port->active->segs[port->seg];
+    struct stm32f4_dma_ops *rx_ops = port->rx_dma->obj.ops;
+    struct stm32f4_dma_ops *tx_ops = port->tx_dma->obj.ops;
+    struct stm32f4_dma_config rx_config = {
+        .direction = STM32F4_DMA_DIR_PERIPH_TO_MEM,
+        .memory_size = 1,
+        .peripheral_size = 1,
+        .memory_increment = !!seg->rx,
+        .peripheral_increment = 0,
+        .circular = 0,
+        .double_buffer = 0,
+        .peripheral_addr = (uintptr_t) &port->regs->DR,
+        .mem0_addr = seg->rx ? (uintptr_t) seg->rx :
+                               (uintptr_t) &stm32f4_spi_dummy_rx,
+        .mem1_addr = 0,
+    };
+    struct stm32f4_dma_config tx_config = {
+        .direction = STM32F4_DMA_DIR_MEM_TO_PERIPH,
+        .memory_size = 1,
+        .peripheral_size = 1,
+        .memory_increment = !!seg->tx,
+        .peripheral_increment = 0,
+        .circular = 0,
+        .double_buffer = 0,
+        .peripheral_addr = (uintptr_t) &port->regs->DR,
+        .mem0_addr = seg->tx ? (uintptr_t) seg->tx :
+                               (uintptr_t) &stm32f4_spi_dummy_tx,
+        .mem1_addr = 0,
+    };
+
+    if (rx_ops->configure(port->rx_dma, port->rx_handle, &rx_config) ||
+        tx_ops->configure(port->tx_dma, port->tx_handle, &tx_config)) {
+        return -1;
+    }
+
+    /* Clear overrun by reading old data */
+    if (raw_mem_read(&port->regs->SR) & SPI_SR_OVR) {
+        READ_AND_DISCARD(&port->regs->DR);
+        READ_AND_DISCARD(&port->regs->SR);
+    }
+
+    if (rx_ops->begin_transaction(port->rx_dma, port->rx_handle, seg->len) ||
+        tx_ops->begin_transaction(port->tx_dma, port->tx_handle, seg->len)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void stm32f4_spi_start_next(struct spi *spi);
+
+/*
+ * Stop DMA for the active transfer
+ *
+ * Both streams are stopped, not just the requests, so neither touches the
+ * transfer's buffers once it is finished or abandoned.
+ */
+static void stm32f4_spi_stop_dma(struct stm32f4_spi *port) {
+    struct stm32f4_dma_ops *rx_ops = port->rx_dma->obj.ops;
+    struct stm32f4_dma_ops *tx_ops = port->tx_dma->obj.ops;
+
+    raw_mem_clear_bits(&port->regs->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+
+    rx_ops->end_transaction(port->rx_dma, port->rx_handle);
+    tx_ops->end_transaction(port->tx_dma, port->tx_handle);
+}
+
+/*
+ * Finish active transfer
+ *
+ * Release the device, notify the owner, and move on to the next transfer.
+ */
+static void stm32f4_spi_complete(struct spi *spi, int result) {
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+    struct spi_xfer *xfer = port->active;
+
+    stm32f4_spi_stop_dma(port);
+    stm32f4_spi_cs(xfer->dev, 0);
+
+    port->active = NULL;
+    xfer->result = result;
+
+    if (xfer->complete) {
+        xfer->complete(xfer, result);
+    }
+    else {
+        sem_post(xfer->waiter);
+    }
+
+    stm32f4_spi_start_next(spi);
+}
+
+/*
+ * Start the next queued transfer
+ *
+ * Called with the port idle, from the RX stream interrupt, or with it
+ * masked.
+ */
+static void stm32f4_spi_start_next(struct spi *spi) {
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+    struct spi_xfer *xfer = port->queue_head;
+
+    if (!xfer) {
+        return;
+    }
+
+    port->queue_head = xfer->next;
+    if (!port->queue_head) {
+        port->queue_tail = NULL;
+    }
+
+    port->active = xfer;
+    port->seg = 0;
+
+    stm32f4_spi_cs(xfer->dev, 1);
+    raw_mem_set_bits(&port->regs->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+
+    if (stm32f4_spi_start_seg(spi)) {
+        stm32f4_spi_complete(spi, -1);
+    }
+}
+
+/* RX stream callback, all bytes of the segment have been clocked */
+static void stm32f4_spi_dma_callback(void *data, uint32_t events) {
+    struct spi *spi = data;
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+
+    if (!port->active) {
+        return;
+    }
+
+    if (events & STM32F4_DMA_EVENT_TE) {
+        stm32f4_spi_complete(spi, -1);
+        return;
+    }
+
+    if (++port->seg < port->active->num) {
+        if (stm32f4_spi_start_seg(spi)) {
+            stm32f4_spi_complete(spi, -1);
+        }
+        return;
+    }
+
+    stm32f4_spi_complete(spi, 0);
+}
+
+/*
+ * Abandon transfer
+ *
+ * Remove a transfer that is taking too long from the queue, or stop it
+ * if it is in progress.
+ */
+static void stm32f4_spi_abort(struct spi *spi, struct spi_xfer *xfer) {
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+    struct spi_xfer **curr;
+
+    nvic_disable_irq(port->rx_irq);
+
+    /* Completed while we weren't looking */
+    if (xfer->result != STM32F4_SPI_PENDING) {
+        goto out;
+    }
+
+    if (port->active == xfer) {
+        stm32f4_spi_stop_dma(port);
+        stm32f4_spi_cs(xfer->dev, 0);
+
+        port->active = NULL;
+        stm32f4_spi_start_next(spi);
+    }
+    else {
+        /* Not active, so it must still be queued */
+        for (curr = &port->queue_head; *curr != xfer; curr = &(*curr)->next);
+
+        *curr = xfer->next;
+
+        if (port->queue_tail == xfer) {
+            port->queue_tail = (curr == &port->queue_head) ? NULL :
+                container_of(curr, struct spi_xfer, next);
+        }
+    }
+
+    xfer->result = -1;
+
+out:
+    nvic_enable_irq(port->rx_irq);
+}
+
+static int stm32f4_spi_transfer(struct spi *spi, struct spi_xfer *xfer) {
+    struct stm32f4_spi *port;
+    struct semaphore done;
+    int ret = 0;
+
+    if (!spi || !xfer || !xfer->dev || !xfer->dev->cs || !xfer->segs ||
+        !xfer->num) {
+        return -1;
+    }
+
+    /* Segments are limited by the DMA item count */
+    for (uint32_t i = 0; i < xfer->num; i++) {
+        if (!xfer->segs[i].len || xfer->segs[i].len > 0xffff) {
+            return -1;
+        }
+    }
+
+    port = (struct stm32f4_spi *) spi->priv;
+
+    acquire(&spi->lock);
+
+    if (!port->ready) {
+        ret = stm32f4_spi_initialize(spi);
+        if (ret) {
+            release(&spi->lock);
+            return ret;
+        }
+    }
+
+    /* Nothing to wait for, just do it */
+    if (!port->rx_dma || !task_switching) {
+        ret = stm32f4_spi_transfer_polled(spi, xfer);
+        release(&spi->lock);
+
+        xfer->result = ret;
+        if (xfer->complete) {
+            xfer->complete(xfer, ret);
+        }
+
+        return ret;
+    }
+
+    if (!xfer->complete) {
+        sem_init(&done, 0);
+        xfer->waiter = &done;
+    }
+
+    xfer->next = NULL;
+    xfer->result = STM32F4_SPI_PENDING;
+
+    nvic_disable_irq(port->rx_irq);
+
+    if (port->queue_tail) {
+        port->queue_tail->next = xfer;
+    }
+    else {
+        port->queue_head = xfer;
+    }
+    port->queue_tail = xfer;
+
+    if (!port->active) {
+        stm32f4_spi_start_next(spi);
+    }
+
+    nvic_enable_irq(port->rx_irq);
+
+    release(&spi->lock);
+
+    if (xfer->complete) {
+        return 0;
+    }
+
+    if (sem_wait(&done, STM32F4_SPI_TIMEOUT_US)) {
+        stm32f4_spi_abort(spi, xfer);
+    }
+
+    return xfer->result;
+}
+
+/* Wait for queued transfers to finish.  The SPI mutex must be held. */
+static void stm32f4_spi_drain(struct spi *spi) {
+    struct stm32f4_spi *port = (struct stm32f4_spi *) spi->priv;
+
+    while (port->active) {
+        yield_if_possible();
+    }
+}
+
 static int stm32f4_spi_read_write(struct spi *spi, struct spi_dev *dev,
                                   uint8_t *read_data, uint8_t *write_data,
                                   uint32_t num) {
@@ -268,12 +620,34 @@ static int stm32f4_spi_read_write(struct spi *spi, struct spi_dev *dev,
         return 0;
     }
 
+    if (!dev->extended_transaction && port->rx_dma && task_switching &&
+        num <= 0xffff) {
+        struct spi_seg seg = {
+            .tx = write_data,
+            .rx = read_data,
+            .len = num,
+        };
+        struct spi_xfer xfer = {
+            .dev = dev,
+            .segs = &seg,
+            .num = 1,
+            .complete = NULL,
+        };
+
+        if (stm32f4_spi_transfer(spi, &xfer)) {
+            return -1;
+        }
+
+        return num;
+    }
+
     struct gpio_ops *cs_ops = (struct gpio_ops *) dev->cs->obj.ops;
     uint32_t total = 0;
     int ret;
 
     if (!dev->extended_transaction) {
         acquire(&spi->lock);
+        stm32f4_spi_drain(spi);
         cs_ops->set_output_value(dev->cs, 0);
     }
 
@@ -332,6 +706,10 @@ static void stm32f4_spi_start_transaction(struct spi *spi, struct spi_dev *dev)
     struct gpio_ops *cs_ops = (struct gpio_ops *) dev->cs->obj.ops;
 
     acquire(&spi->lock);
+
+    /* The bus is ours once the queue empties */
+    stm32f4_spi_drain(spi);
+
     cs_ops->set_output_value(dev->cs, 0);
     dev->extended_transaction = 1;
 }
@@ -354,6 +732,7 @@ struct spi_ops stm32f4_spi_ops = {
     .write = stm32f4_spi_write,
     .start_transaction = stm32f4_spi_start_transaction,
     .end_transaction = stm32f4_spi_end_transaction,
+    .transfer = stm32f4_spi_transfer,
 };
 
 static int stm32f4_spi_probe(const char *name) {
@@ -361,13 +740,14 @@ static int stm32f4_spi_probe(const char *name) {
     int offset;
 
     /* Lookup peripheral node */
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
     /* Check that peripheral is compatible with driver */
-    return fdt_node_check_compatible(blob, offset, STM32F4_SPI_COMPAT) == 0;
+    return fdtparse_node_check_compatible(blob, offset,
+                                          STM32F4_SPI_COMPAT) == 0;
 }
 
 static struct obj *stm32f4_spi_ctor(const char *name) {
@@ -379,12 +759,12 @@ static struct obj *stm32f4_spi_ctor(const char *name) {
     struct stm32f4_spi *port;
     enum stm32f4_bus bus;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, STM32F4_SPI_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, STM32F4_SPI_COMPAT)) {
         return NULL;
     }
 
@@ -475,6 +855,38 @@ static struct obj *stm32f4_spi_ctor(const char *name) {
         port->gpio[i] = gpio;
     }
 
+    /* Without both streams, transfers are done on the CPU */
+    err = stm32f4_dma_allocate(blob, offset, "rx", &port->rx_dma,
+                               &port->rx_handle);
+    if (!err) {
+        err = stm32f4_dma_allocate(blob, offset, "tx", &port->tx_dma,
+                                   &port->tx_handle);
+        if (err) {
+            stm32f4_dma_deallocate(port->rx_dma, port->rx_handle);
+        }
+    }
+
+    if (!err) {
+        struct stm32f4_dma_ops *rx_ops = port->rx_dma->obj.ops;
+
+        err = rx_ops->set_callback(port->rx_dma, port->rx_handle,
+                                   STM32F4_DMA_EVENT_TC |
+                                   STM32F4_DMA_EVENT_TE,
+                                   stm32f4_spi_dma_callback, spi);
+        if (err) {
+            stm32f4_dma_deallocate(port->tx_dma, port->tx_handle);
+            stm32f4_dma_deallocate(port->rx_dma, port->rx_handle);
+        }
+    }
+
+    if (!err) {
+        port->rx_irq = stm32f4_dma_irq(port->rx_dma, port->rx_handle);
+    }
+    else {
+        port->rx_dma = NULL;
+        port->tx_dma = NULL;
+    }
+
     /* Export to the OS */
     class_export_member(obj);
 
@@ -33,19 +33,13 @@ static void std_setup_packet(struct usbdev_setup_packet *setup);
 static void cdc_setup_packet(struct usbdev_setup_packet *setup);
 static void cdc_set_configuration(uint16_t configuration);
 
-void usbdev_setup(struct ring_buffer *packet, uint32_t len) {
+void usbdev_setup(struct ring *packet, uint32_t len) {
     uint8_t buf[8];
-    for (int i = 0; i < 8; i++) {
-        if (ring_buf_empty(packet)) {
-            break;
-        }
-        buf[i] = packet->buf[packet->start];
-        packet->start = (packet->start + 1) % packet->len;
-    }
+
+    ring_pop_n(packet, buf, sizeof(buf));
 
     /* Clear ring buffer */
-    packet->start = 0;
-    packet->end = 0;
+    ring_flush(packet);
 
     struct usbdev_setup_packet *setup = (struct usbdev_setup_packet *) buf;
 
@@ -153,22 +147,16 @@ static void cdc_set_configuration(uint16_t configuration) {
     endpoints[USB_CDC_TX_ENDPOINT] = &ep_tx;
 
     if (endpoints[1]) {
-        endpoints[1]->tx.buf = ep_tx_buf[1];
-        endpoints[1]->tx.len = 4*USB_TX1_FIFO_SIZE;
-        endpoints[1]->tx.start = 0;
-        endpoints[1]->tx.end = 0;
+        ring_init(&endpoints[1]->tx, ep_tx_buf[1], 4*USB_TX1_FIFO_SIZE);
+        usbdev_tx_reset(endpoints[1]);
     }
     if (endpoints[2]) {
-        endpoints[2]->tx.buf = ep_tx_buf[2];
-        endpoints[2]->tx.len = 4*USB_TX2_FIFO_SIZE;
-        endpoints[2]->tx.start = 0;
-        endpoints[2]->tx.end = 0;
+        ring_init(&endpoints[2]->tx, ep_tx_buf[2], 4*USB_TX2_FIFO_SIZE);
+        usbdev_tx_reset(endpoints[2]);
     }
     if (endpoints[3]) {
-        endpoints[3]->tx.buf = ep_tx_buf[3];
-        endpoints[3]->tx.len = 4*USB_TX3_FIFO_SIZE;
-        endpoints[3]->tx.start = 0;
-        endpoints[3]->tx.end = 0;
+        ring_init(&endpoints[3]->tx, ep_tx_buf[3], 4*USB_TX3_FIFO_SIZE);
+        usbdev_tx_reset(endpoints[3]);
     }
 
     usb_ready = 1;
@@ -22,6 +22,7 @@
 
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <dev/char.h>
 #include <dev/device.h>
 #include <dev/hw/usbdev.h>
@@ -48,7 +49,7 @@ static int usb_write(struct char_device *dev, const char *buf, size_t num) {
 
     acquire(&usb->write_mutex);
 
-    ret = usbdev_write(&ep_tx, (const uint8_t*)buf, num);
+    ret = usbdev_bulk_write(&ep_tx, (const uint8_t*)buf, num);
 
     release(&usb->write_mutex);
 
@@ -67,14 +68,24 @@ static int usb_read(struct char_device *dev, char *buf, size_t num) {
 
     acquire(&usb->read_mutex);
 
-    for (int i = 0; i < num; i++) {
-        if (ring_buf_empty(&ep_rx.rx)) {
+    /* Copy out of contiguous spans, releasing space for the next packet */
+    while (num > 0) {
+        uint8_t *span;
+        uint32_t n = usbdev_read_span(&ep_rx, &span);
+
+        if (!n) {
             break;
         }
+        if (n > num) {
+            n = num;
+        }
+
+        memcpy(buf, span, n);
+        usbdev_read_commit(&ep_rx, n);
 
-        buf[i] = (char) ep_rx.rx.buf[ep_rx.rx.start];
-        ep_rx.rx.start = (ep_rx.rx.start + 1) % ep_rx.rx.len;
-        total++;
+        buf += n;
+        num -= n;
+        total += n;
     }
 
     release(&usb->read_mutex);
@@ -23,6 +23,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <kernel/fault.h>
 #include <kernel/sched.h>
 #include <arch/system.h>
@@ -53,26 +54,25 @@ int usbdev_write(struct endpoint *ep, const uint8_t *packet, int size) {
     }
 
     /* Wait until current buffer is empty */
-    while (!ring_buf_empty(&ep->tx)) {
+    while (!ring_empty(&ep->tx)) {
         yield_if_possible();
     }
 
     int filled_buffer = 0;
-    int written = 0;
+    int written;
 
     /* Copy to ring buffer */
-    while (size > 0 && !ring_buf_full(&ep->tx)) {
-        ep->tx.buf[ep->tx.end] = *packet++;
-        size--;
-        written++;
+    written = ring_push_n(&ep->tx, packet, size);
+    packet += written;
+    size -= written;
 
-        ep->tx.end = (ep->tx.end + 1) % ep->tx.len;
-    }
-
-    if (ring_buf_full(&ep->tx)) {
+    if (ring_full(&ep->tx)) {
         filled_buffer = 1;
     }
 
+    /* Bound the FIFO writes to this transfer */
+    ep->tx_inflight = written;
+
     uint8_t packets = written % ep->mpsize ? written/ep->mpsize + 1 : written/ep->mpsize;
     if (!packets) {
         packets = 1;
@@ -142,7 +142,142 @@ int usbdev_write(struct endpoint *ep, const uint8_t *packet, int size) {
     return written;
 }
 
-void usbdev_fifo_read(volatile struct ring_buffer *ring, int size) {
+/*
+ * Program the next IN transfer from everything queued in the tx ring
+ *
+ * Data queued while a transfer is in flight is coalesced into the next
+ * one, so a stream of small writes still goes out as full packets.
+ * Must be called from the USB interrupt, or with it masked.
+ */
+static void usbdev_tx_start(struct endpoint *ep) {
+    uint32_t len = ring_count(&ep->tx);
+    uint32_t packets;
+
+    if (ep->tx_busy) {
+        return;
+    }
+
+    if (!len) {
+        if (!ep->tx_zlp) {
+            return;
+        }
+
+        /* Terminate a transfer which ended on a full packet */
+        ep->tx_zlp = 0;
+        ep->tx_busy = 1;
+        *USB_FS_DIEPTSIZ(ep->num) = USB_FS_DIEPTSIZx_PKTCNT(1) | USB_FS_DIEPTSIZx_XFRSIZ(0);
+        *USB_FS_DIEPCTL(ep->num) |= USB_FS_DIEPCTLx_CNAK | USB_FS_DIEPCTLx_EPENA;
+        return;
+    }
+
+    packets = (len + ep->mpsize - 1) / ep->mpsize;
+
+    ep->tx_inflight = len;
+    ep->tx_zlp = !(len % ep->mpsize);
+    ep->tx_busy = 1;
+
+    *USB_FS_DIEPTSIZ(ep->num) = USB_FS_DIEPTSIZx_PKTCNT(packets) | USB_FS_DIEPTSIZx_XFRSIZ(len);
+    *USB_FS_DIEPCTL(ep->num) |= USB_FS_DIEPCTLx_CNAK | USB_FS_DIEPCTLx_EPENA;
+
+    /* Packets are loaded as the FIFO empties */
+    *USB_FS_DIEPEMPMSK |= (1 << ep->num);
+}
+
+/* IN transfer complete, start the next one if anything was queued */
+void usbdev_tx_complete(struct endpoint *ep) {
+    if (ep == NULL || ep->num == 0) {
+        return;
+    }
+
+    ep->tx_busy = 0;
+    usbdev_tx_start(ep);
+}
+
+/* Forget any queued or in flight IN data, on (re)configuration */
+void usbdev_tx_reset(struct endpoint *ep) {
+    ep->tx_inflight = 0;
+    ep->tx_busy = 0;
+    ep->tx_zlp = 0;
+    ep->rx_paused = 0;
+}
+
+/*
+ * Queue data on a bulk IN endpoint
+ *
+ * Data is copied straight into the tx ring, behind any transfer still in
+ * flight, and the endpoint is started if it was idle.  Only waits when the
+ * ring is full.
+ *
+ * Returns bytes written, negative on error
+ */
+int usbdev_bulk_write(struct endpoint *ep, const uint8_t *buf, int size) {
+    int total = 0;
+
+    if (ep == NULL || ep->num == 0) {
+        DEBUG_PRINT("Warning: Invalid endpoint in usbdev_bulk_write. ");
+        return -1;
+    }
+    if (ep->tx.buf == NULL) {
+        DEBUG_PRINT("Warning: Endpoint has no tx buffer in usbdev_bulk_write. ");
+        return -1;
+    }
+
+    while (size > 0) {
+        uint8_t *span;
+        uint32_t n;
+
+        if (!usb_ready) {
+            break;
+        }
+
+        n = ring_write_span(&ep->tx, &span);
+        if (!n) {
+            /* Wait for the FIFO to take a packet */
+            yield_if_possible();
+            continue;
+        }
+
+        if (n > (uint32_t) size) {
+            n = size;
+        }
+
+        memcpy(span, buf, n);
+        ring_write_commit(&ep->tx, n);
+
+        buf += n;
+        size -= n;
+        total += n;
+
+        nvic_disable_irq(USBDEV_IRQ);
+        usbdev_tx_start(ep);
+        nvic_enable_irq(USBDEV_IRQ);
+    }
+
+    return total ? total : (usb_ready ? 0 : -1);
+}
+
+/*
+ * Get contiguous received data to read in place
+ *
+ * Returns bytes which may be read at span
+ */
+uint32_t usbdev_read_span(struct endpoint *ep, uint8_t **span) {
+    return ring_read_span(&ep->rx, span);
+}
+
+/* Release received data, and resume the endpoint once a packet fits */
+void usbdev_read_commit(struct endpoint *ep, uint32_t n) {
+    ring_read_commit(&ep->rx, n);
+
+    if (ep->rx_paused && ring_space(&ep->rx) >= ep->mpsize) {
+        nvic_disable_irq(USBDEV_IRQ);
+        ep->rx_paused = 0;
+        usbdev_enable_receive(ep);
+        nvic_enable_irq(USBDEV_IRQ);
+    }
+}
+
+void usbdev_fifo_read(struct ring *ring, int size) {
     int words = (size+3)/4;
 
     /* Allow us to read into NULL */
@@ -160,24 +295,22 @@ void usbdev_fifo_read(volatile struct ring_buffer *ring, int size) {
     else {
         while (words > 0 && size > 0) {
             union uint8_uint32 data;
+            uint8_t *span;
+            int bytes = size < 4 ? size : 4;
+
             data.uint32 = *USB_FS_DFIFO_EP(0);
             words--;
 
-            for (int i = 0; i < 4; i++) {
-                if (size <= 0) {
-                    data.uint8[i] = 0;
-                    continue;
-                }
-
-                ring->buf[ring->end] = data.uint8[i];
-                size--;
-
-                if (ring_buf_full(ring)) {
-                    DEBUG_PRINT("Warning: USB: Buffer full.\r\n");
-                    ring->start = (ring->start + 1) % ring->len;
-                }
-                ring->end = (ring->end + 1) % ring->len;
+            /* Store straight into the ring, unless the word wraps */
+            if (ring_write_span(ring, &span) >= (uint32_t) bytes) {
+                memcpy(span, data.uint8, bytes);
+                ring_write_commit(ring, bytes);
+            }
+            /* The reader owns the tail, so drop new data when full */
+            else if (ring_push_n(ring, data.uint8, bytes) < (uint32_t) bytes) {
+                DEBUG_PRINT("Warning: USB: Buffer full.\r\n");
             }
+            size -= bytes;
         }
     }
 }
@@ -194,6 +327,49 @@ void usbdev_data_out(uint32_t status) {
     usbdev_fifo_read(&ep->rx, size);
 }
 
+/*
+ * Write bytes of the tx ring to the endpoint FIFO
+ *
+ * Whole words are loaded directly from the ring.  Only a word split by
+ * the end of the ring, or the short final word of a packet, is staged,
+ * the latter padded with zeros.
+ */
+static void usbdev_fifo_write(struct endpoint *ep, uint32_t bytes) {
+    volatile uint32_t *fifo = USB_FS_DFIFO_EP(ep->num);
+
+    while (bytes > 0) {
+        uint8_t *span;
+        uint32_t n = ring_read_span(&ep->tx, &span);
+        uint32_t words;
+
+        if (n > bytes) {
+            n = bytes;
+        }
+
+        words = n / 4;
+        if (words) {
+            for (uint32_t i = 0; i < words; i++) {
+                uint32_t data;
+
+                memcpy(&data, &span[4*i], sizeof(data));
+                *fifo = data;
+            }
+
+            ring_read_commit(&ep->tx, 4*words);
+            bytes -= 4*words;
+        }
+        else {
+            union uint8_uint32 data;
+            uint32_t chunk = bytes < 4 ? bytes : 4;
+
+            data.uint32 = 0;
+            ring_pop_n(&ep->tx, data.uint8, chunk);
+            *fifo = data.uint32;
+            bytes -= chunk;
+        }
+    }
+}
+
 void usbdev_data_in(struct endpoint *ep) {
     if (ep == NULL) {
         DEBUG_PRINT("Warning: Invalid endpoint in usbdev_data_in. ");
@@ -204,33 +380,25 @@ void usbdev_data_in(struct endpoint *ep) {
         return;
     }
 
-    DEBUG_PRINT("Writing FIFO %d: ", ep->num);
+    DEBUG_PRINT("Writing FIFO %d. ", ep->num);
 
-    /* Write until buffer empty */
-    int written = 0;
-    int space = *USB_FS_DTXFSTS(ep->num);
-    while (written < space && !ring_buf_empty(&ep->tx)) {
-        union uint8_uint32 data;
-        data.uint32 = 0;
+    /* Load whole packets while the FIFO has room for them */
+    uint32_t space = *USB_FS_DTXFSTS(ep->num) & 0xffff;
+    while (ep->tx_inflight) {
+        uint32_t bytes = ep->tx_inflight < ep->mpsize ? ep->tx_inflight : ep->mpsize;
+        uint32_t words = (bytes + 3) / 4;
 
-        for (int i = 0; i < 4; i++) {
-            if (!ring_buf_empty(&ep->tx)) {
-                data.uint8[i] = ep->tx.buf[ep->tx.start];
-                ep->tx.start = (ep->tx.start + 1) % ep->tx.len;
-            }
-            else {
-                data.uint8[i] = 0;
-            }
+        if (words > space) {
+            break;
         }
 
-        DEBUG_PRINT("0x%x ", data.uint32);
-
-        *USB_FS_DFIFO_EP(ep->num) = data.uint32;
-        written++;
+        usbdev_fifo_write(ep, bytes);
+        ep->tx_inflight -= bytes;
+        space -= words;
     }
 
-    /* Only disable interrupt once all data has been written */
-    if (ring_buf_empty(&ep->tx)) {
+    /* Only disable interrupt once the whole transfer has been written */
+    if (!ep->tx_inflight) {
         *USB_FS_DIEPEMPMSK &= ~(1 << ep->num);
     }
 }
@@ -253,6 +421,12 @@ void usbdev_enable_receive(struct endpoint *ep) {
         *USB_FS_DOEPCTL0 |= USB_FS_DOEPCTL0_CNAK | USB_FS_DOEPCTL0_EPENA;
     }
     else {
+        /* NAK the host until a whole packet fits, rather than drop it */
+        if (ep->rx.buf && ring_space(&ep->rx) < ep->mpsize) {
+            ep->rx_paused = 1;
+            return;
+        }
+
         *USB_FS_DOEPTSIZ(ep->num) = USB_FS_DOEPTSIZx_XFRSIZ(ep->mpsize) | USB_FS_DOEPTSIZx_PKTCNT(1);
         *USB_FS_DOEPCTL(ep->num) |= USB_FS_DOEPCTLx_CNAK | USB_FS_DOEPCTLx_EPENA;
     }
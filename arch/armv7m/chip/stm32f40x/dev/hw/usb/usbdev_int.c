@@ -30,14 +30,9 @@
 #include <dev/hw/usbdev.h>
 
 /* Setup packet buffer */
-uint8_t setup_buf[3*4];
+uint8_t setup_buf[16];
 
-struct ring_buffer setup_packet = {
-    .buf = setup_buf,
-    .len = sizeof(setup_buf)/sizeof(setup_buf[0]),
-    .start = 0,
-    .end = 0
-};
+struct ring setup_packet = INIT_RING(setup_buf, sizeof(setup_buf));
 
 /* Global interrupt handlers */
 static void gint_mmis(void);
@@ -269,6 +264,9 @@ static void gint_iepint(void) {
         if (interrupts & USB_FS_DIEPINTx_XFRC) {
             *USB_FS_DIEPINT(i) = USB_FS_DIEPINTx_XFRC;
             DEBUG_PRINT("Transfer complete. ");
+
+            /* Chain the next transfer queued behind this one */
+            usbdev_tx_complete(endpoints[i]);
         }
         if (interrupts & USB_FS_DIEPINTx_EPDISD) {
             *USB_FS_DIEPINT(i) = USB_FS_DIEPINTx_EPDISD;
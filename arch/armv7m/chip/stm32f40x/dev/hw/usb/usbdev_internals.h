@@ -23,6 +23,11 @@
 #ifndef USBDEV_INTERNALS_H_INCLUDED
 #define USBDEV_INTERNALS_H_INCLUDED
 
+#include <ring.h>
+
+/* NVIC interrupt number of the OTG FS global interrupt */
+#define     USBDEV_IRQ                                      (67)
+
 #define     USB_VERSION_1_1                                 (0x110)
 #define     USB_CLASS_CDC                                   (0x02)
 #define     USB_CLASS_CDC_DATA                              (0x0A)
@@ -203,49 +208,34 @@ struct __attribute__((packed)) usb_cdc_acm_union_functional_descriptor {
     uint8_t     bSlaveInterface0;
 };
 
-/* Ring buffer semantics always leave one space empty.
- * If start == end, buffer is empty */
-struct ring_buffer {
-    volatile uint8_t    *buf;
-    volatile int        len;
-    volatile int        start;
-    volatile int        end;
-};
-
 struct endpoint {
     uint8_t             num;
     uint8_t             dir;
     uint16_t            mpsize;
-    volatile struct ring_buffer  rx;
-    volatile struct ring_buffer  tx;
+    struct ring         rx;
+    struct ring         tx;
     volatile uint8_t    request_disable;
+    /* Bytes of the programmed IN transfer not yet written to the FIFO */
+    volatile uint32_t   tx_inflight;
+    /* IN transfer programmed and not yet complete */
+    volatile uint8_t    tx_busy;
+    /* Last IN transfer ended on a full packet, and needs a ZLP */
+    volatile uint8_t    tx_zlp;
+    /* OUT endpoint left NAKing until rx has space for a packet */
+    volatile uint8_t    rx_paused;
 };
 
 void usbdev_reset(void);
 int usbdev_write(struct endpoint *ep, const uint8_t *packet, int size);
-void usbdev_fifo_read(volatile struct ring_buffer *ring, int size);
+int usbdev_bulk_write(struct endpoint *ep, const uint8_t *buf, int size);
+void usbdev_tx_complete(struct endpoint *ep);
+void usbdev_tx_reset(struct endpoint *ep);
+uint32_t usbdev_read_span(struct endpoint *ep, uint8_t **span);
+void usbdev_read_commit(struct endpoint *ep, uint32_t n);
+void usbdev_fifo_read(struct ring *ring, int size);
 void usbdev_data_out(uint32_t status);
 void usbdev_data_in(struct endpoint *ep);
 void usbdev_status_in_packet(void);
 void usbdev_enable_receive(struct endpoint *ep);
 
-inline static int ring_buf_full(volatile struct ring_buffer *ring);
-inline static int ring_buf_full(volatile struct ring_buffer *ring) {
-    if (ring->start - ring->end == 1) {
-        return 1;
-    }
-    if (ring->start == 0 && ring->end == (ring->len-1)) {
-        return 1;
-    }
-    return 0;
-}
-
-inline static int ring_buf_empty(volatile struct ring_buffer *ring);
-inline static int ring_buf_empty(volatile struct ring_buffer *ring) {
-    if (ring->start == ring->end) {
-        return 1;
-    }
-    return 0;
-}
-
 #endif
@@ -22,6 +22,7 @@
 
 #include <libfdt.h>
 #include <stdlib.h>
+#include <arch/system.h>
 #include <arch/chip/dma.h>
 #include <arch/chip/rcc.h>
 #include <dev/device.h>
@@ -34,6 +35,25 @@
 
 #define STM32F4_DMA_COMPAT "stmicro,stm32f407-dma"
 
+/* NVIC interrupt number of each stream, for DMA1 and DMA2 */
+static const uint8_t stream_irqs[2][8] = {
+    {11, 12, 13, 14, 15, 16, 17, 47},
+    {56, 57, 58, 59, 60, 68, 69, 70},
+};
+
+/* Controllers by index, for the stream interrupt handlers */
+static struct stm32f4_dma *controllers[2];
+
+static int controller_index(struct stm32f4_dma *dma) {
+    return dma->periph_id == STM32F4_PERIPH_DMA2;
+}
+
+/*
+ * Each stream has six flag bits in LISR/HISR, with streams 0-3 (and 4-7)
+ * at these offsets.  Within them, TEIF is bit 3, HTIF bit 4, TCIF bit 5.
+ */
+static const uint8_t stream_flag_shift[4] = {0, 6, 16, 22};
+
 /* Upper byte is stream, lower byte is channel */
 static stm32f4_dma_handle_t handle_create(uint8_t stream, uint8_t channel) {
     return ((stream & 0xff) << 8) | (channel & 0xff);
@@ -66,6 +86,13 @@ static uint32_t stream_transaction_complete(struct stm32f4_dma *dma, uint8_t str
     }
 }
 
+static uint32_t stream_transfer_error(struct stm32f4_dma *dma, uint8_t stream) {
+    volatile uint32_t *isr = stream < 4 ? &dma->regs->LISR : &dma->regs->HISR;
+
+    /* TEIF is bit 3 of each stream's flags */
+    return raw_mem_read(isr) & (1 << (stream_flag_shift[stream % 4] + 3));
+}
+
 static void stream_clear_flags(struct stm32f4_dma *dma, uint8_t stream) {
     switch (stream) {
     case 0:
@@ -119,6 +146,20 @@ static void stream_clear_flags(struct stm32f4_dma *dma, uint8_t stream) {
     }
 }
 
+/*
+ * Disable stream and wait for it to stop
+ *
+ * The stream ignores writes to its configuration while enabled, and keeps
+ * transferring until EN reads back clear.
+ */
+static void stream_disable(struct stm32f4_dma *dma, uint8_t stream) {
+    raw_mem_clear_bits(&dma->regs->stream[stream].CR, DMA_SxCR_EN);
+
+    while (raw_mem_read(&dma->regs->stream[stream].CR) & DMA_SxCR_EN) {
+        /* TODO: timeout */
+    }
+}
+
 static stm32f4_dma_handle_t stm32f4_dma_class_allocate(struct stm32f4_dma *dma,
                                                        uint8_t stream,
                                                        uint8_t channel) {
@@ -185,13 +226,12 @@ static int stm32f4_dma_class_deallocate(struct stm32f4_dma *dma,
 
     acquire(&dma->lock);
 
-    /* Disable stream */
-    raw_mem_clear_bits(&dma->regs->stream[stream].CR, DMA_SxCR_EN);
+    stream_disable(dma, stream);
 
-    /* Wait for stream to disable */
-    while (raw_mem_read(&dma->regs->stream[stream].CR) & DMA_SxCR_EN) {
-        /* TODO: timeout */
-    }
+    /* Drop any interrupt callback */
+    nvic_disable_irq(stream_irqs[controller_index(dma)][stream]);
+    dma->callbacks[stream].func = NULL;
+    dma->callbacks[stream].data = NULL;
 
     /* Release stream */
     dma->streams_in_use[stream] = 0;
@@ -215,6 +255,9 @@ static int stm32f4_dma_class_configure(struct stm32f4_dma *dma,
         return -1;
     }
 
+    /* An enabled stream would ignore the new configuration */
+    stream_disable(dma, stream);
+
     switch (config->direction) {
     case STM32F4_DMA_DIR_PERIPH_TO_MEM:
         raw_mem_set_mask(&dma->regs->stream[stream].CR,
@@ -333,12 +376,7 @@ static int stm32f4_dma_class_begin_transaction(struct stm32f4_dma *dma,
     }
 
     /* Cancel any ongoing transactions */
-    raw_mem_clear_bits(&dma->regs->stream[stream].CR, DMA_SxCR_EN);
-
-    /* Wait for stream to disable */
-    while (raw_mem_read(&dma->regs->stream[stream].CR) & DMA_SxCR_EN) {
-        /* TODO: timeout */
-    }
+    stream_disable(dma, stream);
 
     /* Clear stream events */
     stream_clear_flags(dma, stream);
@@ -351,6 +389,25 @@ static int stm32f4_dma_class_begin_transaction(struct stm32f4_dma *dma,
     return 0;
 }
 
+static int stm32f4_dma_class_end_transaction(struct stm32f4_dma *dma,
+                                             stm32f4_dma_handle_t handle) {
+    uint8_t stream = handle_stream(handle);
+
+    if (!dma) {
+        return -1;
+    }
+
+    /* Stream in range? */
+    if (stream > 7) {
+        return -1;
+    }
+
+    stream_disable(dma, stream);
+    stream_clear_flags(dma, stream);
+
+    return 0;
+}
+
 static int stm32f4_dma_class_transaction_complete(struct stm32f4_dma *dma,
                                                   stm32f4_dma_handle_t handle) {
     uint8_t stream = handle_stream(handle);
@@ -365,6 +422,12 @@ static int stm32f4_dma_class_transaction_complete(struct stm32f4_dma *dma,
         return -1;
     }
 
+    /* The stream disables itself on error, so it will never complete */
+    if (stream_transfer_error(dma, stream)) {
+        stream_clear_flags(dma, stream);
+        return -1;
+    }
+
     complete = stream_transaction_complete(dma, stream);
 
     if (complete) {
@@ -394,15 +457,128 @@ static int stm32f4_dma_class_items_remaining(struct stm32f4_dma *dma,
     return items;
 }
 
+static int stm32f4_dma_class_set_callback(struct stm32f4_dma *dma,
+                                          stm32f4_dma_handle_t handle,
+                                          uint32_t events,
+                                          stm32f4_dma_callback_t func,
+                                          void *data) {
+    uint8_t stream = handle_stream(handle);
+    uint8_t irq;
+    uint32_t interrupts = 0;
+
+    if (!dma) {
+        return -1;
+    }
+
+    /* Stream in range? */
+    if (stream > 7) {
+        return -1;
+    }
+
+    irq = stream_irqs[controller_index(dma)][stream];
+
+    /* Quiesce the stream interrupt while the callback changes */
+    nvic_disable_irq(irq);
+    raw_mem_clear_bits(&dma->regs->stream[stream].CR,
+                       DMA_SxCR_TCIE | DMA_SxCR_HTIE | DMA_SxCR_TEIE);
+
+    dma->callbacks[stream].func = func;
+    dma->callbacks[stream].data = data;
+
+    if (!func) {
+        return 0;
+    }
+
+    if (events & STM32F4_DMA_EVENT_TC) {
+        interrupts |= DMA_SxCR_TCIE;
+    }
+    if (events & STM32F4_DMA_EVENT_HT) {
+        interrupts |= DMA_SxCR_HTIE;
+    }
+    if (events & STM32F4_DMA_EVENT_TE) {
+        interrupts |= DMA_SxCR_TEIE;
+    }
+
+    raw_mem_set_bits(&dma->regs->stream[stream].CR, interrupts);
+    nvic_enable_irq(irq);
+
+    return 0;
+}
+
 static struct stm32f4_dma_ops stm32f4_dma_ops = {
     .allocate = stm32f4_dma_class_allocate,
     .deallocate = stm32f4_dma_class_deallocate,
     .configure = stm32f4_dma_class_configure,
     .begin_transaction = stm32f4_dma_class_begin_transaction,
+    .end_transaction = stm32f4_dma_class_end_transaction,
     .transaction_complete = stm32f4_dma_class_transaction_complete,
     .items_remaining = stm32f4_dma_class_items_remaining,
+    .set_callback = stm32f4_dma_class_set_callback,
 };
 
+static void stm32f4_dma_stream_irq(int index, uint8_t stream) {
+    struct stm32f4_dma *dma = controllers[index];
+    volatile uint32_t *isr, *ifcr;
+    uint32_t flags, events = 0;
+    uint8_t shift = stream_flag_shift[stream % 4];
+
+    if (!dma) {
+        return;
+    }
+
+    if (stream < 4) {
+        isr = &dma->regs->LISR;
+        ifcr = &dma->regs->LIFCR;
+    }
+    else {
+        isr = &dma->regs->HISR;
+        ifcr = &dma->regs->HIFCR;
+    }
+
+    flags = (raw_mem_read(isr) >> shift) & 0x3d;
+
+    /* Clear only the flags we saw, so no new events are lost */
+    raw_mem_write(ifcr, flags << shift);
+
+    if (flags & (1 << 5)) {
+        events |= STM32F4_DMA_EVENT_TC;
+    }
+    if (flags & (1 << 4)) {
+        events |= STM32F4_DMA_EVENT_HT;
+    }
+    if (flags & (1 << 3)) {
+        events |= STM32F4_DMA_EVENT_TE;
+    }
+
+    if (events && dma->callbacks[stream].func) {
+        dma->callbacks[stream].func(dma->callbacks[stream].data, events);
+    }
+}
+
+#define DMA_STREAM_HANDLER(controller, stream)                              \
+    void dma##controller##_stream##stream##_handler(void)                   \
+        __attribute__((section(".kernel")));                                \
+    void dma##controller##_stream##stream##_handler(void) {                 \
+        stm32f4_dma_stream_irq(controller - 1, stream);                     \
+    }
+
+DMA_STREAM_HANDLER(1, 0)
+DMA_STREAM_HANDLER(1, 1)
+DMA_STREAM_HANDLER(1, 2)
+DMA_STREAM_HANDLER(1, 3)
+DMA_STREAM_HANDLER(1, 4)
+DMA_STREAM_HANDLER(1, 5)
+DMA_STREAM_HANDLER(1, 6)
+DMA_STREAM_HANDLER(1, 7)
+DMA_STREAM_HANDLER(2, 0)
+DMA_STREAM_HANDLER(2, 1)
+DMA_STREAM_HANDLER(2, 2)
+DMA_STREAM_HANDLER(2, 3)
+DMA_STREAM_HANDLER(2, 4)
+DMA_STREAM_HANDLER(2, 5)
+DMA_STREAM_HANDLER(2, 6)
+DMA_STREAM_HANDLER(2, 7)
+
 static void stm32f4_dma_dtor(struct obj *o);
 
 static struct obj_type stm32f4_dma_type = {
@@ -419,13 +595,14 @@ static int stm32f4_dma_probe(const char *name) {
     int offset;
 
     /* Lookup peripheral node */
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
     /* Check that peripheral is compatible with driver */
-    return fdt_node_check_compatible(blob, offset, STM32F4_DMA_COMPAT) == 0;
+    return fdtparse_node_check_compatible(blob, offset,
+                                          STM32F4_DMA_COMPAT) == 0;
 }
 
 static struct obj *stm32f4_dma_ctor(const char *name) {
@@ -435,12 +612,12 @@ static struct obj *stm32f4_dma_ctor(const char *name) {
     struct stm32f4_dma *stm32f4_dma;
     struct stm32f4_dma_regs *regs;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, STM32F4_DMA_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, STM32F4_DMA_COMPAT)) {
         return NULL;
     }
 
@@ -476,6 +653,7 @@ static struct obj *stm32f4_dma_ctor(const char *name) {
     init_mutex(&stm32f4_dma->lock);
     memset(stm32f4_dma->streams_in_use, 0,
            sizeof(stm32f4_dma->streams_in_use));
+    memset(stm32f4_dma->callbacks, 0, sizeof(stm32f4_dma->callbacks));
 
     /* Enable clock */
     err = rcc_set_clock_enable(periph_id, 1);
@@ -483,6 +661,8 @@ static struct obj *stm32f4_dma_ctor(const char *name) {
         goto err_free_obj;
     }
 
+    controllers[controller_index(stm32f4_dma)] = stm32f4_dma;
+
     /* Export to the OS */
     class_export_member(obj);
 
@@ -500,6 +680,8 @@ static void stm32f4_dma_dtor(struct obj *o) {
     assert_type(o, &stm32f4_dma_type);
     stm32f4_dma = to_stm32f4_dma(o);
 
+    controllers[controller_index(stm32f4_dma)] = NULL;
+
     /* Disable clock */
     rcc_set_clock_enable(stm32f4_dma->periph_id, 0);
 
@@ -530,7 +712,7 @@ static int try_dma_allocate(const void *fdt, int phandle, int stream,
     struct obj *obj;
     struct stm32f4_dma_ops *ops;
 
-    offset = fdt_node_offset_by_phandle(fdt, phandle);
+    offset = fdtparse_node_offset_by_phandle(fdt, phandle);
     if (offset < 0) {
         return offset;
     }
@@ -627,6 +809,16 @@ int stm32f4_dma_allocate(const void *fdt, int offset, const char *name,
     return 0;
 }
 
+int stm32f4_dma_irq(struct stm32f4_dma *dma, stm32f4_dma_handle_t handle) {
+    uint8_t stream = handle_stream(handle);
+
+    if (!dma || stream > 7) {
+        return -1;
+    }
+
+    return stream_irqs[controller_index(dma)][stream];
+}
+
 int stm32f4_dma_deallocate(struct stm32f4_dma *dma,
                            stm32f4_dma_handle_t handle) {
     struct stm32f4_dma_ops *ops;
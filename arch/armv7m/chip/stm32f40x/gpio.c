@@ -23,8 +23,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <arch/system.h>
 #include <arch/chip/gpio.h>
 #include <arch/chip/periph.h>
+#include <arch/chip/rcc.h>
 #include <arch/chip/registers.h>
 #include <dev/hw/gpio.h>
 #include <kernel/class.h>
@@ -115,6 +117,59 @@ static struct stm32f4_gpio stm32f4_gpio_decode(uint32_t num) {
     return gpio;
 }
 
+/*
+ * EXTI lines
+ *
+ * Pin n of every port shares EXTI line n, so only one port may use each
+ * line at a time.  Lines 0-4 have their own IRQ, while lines 5-9 and
+ * 10-15 share one each.
+ */
+#define STM32F4_NUM_EXTI_LINES  16
+
+static const uint8_t stm32f4_exti_irqs[STM32F4_NUM_EXTI_LINES] = {
+    6, 7, 8, 9, 10, 23, 23, 23, 23, 23, 40, 40, 40, 40, 40, 40,
+};
+
+struct stm32f4_exti_line {
+    struct gpio *gpio;
+    void        (*handler)(struct gpio *, void *);
+    void        *data;
+};
+
+static struct stm32f4_exti_line stm32f4_exti_lines[STM32F4_NUM_EXTI_LINES];
+
+/* Atomically clear then set bits in an EXTI or SYSCFG register */
+static inline void stm32f4_exti_modify(volatile uint32_t *reg, uint32_t clear,
+                                       uint32_t set) {
+    uint32_t val;
+
+    do {
+        val = load_link(reg);
+        val &= ~clear;
+        val |= set;
+    } while (store_conditional(reg, val));
+}
+
+/* Mask and forget the EXTI line of g, if it owns it */
+static void stm32f4_gpio_irq_disable(struct gpio *g) {
+    struct stm32f4_gpio gpio = stm32f4_gpio_decode(g->num);
+    struct stm32f4_exti_line *line = &stm32f4_exti_lines[gpio.pin];
+    uint32_t bit = 1 << gpio.pin;
+
+    if (line->gpio != g) {
+        return;
+    }
+
+    stm32f4_exti_modify(EXTI_IMR, bit, 0);
+    stm32f4_exti_modify(EXTI_RTSR, bit, 0);
+    stm32f4_exti_modify(EXTI_FTSR, bit, 0);
+    *EXTI_PR = bit;
+
+    line->handler = NULL;
+    line->data = NULL;
+    line->gpio = NULL;
+}
+
 /*
  * Set to standard reset values:
  * input, push-pull, low speed, no pull up/down
@@ -127,6 +182,8 @@ static int stm32f4_gpio_reset(struct gpio *g) {
     gpio_ospeedr(gpio.port, gpio.pin, GPIO_OSPEEDR_2M);
     gpio_pupdr(gpio.port, gpio.pin, GPIO_PUPDR_NONE);
 
+    stm32f4_gpio_irq_disable(g);
+
     g->active_low = 0;
 
     return 0;
@@ -270,8 +327,104 @@ static int stm32f4_gpio_set_flags(struct gpio *g, unsigned int flag, int val) {
     }
 }
 
+/*
+ * Route the pin to its EXTI line and unmask it.
+ *
+ * The edges are fixed when the interrupt is set, so changing active_low
+ * afterwards does not change which pin edges interrupt.
+ */
+static int stm32f4_gpio_set_irq(struct gpio *g, int trigger,
+                                void (*handler)(struct gpio *, void *),
+                                void *data) {
+    struct stm32f4_gpio gpio = stm32f4_gpio_decode(g->num);
+    struct stm32f4_exti_line *line = &stm32f4_exti_lines[gpio.pin];
+    uint32_t bit = 1 << gpio.pin;
+    uint32_t irq = stm32f4_exti_irqs[gpio.pin];
+    struct gpio *owner;
+    int rising, falling;
+
+    if (!handler || !(trigger & GPIO_IRQ_BOTH)) {
+        stm32f4_gpio_irq_disable(g);
+        return 0;
+    }
+
+    /* Claim the line, unless another port's pin already has it */
+    do {
+        owner = (struct gpio *) load_link((volatile uint32_t *) &line->gpio);
+        if (owner && owner != g) {
+            return -GPIO_ERR_UNAVAIL;
+        }
+    } while (store_conditional((volatile uint32_t *) &line->gpio,
+                               (uint32_t) g));
+
+    /* Mask while the handler is changed */
+    stm32f4_exti_modify(EXTI_IMR, bit, 0);
+
+    line->handler = handler;
+    line->data = data;
+
+    /* Value edges are the opposite pin edges when active low */
+    rising = !!(trigger & GPIO_IRQ_RISING);
+    falling = !!(trigger & GPIO_IRQ_FALLING);
+    if (g->active_low) {
+        int tmp = rising;
+        rising = falling;
+        falling = tmp;
+    }
+
+    *RCC_APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    stm32f4_exti_modify(SYSCFG_EXTICR(gpio.pin / 4), SYSCFG_EXTICR_M(gpio.pin),
+                        gpio.port << SYSCFG_EXTICR_LINE(gpio.pin));
+
+    stm32f4_exti_modify(EXTI_RTSR, bit, rising ? bit : 0);
+    stm32f4_exti_modify(EXTI_FTSR, bit, falling ? bit : 0);
+
+    /* Drop any stale edge, then unmask */
+    *EXTI_PR = bit;
+    stm32f4_exti_modify(EXTI_IMR, 0, bit);
+
+    nvic_enable_irq(irq);
+
+    return 0;
+}
+
+/* Call the handlers of pending lines first through last */
+static void stm32f4_exti_irq(int first, int last) {
+    uint32_t pending = *EXTI_PR & *EXTI_IMR;
+
+    for (int i = first; i <= last; i++) {
+        struct stm32f4_exti_line *line = &stm32f4_exti_lines[i];
+        uint32_t bit = 1 << i;
+
+        if (!(pending & bit)) {
+            continue;
+        }
+
+        /* Clear first, so an edge during the handler is not lost */
+        *EXTI_PR = bit;
+
+        if (line->handler) {
+            line->handler(line->gpio, line->data);
+        }
+    }
+}
+
+#define EXTI_IRQ_HANDLER(name, first, last)                                 \
+    void exti##name##_handler(void) __attribute__((section(".kernel")));    \
+    void exti##name##_handler(void) {                                       \
+        stm32f4_exti_irq(first, last);                                      \
+    }
+
+EXTI_IRQ_HANDLER(0, 0, 0)
+EXTI_IRQ_HANDLER(1, 1, 1)
+EXTI_IRQ_HANDLER(2, 2, 2)
+EXTI_IRQ_HANDLER(3, 3, 3)
+EXTI_IRQ_HANDLER(4, 4, 4)
+EXTI_IRQ_HANDLER(9_5, 5, 9)
+EXTI_IRQ_HANDLER(15_10, 10, 15)
+
 static int stm32f4_gpio_dtor(struct gpio *gpio) {
-    /* Nothing to do */
+    stm32f4_gpio_irq_disable(gpio);
 
     return 0;
 }
@@ -284,6 +437,7 @@ static struct gpio_ops stm32f4_gpio_ops = {
     .set_output_value = stm32f4_gpio_set_output_value,
     .get_output_value = stm32f4_gpio_get_output_value,
     .set_flags = stm32f4_gpio_set_flags,
+    .set_irq = stm32f4_gpio_set_irq,
     .dtor = stm32f4_gpio_dtor,
 };
 
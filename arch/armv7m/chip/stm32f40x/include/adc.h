@@ -120,6 +120,11 @@ struct stm32f4_adc_regs {
 #define ADC_CR2_EXTEN_MASK      ((uint32_t) (3 << 28))  /* ADC CR2 external trigger for regular channels mask */
 #define ADC_CR2_SWSTART         ((uint32_t) (1 << 30))  /* ADC CR2 start conversion of regular channels */
 
+/* ADC CR2 EXTSEL regular group trigger sources */
+#define ADC_EXTSEL_TIM2_TRGO    ((uint32_t) (6))        /* ADC trigger on TIM2 TRGO */
+#define ADC_EXTSEL_TIM3_TRGO    ((uint32_t) (8))        /* ADC trigger on TIM3 TRGO */
+#define ADC_EXTSEL_TIM8_TRGO    ((uint32_t) (14))       /* ADC trigger on TIM8 TRGO */
+
 #define ADC_SMP_3               ((uint32_t) (0))        /* ADC 3 cycle sampling time */
 #define ADC_SMP_15              ((uint32_t) (1))        /* ADC 15 cycle sampling time */
 #define ADC_SMP_28              ((uint32_t) (2))        /* ADC 28 cycle sampling time */
@@ -44,10 +44,29 @@ struct stm32f4_dma_regs {
     struct stm32f4_dma_stream_regs stream[8];
 };
 
+/* Stream events reported to stream callbacks */
+#define STM32F4_DMA_EVENT_TC    (1 << 0)    /* Transfer complete */
+#define STM32F4_DMA_EVENT_HT    (1 << 1)    /* Half transfer */
+#define STM32F4_DMA_EVENT_TE    (1 << 2)    /* Transfer error */
+
+/*
+ * Stream interrupt callback
+ *
+ * Called from the stream interrupt handler, with the STM32F4_DMA_EVENT_*
+ * events that occurred.  The stream flags are already cleared.
+ */
+typedef void (*stm32f4_dma_callback_t)(void *data, uint32_t events);
+
+struct stm32f4_dma_stream_callback {
+    stm32f4_dma_callback_t  func;
+    void                    *data;
+};
+
 struct stm32f4_dma {
     int periph_id;
     struct stm32f4_dma_regs *regs;
     uint8_t streams_in_use[8];
+    struct stm32f4_dma_stream_callback callbacks[8];
     /* Required for shared structures and registers, not stream-specific regs */
     struct mutex lock;
     struct obj obj;
@@ -118,7 +137,8 @@ struct stm32f4_dma_ops {
      * Configure DMA handle
      *
      * Configure DMA handle with options specified in stm32f4_dma_config
-     * struct.  Should be called before any transactions begin.
+     * struct.  Should be called before any transactions begin.  Any
+     * transaction in progress is cancelled.
      *
      * @param stm32f4_dma   DMA controller for handle
      * @param handle        Stream/channel handle to configure
@@ -140,13 +160,27 @@ struct stm32f4_dma_ops {
      */
     int (*begin_transaction)(struct stm32f4_dma *, stm32f4_dma_handle_t,
                              uint16_t);
+    /*
+     * End DMA transaction
+     *
+     * Cancel the transaction in progress, if any.  On return, the stream has
+     * stopped, and will not access memory until the next transaction begins.
+     *
+     * @param stm32f4_dma   DMA controller for handle
+     * @param handle        Stream/channel handle for transaction
+     * @returns zero on success, negative on error
+     */
+    int (*end_transaction)(struct stm32f4_dma *, stm32f4_dma_handle_t);
     /*
      * Transaction complete
      *
+     * A transfer error ends the transaction early, and is reported as an
+     * error rather than completion.
+     *
      * @param stm32f4_dma   DMA controller for handle
      * @param handle        Stream/channel handle to check
      * @returns positive if transaction completed since last call, zero if
-     *          not, negative on error
+     *          not, negative on error (including a transfer error)
      */
     int (*transaction_complete)(struct stm32f4_dma *, stm32f4_dma_handle_t);
     /*
@@ -158,6 +192,24 @@ struct stm32f4_dma_ops {
      *          negative on error.
      */
     int (*items_remaining)(struct stm32f4_dma *, stm32f4_dma_handle_t);
+    /*
+     * Set stream interrupt callback
+     *
+     * Enable the stream interrupt for the given STM32F4_DMA_EVENT_* events,
+     * calling func from the interrupt handler when any of them occur.
+     * A NULL func disables the stream interrupt.
+     *
+     * The callback runs in interrupt context, and must not block.
+     *
+     * @param stm32f4_dma   DMA controller for handle
+     * @param handle        Stream/channel handle to set callback for
+     * @param events        Events to interrupt on
+     * @param func          Callback, or NULL to disable
+     * @param data          Argument passed to func
+     * @returns zero on success, negative on error
+     */
+    int (*set_callback)(struct stm32f4_dma *, stm32f4_dma_handle_t, uint32_t,
+                        stm32f4_dma_callback_t, void *);
 };
 
 /*
@@ -182,6 +234,18 @@ int stm32f4_dma_allocate(const void *fdt, int offset, const char *name,
                          struct stm32f4_dma **dma,
                          stm32f4_dma_handle_t *handle);
 
+/*
+ * Get stream interrupt number
+ *
+ * The NVIC interrupt that runs the stream callback.  Drivers may mask it
+ * to protect state shared with the callback.
+ *
+ * @param dma       STM32F4 DMA controller
+ * @param handle    Stream handle
+ * @returns NVIC interrupt number, negative on error
+ */
+int stm32f4_dma_irq(struct stm32f4_dma *dma, stm32f4_dma_handle_t handle);
+
 /*
  * Deallocate DMA stream and channel
  *
@@ -78,6 +78,8 @@
 #define TIM11_BASE                      (APB2PERIPH_BASE + 0x4800)                              /* Timer 11 base address */
 #define TIM10_BASE                      (APB2PERIPH_BASE + 0x4400)                              /* Timer 10 base address */
 #define TIM9_BASE                       (APB2PERIPH_BASE + 0x4000)                              /* Timer 9 base address */
+#define EXTI_BASE                       (APB2PERIPH_BASE + 0x3C00)                              /* External interrupt/event controller base address */
+#define SYSCFG_BASE                     (APB2PERIPH_BASE + 0x3800)                              /* System configuration controller base address */
 #define SPI4_BASE                       (APB2PERIPH_BASE + 0x3400)                              /* SPI4 Base Address */
 #define SPI1_BASE                       (APB2PERIPH_BASE + 0x3000)                              /* SPI1 Base Address */
 #define USART6_BASE                     (APB2PERIPH_BASE + 0x1400)                              /* USART6 Base Address */
@@ -104,6 +106,21 @@
 #define GPIO_AFRL(port)                 (volatile uint32_t *) (GPIO_BASE(port) + 0x20)          /* Port alternate function low register */
 #define GPIO_AFRH(port)                 (volatile uint32_t *) (GPIO_BASE(port) + 0x24)          /* Port alternate function high register */
 
+/* External Interrupt/Event Controller (EXTI) */
+#define EXTI_IMR                        (volatile uint32_t *) (EXTI_BASE + 0x00)                /* Interrupt mask register */
+#define EXTI_EMR                        (volatile uint32_t *) (EXTI_BASE + 0x04)                /* Event mask register */
+#define EXTI_RTSR                       (volatile uint32_t *) (EXTI_BASE + 0x08)                /* Rising trigger selection register */
+#define EXTI_FTSR                       (volatile uint32_t *) (EXTI_BASE + 0x0C)                /* Falling trigger selection register */
+#define EXTI_SWIER                      (volatile uint32_t *) (EXTI_BASE + 0x10)                /* Software interrupt event register */
+#define EXTI_PR                         (volatile uint32_t *) (EXTI_BASE + 0x14)                /* Pending register */
+
+/* System Configuration Controller (SYSCFG) */
+#define SYSCFG_MEMRMP                   (volatile uint32_t *) (SYSCFG_BASE + 0x00)              /* Memory remap register */
+#define SYSCFG_PMC                      (volatile uint32_t *) (SYSCFG_BASE + 0x04)              /* Peripheral mode configuration register */
+#define SYSCFG_EXTICR(n)                (volatile uint32_t *) (SYSCFG_BASE + 0x08 + (0x4*n))    /* External interrupt configuration register n (0-3) */
+#define SYSCFG_EXTICR_LINE(line)        (4*((line) % 4))                                        /* Shift of EXTI line port selection in SYSCFG_EXTICR(line/4) */
+#define SYSCFG_EXTICR_M(line)           (0xF << SYSCFG_EXTICR_LINE(line))                       /* Mask of EXTI line port selection */
+
 /* Flash Registers (FLASH) */
 #define FLASH_ACR                       (volatile uint32_t *) (FLASH_R_BASE + 0x00)             /* Flash Access Control Register */
 
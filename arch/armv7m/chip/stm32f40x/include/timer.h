@@ -71,6 +71,58 @@ static inline struct stm32f4_timer_regs *timer_get_regs(int num) {
     return (struct stm32f4_timer_regs *) INVALID_PERIPH_BASE;
 }
 
+/*
+ * Determine timer master clock
+ *
+ * Timers are clocked at 2 * APB clock.
+ * APB1 is system clock / 4, APB2 is system clock / 2.
+ *
+ * @param timer Timer to get master clock of
+ * @return master clock speed in hertz
+ */
+static inline uint32_t timer_clock(uint8_t timer) {
+    switch (timer) {
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 12:
+        case 13:
+        case 14:
+            return CONFIG_SYS_CLOCK/2;
+        case 1:
+        case 8:
+        case 9:
+        case 10:
+        case 11:
+            return CONFIG_SYS_CLOCK;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Reserve a timer
+ *
+ * Timers are shared between drivers (PWM outputs, ADC triggers, the
+ * perfcounter) which each reprogram the whole timer.  A driver must
+ * reserve a timer before touching its registers, and release it once
+ * it no longer uses it.
+ *
+ * @param timer Timer to reserve
+ * @returns 0 on success, negative if the timer is invalid or already reserved
+ */
+int timer_reserve(uint8_t timer);
+
+/*
+ * Release a timer reserved with timer_reserve()
+ *
+ * @param timer Timer to release
+ */
+void timer_release(uint8_t timer);
+
 
 #define TIM_CR1_CEN         ((uint32_t) (1 << 0))   /* TIM counter enable */
 #define TIM_CR1_UDIS        ((uint32_t) (1 << 1))   /* TIM update disable */
@@ -88,5 +88,9 @@ struct stm32f4_usart_regs {
 #define USART_CR3_DMAR              ((uint32_t) (1 << 6))           /* USART_CR3 DMA enable receiver */
 #define USART_CR3_SCEN              ((uint32_t) (1 << 5))           /* USART_CR3 Smartcard mode enable */
 #define USART_CR3_NACK              ((uint32_t) (1 << 4))           /* USART_CR3 Smartcard NACK enable */
+#define USART_CR3_HDSEL             ((uint32_t) (1 << 3))           /* USART_CR3 Half-duplex selection */
+#define USART_CR3_IRLP              ((uint32_t) (1 << 2))           /* USART_CR3 IrDA low-power */
+#define USART_CR3_IREN              ((uint32_t) (1 << 1))           /* USART_CR3 IrDA mode enable */
+#define USART_CR3_EIE               ((uint32_t) (1 << 0))           /* USART_CR3 Error interrupt enable */
 
 #endif // DEV_USART_H_INCLUDED
@@ -23,7 +23,9 @@
 /*
  * STM32F4 PWM peripheral using timers 1, 3, 4, 8, 9, 10, 11, 12, 13, 14.
  * Timers 2 and 5 are used for the perfcounter, and 6 and 7 do not support
- * PWM outputs.
+ * PWM outputs.  A timer is reserved while any of its channels are in use,
+ * so timers reserved by other drivers, such as ADC stream triggers, are
+ * skipped.
  */
 
 #include <stdint.h>
@@ -310,35 +312,38 @@ static struct mutex *timer_mutex(uint8_t timer) {
 }
 
 /*
- * Determine timer master clock
+ * No channels of the timer are in use
  *
- * Timers are clocked at 2 * APB clock.
- * APB1 is system clock / 4, APB2 is system clock / 2.
+ * channels_available_mut must be held.
+ */
+static int timer_unused(uint8_t timer) {
+    uint32_t all_channels = timer_all_channels(timer);
+
+    return (channels_available & all_channels) == all_channels;
+}
+
+/*
+ * Free a timer channel that was taken
  *
- * @param timer Timer to get master clock of
- * @return master clock speed in hertz
+ * Once no other channels in the timer are in use, the timer is disabled
+ * and its reservation released.
  */
-uint32_t timer_clock(uint8_t timer) {
-    switch (timer) {
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-        case 6:
-        case 7:
-        case 12:
-        case 13:
-        case 14:
-            return CONFIG_SYS_CLOCK/2;
-        case 1:
-        case 8:
-        case 9:
-        case 10:
-        case 11:
-            return CONFIG_SYS_CLOCK;
-        default:
-            return 0;
+static void free_timer_channel(enum timer_channels timer_channel) {
+    uint8_t timer = timer_channel_to_timer(timer_channel);
+
+    acquire(&channels_available_mut);
+    channels_available |= timer_channel;
+
+    if (timer_unused(timer)) {
+        struct stm32f4_timer_regs *regs = timer_get_regs(timer);
+        acquire(timer_mutex(timer));
+        raw_mem_clear_bits(&regs->CR1, TIM_CR1_CEN);
+        release(timer_mutex(timer));
+
+        timer_release(timer);
     }
+
+    release(&channels_available_mut);
 }
 
 /* Get timer GPIO alternative function */
@@ -645,13 +650,19 @@ static uint32_t stm32f4_pwm_get_period(struct pwm *pwm) {
     return timer_period(stm32_pwm->timer);
 }
 
-static int32_t stm32f4_pwm_set_pulse_width(struct pwm *pwm, uint32_t width) {
-    struct stm32f4_pwm *stm32_pwm = pwm->priv;
-    struct stm32f4_timer_regs *regs = timer_get_regs(stm32_pwm->timer);
-    uint32_t clock = timer_clock(stm32_pwm->timer);
+/* Convert pulse width in microseconds to timer counts */
+static uint32_t timer_width_to_counts(uint8_t timer, uint32_t width) {
+    struct stm32f4_timer_regs *regs = timer_get_regs(timer);
+    uint32_t clock = timer_clock(timer);
     uint32_t prescaler = raw_mem_read(&regs->PSC) + 1;
     uint32_t frequency = clock/prescaler;
-    uint32_t value = width*(frequency/1e6);
+
+    return width*(frequency/1e6);
+}
+
+static int32_t stm32f4_pwm_set_pulse_width(struct pwm *pwm, uint32_t width) {
+    struct stm32f4_pwm *stm32_pwm = pwm->priv;
+    uint32_t value = timer_width_to_counts(stm32_pwm->timer, width);
     uint32_t *ccr = timer_ccr_register(stm32_pwm->timer, stm32_pwm->channel);
     if (!ccr) {
         return -1;
@@ -685,6 +696,76 @@ static uint32_t stm32f4_pwm_get_pulse_width(struct pwm *pwm) {
     return (1e6*value)/frequency;
 }
 
+/*
+ * CCR writes are preloaded, and only take effect at the next update event.
+ * Updates of several channels on one timer may still straddle an update
+ * event, so the timer's update event is disabled (UDIS) while they are
+ * written.  If the counter overflows meanwhile, the previous widths
+ * simply run for one more period.
+ *
+ * Only outputs sharing a timer are synchronized, as each timer has its
+ * own counter.
+ */
+static int stm32f4_pwm_commit_group(struct pwm_group *group) {
+    uint8_t timers[PWM_NUM_TIMERS];
+    int num_timers = 0;
+    int ret = 0;
+    int i, j;
+
+    /* Collect the timers with staged outputs */
+    for (i = 0; i < group->num; i++) {
+        struct stm32f4_pwm *stm32_pwm = to_pwm(group->pwms[i])->priv;
+
+        if (!(group->staged & ((uint32_t) 1 << i))) {
+            continue;
+        }
+
+        for (j = 0; j < num_timers; j++) {
+            if (timers[j] == stm32_pwm->timer) {
+                break;
+            }
+        }
+
+        if (j == num_timers) {
+            timers[num_timers++] = stm32_pwm->timer;
+        }
+    }
+
+    for (j = 0; j < num_timers; j++) {
+        uint8_t timer = timers[j];
+        struct stm32f4_timer_regs *regs = timer_get_regs(timer);
+
+        acquire(timer_mutex(timer));
+
+        raw_mem_set_bits(&regs->CR1, TIM_CR1_UDIS);
+
+        for (i = 0; i < group->num; i++) {
+            struct stm32f4_pwm *stm32_pwm = to_pwm(group->pwms[i])->priv;
+            uint32_t *ccr;
+
+            if (!(group->staged & ((uint32_t) 1 << i)) ||
+                    stm32_pwm->timer != timer) {
+                continue;
+            }
+
+            ccr = timer_ccr_register(timer, stm32_pwm->channel);
+            if (!ccr) {
+                ret = -1;
+                continue;
+            }
+
+            raw_mem_write(ccr, timer_width_to_counts(timer,
+                                                     group->widths[i]));
+        }
+
+        raw_mem_clear_bits(&regs->CR1, TIM_CR1_UDIS);
+
+        release(timer_mutex(timer));
+    }
+
+    return ret;
+}
+
 static uint8_t stm32f4_pwm_is_hardware(struct pwm *pwm) {
     /* Only hardware PWM supported, for now */
     return 1;
@@ -693,24 +774,11 @@ static uint8_t stm32f4_pwm_is_hardware(struct pwm *pwm) {
 static int stm32f4_pwm_dtor(struct pwm *pwm) {
     struct pwm_ops *ops = pwm->obj.ops;
     struct stm32f4_pwm *stm32_pwm = pwm->priv;
-    uint32_t all_channels = timer_all_channels(stm32_pwm->timer);
 
     /* Disable output */
     ops->enable(pwm, 0);
 
-    /* Free timer channel that was taken */
-    acquire(&channels_available_mut);
-    channels_available |= stm32_pwm->timer_channel;
-
-    if ((channels_available & all_channels) == all_channels) {
-        /* No other channels in timer in use, disable timer */
-        struct stm32f4_timer_regs *regs = timer_get_regs(stm32_pwm->timer);
-        acquire(timer_mutex(stm32_pwm->timer));
-        raw_mem_clear_bits(&regs->CR1, TIM_CR1_CEN);
-        release(timer_mutex(stm32_pwm->timer));
-    }
-
-    release(&channels_available_mut);
+    free_timer_channel(stm32_pwm->timer_channel);
 
     kfree(pwm->priv);
 
@@ -724,6 +792,7 @@ static struct pwm_ops stm32f4_pwm_ops = {
     .set_pulse_width = stm32f4_pwm_set_pulse_width,
     .get_pulse_width = stm32f4_pwm_get_pulse_width,
     .is_hardware = stm32f4_pwm_is_hardware,
+    .commit_group = stm32f4_pwm_commit_group,
     .dtor = stm32f4_pwm_dtor,
 };
 
@@ -745,6 +814,7 @@ static enum timer_channels find_and_configure_timer_channel(struct gpio *gpio,
     uint32_t valid_channels, available;
     uint32_t selected_timer, selected_channel;
     enum timer_channels selected_timer_channel = INVALID_TIMER_CHANNEL;
+    int reserved = 0;
     int err;
 
     valid_channels = gpio_to_timer_channel[gpio->num];
@@ -762,12 +832,24 @@ static enum timer_channels find_and_configure_timer_channel(struct gpio *gpio,
         uint32_t timer_channel = (1 << i);
         if (available & timer_channel) {
             uint8_t timer = timer_channel_to_timer(timer_channel);
+            int unused = timer_unused(timer);
+
+            /* First channel on a timer reserves it from other drivers */
+            if (unused && timer_reserve(timer)) {
+                continue;
+            }
+
             acquire(timer_mutex(timer));
             if (!timer_enabled(timer) || (timer_period(timer) == period)) {
                 selected_timer_channel = timer_channel;
+                reserved = unused;
                 break;
             }
             release(timer_mutex(timer));
+
+            if (unused) {
+                timer_release(timer);
+            }
         }
     }
 
@@ -801,6 +883,9 @@ static enum timer_channels find_and_configure_timer_channel(struct gpio *gpio,
 
 err_release_selected_timer:
     release(timer_mutex(selected_timer));
+    if (reserved) {
+        timer_release(selected_timer);
+    }
 err_release_channels_available:
     release(&channels_available_mut);
     return INVALID_TIMER_CHANNEL;
@@ -874,10 +959,7 @@ err_free_pwm_obj:
     class_deinstantiate(pwm_obj);
 err_put_gpio:
     obj_put(gpio_obj);
-    /* Free timer channel that was taken */
-    acquire(&channels_available_mut);
-    channels_available |= timer_channel;
-    release(&channels_available_mut);
+    free_timer_channel(timer_channel);
 err:
     return NULL;
 }
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <arch/chip/timer.h>
+#include <kernel/mutex.h>
+
+#define NUM_TIMERS  14
+
+/* Bit n set when timer n is reserved */
+static uint32_t timers_reserved = 0;
+static struct mutex timers_reserved_mut = INIT_MUTEX;
+
+int timer_reserve(uint8_t timer) {
+    int ret = -1;
+
+    if (!timer || timer > NUM_TIMERS) {
+        return -1;
+    }
+
+    acquire(&timers_reserved_mut);
+
+    if (!(timers_reserved & (1 << timer))) {
+        timers_reserved |= (1 << timer);
+        ret = 0;
+    }
+
+    release(&timers_reserved_mut);
+
+    return ret;
+}
+
+void timer_release(uint8_t timer) {
+    if (!timer || timer > NUM_TIMERS) {
+        return;
+    }
+
+    acquire(&timers_reserved_mut);
+    timers_reserved &= ~(1 << timer);
+    release(&timers_reserved_mut);
+}
@@ -21,7 +21,10 @@
  */
 
 #include <libfdt.h>
+#include <ring.h>
 #include <stdlib.h>
+#include <string.h>
+#include <arch/system.h>
 #include <arch/chip/clock.h>
 #include <arch/chip/dma.h>
 #include <arch/chip/gpio.h>
@@ -35,11 +38,22 @@
 #include <kernel/class.h>
 #include <kernel/init.h>
 #include <kernel/mutex.h>
+#include <kernel/sched.h>
+#include <kernel/sem.h>
 #include <mm/mm.h>
 
 #define STM32F4_UART_COMPAT "stmicro,stm32f407-uart"
 
-#define STM32F4_UART_BUFFER_SIZE    (250)
+/* Ring sizes must be powers of two */
+#define STM32F4_UART_RX_RING_SIZE   (1024)
+#define STM32F4_UART_TX_RING_SIZE   (1024)
+
+#define STM32F4_NUM_USARTS          (6)
+
+/* Global interrupt of USART1-6 */
+static const uint8_t stm32f4_uart_irqs[STM32F4_NUM_USARTS] = {
+    37, 38, 39, 52, 53, 71,
+};
 
 struct stm32f4_uart {
     /* One lock must be held to read ready, both must be held to write it */
@@ -56,12 +70,36 @@ struct stm32f4_uart {
     stm32f4_dma_handle_t tx_handle;
     struct stm32f4_usart_regs *regs;
 
-    uint8_t *rx_buffer;
-    uint8_t *tx_buffer;
-    uint8_t first_tx;   /* Bootstrap initial TX */
-    uint32_t read_index;/* Index of last read data in rx_buffer */
-    /* DMA has wrapped around to beginning of rx buffer, before read_index */
-    uint8_t wrapped;
+    int irq;    /* USART global interrupt */
+
+    /*
+     * The RX DMA fills rx_ring circularly, as its producer.  The USART
+     * interrupt advances the ring head to the DMA position whenever the
+     * line goes idle, or the DMA is half or completely through the ring.
+     * rx_pos is the DMA position at the last update.
+     *
+     * If the reader falls more than a ring behind, the overwritten bytes
+     * are counted in rx_dropped.
+     */
+    struct ring rx_ring;
+    uint32_t rx_pos;
+    uint32_t read_timeout;          /* Microseconds to block in read() */
+    volatile uint8_t rx_waiting;    /* Reader waiting for rx_data */
+    volatile uint32_t rx_dropped;
+    volatile uint32_t rx_overruns;  /* USART overrun errors */
+    struct semaphore rx_data;
+
+    /*
+     * Writers produce into tx_ring, and the TX DMA consumes it, chaining
+     * the next transfer from the transfer complete interrupt.  tx_active
+     * is the length of the transfer in flight, zero if the DMA is idle.
+     * tx_active is only modified with tx_irq masked.
+     */
+    struct ring tx_ring;
+    int tx_irq;
+    volatile uint32_t tx_active;
+    volatile uint8_t tx_waiting;    /* Writer waiting for tx_space */
+    struct semaphore tx_space;
 
     struct mutex read_lock;
     struct mutex write_lock;
@@ -84,37 +122,199 @@ static uint32_t brr_to_baud(long clock, uint32_t brr) {
 }
 
 /*
- * Peripheral initialization.
- * Read and write locks must be held when calling,
+ * Start transmitting the next span of the TX ring
+ *
+ * Does nothing if a transfer is already in flight or the ring is empty.
+ * Must be called with tx_irq masked, or from the TX DMA interrupt.
  */
-static int stm32f4_uart_initialize(struct stm32f4_uart *port) {
-    int ret = 0;
-    struct stm32f4_dma_ops *rx_ops = port->rx_dma->obj.ops;
+static void stm32f4_uart_tx_start(struct stm32f4_uart *port) {
     struct stm32f4_dma_ops *tx_ops = port->tx_dma->obj.ops;
+    uint8_t *span;
+    uint32_t len;
 
-    struct stm32f4_dma_config rx_config = {
-        .direction = STM32F4_DMA_DIR_PERIPH_TO_MEM,
+    struct stm32f4_dma_config tx_config = {
+        .direction = STM32F4_DMA_DIR_MEM_TO_PERIPH,
         .memory_size = 1,
         .peripheral_size = 1,
         .memory_increment = 1,
         .peripheral_increment = 0,
-        .circular = 1,
+        .circular = 0,
         .double_buffer = 0,
         .peripheral_addr = (uintptr_t) &port->regs->DR,
-        .mem0_addr = (uintptr_t) port->rx_buffer,
         .mem1_addr = (uintptr_t) NULL,
     };
 
-    struct stm32f4_dma_config tx_config = {
-        .direction = STM32F4_DMA_DIR_MEM_TO_PERIPH,
+    if (port->tx_active) {
+        return;
+    }
+
+    len = ring_read_span(&port->tx_ring, &span);
+    if (!len) {
+        return;
+    }
+
+    tx_config.mem0_addr = (uintptr_t) span;
+
+    if (tx_ops->configure(port->tx_dma, port->tx_handle, &tx_config)) {
+        return;
+    }
+
+    port->tx_active = len;
+
+    tx_ops->begin_transaction(port->tx_dma, port->tx_handle, len);
+}
+
+/*
+ * Retire the finished transfer and chain the next
+ *
+ * Must be called with tx_irq masked, or from the TX DMA interrupt.
+ */
+static void stm32f4_uart_tx_done(struct stm32f4_uart *port) {
+    ring_read_commit(&port->tx_ring, port->tx_active);
+    port->tx_active = 0;
+
+    stm32f4_uart_tx_start(port);
+
+    if (port->tx_waiting) {
+        port->tx_waiting = 0;
+        sem_post(&port->tx_space);
+    }
+}
+
+static void stm32f4_uart_tx_callback(void *data, uint32_t events) {
+    struct stm32f4_uart *port = data;
+
+    if (events & (STM32F4_DMA_EVENT_TC | STM32F4_DMA_EVENT_TE)) {
+        stm32f4_uart_tx_done(port);
+    }
+}
+
+/*
+ * Make TX progress without the interrupt
+ *
+ * Used when the writer cannot block: before task switching, or from
+ * interrupt context, where the DMA interrupt may not be able to run.
+ */
+static void stm32f4_uart_tx_poll(struct stm32f4_uart *port) {
+    struct stm32f4_dma_ops *tx_ops = port->tx_dma->obj.ops;
+
+    nvic_disable_irq(port->tx_irq);
+
+    if (!port->tx_active) {
+        stm32f4_uart_tx_start(port);
+    }
+    /*
+     * As in the interrupt, a transfer error drops the span, rather than
+     * leaving a drain loop waiting forever on a stopped stream.
+     */
+    else if (tx_ops->transaction_complete(port->tx_dma, port->tx_handle)) {
+        stm32f4_uart_tx_done(port);
+    }
+
+    nvic_enable_irq(port->tx_irq);
+}
+
+/* USARTs by index, for interrupt handlers */
+static struct stm32f4_uart *stm32f4_uart_ports[STM32F4_NUM_USARTS];
+
+/*
+ * Publish received bytes to the reader
+ *
+ * Advances the RX ring head to the current DMA position.  Interrupts
+ * come at least every half ring, so the DMA can never have lapped
+ * rx_pos.  Only called from the USART interrupt.
+ */
+static void stm32f4_uart_rx_update(struct stm32f4_uart *port) {
+    struct stm32f4_dma_ops *rx_ops = port->rx_dma->obj.ops;
+    uint32_t pos, delta;
+    int remaining;
+
+    remaining = rx_ops->items_remaining(port->rx_dma, port->rx_handle);
+    if (remaining < 0) {
+        return;
+    }
+
+    pos = (STM32F4_UART_RX_RING_SIZE - remaining) &
+            (STM32F4_UART_RX_RING_SIZE - 1);
+    delta = (pos - port->rx_pos) & (STM32F4_UART_RX_RING_SIZE - 1);
+    if (!delta) {
+        return;
+    }
+
+    port->rx_pos = pos;
+    ring_write_commit(&port->rx_ring, delta);
+
+    if (port->rx_waiting) {
+        port->rx_waiting = 0;
+        sem_post(&port->rx_data);
+    }
+}
+
+static void stm32f4_uart_irq(int index) {
+    struct stm32f4_uart *port = stm32f4_uart_ports[index];
+    uint32_t sr;
+
+    if (!port) {
+        return;
+    }
+
+    sr = raw_mem_read(&port->regs->SR);
+
+    if (sr & USART_SR_ORE) {
+        port->rx_overruns++;
+    }
+
+    /* IDLE and errors are cleared by reading SR, then DR */
+    if (sr & (USART_SR_IDLE | USART_SR_ORE | USART_SR_NF | USART_SR_FE)) {
+        raw_mem_read(&port->regs->DR);
+    }
+
+    stm32f4_uart_rx_update(port);
+}
+
+#define USART_IRQ_HANDLER(num)                                              \
+    void usart##num##_handler(void) __attribute__((section(".kernel")));    \
+    void usart##num##_handler(void) {                                       \
+        stm32f4_uart_irq(num - 1);                                          \
+    }
+
+USART_IRQ_HANDLER(1)
+USART_IRQ_HANDLER(2)
+USART_IRQ_HANDLER(3)
+USART_IRQ_HANDLER(4)
+USART_IRQ_HANDLER(5)
+USART_IRQ_HANDLER(6)
+
+/*
+ * RX DMA half and complete transfer callback
+ *
+ * Defers to the USART interrupt, so the ring head only has one producer.
+ */
+static void stm32f4_uart_rx_callback(void *data, uint32_t events) {
+    struct stm32f4_uart *port = data;
+
+    nvic_set_pending(port->irq);
+}
+
+/*
+ * Peripheral initialization.
+ * Read and write locks must be held when calling,
+ */
+static int stm32f4_uart_initialize(struct stm32f4_uart *port) {
+    int ret = 0;
+    struct stm32f4_dma_ops *rx_ops = port->rx_dma->obj.ops;
+    struct stm32f4_dma_ops *tx_ops = port->tx_dma->obj.ops;
+
+    struct stm32f4_dma_config rx_config = {
+        .direction = STM32F4_DMA_DIR_PERIPH_TO_MEM,
         .memory_size = 1,
         .peripheral_size = 1,
         .memory_increment = 1,
         .peripheral_increment = 0,
-        .circular = 0,
+        .circular = 1,
         .double_buffer = 0,
         .peripheral_addr = (uintptr_t) &port->regs->DR,
-        .mem0_addr = (uintptr_t) port->tx_buffer,
+        .mem0_addr = (uintptr_t) port->rx_ring.buf,
         .mem1_addr = (uintptr_t) NULL,
     };
 
@@ -124,6 +324,9 @@ static int stm32f4_uart_initialize(struct stm32f4_uart *port) {
         return ret;
     }
 
+    /* Keep the RX interrupt out while RX restarts */
+    nvic_disable_irq(port->irq);
+
     /* Enable peripheral */
     raw_mem_set_bits(&port->regs->CR1, USART_CR1_UE);
 
@@ -146,18 +349,36 @@ static int stm32f4_uart_initialize(struct stm32f4_uart *port) {
         return ret;
     }
 
-    ret = tx_ops->configure(port->tx_dma, port->tx_handle, &tx_config);
+    /* TX transfers are configured as they start, from the ring */
+    ret = tx_ops->set_callback(port->tx_dma, port->tx_handle,
+                               STM32F4_DMA_EVENT_TC | STM32F4_DMA_EVENT_TE,
+                               stm32f4_uart_tx_callback, port);
+    if (ret) {
+        return ret;
+    }
+
+    ret = rx_ops->set_callback(port->rx_dma, port->rx_handle,
+                               STM32F4_DMA_EVENT_HT | STM32F4_DMA_EVENT_TC,
+                               stm32f4_uart_rx_callback, port);
     if (ret) {
         return ret;
     }
 
-    /* Begin continuous receive transaction */
+    /* Begin continuous receive transaction, from an empty ring */
+    ring_flush(&port->rx_ring);
+    port->rx_pos = 0;
+
     ret = rx_ops->begin_transaction(port->rx_dma, port->rx_handle,
-                                    STM32F4_UART_BUFFER_SIZE);
+                                    STM32F4_UART_RX_RING_SIZE);
     if (ret) {
         return ret;
     }
 
+    /* Interrupt on idle line and receive errors */
+    raw_mem_set_bits(&port->regs->CR1, USART_CR1_IDLEIE);
+    raw_mem_set_bits(&port->regs->CR3, USART_CR3_EIE);
+    nvic_enable_irq(port->irq);
+
     /* Enable reciever and transmitter */
     raw_mem_set_bits(&port->regs->CR1, USART_CR1_RE | USART_CR1_TE);
 
@@ -265,16 +486,14 @@ out:
 
 static int stm32f4_uart_read(struct uart *uart, char *buf, size_t len) {
     struct stm32f4_uart *port;
-    struct stm32f4_dma_ops *rx_ops;
-    int items_remaining, dma_read, wrapped;
-    int i, ret;
+    uint32_t count;
+    int ret;
 
     if (!uart) {
         return -1;
     }
 
     port = uart->priv;
-    rx_ops = port->rx_dma->obj.ops;
 
     acquire(&port->read_lock);
 
@@ -287,78 +506,44 @@ static int stm32f4_uart_read(struct uart *uart, char *buf, size_t len) {
         }
     }
 
-    /*
-     * DMA has wrapped around to the beginning of the buffer since
-     * the last read if a transaction has completed.
-     *
-     * DMA may have been indicated a wrapped state in a previous read,
-     * so port->wrapped is used to keep track.  It will be reset to
-     * not wrapped when the reading rolls over as well.
-     */
-    wrapped = rx_ops->transaction_complete(port->rx_dma, port->rx_handle);
-    if (wrapped < 0) {
-        ret = wrapped;
-        goto out;
-    }
+    while (1) {
+        count = ring_count(&port->rx_ring);
 
-    /*
-     * DMA was already wrapped at the last check, and has since wrapped
-     * *again*.  We are hopelessly behind; start over; data is lost.
-     */
-    if (wrapped && port->wrapped) {
-        port->read_index = 0;
-        wrapped = port->wrapped = 0;
-    }
-    /* Wrapped state is new */
-    else if (wrapped && !port->wrapped) {
-        port->wrapped = wrapped;
-    }
+        /*
+         * The DMA lapped us, overwriting the oldest data, and is now
+         * writing over what remains.  Skip to the newest half.
+         */
+        if (count > STM32F4_UART_RX_RING_SIZE) {
+            uint32_t lost = count - STM32F4_UART_RX_RING_SIZE/2;
 
-    items_remaining = rx_ops->items_remaining(port->rx_dma, port->rx_handle);
-    if (items_remaining < 0) {
-        ret = items_remaining;
-        goto out;
-    }
+            ring_read_commit(&port->rx_ring, lost);
+            port->rx_dropped += lost;
+            count -= lost;
+        }
 
-    /* DMA has written to this point */
-    dma_read = STM32F4_UART_BUFFER_SIZE - items_remaining;
+        if (count || !port->read_timeout) {
+            break;
+        }
 
-    /* We are caught up to everything the DMA has read */
-    if (!port->wrapped && dma_read == port->read_index) {
-        ret = 0;
-        goto out;
-    }
-    /*
-     * The DMA has not wrapped around, yet is somehow behind us.
-     * Start over; data is lost.
-     */
-    else if (!port->wrapped && dma_read < port->read_index) {
-        port->read_index = 0;
-        port->wrapped = 0;
-    }
-    /*
-     * The DMA has wrapped around, and is already ahead of us.
-     * Start over; data is lost.
-     */
-    else if (port->wrapped && dma_read >= port->read_index) {
-        port->read_index = 0;
-        port->wrapped = 0;
-    }
+        if (!task_switching || !arch_svc_legal()) {
+            break;
+        }
 
-    for (i = 0; i < len && port->read_index != dma_read; i++) {
-        buf[i] = port->rx_buffer[port->read_index++];
+        port->rx_waiting = 1;
 
-        /*
-         * Roll over to beginning of ring buffer.
-         * The DMA is now definitely ahead of us.
-         */
-        if (port->read_index >= STM32F4_UART_BUFFER_SIZE) {
-            port->read_index = 0;
-            port->wrapped = 0;
+        /* Data may have arrived before rx_waiting was seen */
+        if (!ring_empty(&port->rx_ring)) {
+            port->rx_waiting = 0;
+            continue;
+        }
+
+        if (sem_wait(&port->rx_data, port->read_timeout)) {
+            port->rx_waiting = 0;
+            break;
         }
     }
 
-    ret = i;
+    ret = ring_pop_n(&port->rx_ring, buf, len);
 
 out:
     release(&port->read_lock);
@@ -367,16 +552,14 @@ out:
 
 static int stm32f4_uart_write(struct uart *uart, const char *buf, size_t len) {
     struct stm32f4_uart *port;
-    struct stm32f4_dma_ops *tx_ops;
+    size_t total = 0;
     int ret;
-    size_t tx_size;
 
     if (!uart) {
         return -1;
     }
 
     port = uart->priv;
-    tx_ops = port->tx_dma->obj.ops;
 
     acquire(&port->write_lock);
 
@@ -389,32 +572,82 @@ static int stm32f4_uart_write(struct uart *uart, const char *buf, size_t len) {
         }
     }
 
+    while (total < len) {
+        total += ring_push_n(&port->tx_ring, &buf[total], len - total);
+
+        /* Kick the DMA, in case it was idle */
+        nvic_disable_irq(port->tx_irq);
+        stm32f4_uart_tx_start(port);
+        nvic_enable_irq(port->tx_irq);
+
+        if (total == len) {
+            break;
+        }
+
+        /* Ring is full, wait for the in flight transfer to free space */
+        if (!task_switching || !arch_svc_legal()) {
+            stm32f4_uart_tx_poll(port);
+            continue;
+        }
+
+        port->tx_waiting = 1;
+
+        /* Space may have appeared before tx_waiting was seen */
+        if (ring_space(&port->tx_ring)) {
+            port->tx_waiting = 0;
+            continue;
+        }
+
+        sem_wait(&port->tx_space, WAIT_FOREVER);
+    }
+
     /*
-     * Wait if previous not transaction complete.
-     * However, there is no previous transaction the first time
+     * Without task switching, the interrupt may never get to chain the
+     * remaining transfers (e.g., during a panic), so finish them here.
      */
-    if (port->first_tx) {
-        port->first_tx = 0;
+    if (!task_switching || !arch_svc_legal()) {
+        while (!ring_empty(&port->tx_ring)) {
+            stm32f4_uart_tx_poll(port);
+        }
     }
-    else if (!tx_ops->transaction_complete(port->tx_dma, port->tx_handle)) {
-        ret = 0;
-        goto out;
+
+    ret = total;
+
+out:
+    release(&port->write_lock);
+    return ret;
+}
+
+static int stm32f4_uart_set_read_timeout(struct uart *uart,
+                                         uint32_t timeout_us) {
+    struct stm32f4_uart *port;
+
+    if (!uart) {
+        return -1;
     }
 
-    tx_size = len < STM32F4_UART_BUFFER_SIZE ? len : STM32F4_UART_BUFFER_SIZE;
-    memcpy(port->tx_buffer, buf, tx_size);
+    port = uart->priv;
+
+    acquire(&port->read_lock);
+    port->read_timeout = timeout_us;
+    release(&port->read_lock);
 
-    /* TX via DMA */
-    ret = tx_ops->begin_transaction(port->tx_dma, port->tx_handle, tx_size);
-    if (ret) {
-        goto out;
+    return 0;
+}
+
+static int stm32f4_uart_get_stats(struct uart *uart, struct uart_stats *stats) {
+    struct stm32f4_uart *port;
+
+    if (!uart || !stats) {
+        return -1;
     }
 
-    ret = tx_size;
+    port = uart->priv;
 
-out:
-    release(&port->write_lock);
-    return ret;
+    stats->rx_dropped = port->rx_dropped;
+    stats->rx_overruns = port->rx_overruns;
+
+    return 0;
 }
 
 static struct uart_ops stm32f4_uart_ops = {
@@ -424,6 +657,8 @@ static struct uart_ops stm32f4_uart_ops = {
     .set_baud_rate = stm32f4_uart_set_baud_rate,
     .read = stm32f4_uart_read,
     .write = stm32f4_uart_write,
+    .set_read_timeout = stm32f4_uart_set_read_timeout,
+    .get_stats = stm32f4_uart_get_stats,
 };
 
 static int stm32f4_uart_probe(const char *name) {
@@ -431,30 +666,32 @@ static int stm32f4_uart_probe(const char *name) {
     int offset;
 
     /* Lookup peripheral node */
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
     /* Check that peripheral is compatible with driver */
-    return fdt_node_check_compatible(blob, offset, STM32F4_UART_COMPAT) == 0;
+    return fdtparse_node_check_compatible(blob, offset,
+                                          STM32F4_UART_COMPAT) == 0;
 }
 
 static struct obj *stm32f4_uart_ctor(const char *name) {
     const void *blob = fdtparse_get_blob();
-    int offset, err, periph_id, gpio_af;
+    int offset, err, periph_id, gpio_af, index;
     struct obj *obj;
     struct uart *uart;
     struct stm32f4_usart_regs *regs;
     struct stm32f4_uart *port;
+    uint8_t *rx_buffer, *tx_buffer;
     enum stm32f4_bus bus;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, STM32F4_UART_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, STM32F4_UART_COMPAT)) {
         return NULL;
     }
 
@@ -468,6 +705,11 @@ static struct obj *stm32f4_uart_ctor(const char *name) {
         return NULL;
     }
 
+    index = periph_id - STM32F4_PERIPH_USART1;
+    if (index < 0 || index >= STM32F4_NUM_USARTS) {
+        return NULL;
+    }
+
     obj = instantiate(name, &uart_class, &stm32f4_uart_ops, struct uart);
     if (!obj) {
         return NULL;
@@ -487,23 +729,27 @@ static struct obj *stm32f4_uart_ctor(const char *name) {
     port->baud = 115200;    /* Default baud */
     port->periph_id = periph_id;
     port->regs = regs;
+    port->irq = stm32f4_uart_irqs[index];
     init_mutex(&port->read_lock);
     init_mutex(&port->write_lock);
-    port->first_tx = 1;
-    port->read_index = 0;
-    port->wrapped = 0;
+    sem_init(&port->tx_space, 0);
+    sem_init(&port->rx_data, 0);
 
     /* Allocate DMA addressable buffers */
-    port->rx_buffer = malloc(STM32F4_UART_BUFFER_SIZE);
-    if (!port->rx_buffer) {
+    rx_buffer = malloc(STM32F4_UART_RX_RING_SIZE);
+    if (!rx_buffer) {
         goto err_free_port;
     }
 
-    port->tx_buffer = malloc(STM32F4_UART_BUFFER_SIZE);
-    if (!port->tx_buffer) {
+    ring_init(&port->rx_ring, rx_buffer, STM32F4_UART_RX_RING_SIZE);
+
+    tx_buffer = malloc(STM32F4_UART_TX_RING_SIZE);
+    if (!tx_buffer) {
         goto err_free_rx_buffer;
     }
 
+    ring_init(&port->tx_ring, tx_buffer, STM32F4_UART_TX_RING_SIZE);
+
     /* Get the RX and TX DMAs */
     err = stm32f4_dma_allocate(blob, offset, "rx", &port->rx_dma,
                                &port->rx_handle);
@@ -517,6 +763,8 @@ static struct obj *stm32f4_uart_ctor(const char *name) {
         goto err_dealloc_rx_dma;
     }
 
+    port->tx_irq = stm32f4_dma_irq(port->tx_dma, port->tx_handle);
+
     bus = rcc_peripheral_bus(port->periph_id);
     if (bus == STM32F4_UNKNOWN_BUS) {
         goto err_dealloc_tx_dma;
@@ -587,6 +835,8 @@ static struct obj *stm32f4_uart_ctor(const char *name) {
         port->gpio[i] = gpio;
     }
 
+    stm32f4_uart_ports[index] = port;
+
     /* Export to the OS */
     class_export_member(obj);
 
@@ -604,9 +854,9 @@ err_dealloc_tx_dma:
 err_dealloc_rx_dma:
     stm32f4_dma_deallocate(port->rx_dma, port->rx_handle);
 err_free_tx_buffer:
-    free(port->tx_buffer);
+    free(tx_buffer);
 err_free_rx_buffer:
-    free(port->rx_buffer);
+    free(rx_buffer);
 err_free_port:
     kfree(port);
 err_free_obj:
@@ -24,10 +24,14 @@
 #include <arch/system.h>
 #include <dev/hw/systick.h>
 
+/* Core clock cycles per system tick */
+#define SYSTICK_CYCLES  (CONFIG_SYS_CLOCK / CONFIG_SYSTICK_FREQ)
+
 void init_systick(void) {
-    *SYSTICK_RELOAD = CONFIG_SYS_CLOCK / CONFIG_SYSTICK_FREQ;
+    *SYSTICK_RELOAD = SYSTICK_CYCLES;
     *SYSTICK_VAL = 0;
-    *SYSTICK_CTL = 0x00000007;
+    *SYSTICK_CTL = SYSTICK_CTL_ENABLE | SYSTICK_CTL_TICKINT |
+                   SYSTICK_CTL_CLKSOURCE;
 
     /* Set PendSV and SVC to lowest priority.
      * This means that both will be deferred
@@ -38,3 +42,81 @@ void init_systick(void) {
     *NVIC_IPR(14) = 0xFF;
 }
 
+#ifdef CONFIG_SCHED_TICKLESS
+
+/* Ticks programmed for the current tickless sleep, 0 if not sleeping */
+static uint32_t tickless_ticks;
+/* Cycles of the current tick that had elapsed when the sleep began */
+static uint32_t tickless_offset;
+
+uint32_t systick_tickless_max(void) {
+    return (SYSTICK_RELOAD_MAX + 1) / SYSTICK_CYCLES;
+}
+
+int systick_tickless_start(uint32_t ticks) {
+    uint32_t val;
+
+    *SYSTICK_CTL &= ~SYSTICK_CTL_ENABLE;
+
+    /* A tick arrived before the counter stopped, let it run normally */
+    if (*SCB_ICSR & (SCB_ICSR_PENDSTSET | SCB_ICSR_PENDSVSET)) {
+        *SYSTICK_CTL |= SYSTICK_CTL_ENABLE;
+        return -1;
+    }
+
+    val = *SYSTICK_VAL;
+    tickless_offset = SYSTICK_CYCLES - val;
+    tickless_ticks = ticks;
+
+    /* Expire on the boundary of the ticks'th tick from now */
+    *SYSTICK_RELOAD = val + (ticks - 1) * SYSTICK_CYCLES - 1;
+    *SYSTICK_VAL = 0;
+    *SYSTICK_CTL |= SYSTICK_CTL_ENABLE;
+
+    return 0;
+}
+
+uint32_t systick_tickless_stop(void) {
+    uint32_t ctl, val, load, elapsed, ticks, remainder;
+
+    load = *SYSTICK_RELOAD;
+    /* Reading CTL clears COUNTFLAG */
+    ctl = *SYSTICK_CTL;
+    val = *SYSTICK_VAL;
+    *SYSTICK_CTL = ctl & ~SYSTICK_CTL_ENABLE;
+
+    if (ctl & SYSTICK_CTL_COUNTFLAG) {
+        /*
+         * The sleep ran to completion.  The expiry has now been
+         * accounted for, so don't let it tick again.  PendSV may
+         * still be needed for deferred work, so leave it pending.
+         */
+        *SCB_ICSR = SCB_ICSR_PENDSTCLR;
+        systick_pending = 0;
+        ticks = tickless_ticks;
+        elapsed = load + 1 - val;
+    }
+    else {
+        ticks = 0;
+        elapsed = tickless_offset + load + 1 - val;
+    }
+
+    ticks += elapsed / SYSTICK_CYCLES;
+    remainder = elapsed % SYSTICK_CYCLES;
+
+    /*
+     * Finish the partial tick, then resume normal periodic ticks.
+     * The counter picks up the short reload value when VAL is cleared,
+     * so the full reload value can be restored immediately after.
+     */
+    *SYSTICK_RELOAD = SYSTICK_CYCLES - remainder;
+    *SYSTICK_VAL = 0;
+    *SYSTICK_CTL |= SYSTICK_CTL_ENABLE;
+    *SYSTICK_RELOAD = SYSTICK_CYCLES;
+
+    tickless_ticks = 0;
+
+    return ticks;
+}
+
+#endif
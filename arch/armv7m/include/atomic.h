@@ -135,6 +135,10 @@ static inline uint32_t atomic_and(uint32_t *ptr, uint32_t val) {
     return ret;
 }
 
+static __always_inline void data_memory_barrier(void) {
+    asm volatile ("dmb" ::: "memory");
+}
+
 static __always_inline uint32_t load_link32(volatile uint32_t *address) {
     uint32_t val;
 
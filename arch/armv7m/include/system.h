@@ -142,7 +142,16 @@ static __always_inline uint32_t *MSP(void) {
 #define CONTROL_SPSEL                   (1 << 1)                                                /* SP selection */
 #define CONTROL_FPCA                    (1 << 2)                                                /* FP extension enable */
 
+/* SysTick Timer */
+#define SYSTICK_CTL_ENABLE              (uint32_t) (1 << 0)                                     /* Counter enable */
+#define SYSTICK_CTL_TICKINT             (uint32_t) (1 << 1)                                     /* SysTick exception request enable */
+#define SYSTICK_CTL_CLKSOURCE           (uint32_t) (1 << 2)                                     /* Use processor clock */
+#define SYSTICK_CTL_COUNTFLAG           (uint32_t) (1 << 16)                                    /* Counted to 0 since last read */
+#define SYSTICK_RELOAD_MAX              (uint32_t) (0x00FFFFFF)                                 /* Reload value is 24 bits */
+
 /* System Control Block */
+#define SCB_ICSR_PENDSTCLR              (uint32_t) (1 << 25)                                    /* Clear SysTick interrupt */
+#define SCB_ICSR_PENDSTSET              (uint32_t) (1 << 26)                                    /* Set SysTick interrupt */
 #define SCB_ICSR_PENDSVCLR              (uint32_t) (1 << 27)                                    /* Clear PendSV interrupt */
 #define SCB_ICSR_PENDSVSET              (uint32_t) (1 << 28)                                    /* Set PendSV interrupt */
 
@@ -208,4 +217,22 @@ static __always_inline uint32_t *MSP(void) {
  * ST PM0214 (Cortex M4 Programming Manual) pg. 236 */
 #define FPU_CCR_ASPEN                   (uint32_t) (1 << 31)                                    /* FPU Automatic State Preservation */
 
+/* NVIC helpers, irq is the external interrupt number (vector number - 16) */
+static inline void nvic_enable_irq(uint32_t irq) {
+    *(NVIC_ISER0 + (irq / 32)) = 1 << (irq % 32);
+}
+
+static inline void nvic_disable_irq(uint32_t irq) {
+    *(NVIC_ICER0 + (irq / 32)) = 1 << (irq % 32);
+    asm volatile ("dsb\n\tisb" ::: "memory");
+}
+
+static inline void nvic_set_pending(uint32_t irq) {
+    *(NVIC_ISPR0 + (irq / 32)) = 1 << (irq % 32);
+}
+
+static inline void nvic_set_priority(uint32_t irq, uint8_t priority) {
+    *NVIC_IPR(irq) = priority;
+}
+
 #endif
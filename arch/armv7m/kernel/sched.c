@@ -21,19 +21,35 @@
  */
 
 #include <arch/system.h>
+#include <dev/hw/systick.h>
 #include <kernel/sched.h>
 #include <kernel/sched_internals.h>
 #include "sched.h"
 
+volatile uint8_t systick_pending = 0;
+
 /* System tick interrupt handler */
 void systick_handler(void) {
+    systick_pending = 1;
+
     /* Call PendSV to do switching */
     *SCB_ICSR |= SCB_ICSR_PENDSVSET;
 }
 
-/* PendSV interrupt handler */
+/*
+ * PendSV interrupt handler
+ *
+ * PendSV is pended by the system tick, and by interrupts that queued
+ * deferred work.  Both are handled by the tick.
+ */
 void pendsv_handler(void){
-    sched_system_tick();
+    if (systick_pending) {
+        systick_pending = 0;
+        sched_system_tick();
+    }
+    else {
+        sched_deferred_work();
+    }
 }
 
 uint32_t *get_user_stack_pointer(void) {
@@ -25,6 +25,10 @@
 #include <kernel/sched.h>
 #include <kernel/sched_internals.h>
 #include <kernel/mutex.h>
+#include <kernel/timer.h>
+#include <kernel/sem.h>
+#include <kernel/event.h>
+#include <kernel/msgq.h>
 
 void svc_handler(uint32_t*) __attribute__((section(".kernel")));
 
@@ -41,6 +45,9 @@ void svc_handler(uint32_t *registers) {
         case SVC_END_TASK:
         case SVC_REGISTER_TASK:
         case SVC_TASK_SWITCH:
+        case SVC_TASK_SLEEP:
+        case SVC_TICKLESS_ENTER:
+        case SVC_TICKLESS_EXIT:
             registers[0] = sched_service_call(svc_number, registers[0],
                                               registers[1]);
             break;
@@ -48,6 +55,26 @@ void svc_handler(uint32_t *registers) {
         case SVC_RELEASE:
             registers[0] = mutex_service_call(svc_number, registers[0]);
             break;
+        case SVC_TIMER_START:
+        case SVC_TIMER_STOP:
+            registers[0] = timer_service_call(svc_number, registers[0],
+                                              registers[1]);
+            break;
+        case SVC_SEM_WAIT:
+        case SVC_SEM_POST:
+            registers[0] = sem_service_call(svc_number, registers[0],
+                                            registers[1]);
+            break;
+        case SVC_EVENT_WAIT:
+        case SVC_EVENT_SET:
+            registers[0] = event_service_call(svc_number, registers[0],
+                                              registers[1]);
+            break;
+        case SVC_MSGQ_SEND:
+        case SVC_MSGQ_RECEIVE:
+            registers[0] = msgq_service_call(svc_number, registers[0],
+                                             registers[1]);
+            break;
         default:
             panic_print("Unknown SVC: %d", svc_number);
             break;
@@ -96,35 +96,33 @@ static int lis302dl_get_raw_data(struct accel *a, struct accel_raw_data *data) {
     /* Burst read of 5 bytes, starting at OUTX */
     uint8_t addr = LIS302DL_OUTX | ADDR_INC | SPI_READ;
     uint8_t databuf[5];
+    /* Write start address, then read data */
+    struct spi_seg segs[2] = {
+        { .tx = &addr, .rx = NULL, .len = 1 },
+        { .tx = NULL, .rx = databuf, .len = 5 },
+    };
+    struct spi_xfer xfer = {
+        .dev = &lis_accel->spi_dev,
+        .segs = segs,
+        .num = 2,
+        .complete = NULL,
+    };
 
     if (!lis_accel->ready) {
         struct accel_ops *accel_ops = (struct accel_ops *)a->obj.ops;
         accel_ops->init(a);
     }
 
-    spi_ops->start_transaction(spi, &lis_accel->spi_dev);
-
-    /* Write start address */
-    if (spi_ops->write(spi, &lis_accel->spi_dev, &addr, 1) != 1) {
-        goto spi_err;
-    }
-    /* Read data */
-    if (spi_ops->read(spi, &lis_accel->spi_dev, databuf, 5) != 5) {
-        goto spi_err;
+    if (spi_ops->transfer(spi, &xfer)) {
+        return -1;
     }
 
-    spi_ops->end_transaction(spi, &lis_accel->spi_dev);
-
     /* Ignore unused registers between output registers */
     data->x = (int8_t) databuf[0];
     data->y = (int8_t) databuf[2];
     data->z = (int8_t) databuf[4];
 
     return 0;
-
-spi_err:
-    spi_ops->end_transaction(spi, &lis_accel->spi_dev);
-    return -1;
 }
 
 static int lis302dl_get_data(struct accel *a, struct accel_data *data) {
@@ -220,16 +218,16 @@ static int lis302dl_probe(const char *name) {
     /* Default to assuming no device */
     ret = 0;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, LIS302DL_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, LIS302DL_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -282,16 +280,16 @@ static struct obj *lis302dl_ctor(const char *name) {
     struct accel *accel;
     struct lis302dl *lis_accel;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, LIS302DL_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, LIS302DL_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
@@ -20,6 +20,7 @@
  * SOFTWARE.
  */
 
+#include <atomic.h>
 #include <libfdt.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -29,194 +30,419 @@
 #include <dev/fdtparse.h>
 #include <dev/hw/i2c.h>
 #include <dev/baro.h>
+#include <dev/sensor_stream.h>
 #include <kernel/init.h>
 #include <kernel/mutex.h>
 #include <mm/mm.h>
 
+#define MS5611_COMPAT    "meas-spec,ms5611-01ba03"
+
+/* Commands */
+#define MS5611_ADC_READ         0x00
+#define MS5611_CONVERT_D1       0x48    /* Pressure, OSR 4096 */
+#define MS5611_CONVERT_D2       0x58    /* Temperature, OSR 4096 */
+#define MS5611_PROM_READ(n)     (0xA0 + 2*(n))
+
+/* OSR 4096 conversions take up to 9.04ms */
+#define MS5611_CONVERSION_US    10000
+
+/* Conversions until the first reading: temperature, then pressure */
+#define MS5611_FIRST_READING    3
+
+/* Samples queued for stream readers */
+#define MS5611_STREAM_DEPTH     16
+
+enum ms5611_conversion {
+    MS5611_CONVERT_NONE,
+    MS5611_CONVERT_PRESSURE,
+    MS5611_CONVERT_TEMPERATURE,
+};
+
+/*
+ * The MS5611 converts pressure (D1) and temperature (D2) on command, and
+ * a conversion must finish before the result is read.  Rather than have
+ * each reader wait out the conversions, a sensor timer steps through them
+ * in the background every MS5611_CONVERSION_US.  Each step reads the last
+ * conversion and starts the next, converting temperature once every
+ * CONFIG_MS5611_TEMP_INTERVAL pressure conversions.  Each pressure result
+ * is compensated with the latest temperature and published.
+ *
+ * Without sensor streams there is no sensor task, so get_data() steps the
+ * conversions itself, under lock, until a new reading is published.
+ */
 struct ms5611 {
     uint8_t             ready;
     int                 addr;
     struct mutex        lock;
     uint16_t            c[7];   /* Conversion parameters */
+
+    /* Conversion state, only touched by the sensor timer once ready */
+    uint8_t             converting;     /* enum ms5611_conversion */
+    uint8_t             have_d2;
+    uint32_t            d2;             /* Latest digital temperature */
+    uint32_t            pressures;      /* Since the last temperature */
+
+    /* Latest reading, protected by data_lock */
+    struct mutex        data_lock;
+    struct baro_data    latest;
+
+#ifdef CONFIG_SENSOR_STREAMS
+    struct sensor_timer     timer;
+    uint64_t                start;      /* Timestamp of conversion start */
+    uint8_t                 streaming;
+    struct sensor_stream    stream;
+#endif
 };
 
-#define MS5611_COMPAT    "meas-spec,ms5611-01ba03"
+/* Send a command with no response */
+static int ms5611_command(struct i2c *i2c, uint8_t addr, uint8_t cmd) {
+    struct i2c_ops *i2c_ops = (struct i2c_ops *) i2c->obj.ops;
+
+    return i2c_ops->write(i2c, addr, &cmd, 1) == 1 ? 0 : -1;
+}
+
+/* Send a command, then read its response after a repeated start */
+static int ms5611_read(struct i2c *i2c, uint8_t addr, uint8_t cmd,
+                       uint8_t *buf, uint32_t len) {
+    struct i2c_ops *i2c_ops = (struct i2c_ops *) i2c->obj.ops;
+    struct i2c_msg msgs[2] = {
+        {
+            .addr = addr,
+            .flags = 0,
+            .buf = &cmd,
+            .len = 1,
+        },
+        {
+            .addr = addr,
+            .flags = I2C_MSG_READ,
+            .buf = buf,
+            .len = len,
+        },
+    };
+
+    return i2c_ops->transfer(i2c, msgs, 2) == 2 ? 0 : -1;
+}
+
+/**
+ * Read MS5611 ADC
+ *
+ * Read the result of the last conversion.  The ADC reads zero if no
+ * conversion was started, or it has not finished.
+ *
+ * @param i2c   I2C bus that MS5611 is on
+ * @param addr  Device I2C address
+ * @param value Pointer to unsigned int to place ADC value in
+ *
+ * @returns 0 on sucess, negative on error
+ */
+static int ms5611_read_adc(struct i2c *i2c, uint8_t addr, uint32_t *value) {
+    uint8_t raw_data[3];
+
+    if (ms5611_read(i2c, addr, MS5611_ADC_READ, raw_data, 3)) {
+        return -1;
+    }
+
+    *value = (raw_data[0] << 16) | (raw_data[1] << 8) | raw_data[2];
+
+    return *value ? 0 : -1;
+}
+
+/* Compensate digital pressure d1 with digital temperature d2 */
+static void ms5611_compensate(struct ms5611 *ms5611_baro, uint32_t d1,
+                              uint32_t d2, struct baro_data *data) {
+    int64_t dT = d2 - ((uint64_t) ms5611_baro->c[5] << 8);
+    int64_t temp = 2000 + ((dT * (uint64_t) ms5611_baro->c[6]) >> 23);
+
+    int64_t off = ((uint64_t) ms5611_baro->c[2] << 16) +
+                  (((uint64_t) ms5611_baro->c[4] * dT) >> 7);
+
+    int64_t sens = ((uint64_t) ms5611_baro->c[1] << 15) +
+                   (((uint64_t) ms5611_baro->c[3] * dT) >> 8);
+
+    /* Untested! It isn't cold enough in here */
+    if (temp < 2000) {
+        int64_t temp2;
+        int64_t off2;
+        int64_t sens2;
+
+        temp2 = (dT * dT) >> 31;
+        off2 = (5 * (temp - 2000) * (temp - 2000)) >> 1;
+        sens2 = (5 * (temp - 2000) * (temp - 2000)) >> 2;
+
+        if (temp < -1500) {
+            off2 = off2 + 7 * (temp + 1500) * (temp + 1500);
+            sens2 = sens2 + ((11 * (temp + 1500) * (temp + 1500)) >> 1);
+        }
+
+        temp = temp - temp2;
+        off = off - off2;
+        sens = sens - sens2;
+    }
+
+    int64_t pressure = ((d1 * sens >> 21) - off) >> 15;
+
+    data->pressure = (float) (int) pressure;
+    data->temperature = ((int) temp)/100.0;
+}
+
+/* Make a new pressure reading available to readers */
+static void ms5611_publish(struct baro *baro, uint32_t d1) {
+    struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
+    struct baro_sample sample;
+
+    ms5611_compensate(ms5611_baro, d1, ms5611_baro->d2, &sample.data);
+
+    acquire(&ms5611_baro->data_lock);
+    sample.data.sequence = ms5611_baro->latest.sequence + 1;
+    ms5611_baro->latest = sample.data;
+    release(&ms5611_baro->data_lock);
+
+#ifdef CONFIG_SENSOR_STREAMS
+    if (ms5611_baro->streaming) {
+        sample.timestamp = ms5611_baro->start;
+        sensor_stream_push(&ms5611_baro->stream, &sample, 1);
+    }
+#endif
+}
+
+/*
+ * Step the conversion state machine
+ *
+ * Collect the conversion started last step, then start the next.  On any
+ * error, the next step starts over with a temperature conversion.
+ */
+static void ms5611_step(struct baro *baro) {
+    struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
+    struct i2c *i2c = to_i2c(baro->device.parent);
+    uint8_t next, cmd;
+    uint32_t value;
+
+    switch (ms5611_baro->converting) {
+    case MS5611_CONVERT_TEMPERATURE:
+        if (!ms5611_read_adc(i2c, ms5611_baro->addr, &value)) {
+            ms5611_baro->d2 = value;
+            ms5611_baro->have_d2 = 1;
+            ms5611_baro->pressures = 0;
+        }
+        break;
+    case MS5611_CONVERT_PRESSURE:
+        if (!ms5611_read_adc(i2c, ms5611_baro->addr, &value)) {
+            ms5611_publish(baro, value);
+            ms5611_baro->pressures++;
+        }
+        else {
+            ms5611_baro->have_d2 = 0;
+        }
+        break;
+    }
+
+    if (!ms5611_baro->have_d2 ||
+            ms5611_baro->pressures >= CONFIG_MS5611_TEMP_INTERVAL) {
+        next = MS5611_CONVERT_TEMPERATURE;
+        cmd = MS5611_CONVERT_D2;
+    }
+    else {
+        next = MS5611_CONVERT_PRESSURE;
+        cmd = MS5611_CONVERT_D1;
+    }
+
+    if (ms5611_command(i2c, ms5611_baro->addr, cmd)) {
+        ms5611_baro->converting = MS5611_CONVERT_NONE;
+        ms5611_baro->have_d2 = 0;
+        return;
+    }
+
+#ifdef CONFIG_SENSOR_STREAMS
+    ms5611_baro->start = sensor_timestamp();
+#endif
+    ms5611_baro->converting = next;
+}
+
+#ifdef CONFIG_SENSOR_STREAMS
+/* Step the conversions from the sensor task */
+static void ms5611_timer_step(struct sensor_timer *timer) {
+    ms5611_step((struct baro *) timer->data);
+}
+#endif
 
 static int ms5611_init(struct baro *baro) {
     struct i2c *i2c = to_i2c(baro->device.parent);
-    struct i2c_ops *i2c_ops = (struct i2c_ops *)i2c->obj.ops;
     struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
-    int ret;
-
-    uint8_t packet;
     uint8_t data[2];
+    int ret = 0;
 
     acquire(&ms5611_baro->lock);
 
-    for (int i = 1; i <= 6; i++) {
-        packet = 0xA0 + 2*i;  /* Read C[i] */
-        ret = i2c_ops->write(i2c, ms5611_baro->addr, &packet, 1);
-        if (ret != 1) {
-            goto err_release_mut;
-        }
+    if (ms5611_baro->ready) {
+        goto out;
+    }
 
-        ret = i2c_ops->read(i2c, ms5611_baro->addr, data, 2);
-        if (ret != 2) {
-            goto err_release_mut;
+    for (int i = 1; i <= 6; i++) {
+        ret = ms5611_read(i2c, ms5611_baro->addr, MS5611_PROM_READ(i),
+                          data, 2);
+        if (ret) {
+            goto out;
         }
 
         ms5611_baro->c[i] = (data[0] << 8) | data[1];
     }
 
-    release(&ms5611_baro->lock);
+    ms5611_baro->converting = MS5611_CONVERT_NONE;
+    ms5611_baro->have_d2 = 0;
+    ms5611_baro->pressures = 0;
+    ms5611_baro->latest.sequence = 0;
 
-    ms5611_baro->ready = 1;
+#ifdef CONFIG_SENSOR_STREAMS
+    ret = sensor_timer_start(&ms5611_baro->timer, MS5611_CONVERSION_US);
+    if (ret) {
+        goto out;
+    }
+#endif
 
-    return 0;
+    ms5611_baro->ready = 1;
 
-err_release_mut:
+out:
     release(&ms5611_baro->lock);
-    return -1;
+    return ret;
 }
 
 static int ms5611_deinit(struct baro *baro) {
-    /* The MS5611 has no low power mode */
-    return 0;
-}
-
-static int ms5611_has_temp(struct baro *baro) {
-    return 1;
-}
+    struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
 
-/**
- * Read MS5611 ADC
- *
- * Read the internal ADC and return its contents
- *
- * @param i2c   I2C bus that MS5611 is on
- * @param addr  Device I2C address
- * @param value Pointer to unsigned int to place ADC value in
- *
- * @returns 0 on sucess, negative on error
- */
-static int ms5611_read_adc(struct i2c *i2c, uint8_t addr, uint32_t *value) {
-    struct i2c_ops *i2c_ops = (struct i2c_ops *) i2c->obj.ops;
-    uint8_t packet, raw_data[4];
-    int ret;
+    /* The MS5611 has no low power mode, just stop converting */
+    acquire(&ms5611_baro->lock);
 
-    packet = 0x00;  /* Read ADC */
-    ret = i2c_ops->write(i2c, addr, &packet, 1);
-    if (ret != 1) {
-        return -1;
+#ifdef CONFIG_SENSOR_STREAMS
+    if (ms5611_baro->ready) {
+        sensor_timer_stop(&ms5611_baro->timer);
     }
 
-    ret = i2c_ops->read(i2c, addr, raw_data, 3);
-    if (ret != 3) {
-        return -1;
+    if (ms5611_baro->streaming) {
+        ms5611_baro->streaming = 0;
+        sensor_stream_destroy(&ms5611_baro->stream);
     }
+#endif
 
-    *value = (raw_data[0] << 16) | (raw_data[1] << 8) | raw_data[3];
+    ms5611_baro->ready = 0;
+
+    release(&ms5611_baro->lock);
 
     return 0;
 }
 
+static int ms5611_has_temp(struct baro *baro) {
+    return 1;
+}
+
+#ifdef CONFIG_SENSOR_STREAMS
+/* Return the latest reading, waiting only for the first */
 static int ms5611_get_data(struct baro *baro, struct baro_data *data) {
-    struct i2c *i2c = to_i2c(baro->device.parent);
-    struct i2c_ops *i2c_ops = (struct i2c_ops *) i2c->obj.ops;
     struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
-    uint8_t packet;
-    uint32_t d1, d2;
     int ret;
 
     if (!ms5611_baro->ready) {
-        struct baro_ops *baro_ops = (struct baro_ops *) baro->obj.ops;
-        ret = baro_ops->init(baro);
+        ret = ms5611_init(baro);
         if (ret) {
             return ret;
         }
     }
 
-    acquire(&ms5611_baro->lock);
+    /* One extra period for timer rounding */
+    for (int i = 0; i <= MS5611_FIRST_READING; i++) {
+        acquire(&ms5611_baro->data_lock);
+        *data = ms5611_baro->latest;
+        release(&ms5611_baro->data_lock);
 
-    packet = 0x48;  /* Initiate pressure conversion */
-    ret = i2c_ops->write(i2c, ms5611_baro->addr, &packet, 1);
-    if (ret != 1) {
-        goto err_release_mut;
+        if (data->sequence) {
+            return 0;
+        }
+
+        usleep(MS5611_CONVERSION_US);
     }
 
-    /* Wait 10ms for conversion */
-    usleep(10000);
+    return -1;
+}
+#else
+/*
+ * Step the conversions until a new reading is published
+ *
+ * The conversion left pending by the last call, and the temperature it
+ * used, may be arbitrarily old, so start over with a temperature
+ * conversion, then a pressure conversion.
+ */
+static int ms5611_get_data(struct baro *baro, struct baro_data *data) {
+    struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
+    uint32_t sequence;
+    int ret = -1;
 
-    /* Digital pressure value */
-    ret = ms5611_read_adc(i2c, ms5611_baro->addr, &d1);
-    if (ret) {
-        goto err_release_mut;
+    if (!ms5611_baro->ready && ms5611_init(baro)) {
+        return -1;
     }
 
-    packet = 0x58;  /* Initiate temperature conversion */
-    ret = i2c_ops->write(i2c, ms5611_baro->addr, &packet, 1);
-    if (ret != 1) {
-        goto err_release_mut;
-    }
+    acquire(&ms5611_baro->lock);
 
-    /* Wait 10ms for conversion */
-    usleep(10000);
+    ms5611_baro->converting = MS5611_CONVERT_NONE;
+    ms5611_baro->have_d2 = 0;
 
-    /* Digital temperature value */
-    ret = ms5611_read_adc(i2c, ms5611_baro->addr, &d2);
-    if (ret) {
-        goto err_release_mut;
+    sequence = ms5611_baro->latest.sequence;
+
+    for (int i = 0; i < MS5611_FIRST_READING; i++) {
+        ms5611_step(baro);
+
+        if (ms5611_baro->latest.sequence != sequence) {
+            *data = ms5611_baro->latest;
+            ret = 0;
+            break;
+        }
+
+        usleep(MS5611_CONVERSION_US);
     }
 
     release(&ms5611_baro->lock);
 
-    /* Perform conversion to actual values */
-    int64_t dT = d2 - ((uint64_t) ms5611_baro->c[5] << 8);
-    int64_t temp = 2000 + ((dT * (uint64_t) ms5611_baro->c[6]) >> 23);
-
-    int64_t off = ((uint64_t) ms5611_baro->c[2] << 16) +
-                  (((uint64_t) ms5611_baro->c[4] * dT) >> 7);
+    return ret;
+}
+#endif
 
-    int64_t sens = ((uint64_t) ms5611_baro->c[1] << 15) +
-                   (((uint64_t) ms5611_baro->c[3] * dT) >> 8);
+#ifdef CONFIG_SENSOR_STREAMS
+static struct sensor_stream *ms5611_get_stream(struct baro *baro) {
+    struct ms5611 *ms5611_baro = (struct ms5611 *) baro->priv;
+    struct sensor_stream *ret = NULL;
 
-    /* Untested! It isn't cold enough in here */
-    if (temp < 2000) {
-        int64_t temp2;
-        int64_t off2;
-        int64_t sens2;
+    if (!ms5611_baro->ready && ms5611_init(baro)) {
+        return NULL;
+    }
 
-        temp2 = (dT * dT) >> 31;
-        off2 = (5 * (temp - 2000) * (temp - 2000)) >> 1;
-        sens2 = (5 * (temp - 2000) * (temp - 2000)) >> 2;
+    acquire(&ms5611_baro->lock);
 
-        if (temp < -1500) {
-            off2 = off2 + 7 * (temp + 1500) * (temp + 1500);
-            sens2 = sens2 + ((11 * (temp + 1500) * (temp + 1500)) >> 1);
+    if (!ms5611_baro->streaming) {
+        if (sensor_stream_init(&ms5611_baro->stream,
+                               sizeof(struct baro_sample),
+                               MS5611_STREAM_DEPTH)) {
+            goto out;
         }
 
-        temp = temp - temp2;
-        off = off - off2;
-        sens = sens - sens2;
+        /* The stream must be ready before the sensor task sees this */
+        data_memory_barrier();
+        ms5611_baro->streaming = 1;
     }
 
-    int64_t pressure = ((d1 * sens >> 21) - off) >> 15;
-
-    data->pressure = (float) (int) pressure;
-    data->temperature = ((int) temp)/100.0;
-
-    return 0;
+    ret = &ms5611_baro->stream;
 
-err_release_mut:
+out:
     release(&ms5611_baro->lock);
-    return -1;
+    return ret;
 }
+#endif
 
 struct baro_ops ms5611_ops = {
     .init = ms5611_init,
     .deinit = ms5611_deinit,
     .has_temp = ms5611_has_temp,
     .get_data = ms5611_get_data,
+#ifdef CONFIG_SENSOR_STREAMS
+    .get_stream = ms5611_get_stream,
+#endif
 };
 
 /* No way to identify chip, simply check for something at the address */
@@ -230,16 +456,16 @@ static int ms5611_probe(const char *name) {
     uint8_t data;
     int ret = 0;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MS5611_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MS5611_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -291,16 +517,16 @@ static struct obj *ms5611_ctor(const char *name) {
     struct baro *baro;
     struct ms5611 *ms5611_baro;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MS5611_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MS5611_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
@@ -332,6 +558,11 @@ static struct obj *ms5611_ctor(const char *name) {
     ms5611_baro = (struct ms5611 *) baro->priv;
     ms5611_baro->ready = 0;
     init_mutex(&ms5611_baro->lock);
+    init_mutex(&ms5611_baro->data_lock);
+#ifdef CONFIG_SENSOR_STREAMS
+    ms5611_baro->streaming = 0;
+    sensor_timer_init(&ms5611_baro->timer, ms5611_timer_step, baro);
+#endif
 
     err = fdtparse_get_int(blob, offset, "reg", &ms5611_baro->addr);
     if (err) {
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <kernel/mutex.h>
+#include <dev/buffered_stream.h>
+#include <dev/char.h>
+
+struct buffered_stream {
+    struct char_device *dev;
+    enum stream_buffering mode;
+    char *buf;
+    uint32_t count;
+    uint32_t size;
+    struct mutex lock;
+};
+
+/* Write out buffered data.  Call with stream lock held. */
+static int buffered_stream_drain(struct buffered_stream *stream) {
+    int ret;
+
+    if (!stream->count) {
+        return 0;
+    }
+
+    ret = write_block(stream->dev, stream->buf, stream->count);
+    if (ret < 0) {
+        return ret;
+    }
+
+    stream->count = 0;
+
+    return 0;
+}
+
+static int buffered_stream_read(struct char_device *dev, char *buf,
+                                size_t num) {
+    struct buffered_stream *stream = dev->priv;
+    int ret;
+
+    /* Anything printed before reading, like a prompt, should be seen */
+    acquire(&stream->lock);
+    ret = buffered_stream_drain(stream);
+    release(&stream->lock);
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    return read(stream->dev, buf, num);
+}
+
+static int buffered_stream_write(struct char_device *dev, const char *buf,
+                                 size_t num) {
+    struct buffered_stream *stream = dev->priv;
+    size_t left = num;
+    int ret = 0;
+
+    acquire(&stream->lock);
+
+    if (stream->mode == STREAM_UNBUFFERED) {
+        ret = buffered_stream_drain(stream);
+        if (ret >= 0) {
+            ret = write(stream->dev, buf, num);
+        }
+
+        release(&stream->lock);
+        return ret;
+    }
+
+    /* Too big to be worth buffering, keep ordering and write it directly */
+    if (num >= stream->size) {
+        ret = buffered_stream_drain(stream);
+        if (ret >= 0) {
+            ret = write_block(stream->dev, buf, num);
+        }
+
+        release(&stream->lock);
+        return ret;
+    }
+
+    while (left > 0) {
+        uint32_t chunk = stream->size - stream->count;
+
+        if (!chunk) {
+            ret = buffered_stream_drain(stream);
+            if (ret < 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (chunk > left) {
+            chunk = left;
+        }
+
+        memcpy(&stream->buf[stream->count], buf, chunk);
+        stream->count += chunk;
+        buf += chunk;
+        left -= chunk;
+    }
+
+    if (ret >= 0 && stream->mode == STREAM_LINE_BUFFERED &&
+            memchr(buf - num + left, '\n', num - left)) {
+        ret = buffered_stream_drain(stream);
+    }
+
+    release(&stream->lock);
+
+    /* Data left in the buffer has been accepted */
+    return ret < 0 ? ret : (int) (num - left);
+}
+
+static int buffered_stream_flush(struct char_device *dev) {
+    struct buffered_stream *stream = dev->priv;
+    int ret;
+
+    acquire(&stream->lock);
+    ret = buffered_stream_drain(stream);
+    release(&stream->lock);
+
+    return ret;
+}
+
+static int buffered_stream_cleanup(struct char_device *dev) {
+    struct buffered_stream *stream = dev->priv;
+
+    buffered_stream_drain(stream);
+    char_device_put(stream->dev);
+    free(stream);
+
+    return 0;
+}
+
+static struct char_ops buffered_stream_ops = {
+    .read = buffered_stream_read,
+    .write = buffered_stream_write,
+    .flush = buffered_stream_flush,
+    ._cleanup = buffered_stream_cleanup,
+};
+
+struct char_device *buffered_stream_create(struct char_device *dev,
+                                           enum stream_buffering mode,
+                                           uint32_t size) {
+    struct char_device *stream_dev;
+    struct buffered_stream *stream;
+
+    if (!dev) {
+        goto err;
+    }
+
+    if (mode == STREAM_UNBUFFERED) {
+        size = 0;
+    }
+    else if (!size) {
+        goto err;
+    }
+
+    /* Buffer follows the stream state */
+    stream = malloc(sizeof(*stream) + size);
+    if (!stream) {
+        goto err;
+    }
+
+    /*
+     * Share the base obj of dev, so the stream is recognized as
+     * the same device as dev
+     */
+    stream_dev = char_device_create(dev->base, &buffered_stream_ops);
+    if (!stream_dev) {
+        goto err_free_stream;
+    }
+
+    obj_get(&dev->obj);
+
+    stream->dev = dev;
+    stream->mode = mode;
+    stream->buf = (char *) &stream[1];
+    stream->count = 0;
+    stream->size = size;
+    init_mutex(&stream->lock);
+
+    stream_dev->priv = stream;
+
+    return stream_dev;
+
+err_free_stream:
+    free(stream);
+err:
+    return NULL;
+}
@@ -22,15 +22,21 @@
 
 #include <linker_array.h>
 #include <stdlib.h>
+#include <dev/buffered_stream.h>
 #include <dev/char.h>
 #include <dev/device.h>
 #include <kernel/fault.h>
 #include <kernel/obj.h>
+#include <mm/slab.h>
 
 LINKER_ARRAY_DECLARE(char_conversions)
 
 static void char_dtor(struct obj *o);
 
+static struct slab_cache char_device_cache =
+    INIT_SLAB_CACHE(char_device_cache, "char_device",
+                    sizeof(struct char_device), 0, NULL);
+
 static struct obj_type char_type_s  = {
     .offset = offset_of(struct char_device, obj),
     .dtor = char_dtor,
@@ -54,12 +60,12 @@ static void char_dtor(struct obj *o) {
         obj_put(c->base);
     }
 
-    free(c);
+    slab_free(&char_device_cache, c);
 }
 
 struct char_device *char_device_create(struct obj *base,
                                        struct char_ops *ops) {
-    struct char_device *c = malloc(sizeof(*c));
+    struct char_device *c = slab_alloc(&char_device_cache);
     if (!c) {
         return NULL;
     }
@@ -129,11 +135,33 @@ int char_device_base_equal(const struct char_device *d1,
 }
 
 void init_io(void) {
-    curr_task->_stdout = char_device_get(CONFIG_STDOUT_DEV);
-    curr_task->_stdin =  curr_task->_stdout;
+    struct char_device *out;
+
+    out = char_device_get(CONFIG_STDOUT_DEV);
+    if (!out) {
+        panic();
+    }
+
+#if CONFIG_STDOUT_BUFFER_SIZE > 0
+    /* Line buffer stdout, falling back to the raw device */
+    struct char_device *buffered;
+
+    buffered = buffered_stream_create(out, STREAM_LINE_BUFFERED,
+                                      CONFIG_STDOUT_BUFFER_SIZE);
+    if (buffered) {
+        char_device_put(out);
+        out = buffered;
+    }
+#endif
+
+    /* stdin and stdout each hold a reference, put separately on task exit */
+    obj_get(&out->obj);
+
+    curr_task->_stdout = out;
+    curr_task->_stdin =  out;
     curr_task->_stderr = char_device_get(CONFIG_STDERR_DEV);
 
-    if (!curr_task->_stdout || !curr_task->_stderr) {
+    if (!curr_task->_stderr) {
         panic();
     }
 }
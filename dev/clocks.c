@@ -23,6 +23,7 @@
 #include <libfdt.h>
 #include <stddef.h>
 #include <dev/clocks.h>
+#include <dev/fdtparse.h>
 
 LINKER_ARRAY_DECLARE(clocks)
 
@@ -47,13 +48,13 @@ static struct clock_driver *clocks_lookup(const void *fdt, int offset, const cha
     cell = (fdt32_t *) prop->data;
     phandle = fdt32_to_cpu(cell[0]);
 
-    controller = fdt_node_offset_by_phandle(fdt, phandle);
+    controller = fdtparse_node_offset_by_phandle(fdt, phandle);
     if (controller < 0) {
         return NULL;
     }
 
     LINKER_ARRAY_FOR_EACH(clocks, driver) {
-        if (!fdt_node_check_compatible(fdt, controller, driver->compat)) {
+        if (!fdtparse_node_check_compatible(fdt, controller, driver->compat)) {
             return driver;
         }
     }
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <dev/fdtparse.h>
 #include <kernel/class.h>
+#include <kernel/hash_index.h>
 #include <kernel/obj.h>
 #include <kernel/mutex.h>
 #include <mm/mm.h>
@@ -34,23 +35,52 @@
 
 struct list drivers = INIT_LIST(drivers);
 struct mutex driver_mut = INIT_MUTEX;
+static struct hash_index driver_index =
+    INIT_HASH_INDEX(struct device_driver, name_hash, name, list);
 
 struct list compat_drivers = INIT_LIST(compat_drivers);
 struct mutex compat_driver_mut = INIT_MUTEX;
+static struct hash_index compat_driver_index =
+    INIT_HASH_INDEX(struct device_driver, name_hash, name, list);
+
+/**
+ * Find a registered driver by name
+ *
+ * Uses the driver index when available, otherwise walks the list.
+ * The list mutex must be held.
+ *
+ * @param list  Driver list to search
+ * @param index Index of list
+ * @param name  Driver name to find
+ * @returns most recently registered driver with name, or NULL
+ */
+static struct device_driver *device_driver_find(struct list *list,
+                                                struct hash_index *index,
+                                                const char *name) {
+    struct device_driver *iter, *driver = NULL;
+    uint32_t hash = strhash(name);
+
+    if (!hash_index_find(index, name, hash, (void **) &driver)) {
+        return driver;
+    }
+
+    list_for_each_entry(iter, list, list) {
+        if (iter->name_hash == hash && strcmp(name, iter->name) == 0) {
+            return iter;
+        }
+    }
+
+    return NULL;
+}
 
 /* Find and construct a device */
 struct obj *device_get(const char *name) {
-    struct device_driver *iter, *driver = NULL;
+    struct device_driver *driver;
     struct obj *obj = NULL;
     int exists;
 
     acquire(&driver_mut);
-    list_for_each_entry(iter, &drivers, list) {
-        if (strcmp(name, iter->name) == 0) {
-            driver = iter;
-            break;
-        }
-    }
+    driver = device_driver_find(&drivers, &driver_index, name);
     release(&driver_mut);
 
     /* No driver, too bad... */
@@ -89,14 +119,21 @@ out:
 }
 
 void device_driver_register(struct device_driver *driver) {
+    driver->name_hash = strhash(driver->name);
+
     acquire(&driver_mut);
     list_add(&driver->list, &drivers);
+    /* On failure, lookups fall back to walking the list */
+    hash_index_add(&driver_index, driver, &drivers);
     release(&driver_mut);
 }
 
 void device_compat_driver_register(struct device_driver *driver) {
+    driver->name_hash = strhash(driver->name);
+
     acquire(&compat_driver_mut);
     list_add(&driver->list, &compat_drivers);
+    hash_index_add(&compat_driver_index, driver, &compat_drivers);
     release(&compat_driver_mut);
 }
 
@@ -145,38 +182,36 @@ void device_driver_fdt_register(void) {
      * on the compatible string driver.
      */
     do {
-        const struct fdt_property *prop;
         const char *compat;
         int listlen, compatlen;
 
         offset = fdt_next_node(blob, offset, NULL);
 
-        prop = fdt_get_property(blob, offset, "compatible", &listlen);
-        if (!prop) {
+        compat = fdtparse_getprop(blob, offset, "compatible", &listlen);
+        if (!compat) {
             continue;
         }
 
-        compat = (const char *)prop->data;
         while (listlen > 0) {
-            struct device_driver *iter = NULL;
-            list_for_each_entry(iter, &compat_drivers, list) {
-                if (!strcmp(iter->name, compat)) {
-                    /*
-                     * TODO: Since we are walking the entire tree, we could
-                     * just build the path as we go, rather than calling
-                     * this expensive function, which will itself walk the
-                     * entire tree.
-                     */
-                    char *name = fdtparse_get_path(blob, offset);
-                    if (!name) {
-                        fprintf(stderr, "%s: Unable to get name",
-                                __func__);
-                        goto next_node;
-                    }
-
-                    device_driver_register_from_compat(iter, name);
+            struct device_driver *driver;
+
+            driver = device_driver_find(&compat_drivers, &compat_driver_index,
+                                        compat);
+            if (driver) {
+                /*
+                 * TODO: Since we are walking the entire tree, we could
+                 * just build the path as we go, rather than calling
+                 * this expensive function, which will itself walk the
+                 * entire tree.
+                 */
+                char *name = fdtparse_get_path(blob, offset);
+                if (!name) {
+                    fprintf(stderr, "%s: Unable to get name", __func__);
                     goto next_node;
                 }
+
+                device_driver_register_from_compat(driver, name);
+                goto next_node;
             }
 
             compatlen = strlen(compat);
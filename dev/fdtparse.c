@@ -20,8 +20,10 @@
  * SOFTWARE.
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <libfdt.h>
 #include <dev/fdtparse.h>
 
@@ -34,9 +36,406 @@ const void *fdtparse_get_blob(void) {
     return fdt_blob;
 }
 
+/*
+ * Device tree index
+ *
+ * The blob never changes at runtime, so at boot it is walked once to
+ * build tables of its nodes, phandles, compatible strings and aliases.
+ * Lookups on the global blob are then served from those tables, rather
+ * than by libfdt scanning the structure block from the start.
+ *
+ * Until the index is built, or if there is not enough memory for it,
+ * everything falls back to libfdt.
+ */
+
+/* Deepest node the index can hold */
+#define FDTPARSE_MAX_DEPTH  16
+
+/* Properties kept for every node, so they need not be searched for */
+static const char *const fdtparse_cached_props[] = {
+    "compatible",
+    "reg",
+    "regs",
+    "interrupts",
+    "interrupt-parent",
+};
+
+enum fdtparse_cached_prop {
+    FDTPARSE_PROP_COMPATIBLE,
+    FDTPARSE_PROP_REG,
+    FDTPARSE_PROP_REGS,
+    FDTPARSE_PROP_INTERRUPTS,
+    FDTPARSE_PROP_INTERRUPT_PARENT,
+    FDTPARSE_NUM_PROPS,
+};
+
+struct fdtparse_prop {
+    const void  *data;
+    int         len;    /* Negative if the node does not have the property */
+};
+
+struct fdtparse_node {
+    int         offset;     /* Structure block offset */
+    const char  *name;
+    int16_t     parent;     /* Node indices, or -1 for none */
+    int16_t     first_child;
+    int16_t     next_sibling;
+    struct fdtparse_prop props[FDTPARSE_NUM_PROPS];
+};
+
+struct fdtparse_phandle {
+    uint32_t    phandle;
+    int16_t     node;
+};
+
+struct fdtparse_compat {
+    uint32_t    hash;   /* strhash() of compat */
+    const char  *compat;
+    int16_t     node;
+};
+
+struct fdtparse_alias {
+    const char  *name;
+    int         offset; /* Offset of aliased node, or negative error */
+};
+
+static struct fdtparse_index {
+    /* Nodes, in structure block order, so sorted by offset */
+    struct fdtparse_node    *nodes;
+    int                     num_nodes;
+    /* Sorted by phandle */
+    struct fdtparse_phandle *phandles;
+    int                     num_phandles;
+    /* Every compatible string of every node, sorted by (hash, node) */
+    struct fdtparse_compat  *compats;
+    int                     num_compats;
+    struct fdtparse_alias   *aliases;
+    int                     num_aliases;
+} fdt_index;
+
+static int fdt_index_ready;
+
+/* Index of the global blob, if it has been built */
+static inline int fdtparse_indexed(const void *fdt) {
+    return fdt == fdt_blob && fdt_index_ready;
+}
+
+/* Index of the node at offset, or -1 if it is not a node offset */
+static int fdtparse_node_index(int offset) {
+    int lo = 0, hi = fdt_index.num_nodes - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int curr = fdt_index.nodes[mid].offset;
+
+        if (curr == offset) {
+            return mid;
+        }
+        else if (curr < offset) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+/* Cached property slot for name, or -1 if the property is not cached */
+static int fdtparse_cached_prop(const char *name) {
+    for (int i = 0; i < FDTPARSE_NUM_PROPS; i++) {
+        if (!strcmp(name, fdtparse_cached_props[i])) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Node name matches path component, which may omit the unit address */
+static int fdtparse_name_eq(const char *name, const char *s, int len) {
+    if (strncmp(name, s, len)) {
+        return 0;
+    }
+
+    if (name[len] == '\0') {
+        return 1;
+    }
+
+    return name[len] == '@' && !memchr(s, '@', len);
+}
+
+static int fdtparse_subnode_index(int parent, const char *name, int len) {
+    int child = fdt_index.nodes[parent].first_child;
+
+    while (child >= 0) {
+        if (fdtparse_name_eq(fdt_index.nodes[child].name, name, len)) {
+            return child;
+        }
+
+        child = fdt_index.nodes[child].next_sibling;
+    }
+
+    return -1;
+}
+
+/* Offset of node at absolute path, without aliases */
+static int fdtparse_index_path(const char *path) {
+    int node = 0;
+
+    while (*path) {
+        const char *end;
+
+        while (*path == '/') {
+            path++;
+        }
+
+        if (!*path) {
+            break;
+        }
+
+        end = strchr(path, '/');
+        if (!end) {
+            end = path + strlen(path);
+        }
+
+        node = fdtparse_subnode_index(node, path, end - path);
+        if (node < 0) {
+            return -FDT_ERR_NOTFOUND;
+        }
+
+        path = end;
+    }
+
+    return fdt_index.nodes[node].offset;
+}
+
+static const struct fdtparse_alias *fdtparse_index_alias(const char *name,
+                                                         int len) {
+    for (int i = 0; i < fdt_index.num_aliases; i++) {
+        const char *alias = fdt_index.aliases[i].name;
+
+        if (!strncmp(alias, name, len) && alias[len] == '\0') {
+            return &fdt_index.aliases[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Walk node's properties, filling in its cached ones */
+static void fdtparse_index_props(const void *fdt, struct fdtparse_node *node) {
+    int prop;
+
+    for (int i = 0; i < FDTPARSE_NUM_PROPS; i++) {
+        node->props[i].data = NULL;
+        node->props[i].len = -FDT_ERR_NOTFOUND;
+    }
+
+    for (prop = fdt_first_property_offset(fdt, node->offset); prop >= 0;
+         prop = fdt_next_property_offset(fdt, prop)) {
+        const char *name;
+        const void *data;
+        int len, i;
+
+        data = fdt_getprop_by_offset(fdt, prop, &name, &len);
+        if (!data) {
+            continue;
+        }
+
+        i = fdtparse_cached_prop(name);
+        if (i >= 0) {
+            node->props[i].data = data;
+            node->props[i].len = len;
+        }
+    }
+}
+
+/*
+ * Insert node's compatible strings into compats, keeping it sorted by
+ * (hash, node).  Nodes must be added in order, so equal hashes stay in
+ * node order.
+ */
+static void fdtparse_index_compats(int node, struct fdtparse_compat *compats,
+                                   int *count) {
+    const struct fdtparse_prop *prop =
+        &fdt_index.nodes[node].props[FDTPARSE_PROP_COMPATIBLE];
+    const char *compat = prop->data;
+
+    if (prop->len <= 0) {
+        return;
+    }
+
+    do {
+        if (compats) {
+            uint32_t hash = strhash(compat);
+            int i = *count;
+
+            while (i > 0 && compats[i-1].hash > hash) {
+                compats[i] = compats[i-1];
+                i--;
+            }
+
+            compats[i].hash = hash;
+            compats[i].compat = compat;
+            compats[i].node = node;
+        }
+
+        (*count)++;
+    } while ((compat = fdtparse_stringlist_next(prop->data, compat,
+                                                prop->len)));
+}
+
+static void fdtparse_index_phandle(int node, uint32_t phandle) {
+    int i = fdt_index.num_phandles++;
+
+    /* Insertion sort, phandles are normally already in node order */
+    while (i > 0 && fdt_index.phandles[i-1].phandle > phandle) {
+        fdt_index.phandles[i] = fdt_index.phandles[i-1];
+        i--;
+    }
+
+    fdt_index.phandles[i].phandle = phandle;
+    fdt_index.phandles[i].node = node;
+}
+
+int fdtparse_index_init(void) {
+    const void *fdt = fdt_blob;
+    struct fdtparse_index index = { 0 };
+    int stack[FDTPARSE_MAX_DEPTH];
+    int last_child[FDTPARSE_MAX_DEPTH];
+    int offset, depth, aliases, num_compats;
+    size_t size;
+    void *mem;
+
+    if (fdt_check_header(fdt)) {
+        return -1;
+    }
+
+    /* Size the node and alias tables */
+    offset = 0;
+    depth = 0;
+    do {
+        if (depth >= FDTPARSE_MAX_DEPTH || index.num_nodes >= INT16_MAX) {
+            return -1;
+        }
+
+        index.num_nodes++;
+        offset = fdt_next_node(fdt, offset, &depth);
+    } while (offset >= 0 && depth > 0);
+
+    aliases = fdt_path_offset(fdt, "/aliases");
+    if (aliases >= 0) {
+        int prop;
+
+        for (prop = fdt_first_property_offset(fdt, aliases); prop >= 0;
+             prop = fdt_next_property_offset(fdt, prop)) {
+            index.num_aliases++;
+        }
+    }
+
+    size = index.num_nodes * sizeof(*index.nodes) +
+           index.num_nodes * sizeof(*index.phandles) +
+           index.num_aliases * sizeof(*index.aliases);
+
+    mem = malloc(size);
+    if (!mem) {
+        return -1;
+    }
+
+    index.nodes = mem;
+    index.phandles = (void *) &index.nodes[index.num_nodes];
+    index.aliases = (void *) &index.phandles[index.num_nodes];
+
+    /* Built in place, but not used until fdt_index_ready is set */
+    fdt_index = index;
+    fdt_index.num_nodes = 0;
+
+    offset = 0;
+    depth = 0;
+    do {
+        int i = fdt_index.num_nodes++;
+        struct fdtparse_node *node = &fdt_index.nodes[i];
+        uint32_t phandle;
+
+        node->offset = offset;
+        node->name = fdt_get_name(fdt, offset, NULL);
+        node->parent = depth ? stack[depth-1] : -1;
+        node->first_child = -1;
+        node->next_sibling = -1;
+        fdtparse_index_props(fdt, node);
+
+        if (depth) {
+            if (last_child[depth-1] >= 0) {
+                fdt_index.nodes[last_child[depth-1]].next_sibling = i;
+            }
+            else {
+                fdt_index.nodes[node->parent].first_child = i;
+            }
+
+            last_child[depth-1] = i;
+        }
+
+        stack[depth] = i;
+        last_child[depth] = -1;
+
+        phandle = fdt_get_phandle(fdt, offset);
+        if (phandle) {
+            fdtparse_index_phandle(i, phandle);
+        }
+
+        offset = fdt_next_node(fdt, offset, &depth);
+    } while (offset >= 0 && depth > 0);
+
+    /* Compatible strings are only counted once the props are known */
+    num_compats = 0;
+    for (int i = 0; i < fdt_index.num_nodes; i++) {
+        fdtparse_index_compats(i, NULL, &num_compats);
+    }
+
+    fdt_index.compats = malloc(num_compats * sizeof(*fdt_index.compats));
+    if (num_compats && !fdt_index.compats) {
+        free(mem);
+        return -1;
+    }
+
+    for (int i = 0; i < fdt_index.num_nodes; i++) {
+        fdtparse_index_compats(i, fdt_index.compats, &fdt_index.num_compats);
+    }
+
+    if (aliases >= 0) {
+        int prop;
+
+        fdt_index.num_aliases = 0;
+
+        for (prop = fdt_first_property_offset(fdt, aliases); prop >= 0;
+             prop = fdt_next_property_offset(fdt, prop)) {
+            struct fdtparse_alias *alias =
+                &fdt_index.aliases[fdt_index.num_aliases++];
+            const char *path;
+
+            path = fdt_getprop_by_offset(fdt, prop, &alias->name, NULL);
+            alias->offset = path ? fdtparse_index_path(path)
+                                 : -FDT_ERR_NOTFOUND;
+        }
+    }
+
+    fdt_index_ready = 1;
+
+    return 0;
+}
+
 int fdtparse_alias_offset(const void *fdt, const char *name) {
     const char *path;
 
+    if (fdtparse_indexed(fdt)) {
+        const struct fdtparse_alias *alias =
+            fdtparse_index_alias(name, strlen(name));
+
+        return alias ? alias->offset : -FDT_ERR_NOTFOUND;
+    }
+
     path = fdt_get_alias(fdt, name);
     if (!path) {
         return -FDT_ERR_NOTFOUND;
@@ -45,12 +444,217 @@ int fdtparse_alias_offset(const void *fdt, const char *name) {
     return fdt_path_offset(fdt, path);
 }
 
+int fdtparse_path_offset(const void *fdt, const char *path) {
+    const struct fdtparse_alias *alias;
+    const char *end;
+    int offset, node;
+
+    if (!fdtparse_indexed(fdt)) {
+        return fdt_path_offset(fdt, path);
+    }
+
+    if (*path == '/') {
+        return fdtparse_index_path(path);
+    }
+
+    /* Path starts with an alias */
+    end = strchr(path, '/');
+    if (!end) {
+        end = path + strlen(path);
+    }
+
+    alias = fdtparse_index_alias(path, end - path);
+    if (!alias) {
+        return -FDT_ERR_BADPATH;
+    }
+
+    offset = alias->offset;
+    if (offset < 0 || !*end) {
+        return offset;
+    }
+
+    /* Remainder of path is relative to the aliased node */
+    node = fdtparse_node_index(offset);
+    path = end;
+
+    while (*path) {
+        while (*path == '/') {
+            path++;
+        }
+
+        if (!*path) {
+            break;
+        }
+
+        end = strchr(path, '/');
+        if (!end) {
+            end = path + strlen(path);
+        }
+
+        node = fdtparse_subnode_index(node, path, end - path);
+        if (node < 0) {
+            return -FDT_ERR_NOTFOUND;
+        }
+
+        path = end;
+    }
+
+    return fdt_index.nodes[node].offset;
+}
+
+int fdtparse_subnode_offset(const void *fdt, int offset, const char *name) {
+    int node;
+
+    if (!fdtparse_indexed(fdt) || (node = fdtparse_node_index(offset)) < 0) {
+        return fdt_subnode_offset(fdt, offset, name);
+    }
+
+    node = fdtparse_subnode_index(node, name, strlen(name));
+    if (node < 0) {
+        return -FDT_ERR_NOTFOUND;
+    }
+
+    return fdt_index.nodes[node].offset;
+}
+
+int fdtparse_parent_offset(const void *fdt, int offset) {
+    int node;
+
+    if (!fdtparse_indexed(fdt) || (node = fdtparse_node_index(offset)) < 0) {
+        return fdt_parent_offset(fdt, offset);
+    }
+
+    node = fdt_index.nodes[node].parent;
+    if (node < 0) {
+        return -FDT_ERR_NOTFOUND;
+    }
+
+    return fdt_index.nodes[node].offset;
+}
+
+int fdtparse_node_offset_by_phandle(const void *fdt, uint32_t phandle) {
+    int lo = 0, hi = fdt_index.num_phandles - 1;
+
+    if (!fdtparse_indexed(fdt)) {
+        return fdt_node_offset_by_phandle(fdt, phandle);
+    }
+
+    if (phandle == 0 || phandle == (uint32_t) -1) {
+        return -FDT_ERR_BADPHANDLE;
+    }
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t curr = fdt_index.phandles[mid].phandle;
+
+        if (curr == phandle) {
+            return fdt_index.nodes[fdt_index.phandles[mid].node].offset;
+        }
+        else if (curr < phandle) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    return -FDT_ERR_NOTFOUND;
+}
+
+int fdtparse_node_offset_by_compatible(const void *fdt, int startoffset,
+                                       const char *compatible) {
+    uint32_t hash;
+    int lo, hi, node;
+
+    if (!fdtparse_indexed(fdt)) {
+        return fdt_node_offset_by_compatible(fdt, startoffset, compatible);
+    }
+
+    hash = strhash(compatible);
+
+    /* First node after startoffset */
+    lo = 0;
+    hi = fdt_index.num_nodes;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (fdt_index.nodes[mid].offset > startoffset) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    node = lo;
+
+    /* First entry at or after (hash, node) */
+    lo = 0;
+    hi = fdt_index.num_compats;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const struct fdtparse_compat *entry = &fdt_index.compats[mid];
+
+        if (entry->hash < hash || (entry->hash == hash && entry->node < node)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    /* Only hash collisions are skipped */
+    for (int i = lo; i < fdt_index.num_compats; i++) {
+        const struct fdtparse_compat *entry = &fdt_index.compats[i];
+
+        if (entry->hash != hash) {
+            break;
+        }
+
+        if (!strcmp(entry->compat, compatible)) {
+            return fdt_index.nodes[entry->node].offset;
+        }
+    }
+
+    return -FDT_ERR_NOTFOUND;
+}
+
+int fdtparse_node_check_compatible(const void *fdt, int offset,
+                                   const char *compatible) {
+    const void *prop;
+    int len;
+
+    prop = fdtparse_getprop(fdt, offset, "compatible", &len);
+    if (!prop) {
+        return len;
+    }
+
+    return !fdt_stringlist_contains(prop, len, compatible);
+}
+
+const void *fdtparse_getprop(const void *fdt, int offset, const char *name,
+                             int *lenp) {
+    const struct fdtparse_prop *prop;
+    int node, i;
+
+    if (!fdtparse_indexed(fdt) || (node = fdtparse_node_index(offset)) < 0 ||
+            (i = fdtparse_cached_prop(name)) < 0) {
+        return fdt_getprop(fdt, offset, name, lenp);
+    }
+
+    prop = &fdt_index.nodes[node].props[i];
+
+    if (lenp) {
+        *lenp = prop->len;
+    }
+
+    return prop->data;
+}
+
 int fdtparse_get_int(const void *fdt, int offset, const char *name, int *val) {
-    const struct fdt_property *prop;
+    const fdt32_t *cell;
     int len;
-    fdt32_t *cell;
 
-    prop = fdt_get_property(fdt, offset, name, &len);
+    cell = fdtparse_getprop(fdt, offset, name, &len);
     if (len < 0) {
         return len;
     }
@@ -58,35 +662,29 @@ int fdtparse_get_int(const void *fdt, int offset, const char *name, int *val) {
         return -FDT_ERR_NOTFOUND;
     }
 
-    cell = (fdt32_t *) prop->data;
-
     *val = fdt32_to_cpu(cell[0]);
 
     return 0;
 }
 
 void *fdtparse_get_addr32(const void *fdt, int offset, const char *name) {
-    const struct fdt_property *prop;
+    const fdt32_t *cell;
     int len;
-    fdt32_t *cell;
 
-    prop = fdt_get_property(fdt, offset, name, &len);
-    if (len < sizeof(fdt32_t)) {
+    cell = fdtparse_getprop(fdt, offset, name, &len);
+    if (!cell || len < sizeof(fdt32_t)) {
         return NULL;
     }
 
-    cell = (fdt32_t *) prop->data;
-
     return (void *)fdt32_to_cpu(cell[0]);
 }
 
 int fdtparse_get_gpio(const void *fdt, int offset, const char *name,
                       struct fdt_gpio *gpio) {
-    const struct fdt_property *prop;
+    const fdt32_t *cell;
     int len;
-    fdt32_t *cell;
 
-    prop = fdt_get_property(fdt, offset, name, &len);
+    cell = fdtparse_getprop(fdt, offset, name, &len);
     if (len < 0) {
         return len;
     }
@@ -96,8 +694,6 @@ int fdtparse_get_gpio(const void *fdt, int offset, const char *name,
         return -FDT_ERR_BADLAYOUT;
     }
 
-    cell = (fdt32_t *) prop->data;
-
     /* cell[0] is gpio path, cell[1] is number, cell[2] is flags */
     gpio->gpio = fdt32_to_cpu(cell[1]);
     gpio->flags = fdt32_to_cpu(cell[2]);
@@ -107,11 +703,10 @@ int fdtparse_get_gpio(const void *fdt, int offset, const char *name,
 
 int fdtparse_get_gpios(const void *fdt, int offset, const char *name,
                        struct fdt_gpio *gpio, int max) {
-    const struct fdt_property *prop;
+    const fdt32_t *cell;
     int len, num, i;
-    fdt32_t *cell;
 
-    prop = fdt_get_property(fdt, offset, name, &len);
+    cell = fdtparse_getprop(fdt, offset, name, &len);
     if (len < 0) {
         return len;
     }
@@ -122,8 +717,6 @@ int fdtparse_get_gpios(const void *fdt, int offset, const char *name,
         return -FDT_ERR_BADLAYOUT;
     }
 
-    cell = (fdt32_t *) prop->data;
-
     for (i = 0; i < num; i++, cell += 3) {
         /* cell[0] is gpio path, cell[1] is number, cell[2] is flags */
         gpio[i].gpio = fdt32_to_cpu(cell[1]);
@@ -133,10 +726,51 @@ int fdtparse_get_gpios(const void *fdt, int offset, const char *name,
     return num;
 }
 
+/* Build the path from the names of node and its parents */
+static char *fdtparse_index_get_path(int node) {
+    int size = 1;
+    char *path;
+
+    for (int i = node; fdt_index.nodes[i].parent >= 0;
+         i = fdt_index.nodes[i].parent) {
+        size += strlen(fdt_index.nodes[i].name) + 1;
+    }
+
+    /* The root is "/", rather than the empty string */
+    if (size == 1) {
+        size = 2;
+    }
+
+    path = malloc(size);
+    if (!path) {
+        fprintf(stderr, "%s: Unable to allocate %d bytes for path\n",
+                __func__, size);
+        return NULL;
+    }
+
+    path[--size] = '\0';
+    path[0] = '/';
+
+    for (int i = node; fdt_index.nodes[i].parent >= 0;
+         i = fdt_index.nodes[i].parent) {
+        int len = strlen(fdt_index.nodes[i].name);
+
+        size -= len;
+        memcpy(&path[size], fdt_index.nodes[i].name, len);
+        path[--size] = '/';
+    }
+
+    return path;
+}
+
 char *fdtparse_get_path(const void *fdt, int offset) {
-    int err, size;
+    int err, size, node;
     char *path = NULL;
 
+    if (fdtparse_indexed(fdt) && (node = fdtparse_node_index(offset)) >= 0) {
+        return fdtparse_index_get_path(node);
+    }
+
     /* Make an arbitrary best guess at the max path size */
     size = 32;
 
@@ -170,17 +804,15 @@ char *fdtparse_get_path(const void *fdt, int offset) {
 
 int fdtparse_get_interrupt_parent(const void *fdt, int nodeoffset) {
     int len;
-    const struct fdt_property *interrupt_parent;
-    fdt32_t *cell;
+    const fdt32_t *cell;
     uint32_t parent_phandle;
     int parent_offset;
 
     /* Use "interrupt-parent" from node, or node's parent */
     do {
-        interrupt_parent = fdt_get_property(fdt, nodeoffset,
-                                            "interrupt-parent", &len);
+        cell = fdtparse_getprop(fdt, nodeoffset, "interrupt-parent", &len);
     } while ((len < 0) &&
-             (nodeoffset = fdt_parent_offset(fdt, nodeoffset)) >= 0);
+             (nodeoffset = fdtparse_parent_offset(fdt, nodeoffset)) >= 0);
 
     if (len < 0) {
         return len;
@@ -191,9 +823,8 @@ int fdtparse_get_interrupt_parent(const void *fdt, int nodeoffset) {
         return -FDT_ERR_BADPHANDLE;
     }
 
-    cell = (fdt32_t *) interrupt_parent->data;
     parent_phandle = fdt32_to_cpu(cell[0]);
-    parent_offset = fdt_node_offset_by_phandle(fdt, parent_phandle);
+    parent_offset = fdtparse_node_offset_by_phandle(fdt, parent_phandle);
     if (parent_offset < 0) {
         return parent_offset;
     }
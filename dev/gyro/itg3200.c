@@ -109,6 +109,7 @@ static int itg3200_get_raw_data(struct gyro *gyro, struct gyro_raw_data *data) {
     struct i2c_ops *i2c_ops = (struct i2c_ops *)i2c->obj.ops;
     struct itg3200 *itg_gyro = (struct itg3200 *) gyro->priv;
     uint8_t raw_data[6];
+    struct i2c_msg msgs[2];
     int ret;
 
     if (!itg_gyro->ready) {
@@ -118,16 +119,19 @@ static int itg3200_get_raw_data(struct gyro *gyro, struct gyro_raw_data *data) {
 
     acquire(&itg_gyro->lock);
 
-    /* Start reading from XOUT_H */
+    /* Start reading from XOUT_H, then read the six data registers */
     raw_data[0] = ITG3200_XOUT_H;
-    ret = i2c_ops->write(i2c, itg_gyro->addr, raw_data, 1);
-    if (ret != 1) {
-        goto out_err;
-    }
-
-    /* Read the six data registers */
-    ret = i2c_ops->read(i2c, itg_gyro->addr, raw_data, 6);
-    if (ret != 6) {
+    msgs[0].addr = itg_gyro->addr;
+    msgs[0].flags = 0;
+    msgs[0].buf = raw_data;
+    msgs[0].len = 1;
+    msgs[1].addr = itg_gyro->addr;
+    msgs[1].flags = I2C_MSG_READ;
+    msgs[1].buf = raw_data;
+    msgs[1].len = 6;
+
+    ret = i2c_ops->transfer(i2c, msgs, 2);
+    if (ret != 2) {
         goto out_err;
     }
 
@@ -179,16 +183,16 @@ static int itg3200_probe(const char *name) {
     uint8_t data;
     int ret = 0;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, ITG3200_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, ITG3200_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -246,16 +250,16 @@ static struct obj *itg3200_ctor(const char *name) {
     struct gyro *gyro;
     struct itg3200 *itg_gyro;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, ITG3200_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, ITG3200_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
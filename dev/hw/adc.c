@@ -81,7 +81,7 @@ static struct obj *adc_get_lookup(const void *fdt, struct obj *gpio) {
         offset = fdt_next_node(fdt, offset, NULL);
 
         LINKER_ARRAY_FOR_EACH(adc_drivers, driver) {
-            if (!fdt_node_check_compatible(fdt, offset, driver->compat)) {
+            if (!fdtparse_node_check_compatible(fdt, offset, driver->compat)) {
                 struct obj *obj = driver->adc_get(fdt, offset, gpio);
                 if (obj) {
                     return obj;
@@ -110,13 +110,13 @@ struct obj *adc_get(struct obj *gpio, const char *driver_name) {
         return adc;
     }
 
-    offset = fdt_path_offset(fdt, driver_name);
+    offset = fdtparse_path_offset(fdt, driver_name);
     if (offset < 0) {
         goto err;
     }
 
     LINKER_ARRAY_FOR_EACH(adc_drivers, driver) {
-        if (!fdt_node_check_compatible(fdt, offset, driver->compat)) {
+        if (!fdtparse_node_check_compatible(fdt, offset, driver->compat)) {
             break;
         }
     }
@@ -67,3 +67,109 @@ CORE_INITIALIZER(pwm_setup)
 struct obj __weak *pwm_get(struct obj *gpio, uint32_t duty) {
     return NULL;
 }
+
+struct pwm_group *pwm_group_get(struct obj **pwms, uint8_t num) {
+    struct pwm_group *group;
+    int i;
+
+    if (!pwms || !num || num > PWM_GROUP_MAX) {
+        return NULL;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (!pwms[i] || pwms[i]->type != pwm_class.type) {
+            return NULL;
+        }
+    }
+
+    group = kmalloc(sizeof(*group));
+    if (!group) {
+        return NULL;
+    }
+
+    group->pwms = kmalloc(num * sizeof(group->pwms[0]));
+    if (!group->pwms) {
+        goto err_free_group;
+    }
+
+    group->widths = kmalloc(num * sizeof(group->widths[0]));
+    if (!group->widths) {
+        goto err_free_pwms;
+    }
+
+    group->staged = 0;
+    group->num = num;
+    group->ops = (struct pwm_ops *) pwms[0]->ops;
+
+    for (i = 0; i < num; i++) {
+        obj_get(pwms[i]);
+        group->pwms[i] = pwms[i];
+
+        /* Outputs from different drivers are committed one at a time */
+        if (pwms[i]->ops != group->ops) {
+            group->ops = NULL;
+        }
+    }
+
+    return group;
+
+err_free_pwms:
+    kfree(group->pwms);
+err_free_group:
+    kfree(group);
+    return NULL;
+}
+
+int pwm_group_set_pulse_width(struct pwm_group *group, uint8_t index,
+                              uint32_t width) {
+    if (index >= group->num) {
+        return -1;
+    }
+
+    group->widths[index] = width;
+    group->staged |= (uint32_t) 1 << index;
+
+    return 0;
+}
+
+int pwm_group_commit(struct pwm_group *group) {
+    int i, ret = 0;
+
+    if (!group->staged) {
+        return 0;
+    }
+
+    if (group->ops && group->ops->commit_group) {
+        ret = group->ops->commit_group(group);
+    }
+    else {
+        for (i = 0; i < group->num; i++) {
+            struct pwm *pwm = to_pwm(group->pwms[i]);
+            struct pwm_ops *ops = (struct pwm_ops *) pwm->obj.ops;
+
+            if (!(group->staged & ((uint32_t) 1 << i))) {
+                continue;
+            }
+
+            if (ops->set_pulse_width(pwm, group->widths[i]) < 0) {
+                ret = -1;
+            }
+        }
+    }
+
+    group->staged = 0;
+
+    return ret;
+}
+
+void pwm_group_put(struct pwm_group *group) {
+    int i;
+
+    for (i = 0; i < group->num; i++) {
+        obj_put(group->pwms[i]);
+    }
+
+    kfree(group->widths);
+    kfree(group->pwms);
+    kfree(group);
+}
@@ -27,6 +27,7 @@
 #include <dev/fdtparse.h>
 #include <dev/hw/i2c.h>
 #include <dev/mag.h>
+#include <dev/sensor_stream.h>
 #include <kernel/init.h>
 #include <kernel/mutex.h>
 #include <mm/mm.h>
@@ -43,12 +44,22 @@
 #define HMC5883_IDB_VAL 0x34    /* IDB register value */
 #define HMC5883_IDC_VAL 0x33    /* IDC register value */
 
+/* Samples queued for stream readers, 200ms at 75 Hz */
+#define HMC5883_STREAM_DEPTH    16
+
 struct hmc5883 {
     uint8_t             ready;
     int                 addr;
     /* Differentiate between HMC5883 and HMC5883L */
     uint8_t             is_hmc5883l;
     struct mutex        lock;
+#ifdef CONFIG_SENSOR_STREAMS
+    /* Data-ready pin, if connected */
+    uint8_t                 has_drdy;
+    uint8_t                 streaming;
+    struct sensor_trigger   drdy;
+    struct sensor_stream    stream;
+#endif
 };
 
 static int hmc5883_init(struct mag *mag) {
@@ -88,6 +99,14 @@ static int hmc5883_deinit(struct mag *mag) {
     uint8_t packet[2];
     int ret;
 
+#ifdef CONFIG_SENSOR_STREAMS
+    if (hmc_mag->streaming) {
+        sensor_trigger_disable(&hmc_mag->drdy);
+        sensor_stream_destroy(&hmc_mag->stream);
+        hmc_mag->streaming = 0;
+    }
+#endif
+
     hmc_mag->ready = 0;
 
     acquire(&hmc_mag->lock);
@@ -110,6 +129,7 @@ static int hmc5883_get_raw_data(struct mag *mag, struct mag_raw_data *data) {
     struct i2c_ops *i2c_ops = (struct i2c_ops *)i2c->obj.ops;
     struct hmc5883 *hmc_mag = (struct hmc5883 *) mag->priv;
     uint8_t raw_data[6];
+    struct i2c_msg msgs[2];
     int ret;
 
     if (!hmc_mag->ready) {
@@ -119,16 +139,19 @@ static int hmc5883_get_raw_data(struct mag *mag, struct mag_raw_data *data) {
 
     acquire(&hmc_mag->lock);
 
-    /* Start reading from OUTXA */
+    /* Start reading from OUTXA, then read the six data registers */
     raw_data[0] = HMC5883_OUTXA;
-    ret = i2c_ops->write(i2c, hmc_mag->addr, raw_data, 1);
-    if (ret != 1) {
-        goto out_err;
-    }
-
-    /* Read the six data registers */
-    ret = i2c_ops->read(i2c, hmc_mag->addr, raw_data, 6);
-    if (ret != 6) {
+    msgs[0].addr = hmc_mag->addr;
+    msgs[0].flags = 0;
+    msgs[0].buf = raw_data;
+    msgs[0].len = 1;
+    msgs[1].addr = hmc_mag->addr;
+    msgs[1].flags = I2C_MSG_READ;
+    msgs[1].buf = raw_data;
+    msgs[1].len = 6;
+
+    ret = i2c_ops->transfer(i2c, msgs, 2);
+    if (ret != 2) {
         goto out_err;
     }
 
@@ -170,11 +193,77 @@ static int hmc5883_get_data(struct mag *mag, struct mag_data *data) {
     return 0;
 }
 
+#ifdef CONFIG_SENSOR_STREAMS
+/* Read the sample that raised DRDY, from the sensor task */
+static int hmc5883_drdy_read(struct sensor_trigger *trigger,
+                             uint64_t timestamp) {
+    struct mag *mag = (struct mag *) trigger->data;
+    struct hmc5883 *hmc_mag = (struct hmc5883 *) mag->priv;
+    struct mag_sample sample = {
+        .timestamp = timestamp,
+    };
+    int ret;
+
+    ret = hmc5883_get_raw_data(mag, &sample.raw);
+    if (ret) {
+        return ret;
+    }
+
+    sensor_stream_push(&hmc_mag->stream, &sample, 1);
+
+    return 0;
+}
+
+static struct sensor_stream *hmc5883_get_stream(struct mag *mag) {
+    struct hmc5883 *hmc_mag = (struct hmc5883 *) mag->priv;
+    struct sensor_stream *ret = NULL;
+
+    if (!hmc_mag->has_drdy) {
+        return NULL;
+    }
+
+    if (!hmc_mag->ready && hmc5883_init(mag)) {
+        return NULL;
+    }
+
+    /*
+     * Only this device's DRDY read takes the lock from the sensor task,
+     * and it can't run until the trigger is enabled here.
+     */
+    acquire(&hmc_mag->lock);
+
+    if (hmc_mag->streaming) {
+        ret = &hmc_mag->stream;
+        goto out;
+    }
+
+    if (sensor_stream_init(&hmc_mag->stream, sizeof(struct mag_sample),
+                           HMC5883_STREAM_DEPTH)) {
+        goto out;
+    }
+
+    if (sensor_trigger_enable(&hmc_mag->drdy)) {
+        sensor_stream_destroy(&hmc_mag->stream);
+        goto out;
+    }
+
+    hmc_mag->streaming = 1;
+    ret = &hmc_mag->stream;
+
+out:
+    release(&hmc_mag->lock);
+    return ret;
+}
+#endif
+
 struct mag_ops hmc5883_ops = {
     .init = hmc5883_init,
     .deinit = hmc5883_deinit,
     .get_data = hmc5883_get_data,
     .get_raw_data = hmc5883_get_raw_data,
+#ifdef CONFIG_SENSOR_STREAMS
+    .get_stream = hmc5883_get_stream,
+#endif
 };
 
 /* Identify chip by verifying the contents of the 3 ID registers */
@@ -188,18 +277,18 @@ static int hmc5883_probe(const char *name) {
     uint8_t data[3];
     int ret = 0;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, HMC5883L_COMPAT)) {
-        if (fdt_node_check_compatible(blob, offset, HMC5883_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, HMC5883L_COMPAT)) {
+        if (fdtparse_node_check_compatible(blob, offset, HMC5883_COMPAT)) {
             return 0;
         }
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -257,23 +346,23 @@ static struct obj *hmc5883_ctor(const char *name) {
     struct mag *mag;
     struct hmc5883 *hmc_mag;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
     /* Is this the HMC5883 or HMC5883L? */
-    if (!fdt_node_check_compatible(blob, offset, HMC5883L_COMPAT)) {
+    if (!fdtparse_node_check_compatible(blob, offset, HMC5883L_COMPAT)) {
         is_hmc5883l = 1;
     }
-    else if (!fdt_node_check_compatible(blob, offset, HMC5883_COMPAT)) {
+    else if (!fdtparse_node_check_compatible(blob, offset, HMC5883_COMPAT)) {
         is_hmc5883l = 0;
     }
     else {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
@@ -312,6 +401,14 @@ static struct obj *hmc5883_ctor(const char *name) {
         goto err_free_priv;
     }
 
+#ifdef CONFIG_SENSOR_STREAMS
+    /* DRDY is optional, without it the magnetometer can't stream */
+    hmc_mag->streaming = 0;
+    hmc_mag->has_drdy = !sensor_trigger_init(&hmc_mag->drdy, blob, offset,
+                                             "drdy-gpio", hmc5883_drdy_read,
+                                             mag);
+#endif
+
     /* Export to the OS */
     class_export_member(mag_obj);
 
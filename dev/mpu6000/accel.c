@@ -27,6 +27,7 @@
 #include <dev/device.h>
 #include <dev/fdtparse.h>
 #include <dev/mpu6000/class.h>
+#include <dev/sensor_stream.h>
 #include <kernel/class.h>
 #include <kernel/init.h>
 #include <mm/mm.h>
@@ -68,6 +69,10 @@ static int mpu6000_accel_deinit(struct accel *accel) {
 
     mpu_accel->ready = 0;
 
+    if (mpu_ops->stop_stream) {
+        mpu_ops->stop_stream(mpu, MPU6000_STREAM_ACCEL);
+    }
+
     return mpu_ops->enable_accelerometer(mpu, 0);
 }
 
@@ -110,11 +115,36 @@ static int mpu6000_accel_get_data(struct accel *accel,
     return 0;
 }
 
+#ifdef CONFIG_SENSOR_STREAMS
+/* Stream the accelerometer half of the MPU6000 FIFO samples */
+static struct sensor_stream *mpu6000_accel_get_stream(struct accel *accel) {
+    struct mpu6000 *mpu = to_mpu6000(accel->device.parent);
+    struct mpu6000_ops *mpu_ops = (struct mpu6000_ops *) mpu->obj.ops;
+    struct mpu6000_accel *mpu_accel = (struct mpu6000_accel *) accel->priv;
+
+    if (!mpu_ops->get_stream) {
+        return NULL;
+    }
+
+    if (!mpu_accel->ready) {
+        struct accel_ops *ops = (struct accel_ops *) accel->obj.ops;
+        if (ops->init(accel)) {
+            return NULL;
+        }
+    }
+
+    return mpu_ops->get_stream(mpu, MPU6000_STREAM_ACCEL);
+}
+#endif
+
 struct accel_ops mpu6000_accel_ops = {
     .init = mpu6000_accel_init,
     .deinit = mpu6000_accel_deinit,
     .get_data = mpu6000_accel_get_data,
     .get_raw_data = mpu6000_accel_get_raw_data,
+#ifdef CONFIG_SENSOR_STREAMS
+    .get_stream = mpu6000_accel_get_stream,
+#endif
 };
 
 /* Verify parent MPU6000 exists */
@@ -124,16 +154,16 @@ static int mpu6000_accel_probe(const char *name) {
     char *parent;
     struct obj *parent_obj;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MPU6000_ACCEL_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MPU6000_ACCEL_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -168,16 +198,16 @@ static struct obj *mpu6000_accel_ctor(const char *name) {
     struct accel *accel;
     struct mpu6000_accel *mpu_accel;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MPU6000_ACCEL_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MPU6000_ACCEL_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
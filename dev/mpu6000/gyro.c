@@ -27,6 +27,7 @@
 #include <dev/fdtparse.h>
 #include <dev/gyro.h>
 #include <dev/mpu6000/class.h>
+#include <dev/sensor_stream.h>
 #include <kernel/class.h>
 #include <kernel/init.h>
 #include <mm/mm.h>
@@ -68,6 +69,10 @@ static int mpu6000_gyro_deinit(struct gyro *gyro) {
 
     mpu_gyro->ready = 0;
 
+    if (mpu_ops->stop_stream) {
+        mpu_ops->stop_stream(mpu, MPU6000_STREAM_GYRO);
+    }
+
     return mpu_ops->enable_gyroscope(mpu, 0);
 }
 
@@ -110,11 +115,36 @@ static int mpu6000_gyro_get_data(struct gyro *gyro,
     return 0;
 }
 
+#ifdef CONFIG_SENSOR_STREAMS
+/* Stream the gyroscope half of the MPU6000 FIFO samples */
+static struct sensor_stream *mpu6000_gyro_get_stream(struct gyro *gyro) {
+    struct mpu6000 *mpu = to_mpu6000(gyro->device.parent);
+    struct mpu6000_ops *mpu_ops = (struct mpu6000_ops *) mpu->obj.ops;
+    struct mpu6000_gyro *mpu_gyro = (struct mpu6000_gyro *) gyro->priv;
+
+    if (!mpu_ops->get_stream) {
+        return NULL;
+    }
+
+    if (!mpu_gyro->ready) {
+        struct gyro_ops *ops = (struct gyro_ops *) gyro->obj.ops;
+        if (ops->init(gyro)) {
+            return NULL;
+        }
+    }
+
+    return mpu_ops->get_stream(mpu, MPU6000_STREAM_GYRO);
+}
+#endif
+
 struct gyro_ops mpu6000_gyro_ops = {
     .init = mpu6000_gyro_init,
     .deinit = mpu6000_gyro_deinit,
     .get_data = mpu6000_gyro_get_data,
     .get_raw_data = mpu6000_gyro_get_raw_data,
+#ifdef CONFIG_SENSOR_STREAMS
+    .get_stream = mpu6000_gyro_get_stream,
+#endif
 };
 
 /* Verify parent MPU6000 exists */
@@ -124,16 +154,16 @@ static int mpu6000_gyro_probe(const char *name) {
     char *parent;
     struct obj *parent_obj;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MPU6000_GYRO_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MPU6000_GYRO_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -168,16 +198,16 @@ static struct obj *mpu6000_gyro_ctor(const char *name) {
     struct gyro *gyro;
     struct mpu6000_gyro *mpu_gyro;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MPU6000_GYRO_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MPU6000_GYRO_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
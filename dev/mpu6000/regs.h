@@ -28,6 +28,10 @@
 #define MPU6000_CONFIG                      0x1A
 #define MPU6000_GYRO_CONFIG                 0x1B
 #define MPU6000_ACCEL_CONFIG                0x1C
+#define MPU6000_FIFO_EN                     0x23
+#define MPU6000_INT_PIN_CFG                 0x37
+#define MPU6000_INT_ENABLE                  0x38
+#define MPU6000_INT_STATUS                  0x3A
 #define MPU6000_ACCEL_XOUT_H                0x3B
 #define MPU6000_ACCEL_XOUT_L                0x3C
 #define MPU6000_ACCEL_YOUT_H                0x3D
@@ -45,6 +49,9 @@
 #define MPU6000_USER_CTRL                   0x6A
 #define MPU6000_PWR_MGMT_1                  0x6B
 #define MPU6000_PWR_MGMT_2                  0x6C
+#define MPU6000_FIFO_COUNTH                 0x72
+#define MPU6000_FIFO_COUNTL                 0x73
+#define MPU6000_FIFO_R_W                    0x74
 #define MPU6000_WHOAMI                      0x75
 
 #define MPU6000_CONFIG_LPF_256HZ            0x00
@@ -77,6 +84,22 @@
 #define MPU6000_GYRO_SENSITIVITY_1000DPS    (32.8f)
 #define MPU6000_GYRO_SENSITIVITY_2000DPS    (16.4f)
 
+#define MPU6000_FIFO_EN_TEMP                0x80
+#define MPU6000_FIFO_EN_XG                  0x40
+#define MPU6000_FIFO_EN_YG                  0x20
+#define MPU6000_FIFO_EN_ZG                  0x10
+#define MPU6000_FIFO_EN_ACCEL               0x08
+
+#define MPU6000_INT_ENABLE_FIFO_OFLOW       0x10
+#define MPU6000_INT_ENABLE_DATA_RDY         0x01
+
+#define MPU6000_INT_STATUS_FIFO_OFLOW       0x10
+#define MPU6000_INT_STATUS_DATA_RDY         0x01
+
+#define MPU6000_USER_CTRL_FIFO_EN           0x40
+#define MPU6000_USER_CTRL_I2C_IF_DIS        0x10
+#define MPU6000_USER_CTRL_FIFO_RESET        0x04
+
 #define MPU6000_PWR_MGMT_1_SLEEP            0x40
 #define MPU6000_PWR_MGMT_1_CLK_PLLGYROX     0x01
 
@@ -87,6 +110,12 @@
 #define MPU6000_PWR_MGMT_2_STBY_YG          0x02
 #define MPU6000_PWR_MGMT_2_STBY_ZG          0x01
 
+/* FIFO capacity, in bytes */
+#define MPU6000_FIFO_SIZE                   1024
+
+/* Gyro output rate divided by SMPLRT_DIV + 1, with the low-pass filter on */
+#define MPU6000_GYRO_RATE                   1000
+
 /* Bits 0 and 7 are reserved */
 #define MPU6000_WHOAMI_VAL                  0x68
 
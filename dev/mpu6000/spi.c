@@ -28,7 +28,9 @@
 #include <dev/hw/gpio.h>
 #include <dev/hw/spi.h>
 #include <dev/mpu6000/class.h>
+#include <dev/sensor_stream.h>
 #include <kernel/init.h>
+#include <kernel/mutex.h>
 #include <kernel/obj.h>
 #include <mm/mm.h>
 #include "regs.h"
@@ -38,10 +40,60 @@
 /* When set in register addres, perform a read instead of write */
 #define MPU6000_SPI_READ    ((uint8_t) (1 << 7))
 
+/* Default output data rate and low-pass filter bandwidth, in Hz */
+#define MPU6000_DEFAULT_RATE    1000
+#define MPU6000_DEFAULT_LOWPASS 188
+
+/* Each FIFO frame holds accel then gyro X, Y and Z, big endian */
+#define MPU6000_FRAME_SIZE      12
+#define MPU6000_FIFO_FRAMES     (MPU6000_FIFO_SIZE / MPU6000_FRAME_SIZE)
+
+/* Samples queued for stream readers, 32ms at 1kHz */
+#define MPU6000_STREAM_DEPTH    32
+
+/* Samples converted at once when draining the FIFO, on the task stack */
+#define MPU6000_DRAIN_CHUNK     4
+
+/* Low-pass filter bandwidths, and the CONFIG value selecting each */
+static const struct {
+    uint32_t    hz;
+    uint8_t     config;
+} mpu6000_lowpass[] = {
+    { 5,   MPU6000_CONFIG_LPF_5HZ },
+    { 10,  MPU6000_CONFIG_LPF_10HZ },
+    { 20,  MPU6000_CONFIG_LPF_20HZ },
+    { 42,  MPU6000_CONFIG_LPF_50HZ },
+    { 98,  MPU6000_CONFIG_LPF_100HZ },
+    { 188, MPU6000_CONFIG_LPF_190HZ },
+};
+
 struct mpu6000_spi {
     struct spi_dev spi_dev;
+    uint8_t smplrt_div;     /* SMPLRT_DIV register value */
+    uint8_t config;         /* CONFIG register value */
+#ifdef CONFIG_SENSOR_STREAMS
+    /* Data-ready pin, if connected, else the FIFO is polled */
+    uint8_t                 has_int;
+    uint8_t                 streaming;
+    volatile uint8_t        open;   /* Bit mask of started streams */
+    struct sensor_trigger   data_ready;
+    struct sensor_timer     poll;
+    struct sensor_stream    streams[MPU6000_NUM_STREAMS];
+    uint8_t                 *fifo;  /* Burst read buffer */
+    uint64_t                last_timestamp; /* Of the last frame drained */
+    uint32_t                overflows;
+#endif
 };
 
+/* Time between samples in perfcounter counts */
+#define mpu6000_sample_period(mpu_spi) \
+    ((uint64_t) (CONFIG_SYS_CLOCK / MPU6000_GYRO_RATE) * \
+        ((mpu_spi)->smplrt_div + 1))
+
+/* Time between samples in microseconds */
+#define mpu6000_sample_period_us(mpu_spi) \
+    ((1000000 / MPU6000_GYRO_RATE) * ((mpu_spi)->smplrt_div + 1))
+
 /* Internal register write, which does not check ready bit */
 static int _mpu6000_spi_write_reg(struct mpu6000 *mpu, uint8_t reg,
                                   uint8_t val) {
@@ -57,6 +109,44 @@ static int _mpu6000_spi_write_reg(struct mpu6000 *mpu, uint8_t reg,
     return 0;
 }
 
+/* Internal register read, which does not check ready bit */
+static int _mpu6000_spi_read_regs(struct mpu6000 *mpu, uint8_t reg,
+                                  uint8_t *buf, uint32_t num) {
+    struct spi *spi = to_spi(mpu->device.parent);
+    struct spi_ops *spi_ops = (struct spi_ops *) spi->obj.ops;
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+    uint8_t read_reg = reg | MPU6000_SPI_READ;
+    /* Write start address, then read data */
+    struct spi_seg segs[2] = {
+        { .tx = &read_reg, .rx = NULL, .len = 1 },
+        { .tx = NULL, .rx = buf, .len = num },
+    };
+    struct spi_xfer xfer = {
+        .dev = &mpu_spi->spi_dev,
+        .segs = segs,
+        .num = 2,
+        .complete = NULL,
+    };
+
+    if (spi_ops->transfer(spi, &xfer)) {
+        return 0;
+    }
+
+    return num;
+}
+
+/* Write the sample rate divider and low-pass filter configuration */
+static int mpu6000_spi_write_sampling(struct mpu6000 *mpu) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+
+    if (_mpu6000_spi_write_reg(mpu, MPU6000_CONFIG, mpu_spi->config)) {
+        return -1;
+    }
+
+    return _mpu6000_spi_write_reg(mpu, MPU6000_SMPLRT_DIV,
+                                  mpu_spi->smplrt_div);
+}
+
 static int mpu6000_spi_init(struct mpu6000 *mpu) {
     int ret;
 
@@ -71,14 +161,35 @@ static int mpu6000_spi_init(struct mpu6000 *mpu) {
         return -1;
     }
 
+    /* SPI only, so the I2C interface can't be selected by mistake */
+    ret = _mpu6000_spi_write_reg(mpu, MPU6000_USER_CTRL,
+                                 MPU6000_USER_CTRL_I2C_IF_DIS);
+    if (ret) {
+        return -1;
+    }
+
+    ret = mpu6000_spi_write_sampling(mpu);
+    if (ret) {
+        return -1;
+    }
+
     mpu->ready = 1;
 
     return 0;
 }
 
-static int mpu6000_spi_deinit(struct mpu6000 *mpu) {
+#ifdef CONFIG_SENSOR_STREAMS
+static void mpu6000_spi_stop_all_streams(struct mpu6000 *mpu);
+#endif
+
+/* Stop streams and sleep.  mpu->lock must be held. */
+static int _mpu6000_spi_deinit(struct mpu6000 *mpu) {
     int ret;
 
+#ifdef CONFIG_SENSOR_STREAMS
+    mpu6000_spi_stop_all_streams(mpu);
+#endif
+
     mpu->ready = 0;
 
     /*
@@ -95,6 +206,16 @@ static int mpu6000_spi_deinit(struct mpu6000 *mpu) {
     return 0;
 }
 
+static int mpu6000_spi_deinit(struct mpu6000 *mpu) {
+    int ret;
+
+    acquire(&mpu->lock);
+    ret = _mpu6000_spi_deinit(mpu);
+    release(&mpu->lock);
+
+    return ret;
+}
+
 static int mpu6000_spi_write_reg(struct mpu6000 *mpu, uint8_t reg,
                                  uint8_t val) {
     if (!mpu->ready) {
@@ -107,31 +228,12 @@ static int mpu6000_spi_write_reg(struct mpu6000 *mpu, uint8_t reg,
 
 static int mpu6000_spi_read_regs(struct mpu6000 *mpu, uint8_t reg,
                                  uint8_t *buf, uint8_t num) {
-    struct spi *spi = to_spi(mpu->device.parent);
-    struct spi_ops *spi_ops = (struct spi_ops *) spi->obj.ops;
-    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
-    uint8_t read_reg = reg | MPU6000_SPI_READ;
-    int ret = 0;
-
     if (!mpu->ready) {
         struct mpu6000_ops *mpu_ops = (struct mpu6000_ops *) mpu->obj.ops;
         mpu_ops->init(mpu);
     }
 
-    spi_ops->start_transaction(spi, &mpu_spi->spi_dev);
-
-    /* Write start address */
-    if (spi_ops->write(spi, &mpu_spi->spi_dev, &read_reg, 1) != 1) {
-        goto out;
-    }
-
-    /* Read data */
-    ret = spi_ops->read(spi, &mpu_spi->spi_dev, buf, num);
-
-out:
-    spi_ops->end_transaction(spi, &mpu_spi->spi_dev);
-
-    return ret;
+    return _mpu6000_spi_read_regs(mpu, reg, buf, num);
 }
 
 static int mpu6000_spi_enable_accel(struct mpu6000 *mpu, int enable) {
@@ -168,7 +270,7 @@ static int mpu6000_spi_enable_accel(struct mpu6000 *mpu, int enable) {
 
         if (!mpu->gyro_in_use) {
             /* Go into low power mode */
-            if (mpu_ops->deinit(mpu)) {
+            if (_mpu6000_spi_deinit(mpu)) {
                 goto err;
             }
         }
@@ -184,8 +286,6 @@ err:
 }
 
 static int mpu6000_spi_enable_gyro(struct mpu6000 *mpu, int enable) {
-    struct mpu6000_ops *mpu_ops = (struct mpu6000_ops *) mpu->obj.ops;
-
     acquire(&mpu->lock);
 
     if (enable) {
@@ -200,7 +300,7 @@ static int mpu6000_spi_enable_gyro(struct mpu6000 *mpu, int enable) {
 
         if (!mpu->accel_in_use) {
             /* Go into low power mode */
-            if (mpu_ops->deinit(mpu)) {
+            if (_mpu6000_spi_deinit(mpu)) {
                 goto err;
             }
         }
@@ -215,6 +315,429 @@ err:
     return -1;
 }
 
+/*
+ * Select the SMPLRT_DIV and CONFIG values for a sample rate and low-pass
+ * bandwidth.  The registers are not written.
+ */
+static int mpu6000_spi_choose_sampling(struct mpu6000_spi *mpu_spi,
+                                       uint32_t rate, uint32_t lowpass) {
+    const int num_lowpass = sizeof(mpu6000_lowpass)/sizeof(mpu6000_lowpass[0]);
+    uint32_t div;
+    int i;
+
+    if (!rate) {
+        return -1;
+    }
+
+    /* Nearest divider of the gyro rate */
+    div = (MPU6000_GYRO_RATE + rate/2) / rate;
+    if (div < 1) {
+        div = 1;
+    }
+    else if (div > 256) {
+        div = 256;
+    }
+
+    /* Narrowest bandwidth at least that requested, else the widest */
+    for (i = 0; i < num_lowpass - 1; i++) {
+        if (mpu6000_lowpass[i].hz >= lowpass) {
+            break;
+        }
+    }
+
+    mpu_spi->smplrt_div = div - 1;
+    mpu_spi->config = mpu6000_lowpass[i].config;
+
+    return 0;
+}
+
+#ifdef CONFIG_SENSOR_STREAMS
+/* Entry size of each stream */
+static const uint32_t mpu6000_stream_entry_size[MPU6000_NUM_STREAMS] = {
+    [MPU6000_STREAM_PAIRED] = sizeof(struct mpu6000_sample),
+    [MPU6000_STREAM_ACCEL] = sizeof(struct accel_sample),
+    [MPU6000_STREAM_GYRO] = sizeof(struct gyro_sample),
+};
+
+/* Empty the FIFO, and start queueing accel and gyro frames again */
+static int mpu6000_spi_reset_fifo(struct mpu6000 *mpu) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+    int ret;
+
+    ret = _mpu6000_spi_write_reg(mpu, MPU6000_USER_CTRL,
+                                 MPU6000_USER_CTRL_I2C_IF_DIS |
+                                 MPU6000_USER_CTRL_FIFO_RESET);
+    if (ret) {
+        return -1;
+    }
+
+    ret = _mpu6000_spi_write_reg(mpu, MPU6000_USER_CTRL,
+                                 MPU6000_USER_CTRL_I2C_IF_DIS |
+                                 MPU6000_USER_CTRL_FIFO_EN);
+    if (ret) {
+        return -1;
+    }
+
+    mpu_spi->last_timestamp = 0;
+
+    return 0;
+}
+
+static inline int mpu6000_be16(const uint8_t *buf) {
+    return (int16_t) ((buf[0] << 8) | buf[1]);
+}
+
+/*
+ * Read every complete frame in the FIFO in one burst, and queue the
+ * readings in the started streams.
+ *
+ * first is the time of the data-ready edge of the oldest frame not yet
+ * drained, or zero if unknown, in which case the newest frame is taken to
+ * have been sampled as the FIFO count is read.  The other frames are
+ * timestamped a sample period apart.
+ */
+static int mpu6000_spi_drain_fifo(struct mpu6000 *mpu, uint64_t first) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+    uint64_t period = mpu6000_sample_period(mpu_spi);
+    uint64_t timestamp;
+    uint32_t count, frames, i, j, n;
+    uint8_t count_buf[2];
+    uint8_t open = mpu_spi->open;
+    struct mpu6000_sample paired[MPU6000_DRAIN_CHUNK];
+    union {
+        struct accel_sample accel[MPU6000_DRAIN_CHUNK];
+        struct gyro_sample gyro[MPU6000_DRAIN_CHUNK];
+    } single;
+
+    if (_mpu6000_spi_read_regs(mpu, MPU6000_FIFO_COUNTH, count_buf, 2) != 2) {
+        return -1;
+    }
+
+    if (!first) {
+        first = sensor_timestamp();
+    }
+
+    count = (count_buf[0] << 8) | count_buf[1];
+
+    /*
+     * Once full, the FIFO overwrites its oldest bytes, and frames no longer
+     * start on a frame boundary.  Start over.
+     */
+    if (count > MPU6000_FIFO_FRAMES * MPU6000_FRAME_SIZE) {
+        mpu_spi->overflows++;
+        return mpu6000_spi_reset_fifo(mpu);
+    }
+
+    frames = count / MPU6000_FRAME_SIZE;
+    if (!frames) {
+        return 0;
+    }
+
+    if (_mpu6000_spi_read_regs(mpu, MPU6000_FIFO_R_W, mpu_spi->fifo,
+                               frames * MPU6000_FRAME_SIZE) !=
+            frames * MPU6000_FRAME_SIZE) {
+        return -1;
+    }
+
+    if (!mpu_spi->has_int) {
+        /* first is the time of the newest frame */
+        timestamp = first - (frames - 1) * period;
+    }
+    else if (mpu_spi->last_timestamp &&
+             first < mpu_spi->last_timestamp + period/2) {
+        /*
+         * The edge was for a frame already drained, which arrived after
+         * the last read was triggered, but before the FIFO count was read.
+         */
+        timestamp = mpu_spi->last_timestamp + period;
+    }
+    else {
+        timestamp = first;
+    }
+
+    mpu_spi->last_timestamp = timestamp + (frames - 1) * period;
+
+    for (i = 0; i < frames; i += n) {
+        n = frames - i;
+        if (n > MPU6000_DRAIN_CHUNK) {
+            n = MPU6000_DRAIN_CHUNK;
+        }
+
+        for (j = 0; j < n; j++) {
+            const uint8_t *frame = &mpu_spi->fifo[(i + j) * MPU6000_FRAME_SIZE];
+
+            paired[j].timestamp = timestamp + (i + j) * period;
+            paired[j].accel.x = mpu6000_be16(&frame[0]);
+            paired[j].accel.y = mpu6000_be16(&frame[2]);
+            paired[j].accel.z = mpu6000_be16(&frame[4]);
+            paired[j].gyro.x = mpu6000_be16(&frame[6]);
+            paired[j].gyro.y = mpu6000_be16(&frame[8]);
+            paired[j].gyro.z = mpu6000_be16(&frame[10]);
+        }
+
+        if (open & (1 << MPU6000_STREAM_PAIRED)) {
+            sensor_stream_push(&mpu_spi->streams[MPU6000_STREAM_PAIRED],
+                               paired, n);
+        }
+
+        if (open & (1 << MPU6000_STREAM_ACCEL)) {
+            for (j = 0; j < n; j++) {
+                single.accel[j].timestamp = paired[j].timestamp;
+                single.accel[j].raw = paired[j].accel;
+            }
+
+            sensor_stream_push(&mpu_spi->streams[MPU6000_STREAM_ACCEL],
+                               single.accel, n);
+        }
+
+        if (open & (1 << MPU6000_STREAM_GYRO)) {
+            for (j = 0; j < n; j++) {
+                single.gyro[j].timestamp = paired[j].timestamp;
+                single.gyro[j].raw = paired[j].gyro;
+            }
+
+            sensor_stream_push(&mpu_spi->streams[MPU6000_STREAM_GYRO],
+                               single.gyro, n);
+        }
+    }
+
+    return 0;
+}
+
+/* Drain a batch of frames on data-ready, from the sensor task */
+static int mpu6000_spi_data_ready(struct sensor_trigger *trigger,
+                                  uint64_t timestamp) {
+    return mpu6000_spi_drain_fifo((struct mpu6000 *) trigger->data,
+                                  timestamp);
+}
+
+/* Without data-ready, drain the FIFO about every batch, from the sensor task */
+static void mpu6000_spi_poll(struct sensor_timer *timer) {
+    mpu6000_spi_drain_fifo((struct mpu6000 *) timer->data, 0);
+}
+
+/* Stop draining the FIFO.  Once this returns, the sensor task won't. */
+static void mpu6000_spi_fifo_pause(struct mpu6000 *mpu) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+
+    if (mpu_spi->has_int) {
+        sensor_trigger_disable(&mpu_spi->data_ready);
+    }
+    else {
+        sensor_timer_stop(&mpu_spi->poll);
+    }
+}
+
+/*
+ * Empty the FIFO, and drain it from the sensor task every
+ * CONFIG_MPU6000_FIFO_BATCH samples.  Frames queued while paused would
+ * be mistimed, so they are discarded.
+ */
+static int mpu6000_spi_fifo_resume(struct mpu6000 *mpu) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+
+    if (mpu6000_spi_reset_fifo(mpu)) {
+        return -1;
+    }
+
+    if (mpu_spi->has_int) {
+        mpu_spi->data_ready.batch = CONFIG_MPU6000_FIFO_BATCH;
+        return sensor_trigger_enable(&mpu_spi->data_ready);
+    }
+
+    return sensor_timer_start(&mpu_spi->poll, CONFIG_MPU6000_FIFO_BATCH *
+                                    mpu6000_sample_period_us(mpu_spi));
+}
+
+/* Enable the FIFO and data-ready interrupt, and start draining */
+static int mpu6000_spi_fifo_start(struct mpu6000 *mpu) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+    int ret;
+
+    mpu_spi->fifo = kmalloc(MPU6000_FIFO_FRAMES * MPU6000_FRAME_SIZE);
+    if (!mpu_spi->fifo) {
+        return -1;
+    }
+
+    /* Frames are accel, then gyro, in register order */
+    ret = _mpu6000_spi_write_reg(mpu, MPU6000_FIFO_EN,
+                                 MPU6000_FIFO_EN_XG | MPU6000_FIFO_EN_YG |
+                                 MPU6000_FIFO_EN_ZG | MPU6000_FIFO_EN_ACCEL);
+    if (ret) {
+        goto err_free_fifo;
+    }
+
+    if (mpu_spi->has_int) {
+        ret = _mpu6000_spi_write_reg(mpu, MPU6000_INT_ENABLE,
+                                     MPU6000_INT_ENABLE_DATA_RDY);
+        if (ret) {
+            goto err_disable_fifo;
+        }
+    }
+
+    ret = mpu6000_spi_fifo_resume(mpu);
+    if (ret) {
+        goto err_disable_int;
+    }
+
+    mpu_spi->streaming = 1;
+
+    return 0;
+
+err_disable_int:
+    _mpu6000_spi_write_reg(mpu, MPU6000_INT_ENABLE, 0);
+err_disable_fifo:
+    _mpu6000_spi_write_reg(mpu, MPU6000_FIFO_EN, 0);
+err_free_fifo:
+    kfree(mpu_spi->fifo);
+    mpu_spi->fifo = NULL;
+    return -1;
+}
+
+/* Stop draining, and disable the FIFO and data-ready interrupt */
+static void mpu6000_spi_fifo_stop(struct mpu6000 *mpu) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+
+    mpu6000_spi_fifo_pause(mpu);
+
+    _mpu6000_spi_write_reg(mpu, MPU6000_INT_ENABLE, 0);
+    _mpu6000_spi_write_reg(mpu, MPU6000_FIFO_EN, 0);
+    _mpu6000_spi_write_reg(mpu, MPU6000_USER_CTRL,
+                           MPU6000_USER_CTRL_I2C_IF_DIS);
+
+    kfree(mpu_spi->fifo);
+    mpu_spi->fifo = NULL;
+    mpu_spi->streaming = 0;
+}
+
+/* Stop and free stream.  mpu->lock must be held, or the MPU6000 unused. */
+static void _mpu6000_spi_stop_stream(struct mpu6000 *mpu,
+                                     enum mpu6000_stream which) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+
+    if (!(mpu_spi->open & (1 << which))) {
+        return;
+    }
+
+    /* The sensor task may be pushing to the stream */
+    mpu6000_spi_fifo_pause(mpu);
+
+    mpu_spi->open &= ~(1 << which);
+    sensor_stream_destroy(&mpu_spi->streams[which]);
+
+    if (!mpu_spi->open) {
+        mpu6000_spi_fifo_stop(mpu);
+    }
+    else {
+        /* On failure, the other streams receive no more samples */
+        mpu6000_spi_fifo_resume(mpu);
+    }
+}
+
+static void mpu6000_spi_stop_all_streams(struct mpu6000 *mpu) {
+    int i;
+
+    for (i = 0; i < MPU6000_NUM_STREAMS; i++) {
+        _mpu6000_spi_stop_stream(mpu, i);
+    }
+}
+
+static struct sensor_stream *mpu6000_spi_get_stream(struct mpu6000 *mpu,
+                                                    enum mpu6000_stream which) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+    struct mpu6000_ops *mpu_ops = (struct mpu6000_ops *) mpu->obj.ops;
+    struct sensor_stream *stream;
+    struct sensor_stream *ret = NULL;
+
+    if (which >= MPU6000_NUM_STREAMS) {
+        return NULL;
+    }
+
+    stream = &mpu_spi->streams[which];
+
+    /*
+     * The sensor task never takes the lock, so streams can be started and
+     * stopped under it while draining is paused.
+     */
+    acquire(&mpu->lock);
+
+    if (mpu_spi->open & (1 << which)) {
+        ret = stream;
+        goto out;
+    }
+
+    if (!mpu->ready && mpu_ops->init(mpu)) {
+        goto out;
+    }
+
+    if (sensor_stream_init(stream, mpu6000_stream_entry_size[which],
+                           MPU6000_STREAM_DEPTH)) {
+        goto out;
+    }
+
+    if (!mpu_spi->streaming) {
+        if (mpu6000_spi_fifo_start(mpu)) {
+            sensor_stream_destroy(stream);
+            goto out;
+        }
+    }
+
+    /* The stream is ready before the sensor task may see it open */
+    mpu_spi->open |= 1 << which;
+    ret = stream;
+
+out:
+    release(&mpu->lock);
+    return ret;
+}
+
+static void mpu6000_spi_stop_stream(struct mpu6000 *mpu,
+                                    enum mpu6000_stream which) {
+    if (which >= MPU6000_NUM_STREAMS) {
+        return;
+    }
+
+    acquire(&mpu->lock);
+    _mpu6000_spi_stop_stream(mpu, which);
+    release(&mpu->lock);
+}
+#endif
+
+static int mpu6000_spi_set_sampling(struct mpu6000 *mpu, uint32_t rate,
+                                    uint32_t lowpass) {
+    struct mpu6000_spi *mpu_spi = (struct mpu6000_spi *) mpu->priv;
+    struct mpu6000_ops *mpu_ops = (struct mpu6000_ops *) mpu->obj.ops;
+    int ret = -1;
+
+    acquire(&mpu->lock);
+
+    if (!mpu->ready && mpu_ops->init(mpu)) {
+        goto out;
+    }
+
+#ifdef CONFIG_SENSOR_STREAMS
+    /* Timestamps depend on the rate, so change it with draining paused */
+    if (mpu_spi->streaming) {
+        mpu6000_spi_fifo_pause(mpu);
+    }
+#endif
+
+    ret = mpu6000_spi_choose_sampling(mpu_spi, rate, lowpass);
+    if (!ret) {
+        ret = mpu6000_spi_write_sampling(mpu);
+    }
+
+#ifdef CONFIG_SENSOR_STREAMS
+    if (mpu_spi->streaming && mpu6000_spi_fifo_resume(mpu)) {
+        ret = -1;
+    }
+#endif
+
+out:
+    release(&mpu->lock);
+    return ret;
+}
+
 struct mpu6000_ops mpu6000_spi_ops = {
     .init = mpu6000_spi_init,
     .deinit = mpu6000_spi_deinit,
@@ -222,6 +745,11 @@ struct mpu6000_ops mpu6000_spi_ops = {
     .read_regs = mpu6000_spi_read_regs,
     .enable_accelerometer = mpu6000_spi_enable_accel,
     .enable_gyroscope = mpu6000_spi_enable_gyro,
+    .set_sampling = mpu6000_spi_set_sampling,
+#ifdef CONFIG_SENSOR_STREAMS
+    .get_stream = mpu6000_spi_get_stream,
+    .stop_stream = mpu6000_spi_stop_stream,
+#endif
 };
 
 /*
@@ -293,16 +821,16 @@ static int mpu6000_spi_probe(const char *name) {
     /* Default to assuming no device */
     ret = 0;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MPU6000_SPI_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MPU6000_SPI_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -352,22 +880,22 @@ out_put_spi:
 
 static struct obj *mpu6000_spi_ctor(const char *name) {
     const void *blob = fdtparse_get_blob();
-    int offset, parent_offset;
+    int offset, parent_offset, rate, lowpass;
     char *parent;
     struct obj *mpu6000_obj;
     struct mpu6000 *mpu;
     struct mpu6000_spi *mpu_spi;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, MPU6000_SPI_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, MPU6000_SPI_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
@@ -409,6 +937,29 @@ static struct obj *mpu6000_spi_ctor(const char *name) {
         goto err_free_priv;
     }
 
+    /* Sampling is optionally configured in the device tree */
+    rate = MPU6000_DEFAULT_RATE;
+    lowpass = MPU6000_DEFAULT_LOWPASS;
+    fdtparse_get_int(blob, offset, "sample-rate", &rate);
+    fdtparse_get_int(blob, offset, "lowpass", &lowpass);
+
+    if (mpu6000_spi_choose_sampling(mpu_spi, rate, lowpass)) {
+        goto err_put_cs;
+    }
+
+#ifdef CONFIG_SENSOR_STREAMS
+    /* The interrupt is optional, without it the FIFO is polled */
+    mpu_spi->streaming = 0;
+    mpu_spi->open = 0;
+    mpu_spi->fifo = NULL;
+    mpu_spi->last_timestamp = 0;
+    mpu_spi->overflows = 0;
+    mpu_spi->has_int = !sensor_trigger_init(&mpu_spi->data_ready, blob,
+                                            offset, "int-gpio",
+                                            mpu6000_spi_data_ready, mpu);
+    sensor_timer_init(&mpu_spi->poll, mpu6000_spi_poll, mpu);
+#endif
+
     /* Export to the OS */
     class_export_member(mpu6000_obj);
 
@@ -416,6 +967,8 @@ static struct obj *mpu6000_spi_ctor(const char *name) {
 
     return mpu6000_obj;
 
+err_put_cs:
+    gpio_put(&mpu_spi->spi_dev.cs->obj);
 err_free_priv:
     kfree(mpu->priv);
 err_free_obj:
@@ -69,19 +69,23 @@ static int as5048b_get_raw_data(struct rotary_encoder *rotary_encoder,
     struct i2c_ops *i2c_ops = (struct i2c_ops *)i2c->obj.ops;
     struct as5048b *ams_rotary_encoder = (struct as5048b *) rotary_encoder->priv;
     uint8_t raw_data[2];
+    struct i2c_msg msgs[2];
     int ret;
 
     acquire(&ams_rotary_encoder->lock);
 
-    /* Start reading from ANGLEH */
+    /* Start reading from ANGLEH, then read the two data registers */
     raw_data[0] = AS5048B_ANGLEH;
-    ret = i2c_ops->write(i2c, ams_rotary_encoder->addr, raw_data, 1);
-    if (ret != 1) {
-        goto out_err;
-    }
-
-    /* Read the two data registers */
-    ret = i2c_ops->read(i2c, ams_rotary_encoder->addr, raw_data, 2);
+    msgs[0].addr = ams_rotary_encoder->addr;
+    msgs[0].flags = 0;
+    msgs[0].buf = raw_data;
+    msgs[0].len = 1;
+    msgs[1].addr = ams_rotary_encoder->addr;
+    msgs[1].flags = I2C_MSG_READ;
+    msgs[1].buf = raw_data;
+    msgs[1].len = 2;
+
+    ret = i2c_ops->transfer(i2c, msgs, 2);
     if (ret != 2) {
         goto out_err;
     }
@@ -212,16 +216,16 @@ static int as5048b_probe(const char *name) {
     uint8_t data;
     int ret = 0;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return 0;
     }
 
-    if (fdt_node_check_compatible(blob, offset, AS5048B_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, AS5048B_COMPAT)) {
         return 0;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return 0;
     }
@@ -280,16 +284,16 @@ static struct obj *as5048b_ctor(const char *name) {
     struct rotary_encoder *rotary_encoder;
     struct as5048b *ams_rotary_encoder;
 
-    offset = fdt_path_offset(blob, name);
+    offset = fdtparse_path_offset(blob, name);
     if (offset < 0) {
         return NULL;
     }
 
-    if (fdt_node_check_compatible(blob, offset, AS5048B_COMPAT)) {
+    if (fdtparse_node_check_compatible(blob, offset, AS5048B_COMPAT)) {
         return NULL;
     }
 
-    parent_offset = fdt_parent_offset(blob, offset);
+    parent_offset = fdtparse_parent_offset(blob, offset);
     if (parent_offset < 0) {
         return NULL;
     }
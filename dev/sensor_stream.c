@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libfdt.h>
+#include <ring.h>
+#include <stdint.h>
+#include <arch/system.h>
+#include <dev/fdtparse.h>
+#include <dev/hw/gpio.h>
+#include <dev/sensor_stream.h>
+#include <kernel/mutex.h>
+#include <kernel/sched.h>
+#include <kernel/sem.h>
+#include <kernel/timer.h>
+#include <kernel/wait.h>
+#include <mm/mm.h>
+
+/* Above application tasks, below the kernel task */
+#define SENSOR_TASK_PRIORITY    8
+
+int sensor_stream_init(struct sensor_stream *stream, uint32_t entry_size,
+                       uint32_t depth) {
+    uint32_t size = 1;
+    uint8_t *buf;
+
+    if (entry_size < sizeof(uint64_t) || !depth) {
+        return -1;
+    }
+
+    /* Smallest power of two holding depth entries */
+    while (size < entry_size * depth) {
+        size <<= 1;
+    }
+
+    buf = kmalloc(size);
+    if (!buf) {
+        return -1;
+    }
+
+    ring_init(&stream->ring, buf, size);
+    stream->entry_size = entry_size;
+    stream->dropped = 0;
+    stream->waiting = 0;
+    sem_init(&stream->available, 0);
+
+    return 0;
+}
+
+void sensor_stream_destroy(struct sensor_stream *stream) {
+    kfree(stream->ring.buf);
+    stream->ring.buf = NULL;
+    stream->ring.size = 0;
+}
+
+uint32_t sensor_stream_push(struct sensor_stream *stream, const void *entries,
+                            uint32_t num) {
+    uint32_t space = ring_space(&stream->ring) / stream->entry_size;
+
+    /* Space only grows under the producer, so it can't change to less */
+    if (num > space) {
+        stream->dropped += num - space;
+        num = space;
+    }
+
+    if (!num) {
+        return 0;
+    }
+
+    ring_push_n(&stream->ring, entries, num * stream->entry_size);
+
+    if (stream->waiting) {
+        stream->waiting = 0;
+        sem_post(&stream->available);
+    }
+
+    return num;
+}
+
+int sensor_stream_read(struct sensor_stream *stream, void *entries,
+                       uint32_t max, uint32_t timeout_us) {
+    uint32_t count;
+
+    if (!stream->ring.buf || !entries) {
+        return -1;
+    }
+
+    while (1) {
+        count = sensor_stream_count(stream);
+        if (count || !timeout_us) {
+            break;
+        }
+
+        if (!task_switching || !arch_svc_legal()) {
+            break;
+        }
+
+        stream->waiting = 1;
+
+        /* A sample may have arrived before waiting was seen */
+        if (sensor_stream_count(stream)) {
+            stream->waiting = 0;
+            continue;
+        }
+
+        if (sem_wait(&stream->available, timeout_us)) {
+            stream->waiting = 0;
+            count = sensor_stream_count(stream);
+            break;
+        }
+    }
+
+    if (count > max) {
+        count = max;
+    }
+
+    /* Whole entries only, as the producer only commits whole entries */
+    ring_pop_n(&stream->ring, entries, count * stream->entry_size);
+
+    return count;
+}
+
+/*
+ * Sensor task
+ *
+ * Data-ready interrupts and sensor timers flag their work pending and wake
+ * the sensor task, which does the bus transactions they can't.  A single
+ * task serves every sensor, as the work is short bus transactions.
+ *
+ * sensor_lock protects both lists, and is held while the task calls
+ * drivers, so that work can't run once it is disabled.
+ */
+static struct list sensor_triggers = INIT_LIST(sensor_triggers);
+static struct list sensor_timers = INIT_LIST(sensor_timers);
+static struct mutex sensor_lock = INIT_MUTEX;
+static struct semaphore sensor_task_wake;
+static uint8_t sensor_task_started = 0;
+
+static void sensor_trigger_irq(struct gpio *gpio, void *data) {
+    struct sensor_trigger *trigger = data;
+
+    /* The last batch has not been read, so its timestamp must be kept */
+    if (trigger->pending) {
+        trigger->missed++;
+        return;
+    }
+
+    /* The first edge of each batch is timestamped */
+    if (!trigger->count) {
+        trigger->timestamp = sensor_timestamp();
+    }
+
+    if (++trigger->count < trigger->batch) {
+        return;
+    }
+
+    trigger->count = 0;
+    trigger->pending = 1;
+
+    sem_post(&sensor_task_wake);
+}
+
+/* Called from kernel context when a sensor timer expires */
+static void sensor_timer_expired(void *data) {
+    struct sensor_timer *timer = data;
+
+    timer->pending = 1;
+
+    sem_post(&sensor_task_wake);
+}
+
+static void sensor_task(void) {
+    struct sensor_trigger *trigger;
+    struct sensor_timer *timer;
+
+    while (1) {
+        sem_wait(&sensor_task_wake, WAIT_FOREVER);
+
+        acquire(&sensor_lock);
+
+        list_for_each_entry(trigger, &sensor_triggers, list) {
+            uint64_t timestamp;
+
+            if (!trigger->pending) {
+                continue;
+            }
+
+            /* The interrupt won't write timestamp until pending clears */
+            timestamp = trigger->timestamp;
+            trigger->pending = 0;
+
+            trigger->read(trigger, timestamp);
+        }
+
+        list_for_each_entry(timer, &sensor_timers, list) {
+            if (!timer->pending) {
+                continue;
+            }
+
+            timer->pending = 0;
+            timer->func(timer);
+        }
+
+        release(&sensor_lock);
+    }
+}
+
+/* Start the sensor task, if not already started.  sensor_lock must be held. */
+static int sensor_task_start(void) {
+    if (sensor_task_started) {
+        return 0;
+    }
+
+    sem_init(&sensor_task_wake, 0);
+
+    if (!new_task(&sensor_task, SENSOR_TASK_PRIORITY, 0)) {
+        return -1;
+    }
+
+    sensor_task_started = 1;
+
+    return 0;
+}
+
+int sensor_trigger_init(struct sensor_trigger *trigger, const void *fdt,
+                        int offset, const char *prop,
+                        int (*read)(struct sensor_trigger *, uint64_t),
+                        void *data) {
+    struct fdt_gpio fdt_gpio;
+    struct gpio_ops *ops;
+    struct obj *gpio_obj;
+    int err;
+
+    err = fdtparse_get_gpio(fdt, offset, prop, &fdt_gpio);
+    if (err) {
+        return err;
+    }
+
+    gpio_obj = gpio_get(fdt_gpio.gpio);
+    if (!gpio_obj) {
+        return -1;
+    }
+
+    trigger->gpio = to_gpio(gpio_obj);
+    ops = (struct gpio_ops *) gpio_obj->ops;
+
+    if (!ops->set_irq) {
+        goto err_put_gpio;
+    }
+
+    err = ops->active_low(trigger->gpio,
+                          fdt_gpio.flags & GPIO_FDT_ACTIVE_LOW);
+    if (err) {
+        goto err_put_gpio;
+    }
+
+    err = ops->direction(trigger->gpio, GPIO_INPUT);
+    if (err) {
+        goto err_put_gpio;
+    }
+
+    trigger->read = read;
+    trigger->data = data;
+    trigger->timestamp = 0;
+    trigger->pending = 0;
+    trigger->missed = 0;
+    trigger->batch = 1;
+    trigger->count = 0;
+    trigger->enabled = 0;
+    list_init(&trigger->list);
+
+    return 0;
+
+err_put_gpio:
+    gpio_put(gpio_obj);
+    trigger->gpio = NULL;
+    return -1;
+}
+
+void sensor_trigger_destroy(struct sensor_trigger *trigger) {
+    if (!trigger->gpio) {
+        return;
+    }
+
+    sensor_trigger_disable(trigger);
+
+    gpio_put(&trigger->gpio->obj);
+    trigger->gpio = NULL;
+}
+
+int sensor_trigger_enable(struct sensor_trigger *trigger) {
+    struct gpio_ops *ops = (struct gpio_ops *) trigger->gpio->obj.ops;
+    int ret = 0;
+
+    acquire(&sensor_lock);
+
+    if (trigger->enabled) {
+        goto out;
+    }
+
+    ret = sensor_task_start();
+    if (ret) {
+        goto out;
+    }
+
+    trigger->pending = 0;
+    trigger->count = 0;
+    list_add_tail(&trigger->list, &sensor_triggers);
+
+    ret = ops->set_irq(trigger->gpio, GPIO_IRQ_RISING, sensor_trigger_irq,
+                       trigger);
+    if (ret) {
+        list_remove(&trigger->list);
+        goto out;
+    }
+
+    trigger->enabled = 1;
+
+out:
+    release(&sensor_lock);
+    return ret;
+}
+
+void sensor_trigger_disable(struct sensor_trigger *trigger) {
+    struct gpio_ops *ops = (struct gpio_ops *) trigger->gpio->obj.ops;
+
+    /* Holding the lock, the sensor task can't be in read */
+    acquire(&sensor_lock);
+
+    if (trigger->enabled) {
+        ops->set_irq(trigger->gpio, GPIO_IRQ_NONE, NULL, NULL);
+        list_remove(&trigger->list);
+        trigger->pending = 0;
+        trigger->enabled = 0;
+    }
+
+    release(&sensor_lock);
+}
+
+void sensor_timer_init(struct sensor_timer *timer,
+                       void (*func)(struct sensor_timer *), void *data) {
+    timer_init(&timer->timer, sensor_timer_expired, timer);
+    timer->func = func;
+    timer->data = data;
+    timer->pending = 0;
+    timer->enabled = 0;
+    list_init(&timer->list);
+}
+
+int sensor_timer_start(struct sensor_timer *timer, uint32_t period_us) {
+    int ret = 0;
+
+    acquire(&sensor_lock);
+
+    ret = sensor_task_start();
+    if (ret) {
+        goto out;
+    }
+
+    if (!timer->enabled) {
+        list_add_tail(&timer->list, &sensor_timers);
+        timer->enabled = 1;
+    }
+
+    timer->pending = 0;
+    timer_start(&timer->timer, period_us, period_us);
+
+out:
+    release(&sensor_lock);
+    return ret;
+}
+
+void sensor_timer_stop(struct sensor_timer *timer) {
+    /* Holding the lock, the sensor task can't be in func */
+    acquire(&sensor_lock);
+
+    if (timer->enabled) {
+        timer_stop(&timer->timer);
+        list_remove(&timer->list);
+        timer->pending = 0;
+        timer->enabled = 0;
+    }
+
+    release(&sensor_lock);
+}
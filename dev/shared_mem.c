@@ -22,23 +22,31 @@
 
 #include <stddef.h>
 #include <stdlib.h>
-#include <string.h>
+#include <ring.h>
 #include <dev/char.h>
 #include <dev/shared_mem.h>
 #include <kernel/mutex.h>
 
 #define SM_SIZE   CONFIG_SHARED_MEM_SIZE
 
+#if SM_SIZE & (SM_SIZE - 1)
+#error "CONFIG_SHARED_MEM_SIZE must be a power of two"
+#endif
+
+/*
+ * The ring is safe for one reader and one writer at a time, so readers and
+ * writers are each serialized, but never block one another.
+ */
 struct shared_mem {
-    char data[SM_SIZE];
-    int read_ctr;
-    int write_ctr;
-    struct mutex lock;
+    uint8_t data[SM_SIZE];
+    struct ring ring;
+    struct mutex read_lock;
+    struct mutex write_lock;
 };
 
 static int shared_mem_read(struct char_device *dev, char *buf, size_t num) {
     struct shared_mem *mem;
-    int total = 0;
+    int total;
 
     if (!dev) {
         return -1;
@@ -46,18 +54,9 @@ static int shared_mem_read(struct char_device *dev, char *buf, size_t num) {
 
     mem = dev->priv;
 
-    acquire(&mem->lock);
-
-    for (int i = 0; i < num; i++) {
-        if (mem->read_ctr >= SM_SIZE) {
-            mem->read_ctr = 0;
-        }
-
-        buf[i] =  mem->data[mem->read_ctr++];
-        total++;
-    }
-
-    release(&mem->lock);
+    acquire(&mem->read_lock);
+    total = ring_pop_n(&mem->ring, buf, num);
+    release(&mem->read_lock);
 
     return total;
 }
@@ -65,7 +64,7 @@ static int shared_mem_read(struct char_device *dev, char *buf, size_t num) {
 static int shared_mem_write(struct char_device *dev, const char *buf,
                             size_t num) {
     struct shared_mem *mem;
-    int total = 0;
+    int total;
 
     if (!dev) {
         return -1;
@@ -73,18 +72,9 @@ static int shared_mem_write(struct char_device *dev, const char *buf,
 
     mem = dev->priv;
 
-    acquire(&mem->lock);
-
-    for (int i = 0; i < num; i++) {
-        if (mem->write_ctr >= SM_SIZE) {
-            mem->write_ctr = 0;
-        }
-
-        mem->data[mem->write_ctr++] = buf[i];
-        total++;
-    }
-
-    release(&mem->lock);
+    acquire(&mem->write_lock);
+    total = ring_push_n(&mem->ring, buf, num);
+    release(&mem->write_lock);
 
     return total;
 }
@@ -114,10 +104,9 @@ struct char_device *shared_mem_create(void) {
         goto err_free_mem;
     }
 
-    mem->read_ctr = 0;
-    mem->write_ctr = 0;
-    memset(mem->data, '\0', SM_SIZE);
-    init_mutex(&mem->lock);
+    ring_init(&mem->ring, mem->data, SM_SIZE);
+    init_mutex(&mem->read_lock);
+    init_mutex(&mem->write_lock);
 
     dev->priv = mem;
 
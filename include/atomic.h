@@ -145,6 +145,14 @@ static uint32_t atomic_or(uint32_t *ptr, uint32_t val);
  */
 static uint32_t atomic_and(uint32_t *ptr, uint32_t val);
 
+/**
+ * Data memory barrier
+ *
+ * All memory accesses before the barrier are observed before any memory
+ * accesses after it, by both the compiler and the CPU.
+ */
+static void data_memory_barrier(void);
+
 /**
  * Load-link
  *
@@ -32,10 +32,13 @@
  *
  */
 
+#include <stdint.h>
 #include <dev/device.h>
 #include <kernel/obj.h>
 #include <kernel/class.h>
 
+struct sensor_stream;
+
 struct accel_raw_data {
     int x;
     int y;
@@ -49,6 +52,12 @@ struct accel_data {
     float z;
 };
 
+/* Timestamped raw reading, as queued in a sensor stream */
+struct accel_sample {
+    uint64_t                timestamp;  /* perfcounter count */
+    struct accel_raw_data   raw;
+};
+
 struct accel {
     struct device   device;
     struct obj      obj;
@@ -121,6 +130,23 @@ struct accel_ops {
      * @returns zero on success, negative on error
      */
     int     (*get_raw_data)(struct accel *, struct accel_raw_data *);
+    /**
+     * Get sample stream
+     *
+     * Start queueing timestamped raw readings as they are produced, and
+     * return the stream to read them from with sensor_stream_read().
+     * Entries are struct accel_sample.  Returns the same stream if
+     * already started.  The stream is freed by deinit().
+     *
+     * Each stream has one consumer.
+     *
+     * Optional.  NULL if the driver does not support streaming.
+     *
+     * @param accel Accelerometer object to stream from
+     *
+     * @returns stream on success, NULL on error
+     */
+    struct sensor_stream *(*get_stream)(struct accel *);
 };
 
 extern struct class accel_class;
@@ -23,13 +23,23 @@
 #ifndef DEV_BARO_H_INCLUDED
 #define DEV_BARO_H_INCLUDED
 
+#include <stdint.h>
 #include <dev/device.h>
 #include <kernel/class.h>
 #include <kernel/obj.h>
 
+struct sensor_stream;
+
 struct baro_data {
-    float pressure;     /* Pascal */
-    float temperature;  /* deg C */
+    float       pressure;       /* Pascal */
+    float       temperature;    /* deg C */
+    uint32_t    sequence;       /* Increments with each new reading */
+};
+
+/* Timestamped reading, as queued in a sensor stream */
+struct baro_sample {
+    uint64_t                timestamp;  /* perfcounter count */
+    struct baro_data        data;
 };
 
 struct baro {
@@ -87,15 +97,16 @@ struct baro_ops {
     /**
      * Get new barometer data
      *
-     * Get a new reading from the barometer.  The result will be a new
-     * value from the barometer, not a cached value.  However, the barometer
-     * may do internal caching.
+     * Get a new reading from the barometer.  Drivers which convert in the
+     * background return the latest reading without waiting for a new one,
+     * so the same reading may be returned more than once.  Compare
+     * sequence numbers to tell new readings apart.
      *
      * The pressure returned from this function is in units of pascals.  If
      * the baro supports temperature (has_temp()), the temperature returned
      * will be in degrees Celsius.
      *
-     * This function blocks until new data is available.
+     * This function blocks until data is available.
      *
      * @param baro  Barometer object to receive data from
      * @param data  baro_data struct to place data in
@@ -103,6 +114,23 @@ struct baro_ops {
      * @returns zero on success, negative on error
      */
     int     (*get_data)(struct baro *, struct baro_data *);
+    /**
+     * Get sample stream
+     *
+     * Start queueing timestamped readings as they are produced, and
+     * return the stream to read them from with sensor_stream_read().
+     * Entries are struct baro_sample.  Returns the same stream if
+     * already started.  The stream is freed by deinit().
+     *
+     * Each stream has one consumer.
+     *
+     * Optional.  NULL if the driver does not support streaming.
+     *
+     * @param baro  Barometer object to stream from
+     *
+     * @returns stream on success, NULL on error
+     */
+    struct sensor_stream *(*get_stream)(struct baro *);
 };
 
 extern struct class baro_class;
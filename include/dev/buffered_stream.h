@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DEV_BUFFERED_STREAM_H_INCLUDED
+#define DEV_BUFFERED_STREAM_H_INCLUDED
+
+#include <stdint.h>
+#include <dev/char.h>
+
+enum stream_buffering {
+    /* Writes pass straight through to the device */
+    STREAM_UNBUFFERED,
+    /* Written to the device at each newline, or when the buffer fills */
+    STREAM_LINE_BUFFERED,
+    /* Written to the device only when the buffer fills */
+    STREAM_FULLY_BUFFERED,
+};
+
+/*
+ * Create a buffering character device in front of dev.
+ *
+ * Writes are collected in a buffer of size bytes, and written to dev in one
+ * go according to mode.  Buffered output is also written before any read,
+ * so prompts appear before input is awaited, on fflush(), and when the
+ * stream is destroyed.  Reads pass straight through to dev.
+ *
+ * The stream holds a reference to dev, so the caller may put its own.
+ *
+ * @param dev   Character device to buffer
+ * @param mode  Buffering mode
+ * @param size  Buffer size in bytes, ignored when unbuffered
+ * @returns buffered char_device, NULL on error
+ */
+struct char_device *buffered_stream_create(struct char_device *dev,
+                                           enum stream_buffering mode,
+                                           uint32_t size);
+
+#endif
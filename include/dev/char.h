@@ -74,6 +74,17 @@ struct char_ops {
      * @returns number of bytes written, or negative on error
      */
     int     (*write)(struct char_device *, const char *, size_t);
+    /**
+     * Flush buffered output
+     *
+     * Write out any data accepted by write() but held back by the device.
+     * Optional, NULL if the device does not buffer output.
+     *
+     * @param char_device Character device to flush
+     *
+     * @returns zero on success, negative on error
+     */
+    int     (*flush)(struct char_device *);
     /**
      * Cleanup internal structures
      *
@@ -40,6 +40,7 @@ struct device {
 
 struct device_driver {
     const char          *name;
+    uint32_t            name_hash;  /* Set on registration */
     int                 (*probe)(const char *);
     struct obj          *(*ctor)(const char *);
     struct class        *class;
@@ -23,7 +23,15 @@
 #ifndef DEV_FDTPARSE_H_INCLUDED
 #define DEV_FDTPARSE_H_INCLUDED
 
-/* Additional helper functions for parsing FDT */
+#include <stdint.h>
+
+/*
+ * Additional helper functions for parsing FDT
+ *
+ * Once fdtparse_index_init() has run, lookups in the global blob are served
+ * from an in-memory index of the tree, rather than by scanning the blob.
+ * Prefer these functions to their libfdt equivalents for that reason.
+ */
 
 struct fdt_gpio {
     int gpio;
@@ -37,6 +45,106 @@ struct fdt_gpio {
  */
 const void *fdtparse_get_blob(void);
 
+/**
+ * Build the index of the global FDT blob
+ *
+ * Walk the blob once, recording its nodes, phandles, compatible strings,
+ * aliases, and commonly used properties.  Must be called after the heap
+ * is initialized.  Until it is called, or if it fails, lookups fall back
+ * to libfdt.
+ *
+ * @returns 0 on success, negative if the index could not be built
+ */
+int fdtparse_index_init(void);
+
+/**
+ * Find a node by path, as fdt_path_offset()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param path  full path of the node, or an alias, optionally followed by
+ *              a path relative to the aliased node
+ * @returns structure block offset of the node (>= 0), on success, on error:
+ *    -FDT_ERR_BADPATH, if path starts with an alias which does not exist
+ *    -FDT_ERR_NOTFOUND, if the node does not exist
+ *    other libfdt errors, standard meanings
+ */
+int fdtparse_path_offset(const void *fdt, const char *path);
+
+/**
+ * Find a subnode by name, as fdt_subnode_offset()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param offset    offset of parent node
+ * @param name  name of subnode, the unit address may be omitted
+ * @returns structure block offset of the subnode (>= 0), on success,
+ *    -FDT_ERR_NOTFOUND, if the subnode does not exist
+ *    other libfdt errors, standard meanings
+ */
+int fdtparse_subnode_offset(const void *fdt, int offset, const char *name);
+
+/**
+ * Find the parent of a node, as fdt_parent_offset()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param offset    offset of node
+ * @returns structure block offset of the parent node (>= 0), on success,
+ *    -FDT_ERR_NOTFOUND, if offset is the root node
+ *    other libfdt errors, standard meanings
+ */
+int fdtparse_parent_offset(const void *fdt, int offset);
+
+/**
+ * Find a node by phandle, as fdt_node_offset_by_phandle()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param phandle   phandle of node
+ * @returns structure block offset of the node (>= 0), on success,
+ *    -FDT_ERR_NOTFOUND, if no node has phandle
+ *    -FDT_ERR_BADPHANDLE, if phandle is not a valid phandle
+ *    other libfdt errors, standard meanings
+ */
+int fdtparse_node_offset_by_phandle(const void *fdt, uint32_t phandle);
+
+/**
+ * Find the next compatible node, as fdt_node_offset_by_compatible()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param startoffset   only find nodes after this offset, -1 to search
+ *                      from the start of the tree
+ * @param compatible    compatible string to match
+ * @returns structure block offset of the node (>= 0), on success,
+ *    -FDT_ERR_NOTFOUND, if there are no more compatible nodes
+ *    other libfdt errors, standard meanings
+ */
+int fdtparse_node_offset_by_compatible(const void *fdt, int startoffset,
+                                       const char *compatible);
+
+/**
+ * Check node compatibility, as fdt_node_check_compatible()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param offset    offset of node to check
+ * @param compatible    compatible string to match
+ * @returns 0 if node is compatible, 1 if it is not,
+ *    -FDT_ERR_NOTFOUND, if node has no compatible property
+ *    other libfdt errors, standard meanings
+ */
+int fdtparse_node_check_compatible(const void *fdt, int offset,
+                                   const char *compatible);
+
+/**
+ * Get property value, as fdt_getprop()
+ *
+ * @param fdt   pointer to the device tree blob
+ * @param offset    offset of node containing desired property
+ * @param name  name of property
+ * @param lenp  if not NULL, set to the length of the property value,
+ *              or negative error if it is not found
+ * @returns pointer to property value, or NULL on error
+ */
+const void *fdtparse_getprop(const void *fdt, int offset, const char *name,
+                             int *lenp);
+
 /**
  * Retreive the offset of the node referenced by a given alias
  *
@@ -138,9 +246,9 @@ int fdtparse_get_gpios(const void *fdt, int offset, const char *name,
  * buffer returned.  This buffer is malloc()'d, and must be free()'d when
  * no longer needed.
  *
- * NOTE: This function is expensive, as it must scan the device tree
- * structure from the start to nodeoffset, possibly multiple times,
- * depending on the size of the path.
+ * NOTE: Without the index, this function is expensive, as it must scan
+ * the device tree structure from the start to nodeoffset, possibly multiple
+ * times, depending on the size of the path.
  *
  * @param fdt  pointer to the device tree blob
  * @param offset    offset of node to get full path of
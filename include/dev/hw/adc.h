@@ -33,6 +33,20 @@ struct adc {
     void        *priv;
 };
 
+/*
+ * Block of samples from a streaming ADC
+ *
+ * Samples are stored frame by frame, each frame holding one sample for
+ * each channel in the scan, in scan order.
+ */
+struct adc_block {
+    const uint16_t  *samples;   /* frames * channels samples */
+    uint32_t        frames;     /* Number of frames in block */
+    uint32_t        channels;   /* Number of samples in each frame */
+    uint32_t        index;      /* Index of this ADC's sample in each frame */
+    uint32_t        overruns;   /* Total blocks lost since stream started */
+};
+
 /* Takes obj and returns containing struct adc */
 static inline struct adc *to_adc(struct obj *o) {
     return (struct adc *) container_of(o, struct adc, obj);
@@ -60,6 +74,53 @@ struct adc_ops {
      * @return latest value read from ADC
      */
     uint32_t    (*read_raw)(struct adc *);
+    /**
+     * Begin streaming samples
+     *
+     * Continuously scan every initialized channel sharing this ADC's
+     * converter, rate times per second, delivering samples in blocks of
+     * frames scans.  Channels cannot be added to the converter while
+     * it is streaming, and destroying one stops the stream.  While
+     * streaming, read_raw() returns the latest streamed sample.
+     *
+     * This method is optional, and may be NULL if streaming is not
+     * supported.
+     *
+     * @param adc       ADC on converter to stream
+     * @param rate      Scans per second
+     * @param frames    Number of scans in each block
+     * @return 0 on success, negative on error
+     */
+    int         (*stream_start)(struct adc *, uint32_t rate, uint32_t frames);
+    /**
+     * Wait for next block of streamed samples
+     *
+     * Blocks until a new block of samples is complete.  The block remains
+     * valid until the next call to stream_read() or stream_stop(), but must
+     * be consumed before the following block completes, or it will be
+     * overwritten and counted as an overrun.  If more than one block
+     * completed since the last call, only the newest is returned.
+     *
+     * Only one task should read a stream.
+     *
+     * @param adc           Streaming ADC
+     * @param block         Filled with the new block
+     * @param timeout_us    Maximum time to wait, or WAIT_FOREVER
+     * @return 0 on success, negative on error or timeout
+     */
+    int         (*stream_read)(struct adc *, struct adc_block *block,
+                               uint32_t timeout_us);
+    /**
+     * Stop streaming samples
+     *
+     * Stops the stream started by stream_start(), returning the converter
+     * to one-shot reads.  A stream_read() waiting on the stream returns an
+     * error.
+     *
+     * @param adc   ADC on streaming converter
+     * @return 0 on success, negative on error
+     */
+    int         (*stream_stop)(struct adc *);
     /**
      * Implementation specific destructor
      *
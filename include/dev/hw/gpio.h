@@ -49,6 +49,19 @@ enum gpio_direction {
     GPIO_DIRECTION_MASK = (1 << 0),
 };
 
+/*
+ * GPIO interrupt triggers
+ *
+ * Edges refer to the GPIO value, so with an active low GPIO, a rising edge
+ * is the pin going low.
+ */
+enum gpio_irq_trigger {
+    GPIO_IRQ_NONE       = 0,
+    GPIO_IRQ_RISING     = (1 << 0),
+    GPIO_IRQ_FALLING    = (1 << 1),
+    GPIO_IRQ_BOTH       = GPIO_IRQ_RISING | GPIO_IRQ_FALLING,
+};
+
 enum gpio_error {
     GPIO_OK = 0,            /* No error */
     GPIO_ERR_INVAL,         /* GPIO value does not coorespond to a valid GPIO */
@@ -172,6 +185,26 @@ struct gpio_ops {
      * @returns Implementation defined, generally error value, or field value
      */
     int     (*set_flags)(struct gpio *, unsigned int, int);
+    /**
+     * Set GPIO interrupt handler
+     *
+     * Call handler whenever the GPIO input sees an edge selected by trigger.
+     * handler runs in interrupt context, and must not block.  A trigger of
+     * GPIO_IRQ_NONE or a NULL handler disables the interrupt.  Resetting
+     * or destroying the GPIO also disables it.
+     *
+     * The GPIO should be configured as an input.
+     *
+     * Optional.  NULL if the implementation does not support GPIO interrupts.
+     *
+     * @param gpio      GPIO to interrupt on
+     * @param trigger   Edges to interrupt on, from enum gpio_irq_trigger
+     * @param handler   Interrupt handler, passed gpio and data
+     * @param data      Passed to handler
+     * @returns zero on success, negative on error (one of enum gpio_error)
+     */
+    int     (*set_irq)(struct gpio *, int, void (*)(struct gpio *, void *),
+                       void *);
     /**
      * Implementation specific destructor
      *
@@ -38,6 +38,23 @@ static inline struct i2c *to_i2c(struct obj *o) {
     return (struct i2c *) container_of(o, struct i2c, obj);
 }
 
+/* Message is a read from the device, rather than a write */
+#define I2C_MSG_READ    (1 << 0)
+
+/*
+ * One segment of an I2C transfer
+ *
+ * Consecutive messages in a transfer are joined by a repeated start, so
+ * a register address write followed by a read of the register is one
+ * bus transaction.
+ */
+struct i2c_msg {
+    uint8_t     addr;   /* 7-bit device address */
+    uint8_t     flags;  /* I2C_MSG_* */
+    uint8_t     *buf;
+    uint32_t    len;
+};
+
 struct i2c_ops {
     /**
      * Initialize I2C peripheral
@@ -100,6 +117,22 @@ struct i2c_ops {
      * @returns bytes read into buffer, negative on error
      */
     int         (*read)(struct i2c *, uint8_t, uint8_t *, uint32_t);
+    /**
+     * Perform I2C transfer
+     *
+     * Perform each message in turn, separated by repeated starts, and
+     * followed by a stop.  The transfer is queued behind any others on
+     * the bus, and the calling task blocks until it completes.
+     *
+     * Must not be called from interrupt context.
+     *
+     * @param i2c   I2C peripheral the devices are connected to
+     * @param msgs  Messages to transfer
+     * @param num   Number of messages
+     *
+     * @returns number of messages transferred, negative on error
+     */
+    int         (*transfer)(struct i2c *, struct i2c_msg *, uint32_t);
 };
 
 extern struct class i2c_class;
@@ -32,6 +32,25 @@ struct pwm {
     void        *priv;
 };
 
+/* Maximum number of outputs in a PWM group */
+#define PWM_GROUP_MAX   32
+
+/*
+ * PWM update group
+ *
+ * Pulse widths for several outputs are staged, then committed together, so
+ * that outputs sharing a timer never run a period with some widths updated
+ * and others not.  Managed with the pwm_group_* functions below.
+ */
+struct pwm_group {
+    struct obj      **pwms;     /* Outputs, with a reference held to each */
+    uint32_t        *widths;    /* Staged pulse widths, in microseconds */
+    uint32_t        staged;     /* Bit mask of outputs with a staged width */
+    uint8_t         num;
+    /* Ops of every output, if all share a driver, else NULL */
+    struct pwm_ops  *ops;
+};
+
 /* Takes obj and returns containing struct pwm */
 static inline struct pwm *to_pwm(struct obj *o) {
     return (struct pwm *) container_of(o, struct pwm, obj);
@@ -110,6 +129,20 @@ struct pwm_ops {
      *  0 if controlled in software
      */
     uint8_t (*is_hardware)(struct pwm *);
+    /**
+     * Commit group pulse widths
+     *
+     * Set the staged pulse widths of a group of outputs from this driver.
+     * Outputs sharing a timer all begin their new pulse widths in the same
+     * period, without glitches.
+     *
+     * Optional.  Without it, the outputs are set one at a time with
+     * set_pulse_width().
+     *
+     * @param group PWM group with staged widths to commit
+     * @returns zero on success, negative on error
+     */
+    int     (*commit_group)(struct pwm_group *);
     /**
      * Implementation specific destructor
      *
@@ -164,4 +197,55 @@ static inline void pwm_put(struct obj *o) {
     obj_put(o);
 }
 
+/**
+ * Get PWM update group
+ *
+ * Create a group of PWM outputs, whose pulse widths may be staged with
+ * pwm_group_set_pulse_width(), then applied together with
+ * pwm_group_commit().  A reference is taken to each output, and released
+ * by pwm_group_put().
+ *
+ * A group is not protected by a lock, and should be used by one task.
+ *
+ * @param pwms  Array of PWM objects received from pwm_get
+ * @param num   Number of PWM objects, at most PWM_GROUP_MAX
+ * @returns PWM group on success, NULL on error
+ */
+struct pwm_group *pwm_group_get(struct obj **pwms, uint8_t num);
+
+/**
+ * Stage group pulse width
+ *
+ * Stage the pulse width of one output in the group, in microseconds.  The
+ * output is not changed until pwm_group_commit().
+ *
+ * @param group PWM group containing output
+ * @param index Index of the output in the array passed to pwm_group_get
+ * @param width Desired pulse width, in microseconds
+ * @returns zero on success, negative on error
+ */
+int pwm_group_set_pulse_width(struct pwm_group *group, uint8_t index,
+                              uint32_t width);
+
+/**
+ * Commit group pulse widths
+ *
+ * Apply all staged pulse widths.  Where the driver supports it, outputs
+ * sharing a timer all begin their new pulse widths in the same period.
+ *
+ * @param group PWM group to commit
+ * @returns zero on success, negative on error
+ */
+int pwm_group_commit(struct pwm_group *group);
+
+/**
+ * Free PWM update group
+ *
+ * Releases the group's references to its outputs.  Staged pulse widths
+ * which were not committed are discarded.
+ *
+ * @param group PWM group to free
+ */
+void pwm_group_put(struct pwm_group *group);
+
 #endif
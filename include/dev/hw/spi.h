@@ -42,6 +42,45 @@ struct spi_dev {
     uint8_t extended_transaction;
 };
 
+/*
+ * One segment of a SPI transfer
+ *
+ * Clocks len bytes, writing tx (zeros if NULL) while reading into rx
+ * (discarded if NULL).
+ */
+struct spi_seg {
+    const uint8_t   *tx;
+    uint8_t         *rx;
+    uint32_t        len;
+};
+
+/*
+ * SPI transfer
+ *
+ * A list of segments, clocked back to back with the device chip select
+ * held active for the whole transfer.
+ *
+ * Once submitted, the transfer and its buffers belong to the driver until
+ * it completes.
+ */
+struct spi_xfer {
+    struct spi_dev  *dev;
+    struct spi_seg  *segs;
+    uint32_t        num;
+    /*
+     * Completion callback, called with zero on success or negative on
+     * error, usually from interrupt context.  If NULL, transfer() blocks
+     * until the transfer completes.
+     */
+    void            (*complete)(struct spi_xfer *, int);
+    void            *data;  /* For use by complete */
+
+    /* Private to the SPI driver */
+    struct spi_xfer *next;
+    volatile int    result;
+    void            *waiter;
+};
+
 /* Takes obj and returns containing struct spi */
 static inline struct spi *to_spi(struct obj *o) {
     return (struct spi *) container_of(o, struct spi, obj);
@@ -168,6 +207,27 @@ struct spi_ops {
      * @param dev   SPI device to begin transaction with
      */
     void        (*end_transaction)(struct spi *, struct spi_dev *);
+    /**
+     * Perform SPI transfer
+     *
+     * Queue a transfer behind any others on the port.  The chip select is
+     * set for the duration of the transfer, and no other transfers are
+     * interleaved with it.
+     *
+     * If xfer->complete is NULL, block until the transfer completes.
+     * Otherwise, return once it is queued, and call xfer->complete when it
+     * is done, possibly before transfer() returns.
+     *
+     * Must not be called from interrupt context, or during an extended
+     * transaction.
+     *
+     * @param spi   SPI port the device is connected to
+     * @param xfer  Transfer to perform
+     *
+     * @returns zero on success, negative on error.  For a blocking transfer,
+     *          this is the result of the transfer.
+     */
+    int         (*transfer)(struct spi *, struct spi_xfer *);
 };
 
 extern struct class spi_class;
@@ -23,6 +23,19 @@
 #ifndef DEV_HW_SYSTICK_INCLUDED
 #define DEV_HW_SYSTICK_INCLUDED
 
+#include <stdint.h>
+
 void init_systick(void) __attribute__((section(".kernel")));
 
+/*
+ * Set by the SysTick interrupt, which pends PendSV to perform the tick.
+ * Distinguishes ticks from other reasons for PendSV.
+ */
+extern volatile uint8_t systick_pending;
+
+/* Tickless sleep support.  See arch_sched_tickless_*() */
+uint32_t systick_tickless_max(void) __attribute__((section(".kernel")));
+int systick_tickless_start(uint32_t ticks) __attribute__((section(".kernel")));
+uint32_t systick_tickless_stop(void) __attribute__((section(".kernel")));
+
 #endif
@@ -36,6 +36,11 @@ static inline struct uart *to_uart(struct obj *o) {
     return (struct uart *) container_of(o, struct uart, obj);
 }
 
+struct uart_stats {
+    uint32_t    rx_dropped;     /* Received bytes lost before being read */
+    uint32_t    rx_overruns;    /* Hardware overruns, each losing >= 1 byte */
+};
+
 struct uart_ops {
     /**
      * Initialize UART peripheral
@@ -89,9 +94,13 @@ struct uart_ops {
     /**
      * Read from UART
      *
-     * Read up to num bytes from the UART into buf.  read() does not block.
-     * It will return immediately if blocking would be required.  As such,
-     * multiple calls may be necessary to complete reading.
+     * Read up to num bytes from the UART into buf.  By default, read() does
+     * not block.  It will return immediately if blocking would be required.
+     * As such, multiple calls may be necessary to complete reading.
+     *
+     * If a read timeout is set with set_read_timeout(), read() instead
+     * blocks until at least one byte is available, or the timeout passes,
+     * returning zero.
      *
      * @param uart  UART to read from
      * @param buf   Buffer to read into.  Must hold at least num bytes
@@ -103,9 +112,10 @@ struct uart_ops {
     /**
      * Write to UART
      *
-     * Write up to num bytes to the UART from buf.  write() does not block.
-     * It will return immediately if blocking would be required.  As such,
-     * multiple calls may be necessary to complete reading.
+     * Write up to num bytes to the UART from buf.  Drivers may queue the
+     * data to transmit in the background, returning before it is sent, and
+     * may block while waiting for queue space.  Fewer than num bytes may be
+     * written, so multiple calls may be necessary to complete writing.
      *
      * @param uart  UART to write to
      * @param buf   Buffer to write from.  Must have at least num bytes
@@ -114,6 +124,28 @@ struct uart_ops {
      * @returns number of bytes written, or negative on error
      */
     int     (*write)(struct uart *, const char *, size_t);
+    /**
+     * Set read timeout
+     *
+     * Set the maximum time read() blocks waiting for data.  Zero, the
+     * default, makes read() non-blocking.  read() never blocks from
+     * interrupt context or before task switching begins.
+     *
+     * @param uart          UART to configure
+     * @param timeout_us    Read timeout in microseconds, or WAIT_FOREVER
+     *
+     * @returns zero on success, negative on error
+     */
+    int     (*set_read_timeout)(struct uart *, uint32_t);
+    /**
+     * Get UART statistics
+     *
+     * @param uart  UART to get statistics of
+     * @param stats Filled with the statistics since the UART was created
+     *
+     * @returns zero on success, negative on error
+     */
+    int     (*get_stats)(struct uart *, struct uart_stats *);
 };
 
 extern struct class uart_class;
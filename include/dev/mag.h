@@ -23,10 +23,13 @@
 #ifndef DEV_MAG_H_INCLUDED
 #define DEV_MAG_H_INCLUDED
 
+#include <stdint.h>
 #include <dev/device.h>
 #include <kernel/class.h>
 #include <kernel/obj.h>
 
+struct sensor_stream;
+
 struct mag_raw_data {
     int x;
     int y;
@@ -40,6 +43,12 @@ struct mag_data {
     float z;
 };
 
+/* Timestamped raw reading, as queued in a sensor stream */
+struct mag_sample {
+    uint64_t                timestamp;  /* perfcounter count */
+    struct mag_raw_data     raw;
+};
+
 struct mag {
     struct device   device;
     struct obj      obj;
@@ -114,6 +123,23 @@ struct mag_ops {
      * @returns zero on success, negative on error
      */
     int     (*get_raw_data)(struct mag *, struct mag_raw_data *);
+    /**
+     * Get sample stream
+     *
+     * Start queueing timestamped raw readings as they are produced, and
+     * return the stream to read them from with sensor_stream_read().
+     * Entries are struct mag_sample.  Returns the same stream if
+     * already started.  The stream is freed by deinit().
+     *
+     * Each stream has one consumer.
+     *
+     * Optional.  NULL if the driver does not support streaming.
+     *
+     * @param mag   Magnetometer object to stream from
+     *
+     * @returns stream on success, NULL on error
+     */
+    struct sensor_stream *(*get_stream)(struct mag *);
 };
 
 extern struct class mag_class;
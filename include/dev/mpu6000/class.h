@@ -24,11 +24,15 @@
 #define DEV_MPU6000_CLASS_H_INCLUDED
 
 #include <stdint.h>
+#include <dev/accel.h>
 #include <dev/device.h>
+#include <dev/gyro.h>
 #include <kernel/class.h>
 #include <kernel/obj.h>
 #include <kernel/mutex.h>
 
+struct sensor_stream;
+
 struct mpu6000 {
     struct device       device;
     struct obj          obj;
@@ -44,6 +48,21 @@ static inline struct mpu6000 *to_mpu6000(struct obj *o) {
     return (struct mpu6000 *) container_of(o, struct mpu6000, obj);
 }
 
+/* Accelerometer and gyroscope readings taken at the same instant */
+struct mpu6000_sample {
+    uint64_t                timestamp;  /* perfcounter count */
+    struct accel_raw_data   accel;
+    struct gyro_raw_data    gyro;
+};
+
+/* Sample streams available from get_stream() */
+enum mpu6000_stream {
+    MPU6000_STREAM_PAIRED = 0,  /* struct mpu6000_sample */
+    MPU6000_STREAM_ACCEL,       /* struct accel_sample */
+    MPU6000_STREAM_GYRO,        /* struct gyro_sample */
+    MPU6000_NUM_STREAMS,
+};
+
 struct mpu6000_ops {
     /**
      * Initialize MPU6000
@@ -134,6 +153,58 @@ struct mpu6000_ops {
      * @returns zero on success, negative on error
      */
     int     (*enable_gyroscope)(struct mpu6000 *, int);
+    /**
+     * Set sample rate and low-pass filter
+     *
+     * Set the output data rate of both sensors, and the bandwidth of the
+     * digital low-pass filter applied to them.  The rate is rounded to
+     * 1000Hz divided by an integer from 1 to 256.  The bandwidth is rounded
+     * up to one of 5, 10, 20, 42, 98 or 188Hz, or down to 188Hz.
+     *
+     * Samples queued in streams before the change are discarded.
+     *
+     * @param mpu       MPU6000 object to modify
+     * @param rate      Output data rate, in Hz
+     * @param lowpass   Low-pass filter bandwidth, in Hz
+     *
+     * @returns zero on success, negative on error
+     */
+    int     (*set_sampling)(struct mpu6000 *, uint32_t, uint32_t);
+    /**
+     * Get sample stream
+     *
+     * Start queueing timestamped raw readings as they are produced, and
+     * return the stream to read them from with sensor_stream_read().
+     * Returns the same stream if already started.
+     *
+     * Readings are collected in the MPU6000 FIFO, which is drained in
+     * bursts, so every stream receives readings of both sensors from the
+     * same instant.  Readings are only meaningful from sensors enabled with
+     * the methods above.
+     *
+     * Each stream has one consumer.
+     *
+     * Optional.  NULL if the driver does not support streaming.
+     *
+     * @param mpu       MPU6000 object to stream from
+     * @param stream    Which stream to start
+     *
+     * @returns stream on success, NULL on error
+     */
+    struct sensor_stream *(*get_stream)(struct mpu6000 *,
+                                        enum mpu6000_stream);
+    /**
+     * Stop sample stream
+     *
+     * Stop and free a stream started with get_stream().  Streams are also
+     * stopped by deinit().  Has no effect if the stream is not started.
+     *
+     * Optional, along with get_stream().
+     *
+     * @param mpu       MPU6000 object streaming
+     * @param stream    Which stream to stop
+     */
+    void    (*stop_stream)(struct mpu6000 *, enum mpu6000_stream);
 };
 
 extern struct class mpu6000_class;
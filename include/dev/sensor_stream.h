@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DEV_SENSOR_STREAM_H_INCLUDED
+#define DEV_SENSOR_STREAM_H_INCLUDED
+
+/*
+ * Sensor sample streams
+ *
+ * A sensor stream is a FIFO of timestamped samples, filled by a sensor
+ * driver as the sensor produces data, and read in batches by a consumer
+ * which never touches the sensor bus itself.
+ *
+ * Entries are driver defined structs, all the same size, which begin with
+ * a uint64_t timestamp, such as struct accel_sample.  Timestamps are
+ * perfcounter counts (system clock cycles), taken as close as possible to
+ * the moment the sensor sampled.
+ *
+ * Each stream has one producer, the driver, and one consumer.  When the
+ * FIFO is full, new samples are dropped and counted, rather than
+ * overwriting samples the consumer may be reading.
+ *
+ * Drivers fill streams either by pushing several samples at once from a
+ * hardware FIFO burst, or one at a time from a data-ready trigger.  A
+ * trigger timestamps the data-ready GPIO interrupt, then calls the driver
+ * from the sensor task to read the sample over the bus.  Drivers for
+ * sensors without a data-ready signal may instead poll from the sensor
+ * task on a sensor timer.
+ */
+
+#include <stdint.h>
+#include <ring.h>
+#include <list.h>
+#include <dev/hw/gpio.h>
+#include <dev/hw/perfcounter.h>
+#include <kernel/sem.h>
+#include <kernel/timer.h>
+
+struct sensor_stream {
+    struct ring         ring;
+    uint32_t            entry_size;
+    volatile uint32_t   dropped;    /* Entries dropped with the FIFO full */
+    volatile uint8_t    waiting;
+    struct semaphore    available;
+};
+
+/*
+ * Current sensor timestamp
+ *
+ * @returns perfcounter count, in system clock cycles
+ */
+static inline uint64_t sensor_timestamp(void) {
+    return perfcounter_getcount();
+}
+
+/*
+ * Initialize sensor stream
+ *
+ * Allocate a FIFO holding at least depth entries.
+ *
+ * @param stream        Stream to initialize
+ * @param entry_size    Size of each entry, beginning with its timestamp
+ * @param depth         Minimum number of entries to hold
+ * @returns zero on success, negative on error
+ */
+int sensor_stream_init(struct sensor_stream *stream, uint32_t entry_size,
+                       uint32_t depth);
+
+/*
+ * Free sensor stream
+ *
+ * Neither the producer nor the consumer may use the stream afterwards.
+ *
+ * @param stream    Stream to free
+ */
+void sensor_stream_destroy(struct sensor_stream *stream);
+
+/*
+ * Add entries to stream (producer)
+ *
+ * Entries which do not fit are dropped and counted.  The consumer is woken
+ * once for the whole batch.  May be called from interrupt context.
+ *
+ * @param stream    Stream to add to
+ * @param entries   Array of num entries
+ * @param num       Number of entries
+ * @returns number of entries added
+ */
+uint32_t sensor_stream_push(struct sensor_stream *stream, const void *entries,
+                            uint32_t num);
+
+/*
+ * Read entries from stream (consumer)
+ *
+ * Copy up to max of the oldest entries, blocking until at least one is
+ * available or the timeout passes.  Outside of a task, never blocks.
+ *
+ * @param stream        Stream to read from
+ * @param entries       Array of max entries to copy to
+ * @param max           Maximum number of entries to read
+ * @param timeout_us    Maximum time to block, 0 to never block, or
+ *                      WAIT_FOREVER
+ * @returns number of entries read, zero if none arrived before the
+ *          timeout, negative on error
+ */
+int sensor_stream_read(struct sensor_stream *stream, void *entries,
+                       uint32_t max, uint32_t timeout_us);
+
+/* Entries available to read */
+static inline uint32_t sensor_stream_count(struct sensor_stream *stream) {
+    return ring_count(&stream->ring) / stream->entry_size;
+}
+
+/* Discard all entries (consumer) */
+static inline void sensor_stream_flush(struct sensor_stream *stream) {
+    ring_flush(&stream->ring);
+}
+
+/*
+ * Data-ready trigger
+ *
+ * Calls read from the sensor task each time the data-ready GPIO becomes
+ * active, passing the time of the interrupt.  read fetches the sample and
+ * pushes it to the driver's stream.
+ *
+ * If the GPIO fires again before read is called for the last edge, the
+ * edge is counted in missed, and only the earlier sample is read.
+ *
+ * Sensors which queue samples in a hardware FIFO may set batch, before
+ * enabling the trigger, to call read only once every batch edges.  read
+ * is then passed the time of the first edge of the batch.
+ */
+struct sensor_trigger {
+    struct gpio         *gpio;
+    int                 (*read)(struct sensor_trigger *, uint64_t);
+    void                *data;      /* For use by read */
+    volatile uint64_t   timestamp;
+    volatile uint8_t    pending;
+    volatile uint32_t   missed;
+    uint32_t            batch;      /* Edges per read, default 1 */
+    volatile uint32_t   count;      /* Edges so far in this batch */
+    uint8_t             enabled;
+    struct list         list;
+};
+
+/*
+ * Initialize data-ready trigger from device tree
+ *
+ * Get the GPIO in the named GPIO property of the node, and configure it as
+ * an input.  An active low flag in the property selects an active low
+ * data-ready signal.
+ *
+ * @param trigger   Trigger to initialize
+ * @param fdt       Device tree blob
+ * @param offset    Offset of the sensor node
+ * @param prop      Name of the data-ready GPIO property
+ * @param read      Called with the trigger and timestamp to read a sample
+ * @param data      Stored in trigger->data
+ * @returns zero on success, negative on error.  -FDT_ERR_NOTFOUND if the
+ *          node has no such property.
+ */
+int sensor_trigger_init(struct sensor_trigger *trigger, const void *fdt,
+                        int offset, const char *prop,
+                        int (*read)(struct sensor_trigger *, uint64_t),
+                        void *data);
+
+/*
+ * Free data-ready trigger
+ *
+ * Disables the trigger and releases its GPIO.
+ *
+ * @param trigger   Trigger to free
+ */
+void sensor_trigger_destroy(struct sensor_trigger *trigger);
+
+/*
+ * Enable data-ready trigger
+ *
+ * Starts the sensor task, if it is not already running.  Must be called
+ * from a task.
+ *
+ * @param trigger   Trigger to enable
+ * @returns zero on success, negative on error
+ */
+int sensor_trigger_enable(struct sensor_trigger *trigger);
+
+/*
+ * Disable data-ready trigger
+ *
+ * Once this returns, read is not running and will not be called again.
+ * Must be called from a task, and not from read.
+ *
+ * @param trigger   Trigger to disable
+ */
+void sensor_trigger_disable(struct sensor_trigger *trigger);
+
+/*
+ * Sensor timer
+ *
+ * Calls func from the sensor task every period, so drivers may poll the
+ * bus on a schedule, such as to step a conversion state machine.  If the
+ * sensor task falls behind, expiries which pass before func runs are
+ * merged into one call.
+ */
+struct sensor_timer {
+    struct timer        timer;
+    void                (*func)(struct sensor_timer *);
+    void                *data;      /* For use by func */
+    volatile uint8_t    pending;
+    uint8_t             enabled;
+    struct list         list;
+};
+
+/*
+ * Initialize sensor timer
+ *
+ * @param timer Timer to initialize
+ * @param func  Called from the sensor task on expiry
+ * @param data  Stored in timer->data
+ */
+void sensor_timer_init(struct sensor_timer *timer,
+                       void (*func)(struct sensor_timer *), void *data);
+
+/*
+ * Start sensor timer
+ *
+ * Starts the sensor task, if it is not already running.  func is first
+ * called one period from now.  If the timer is already running, it is
+ * restarted.  Must be called from a task.
+ *
+ * @param timer     Timer to start
+ * @param period_us Microseconds between calls, rounded up to a system tick
+ * @returns zero on success, negative on error
+ */
+int sensor_timer_start(struct sensor_timer *timer, uint32_t period_us);
+
+/*
+ * Stop sensor timer
+ *
+ * Once this returns, func is not running and will not be called again.
+ * Must be called from a task, and not from func.
+ *
+ * @param timer Timer to stop
+ */
+void sensor_timer_stop(struct sensor_timer *timer);
+
+#endif
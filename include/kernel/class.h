@@ -51,10 +51,12 @@
 #include <stdint.h>
 #include <kernel/obj.h>
 #include <kernel/collection.h>
+#include <mm/slab.h>
 
 typedef struct class {
     struct collection instances;
     struct obj_type *type;
+    struct slab_cache cache;    /* Instance containers */
     struct obj      obj;
 } class_t;
 
@@ -66,8 +68,9 @@ typedef struct class {
 /*
  * Instantiate a class member
  *
- * Allocate (using kmalloc()) an instance of a class, using the container
- * type, returning the instance obj.  The provided name will be copied.
+ * Allocate (from the class slab cache) an instance of a class, using the
+ * container type, returning the instance obj.  The provided name will be
+ * copied.  Every instance of a class must use the same container type.
  *
  * When finished with the class instance, the container should be freed
  * with class_deinstantiate().
@@ -119,9 +122,11 @@ int class_export_member(struct obj *o);
  */
 int class_unexport_member(struct obj *o);
 
+/* The cache object size is set by the first instantiate() */
 #define INIT_CLASS(symbol, name, obj_type) {    \
     .instances = INIT_COLLECTION((symbol).instances), \
     .type = (obj_type),   \
+    .cache = INIT_SLAB_CACHE((symbol).cache, (name), 0, SLAB_KERNEL, NULL), \
     .obj = INIT_OBJ((symbol).obj, (name), (obj_type), NULL, NULL),  \
 }
 
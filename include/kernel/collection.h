@@ -29,12 +29,16 @@
  *
  * Collections are kind of like an iterator for your data structure, baked in
  * with add/delete functions.
+ *
+ * Members are also indexed by name hash, so collection_get_by_name() does
+ * not need to walk and strcmp() every member.
  */
 
 #ifndef KERNEL_COLLECTION_H_INCLUDED
 #define KERNEL_COLLECTION_H_INCLUDED
 
 #include <list.h>
+#include <kernel/hash_index.h>
 #include <kernel/obj.h>
 #include <kernel/reentrant_mutex.h>
 
@@ -42,8 +46,12 @@ struct collection {
     struct reentrant_mutex lock;
     struct list list;
     struct list *curr;
+    struct hash_index index;    /* Members by name */
 };
 
+#define INIT_COLLECTION_INDEX \
+    INIT_HASH_INDEX(struct obj, name_hash, name, list)
+
 /**
  * Statically initialize collection
  *
@@ -57,6 +65,7 @@ struct collection {
 #define INIT_COLLECTION(c) { .lock = INIT_REENTRANT_MUTEX, \
                              .list = INIT_LIST((c).list), \
                              .curr = NULL, \
+                             .index = INIT_COLLECTION_INDEX, \
                            }
 
 /**
@@ -70,6 +79,7 @@ static inline void init_collection(struct collection *c) {
     init_reentrant_mutex(&c->lock);
     list_init(&c->list);
     c->curr = NULL;
+    c->index = (struct hash_index) INIT_COLLECTION_INDEX;
 }
 
 /**
@@ -165,7 +175,7 @@ int collection_del(struct collection *c, struct obj *o);
  * Find member by name
  *
  * Find a collection member by its obj name.  The first obj matching the
- * provided name will be returned.
+ * provided name will be returned, that is, the most recently added.
  *
  * @param c collection to search
  * @param name  name to find
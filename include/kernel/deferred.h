@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KERNEL_DEFERRED_H_INCLUDED
+#define KERNEL_DEFERRED_H_INCLUDED
+
+/*
+ * Deferred kernel work
+ *
+ * Interrupt handlers may not call into the kernel directly, as they may
+ * have preempted the kernel itself.  Instead, an interrupt handler records
+ * what needs to be done (for example, by atomically incrementing a count
+ * of semaphore posts), then queues deferred work with defer().  The work
+ * function is called from kernel context as soon as the interrupt returns,
+ * before the scheduler picks the next task to run.
+ *
+ * A work item is only queued once, no matter how many times it is deferred
+ * before it runs, so the work function should handle everything that was
+ * recorded since it last ran.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct deferred {
+    struct deferred *next;
+    uint32_t        queued;
+    void            (*func)(struct deferred *);
+};
+
+#define INIT_DEFERRED(work_func) {  \
+    .next = NULL,                   \
+    .queued = 0,                    \
+    .func = (work_func),            \
+}
+
+static inline void deferred_init(struct deferred *work,
+                                 void (*func)(struct deferred *)) {
+    work->next = NULL;
+    work->queued = 0;
+    work->func = func;
+}
+
+/*
+ * Queue deferred work
+ *
+ * Safe to call from any interrupt handler.  Does nothing if work is
+ * already queued.
+ *
+ * @param work  Work to queue
+ */
+void defer(struct deferred *work);
+
+/*
+ * Run deferred work
+ *
+ * Call the work function of every queued item.  Must be called from kernel
+ * context.  The scheduler does so before every scheduling decision made in
+ * an interrupt.
+ */
+void run_deferred(void) __attribute__((section(".kernel")));
+
+#endif
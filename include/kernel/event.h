@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KERNEL_EVENT_H_INCLUDED
+#define KERNEL_EVENT_H_INCLUDED
+
+/*
+ * Event flags
+ *
+ * An event holds 32 flags, which are set with event_set() and waited on
+ * with event_wait().  A task may wait for any or all of a set of flags,
+ * and optionally consume the flags it waited for.  Setting flags wakes
+ * every waiter whose condition is satisfied.
+ *
+ * event_set() may be called from interrupt handlers.
+ *
+ * Like semaphores, events are either named, created with event_create()
+ * and found with event_get(), or anonymous, initialized with event_init().
+ */
+
+#include <stdint.h>
+#include <kernel/class.h>
+#include <kernel/deferred.h>
+#include <kernel/obj.h>
+#include <kernel/wait.h>
+
+/* event_wait() modes, which may be OR'd together */
+#define EVENT_WAIT_ANY  0           /* Wait for any of the flags */
+#define EVENT_WAIT_ALL  (1 << 0)    /* Wait for all of the flags */
+#define EVENT_CLEAR     (1 << 1)    /* Clear the flags waited for on return */
+
+struct event {
+    uint32_t            flags;
+    struct wait_queue   waiters;
+    uint32_t            isr_set;    /* Flags set from interrupts, not yet applied */
+    struct deferred     isr_work;
+    struct obj          obj;
+};
+
+#define to_event(__obj) container_of((__obj), struct event, obj)
+
+extern struct class event_class;
+
+/*
+ * Initialize anonymous event
+ *
+ * All flags are initially clear.
+ *
+ * @param ev    Event to initialize
+ */
+void event_init(struct event *ev);
+
+/*
+ * Create named event
+ *
+ * Allocate an event, and make it available by name with event_get().
+ * It is destroyed when the last reference is put with event_put().
+ *
+ * @param name  Event name (will be copied)
+ * @returns new event, or NULL on error
+ */
+struct event *event_create(const char *name);
+
+/*
+ * Get named event
+ *
+ * @param name  Event name
+ * @returns reference to event, or NULL if it doesn't exist
+ */
+struct event *event_get(const char *name);
+
+/*
+ * Put event reference
+ *
+ * @param ev    Event from event_create() or event_get()
+ */
+void event_put(struct event *ev);
+
+/*
+ * Wait for event flags
+ *
+ * Block until any (EVENT_WAIT_ANY) or all (EVENT_WAIT_ALL) of flags are
+ * set, or the timeout expires.  With EVENT_CLEAR, the flags waited for
+ * are cleared before returning.
+ *
+ * Must not be called from interrupt context.
+ *
+ * @param ev            Event to wait on
+ * @param flags         Flags to wait for, non-zero
+ * @param mode          EVENT_WAIT_ANY or EVENT_WAIT_ALL, optionally OR'd
+ *                      with EVENT_CLEAR
+ * @param timeout_us    Maximum time to block, 0 to never block, or
+ *                      WAIT_FOREVER
+ * @returns the requested flags that were set, or 0 on timeout
+ */
+uint32_t event_wait(struct event *ev, uint32_t flags, uint32_t mode,
+                    uint32_t timeout_us);
+
+/*
+ * Set event flags
+ *
+ * Set flags, waking all waiters whose conditions are now satisfied.  May
+ * be called from interrupt context.
+ *
+ * @param ev    Event to set flags in
+ * @param flags Flags to set
+ */
+void event_set(struct event *ev, uint32_t flags);
+
+/*
+ * Clear event flags
+ *
+ * @param ev    Event to clear flags in
+ * @param flags Flags to clear
+ */
+void event_clear(struct event *ev, uint32_t flags);
+
+/**
+ * Event service call handler
+ * Should only be called by global SVC handler.  This takes va_args for the
+ * event service calls and returns the result of the service call.
+ *
+ * @param svc_number    Service call number.  Must be an event service call
+ * @param va_args       Arguments for service call
+ * @returns Return value of service call
+ */
+int event_service_call(uint32_t svc_number, ...);
+
+#endif
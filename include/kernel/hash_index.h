@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Hashed name index over a list of named entries
+ *
+ * An open-addressing (linear probing) table of pointers to entries which
+ * are also linked on a list.  Each entry holds its name, a cached hash of
+ * that name, and its list node, at fixed offsets described by the index.
+ * Lookups compare hashes before names, so most probes never touch a
+ * string.
+ *
+ * Entries sharing a name are found in the same order as a walk of the
+ * list from its head, which has the most recently added entry first.
+ *
+ * The index does no locking of its own, the owner of the list must
+ * serialize access.
+ */
+
+#ifndef KERNEL_HASH_INDEX_H_INCLUDED
+#define KERNEL_HASH_INDEX_H_INCLUDED
+
+#include <stdint.h>
+#include <compiler.h>
+#include <list.h>
+
+/* Smallest table, in slots */
+#define HASH_INDEX_MIN_SIZE 8
+
+struct hash_index {
+    void        **slots;
+    uint32_t    size;       /* Number of slots, a power of two, or 0 */
+    uint32_t    used;       /* Slots holding entries or deleted markers */
+    uint32_t    count;      /* Entries in the index */
+    uint16_t    hash_offset;    /* uint32_t name hash within entry */
+    uint16_t    name_offset;    /* const char *name within entry */
+    uint16_t    list_offset;    /* struct list node within entry */
+};
+
+/*
+ * Statically initialize an index for entries of type, whose name hash,
+ * name and list node are the named members.  Slots are allocated on the
+ * first addition.
+ */
+#define INIT_HASH_INDEX(type, hash_member, name_member, list_member) { \
+    .slots = NULL,  \
+    .size = 0,  \
+    .used = 0,  \
+    .count = 0, \
+    .hash_offset = offset_of(type, hash_member),    \
+    .name_offset = offset_of(type, name_member),    \
+    .list_offset = offset_of(type, list_member),    \
+}
+
+/**
+ * Add entry to index
+ *
+ * The entry must already be on the list headed by head.  When the index
+ * is too full, it is rebuilt larger from the list.  If that fails, the
+ * index is dropped, and hash_index_find() reports it unavailable until
+ * a later rebuild succeeds.
+ *
+ * @param index Index to add to
+ * @param entry Entry to add
+ * @param head  Head of the list of all entries
+ * @returns zero on success, negative if the index is unavailable
+ */
+int hash_index_add(struct hash_index *index, void *entry, struct list *head);
+
+/**
+ * Remove entry from index
+ *
+ * @param index Index to remove from
+ * @param entry Entry to remove
+ */
+void hash_index_del(struct hash_index *index, void *entry);
+
+/**
+ * Find entry by name
+ *
+ * @param index Index to search
+ * @param name  Name to find
+ * @param hash  strhash() of name
+ * @param found Set to the matching entry, or NULL if there is none
+ * @returns zero if the index was searched, negative if it is unavailable
+ *          and the caller must search the list
+ */
+int hash_index_find(struct hash_index *index, const char *name, uint32_t hash,
+                    void **found);
+
+/**
+ * Free index storage
+ *
+ * The index is left empty, and may be added to again.
+ *
+ * @param index Index to destroy
+ */
+void hash_index_destroy(struct hash_index *index);
+
+/**
+ * Cached name hash of an entry, computed if not yet known
+ *
+ * @param index Index describing the entry
+ * @param entry Entry to hash
+ * @returns name hash of entry
+ */
+uint32_t hash_index_entry_hash(struct hash_index *index, void *entry);
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KERNEL_MSGQ_H_INCLUDED
+#define KERNEL_MSGQ_H_INCLUDED
+
+/*
+ * Message queues
+ *
+ * A message queue holds up to a fixed number of fixed size messages, which
+ * are copied in by msgq_send() and out by msgq_receive(), in FIFO order.
+ * Senders block while the queue is full, and receivers while it is empty.
+ *
+ * When a receiver is already waiting, a sent message is copied directly
+ * into its buffer, bypassing the queue.
+ *
+ * Unlike semaphores and events, message queues may not be used from
+ * interrupt context, as a message cannot be safely copied into the queue
+ * while the kernel may be using it.  Interrupt handlers should instead
+ * buffer data themselves, and signal a task with a semaphore or event.
+ */
+
+#include <stdint.h>
+#include <kernel/class.h>
+#include <kernel/obj.h>
+#include <kernel/wait.h>
+
+struct msgq {
+    uint32_t            msg_size;
+    uint32_t            capacity;   /* Maximum messages in queue */
+    uint32_t            count;      /* Messages currently in queue */
+    uint32_t            head;       /* Index of oldest message */
+    uint8_t             *buf;       /* capacity * msg_size bytes */
+    struct wait_queue   senders;
+    struct wait_queue   receivers;
+    struct obj          obj;
+};
+
+#define to_msgq(__obj) container_of((__obj), struct msgq, obj)
+
+extern struct class msgq_class;
+
+/*
+ * Initialize anonymous message queue
+ *
+ * @param q         Message queue to initialize
+ * @param buf       Message storage, at least msg_size * capacity bytes
+ * @param msg_size  Size of each message in bytes
+ * @param capacity  Maximum number of queued messages, non-zero
+ */
+void msgq_init(struct msgq *q, void *buf, uint32_t msg_size,
+               uint32_t capacity);
+
+/*
+ * Create named message queue
+ *
+ * Allocate a message queue, and make it available by name with msgq_get().
+ * It is destroyed when the last reference is put with msgq_put().
+ *
+ * @param name      Message queue name (will be copied)
+ * @param msg_size  Size of each message in bytes
+ * @param capacity  Maximum number of queued messages, non-zero
+ * @returns new message queue, or NULL on error
+ */
+struct msgq *msgq_create(const char *name, uint32_t msg_size,
+                         uint32_t capacity);
+
+/*
+ * Get named message queue
+ *
+ * @param name  Message queue name
+ * @returns reference to message queue, or NULL if it doesn't exist
+ */
+struct msgq *msgq_get(const char *name);
+
+/*
+ * Put message queue reference
+ *
+ * @param q     Message queue from msgq_create() or msgq_get()
+ */
+void msgq_put(struct msgq *q);
+
+/*
+ * Send message
+ *
+ * Copy a message into the queue, blocking while it is full, until the
+ * timeout expires.
+ *
+ * @param q             Message queue to send to
+ * @param msg           Message to send, msg_size bytes
+ * @param timeout_us    Maximum time to block, 0 to never block, or
+ *                      WAIT_FOREVER
+ * @returns zero on success, negative on timeout
+ */
+int msgq_send(struct msgq *q, const void *msg, uint32_t timeout_us);
+
+/*
+ * Receive message
+ *
+ * Copy the oldest message out of the queue, blocking while it is empty,
+ * until the timeout expires.
+ *
+ * @param q             Message queue to receive from
+ * @param msg           Buffer for message, msg_size bytes
+ * @param timeout_us    Maximum time to block, 0 to never block, or
+ *                      WAIT_FOREVER
+ * @returns zero on success, negative on timeout
+ */
+int msgq_receive(struct msgq *q, void *msg, uint32_t timeout_us);
+
+/**
+ * Message queue service call handler
+ * Should only be called by global SVC handler.  This takes va_args for the
+ * message queue service calls and returns the result of the service call.
+ *
+ * @param svc_number    Service call number.  Must be a message queue
+ *                      service call
+ * @param va_args       Arguments for service call
+ * @returns Return value of service call
+ */
+int msgq_service_call(uint32_t svc_number, ...);
+
+#endif
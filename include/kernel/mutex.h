@@ -31,32 +31,50 @@
 struct task_t;
 typedef struct task_t task_t;
 
+/*
+ * lock holds the address of the holding task, or 0 when free.  Bit 0
+ * (MUTEX_WAITERS) is set while tasks are waiting, forcing the holder to
+ * release through the kernel.  An uncontended acquire or release only
+ * needs to update lock, so it is done with load-link/store-conditional,
+ * without a service call.
+ *
+ * waiting is the head of the queue of tasks blocked on the mutex, linked
+ * through their task_mutex_data.next_waiter.  The queue is kept in priority
+ * order, first-come first-served among equal priorities.
+ */
 struct mutex {
-        uint8_t lock;
-        task_t  *held_by;
+        uint32_t lock;
         task_t  *waiting;
 };
 
+#define MUTEX_WAITERS   (1 << 0)
+
 typedef struct mutex mutex;
 
 struct task_mutex_data {
     struct mutex   *held_mutexes[HELD_MUTEXES_MAX];
-    struct mutex   *waiting;
+    struct mutex   *waiting;        /* Mutex this task is blocked on */
+    task_t         *next_waiter;    /* Next task in waiting->waiting queue */
 };
 
+/*
+ * Acquire mutex
+ *
+ * If the mutex is held, the task blocks until the mutex is handed to it by
+ * release().  While blocked, the holder (and anything it is in turn blocked
+ * on) inherits the task's priority.
+ */
 void acquire(volatile struct mutex *mutex);
 void acquire_for_free(volatile struct mutex *mutex);
 void release(volatile struct mutex *mutex);
 
 static inline void init_mutex(volatile struct mutex *mutex) {
     mutex->lock = 0;
-    mutex->held_by = NULL;
     mutex->waiting = NULL;
 }
 
 #define INIT_MUTEX  {\
     .lock = 0,          \
-    .held_by = NULL,    \
     .waiting = NULL,    \
 }
 
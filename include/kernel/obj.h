@@ -63,6 +63,7 @@
 #define KERNEL_OBJ_H_INCLUDED
 
 #include <stdint.h>
+#include <string.h>
 #include <list.h>
 #include <atomic.h>
 #include <kernel/fault.h> /* kind of hacky, for panic_print in assert */
@@ -75,6 +76,7 @@ struct obj_type;
 typedef struct obj {
     atomic_t        refcount;
     const char      *name;      /* name must be replaced to be modified */
+    uint32_t        name_hash;  /* strhash() of name, 0 if not yet known */
     struct obj      *parent;    /* Parent in some sense, often a class */
     struct obj_type *type;
     struct list     list;
@@ -89,6 +91,7 @@ typedef struct obj_type {
 #define INIT_OBJ(symbol, obj_name, obj_type, obj_ops, obj_parent) { \
     .refcount = ATOMIC_INIT(1),  \
     .name = obj_name,   \
+    .name_hash = 0, \
     .parent = obj_parent,   \
     .type = obj_type,   \
     .list = INIT_LIST(symbol.list), \
@@ -101,12 +104,14 @@ static inline void obj_init(struct obj *o, struct obj_type *type, char *name) {
     atomic_set(&o->refcount, 1);
     o->type = type;
     o->name = name;
+    o->name_hash = name ? strhash(name) : 0;
     o->list.next = &o->list;
     o->list.prev = &o->list;
 }
 
 static inline void obj_set_name(struct obj *o, char *name) {
     o->name = name;
+    o->name_hash = name ? strhash(name) : 0;
 }
 
 static inline char *obj_get_name(struct obj *o) {
@@ -90,6 +90,11 @@ static __always_inline void yield_if_possible(void) {
  * This function should be called by any scheduler implementation. */
 void generic_task_setup(task_t *task);
 
+/* Do non-scheduler cleanup for an ended task, from task context.
+ * This function should be called by any scheduler implementation
+ * before freeing the task. */
+void generic_task_cleanup(task_t *task);
+
 /* Task comparison.
  * Compares two tasks in terms of priority, if applicable to the scheduler
  * Returns 0 for equality, >0 if task1 is greater, <0 if task2 is greater */
@@ -109,4 +114,27 @@ uint8_t task_runnable(task_t *task);
  * not runnable) */
 int task_switch(task_t *task);
 
+/*
+ * Sleep until deadline
+ *
+ * Block the current task until system_time(0) reaches deadline, allowing
+ * other tasks, including those of lower priority, to run in the meantime.
+ * Returns immediately if deadline has already passed.
+ *
+ * Max precision is system tick period.  Outside of a task (before task
+ * switching begins or in an interrupt), this busy-waits instead.
+ *
+ * @param deadline  Time to wake, in us since boot
+ */
+void task_sleep_until(uint64_t deadline);
+
+/*
+ * Sleep for us microseconds
+ *
+ * Equivalent to task_sleep_until(system_time(0) + us).
+ *
+ * @param us    Microseconds to sleep
+ */
+void task_sleep(uint32_t us);
+
 #endif
@@ -30,6 +30,8 @@
 
 #include <compiler.h>
 #include <list.h>
+#include <kernel/timer.h>
+#include <kernel/wait.h>
 
 typedef struct task_ctrl {
     uint32_t    *stack_limit;
@@ -37,14 +39,20 @@ typedef struct task_ctrl {
     uint32_t    *stack_base;
     void        (*fptr)(void);
     uint32_t    period; /* in ticks */
-    uint32_t    ticks_until_wake;
-    uint8_t     priority;
+    uint8_t     priority;       /* Effective, may be boosted by inheritance */
+    uint8_t     base_priority;  /* Assigned at creation */
     uint8_t     running;
+    uint8_t     runnable;   /* In the ready queue */
+    uint8_t     blocked;    /* Waiting to be woken */
+    uint8_t     wake_timeout;   /* Last woken by wake_timer expiry */
     uint8_t     abort;
     uint32_t    pid;
     struct list runnable_task_list;
-    struct list periodic_task_list;
     struct list free_task_list;
+    struct timer period_timer;  /* Releases periodic tasks */
+    struct timer wake_timer;    /* Wakes blocked tasks on timeout */
+    struct list wait_list;      /* Entry in wait queue while blocked */
+    void        *wait_data;     /* Wait queue owner's data while blocked */
     task_t      exported;
 } task_ctrl;
 
@@ -58,6 +66,71 @@ static __always_inline task_t *get_task_t(task_ctrl *task) {
     return &task->exported;
 }
 
+/**
+ * Block current task
+ *
+ * Remove the current task from the ready queue and switch to another task.
+ * The task will not run again until task_wake() is called on it, or the
+ * timeout expires.
+ *
+ * Must be called from kernel context, after task switching has begun.
+ *
+ * @param timeout   Ticks until the task is woken anyway, 0 for no timeout
+ */
+void svc_task_block(uint32_t timeout) __attribute__((section(".kernel")));
+
+/**
+ * Wake blocked task
+ *
+ * Return a task blocked by svc_task_block() to the ready queue, removing it
+ * from any wait queue it is in.  Does nothing if the task is not blocked.
+ * The woken task is not switched to; the caller may do so if appropriate.
+ *
+ * Must be called from kernel context.
+ *
+ * @param task  Task to wake
+ */
+void task_wake(task_ctrl *task) __attribute__((section(".kernel")));
+
+/**
+ * Block current task in wait queue
+ *
+ * Add the current task to wq, in priority order, then block it as
+ * svc_task_block() does.  data is kept in the task's wait_data while it
+ * waits, for use by whoever wakes it.
+ *
+ * If the timeout expires, the task is removed from wq and woken with
+ * wake_timeout set.
+ *
+ * @param wq        Wait queue to wait in
+ * @param data      Waiter data, passed to the waker through wait_data
+ * @param timeout   Ticks until the task is woken anyway, 0 for no timeout
+ */
+void svc_wait_queue_block(struct wait_queue *wq, void *data, uint32_t timeout)
+    __attribute__((section(".kernel")));
+
+/**
+ * First task in wait queue
+ *
+ * @param wq    Wait queue
+ * @returns highest priority waiting task, or NULL if none are waiting
+ */
+task_ctrl *wait_queue_head(struct wait_queue *wq) __attribute__((section(".kernel")));
+
+/**
+ * Set task effective priority
+ *
+ * Change the priority the task is scheduled at, moving it within the ready
+ * queue if it is runnable.  Used for priority inheritance; base_priority is
+ * left unchanged.
+ *
+ * Must be called from kernel context.
+ *
+ * @param task      Task to change
+ * @param priority  New effective priority
+ */
+void task_set_priority(task_ctrl *task, uint8_t priority) __attribute__((section(".kernel")));
+
 /**
  * Scheduler service call handler
  *
@@ -81,14 +154,6 @@ int sched_service_call(uint32_t svc_number, ...);
  */
 void switch_task(task_ctrl *task);
 
-/**
- * Perform system tick of the RTOS
- *
- * This updates all periodic tasks timers, and should be called during each
- * system tick.
- */
-void rtos_tick(void);
-
 /*
  * Arch-provided functions
  */
@@ -161,6 +226,45 @@ void arch_sched_start_bootstrap(void);
  */
 void sched_system_tick(void);
 
+/**
+ * Perform deferred kernel work
+ *
+ * Run work queued by interrupt handlers with defer(), then perform a task
+ * switch, as the work may have woken a higher priority task.
+ *
+ * This function should be called in privileged mode, in response to
+ * arch_sched_request_deferred().
+ */
+void sched_deferred_work(void);
+
+/**
+ * Request deferred kernel work
+ *
+ * Called from interrupt context by defer().  The arch should arrange for
+ * sched_deferred_work() to be called as soon as no kernel code is executing,
+ * ideally upon return from the interrupt.  sched_system_tick() also runs
+ * deferred work, so one call may serve both, if they coincide.
+ */
+void arch_sched_request_deferred(void);
+
+/**
+ * Hold off kernel entry from interrupts
+ *
+ * Prevent sched_system_tick() and sched_deferred_work() from running until
+ * arch_sched_unmask() is called, so that kernel structures may be modified
+ * outside of an SVC.  May be nested, and may be called from any context.
+ *
+ * @returns previous mask state, to pass to arch_sched_unmask()
+ */
+uint32_t arch_sched_mask(void);
+
+/**
+ * Allow kernel entry from interrupts
+ *
+ * @param state Mask state returned by the matching arch_sched_mask()
+ */
+void arch_sched_unmask(uint32_t state);
+
 /**
  * Enable arch system tick timer
  *
@@ -170,4 +274,41 @@ void sched_system_tick(void);
  */
 void arch_sched_start_system_tick(void);
 
+/**
+ * Maximum tickless sleep length
+ *
+ * Only required when CONFIG_SCHED_TICKLESS is enabled.
+ *
+ * @returns Maximum number of ticks arch_sched_tickless_start() can sleep for
+ */
+uint32_t arch_sched_tickless_max(void);
+
+/**
+ * Begin tickless sleep
+ *
+ * Stop periodic system ticks, and instead call sched_system_tick() once,
+ * on the boundary of the ticks'th tick from now.
+ *
+ * Called from privileged mode.  Only required when CONFIG_SCHED_TICKLESS
+ * is enabled.
+ *
+ * @param ticks Ticks to sleep for, at least 2
+ * @returns 0 on success, non-zero if a system tick was already pending, in
+ *          which case periodic ticks continue uninterrupted
+ */
+int arch_sched_tickless_start(uint32_t ticks);
+
+/**
+ * End tickless sleep
+ *
+ * Resume periodic system ticks, keeping the phase of the tick in progress.
+ * Called either from sched_system_tick() when the sleep expires, or early
+ * when another interrupt woke the system.
+ *
+ * Only required when CONFIG_SCHED_TICKLESS is enabled.
+ *
+ * @returns Number of whole ticks that elapsed since arch_sched_tickless_start()
+ */
+uint32_t arch_sched_tickless_stop(void);
+
 #endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KERNEL_SEM_H_INCLUDED
+#define KERNEL_SEM_H_INCLUDED
+
+/*
+ * Counting semaphores
+ *
+ * sem_wait() takes one from the count, blocking until it is non-zero.
+ * sem_post() adds one to the count, or hands it directly to the highest
+ * priority waiting task.
+ *
+ * sem_post() may be called from interrupt handlers, making semaphores
+ * suitable for waking a task when a device has data for it.
+ *
+ * Semaphores are either named, created with sem_create() and found with
+ * sem_get(), or anonymous, embedded in another structure and initialized
+ * with sem_init().
+ */
+
+#include <stdint.h>
+#include <atomic.h>
+#include <kernel/class.h>
+#include <kernel/deferred.h>
+#include <kernel/obj.h>
+#include <kernel/wait.h>
+
+struct semaphore {
+    uint32_t            count;
+    struct wait_queue   waiters;
+    atomic_t            isr_posts;  /* Posts from interrupts, not yet made */
+    struct deferred     isr_work;
+    struct obj          obj;
+};
+
+#define to_semaphore(__obj) container_of((__obj), struct semaphore, obj)
+
+extern struct class semaphore_class;
+
+/*
+ * Initialize anonymous semaphore
+ *
+ * @param sem   Semaphore to initialize
+ * @param count Initial count
+ */
+void sem_init(struct semaphore *sem, uint32_t count);
+
+/*
+ * Create named semaphore
+ *
+ * Allocate a semaphore, and make it available by name with sem_get().
+ * It is destroyed when the last reference is put with sem_put().
+ *
+ * @param name  Semaphore name (will be copied)
+ * @param count Initial count
+ * @returns new semaphore, or NULL on error
+ */
+struct semaphore *sem_create(const char *name, uint32_t count);
+
+/*
+ * Get named semaphore
+ *
+ * @param name  Semaphore name
+ * @returns reference to semaphore, or NULL if it doesn't exist
+ */
+struct semaphore *sem_get(const char *name);
+
+/*
+ * Put semaphore reference
+ *
+ * @param sem   Semaphore from sem_create() or sem_get()
+ */
+void sem_put(struct semaphore *sem);
+
+/*
+ * Wait on semaphore
+ *
+ * Take one from the semaphore count, blocking until the count is non-zero
+ * or the timeout expires.
+ *
+ * Must not be called from interrupt context.
+ *
+ * @param sem           Semaphore to wait on
+ * @param timeout_us    Maximum time to block, 0 to never block, or
+ *                      WAIT_FOREVER
+ * @returns zero on success, negative on timeout
+ */
+int sem_wait(struct semaphore *sem, uint32_t timeout_us);
+
+/*
+ * Post semaphore
+ *
+ * Add one to the semaphore count, waking a waiting task, if any.  May be
+ * called from interrupt context.
+ *
+ * @param sem   Semaphore to post
+ */
+void sem_post(struct semaphore *sem);
+
+/**
+ * Semaphore service call handler
+ * Should only be called by global SVC handler.  This takes va_args for the
+ * semaphore service calls and returns the result of the service call.
+ *
+ * @param svc_number    Service call number.  Must be a semaphore service call
+ * @param va_args       Arguments for service call
+ * @returns Return value of service call
+ */
+int sem_service_call(uint32_t svc_number, ...);
+
+#endif
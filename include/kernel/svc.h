@@ -76,6 +76,17 @@ enum service_calls {
     SVC_RELEASE,
     SVC_REGISTER_TASK,
     SVC_TASK_SWITCH,
+    SVC_TASK_SLEEP,
+    SVC_TICKLESS_ENTER,
+    SVC_TICKLESS_EXIT,
+    SVC_TIMER_START,
+    SVC_TIMER_STOP,
+    SVC_SEM_WAIT,
+    SVC_SEM_POST,
+    SVC_EVENT_WAIT,
+    SVC_EVENT_SET,
+    SVC_MSGQ_SEND,
+    SVC_MSGQ_RECEIVE,
 };
 
 #endif
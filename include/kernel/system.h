@@ -64,6 +64,7 @@ typedef struct system {
     }
 
 extern struct system dev_system;
+extern struct system ipc_system;
 extern struct class system_class;
 extern struct collection systems;
 
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KERNEL_TIMER_H_INCLUDED
+#define KERNEL_TIMER_H_INCLUDED
+
+/*
+ * Kernel software timers
+ *
+ * A timer calls a function after a delay, and optionally every period
+ * after that.  Active timers are kept in a single delta queue, ordered by
+ * expiry, with each timer storing the number of ticks between it and the
+ * timer before it.  Each system tick only decrements the head of the queue
+ * and fires the timers that are due.
+ *
+ * Timer functions are called from kernel context, during the system tick.
+ * They must be short, and must not block.  They may start or stop timers,
+ * including their own.
+ *
+ * Timers have the precision of the system tick (1/CONFIG_SYSTICK_FREQ).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list.h>
+
+struct timer {
+    struct list list;
+    uint32_t    delta;      /* Ticks after previous timer in queue */
+    uint32_t    period;     /* Ticks between expiries, 0 for one-shot */
+    uint8_t     active;
+    void        (*func)(void *data);
+    void        *data;
+};
+
+/*
+ * Statically initialize timer
+ *
+ * struct timer timer = INIT_TIMER(timer, func, data);
+ */
+#define INIT_TIMER(name, _func, _data) {    \
+    .list = INIT_LIST((name).list),         \
+    .delta = 0,                             \
+    .period = 0,                            \
+    .active = 0,                            \
+    .func = (_func),                        \
+    .data = (_data),                        \
+}
+
+/*
+ * Dynamically initialize timer
+ *
+ * @param timer Timer to initialize
+ * @param func  Function to call when timer expires
+ * @param data  Argument to pass to func
+ */
+static inline void timer_init(struct timer *timer, void (*func)(void *),
+                              void *data) {
+    list_init(&timer->list);
+    timer->delta = 0;
+    timer->period = 0;
+    timer->active = 0;
+    timer->func = func;
+    timer->data = data;
+}
+
+/*
+ * Determine if timer is active
+ *
+ * @param timer Timer to check
+ * @returns non-zero if timer is waiting to expire
+ */
+static inline int timer_active(struct timer *timer) {
+    return timer->active;
+}
+
+/*
+ * Start timer
+ *
+ * The timer will expire after delay_us, then every period_us after that,
+ * until stopped.  Both are rounded up to the nearest tick.  If the timer
+ * is already active, it is restarted.
+ *
+ * @param timer     Timer to start
+ * @param delay_us  Microseconds until first expiry
+ * @param period_us Microseconds between following expiries, 0 for one-shot
+ */
+void timer_start(struct timer *timer, uint32_t delay_us, uint32_t period_us);
+
+/*
+ * Stop timer
+ *
+ * Does nothing if the timer is not active.
+ *
+ * @param timer Timer to stop
+ */
+void timer_stop(struct timer *timer);
+
+/*
+ * Kernel internal timer functions
+ */
+
+/*
+ * Start timer from kernel context
+ *
+ * The timer must not be active.  timer->period must already be set.
+ *
+ * @param timer Timer to start
+ * @param delay Ticks until expiry, minimum 1
+ */
+void svc_timer_start(struct timer *timer, uint32_t delay) __attribute__((section(".kernel")));
+
+/*
+ * Stop timer from kernel context
+ *
+ * @param timer Timer to stop
+ */
+void svc_timer_stop(struct timer *timer) __attribute__((section(".kernel")));
+
+/*
+ * Advance timers by one system tick, calling all timers that expire.
+ */
+void timer_tick(void) __attribute__((section(".kernel")));
+
+/*
+ * Advance timers by ticks that passed without calling timer_tick()
+ *
+ * @param ticks Ticks to skip, fewer than timer_ticks_until_next()
+ */
+void timer_skip_ticks(uint32_t ticks) __attribute__((section(".kernel")));
+
+/*
+ * Ticks until the next timer expiry
+ *
+ * @returns Number of ticks until the next timer_tick() that will call a
+ *          timer, or UINT32_MAX if no timers are active.
+ */
+uint32_t timer_ticks_until_next(void) __attribute__((section(".kernel")));
+
+/**
+ * Timer service call handler
+ *
+ * Should only be called by global SVC handler.  Takes va_args for the given
+ * service call number, and returns the result of the service call.
+ *
+ * @param svc_number    Service call number.  Must be a timer service call
+ * @param va_args       Arguments for service call
+ * @returns Return value of service call
+ */
+int timer_service_call(uint32_t svc_number, ...);
+
+#endif
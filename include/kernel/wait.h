@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KERNEL_WAIT_H_INCLUDED
+#define KERNEL_WAIT_H_INCLUDED
+
+/*
+ * Wait queues
+ *
+ * A wait queue holds the tasks blocked on some kernel object, such as a
+ * semaphore, highest priority first.  The owner of the wait queue blocks
+ * tasks in it with svc_wait_queue_block(), and wakes them with task_wake()
+ * once they may continue (see kernel/sched_internals.h).
+ *
+ * Blocking operations built on wait queues take a timeout in microseconds.
+ * A timeout of 0 never blocks, while WAIT_FOREVER blocks without a timeout.
+ */
+
+#include <stdint.h>
+#include <list.h>
+
+/* Block without a timeout */
+#define WAIT_FOREVER    UINT32_MAX
+
+/*
+ * Returned by service calls that blocked the calling task, which must
+ * then check task_wait_timed_out() to determine the actual result.
+ */
+#define WAIT_BLOCKED    1
+
+struct wait_queue {
+    struct list tasks;
+};
+
+#define INIT_WAIT_QUEUE(symbol) {   \
+    .tasks = INIT_LIST((symbol).tasks), \
+}
+
+static inline void wait_queue_init(struct wait_queue *wq) {
+    list_init(&wq->tasks);
+}
+
+static inline int wait_queue_empty(struct wait_queue *wq) {
+    return list_empty(&wq->tasks);
+}
+
+/*
+ * Convert wait timeout to ticks
+ *
+ * Rounds up to whole system ticks.  WAIT_FOREVER becomes 0, for no timeout.
+ *
+ * @param timeout_us    Timeout in microseconds, non-zero
+ * @returns timeout in system ticks
+ */
+uint32_t wait_timeout_ticks(uint32_t timeout_us);
+
+/*
+ * Determine if the last wait timed out
+ *
+ * Once a service call returns WAIT_BLOCKED, this indicates whether the
+ * task was woken because its timeout expired, rather than by the wait
+ * completing.
+ *
+ * @returns 1 if the current task's last wait timed out, 0 otherwise
+ */
+int task_wait_timed_out(void);
+
+#endif
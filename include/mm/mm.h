@@ -35,6 +35,7 @@ uint32_t mm_kspace(void) __attribute__((section(".kernel")));
 
 #ifdef CONFIG_MM_PROFILING
 extern uint64_t begin_malloc_timestamp, end_malloc_timestamp;
+extern uint64_t begin_free_timestamp, end_free_timestamp;
 #endif
 
 #endif
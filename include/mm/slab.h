@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MM_SLAB_H_INCLUDED
+#define MM_SLAB_H_INCLUDED
+
+/*
+ * Slab allocator
+ *
+ * A slab cache hands out fixed size objects, carved from slabs allocated
+ * from the kernel or user heap.  Free objects are kept on a free list, so
+ * allocation and free are O(1), and objects pack tightly rather than each
+ * rounding up to a heap block with its own header.
+ *
+ * Caches grow a slab at a time as needed.  Slabs are never returned to the
+ * heap, so caches suit objects which are frequently allocated and freed,
+ * or long lived, such as tasks and devices.
+ *
+ * Once a cache allocates its first slab, it is added to the list of caches
+ * reported by slab_cache_next(), e.g., for the top shell app.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list.h>
+#include <kernel/mutex.h>
+
+/* Allocate slabs from the kernel heap, rather than the user heap */
+#define SLAB_KERNEL     (1 << 0)
+
+struct slab;
+
+struct slab_stats {
+    uint32_t    slabs;      /* Slabs allocated from the heap */
+    uint32_t    objects;    /* Objects in all slabs */
+    uint32_t    in_use;     /* Objects currently allocated */
+    uint32_t    peak;       /* Maximum objects ever allocated at once */
+    uint32_t    failures;   /* Allocations failed for lack of memory */
+};
+
+struct slab_cache {
+    const char          *name;
+    size_t              obj_size;
+    uint32_t            flags;
+    void                (*ctor)(void *);
+    void                *free_list;
+    struct slab         *slabs;
+    struct mutex        lock;
+    struct list         list;       /* In list of all caches */
+    struct slab_stats   stats;
+};
+
+/*
+ * Statically initialize slab cache
+ *
+ * @param symbol        Symbol of the cache being initialized
+ * @param cache_name    Name of the cache
+ * @param size          Size of objects in the cache
+ * @param cache_flags   SLAB_* flags
+ * @param constructor   Function to initialize each allocated object, or NULL
+ */
+#define INIT_SLAB_CACHE(symbol, cache_name, size, cache_flags, constructor) { \
+    .name = (cache_name),           \
+    .obj_size = (size),             \
+    .flags = (cache_flags),         \
+    .ctor = (constructor),          \
+    .free_list = NULL,              \
+    .slabs = NULL,                  \
+    .lock = INIT_MUTEX,             \
+    .list = INIT_LIST((symbol).list), \
+    .stats = { 0 },                 \
+}
+
+/*
+ * Initialize slab cache
+ *
+ * @param cache Cache to initialize
+ * @param name  Name of the cache
+ * @param size  Size of objects in the cache
+ * @param flags SLAB_* flags
+ * @param ctor  Function to initialize each allocated object, or NULL
+ */
+void slab_cache_init(struct slab_cache *cache, const char *name, size_t size,
+                     uint32_t flags, void (*ctor)(void *));
+
+/*
+ * Allocate object from slab cache
+ *
+ * Grows the cache by a slab if no objects are free.  If the cache has a
+ * constructor, it is called on the object before it is returned.
+ *
+ * @param cache Cache to allocate from
+ * @returns new object, or NULL if out of memory
+ */
+void *slab_alloc(struct slab_cache *cache);
+
+/*
+ * Free object to slab cache
+ *
+ * @param cache Cache the object was allocated from
+ * @param obj   Object to free.  May be NULL.
+ */
+void slab_free(struct slab_cache *cache, void *obj);
+
+/*
+ * Iterate over slab caches
+ *
+ * Caches are never removed, so this is safe to call at any time.
+ *
+ * @param prev  Cache returned by the last call, or NULL to get the first
+ * @returns the next cache, or NULL after the last
+ */
+struct slab_cache *slab_cache_next(struct slab_cache *prev);
+
+/*
+ * Get slab cache statistics
+ *
+ * @param cache Cache to get statistics for
+ * @param stats Filled with a consistent snapshot of the statistics
+ */
+void slab_cache_stats(struct slab_cache *cache, struct slab_stats *stats);
+
+#endif
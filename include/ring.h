@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RING_H_INCLUDED
+#define RING_H_INCLUDED
+
+/*
+ * Single-producer, single-consumer ring buffer
+ *
+ * A lock-free byte FIFO, safe for exactly one producer and one consumer to
+ * use concurrently, such as an interrupt handler filling the ring and a
+ * task draining it.  Multiple producers or consumers must serialize among
+ * themselves, e.g., with a mutex.
+ *
+ * head and tail are free-running counts of bytes written and read.  Only
+ * the producer writes head, and only the consumer writes tail, so neither
+ * needs a lock.  The ring size must be a power of two, so that indices are
+ * found by masking and the full size of the buffer is usable.
+ *
+ * Besides copying in and out with ring_push_n() and ring_pop_n(), data may
+ * be written or read in place.  ring_write_span() and ring_read_span()
+ * return the largest contiguous region available, which is then handed
+ * over with ring_write_commit() or ring_read_commit().
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic.h>
+
+struct ring {
+    uint8_t             *buf;
+    uint32_t            size;   /* Power of two */
+    volatile uint32_t   head;   /* Bytes written, only modified by producer */
+    volatile uint32_t   tail;   /* Bytes read, only modified by consumer */
+};
+
+#define INIT_RING(buffer, buf_size) {   \
+    .buf = (buffer),                    \
+    .size = (buf_size),                 \
+    .head = 0,                          \
+    .tail = 0,                          \
+}
+
+/*
+ * Initialize ring
+ *
+ * @param ring  Ring to initialize
+ * @param buf   Backing buffer, size bytes
+ * @param size  Size of buf, must be a power of two
+ * @returns zero on success, negative if size is not a power of two
+ */
+static inline int ring_init(struct ring *ring, uint8_t *buf, uint32_t size) {
+    if (!size || (size & (size - 1))) {
+        return -1;
+    }
+
+    ring->buf = buf;
+    ring->size = size;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return 0;
+}
+
+/* Bytes available to read */
+static inline uint32_t ring_count(struct ring *ring) {
+    return ring->head - ring->tail;
+}
+
+/* Bytes available to write */
+static inline uint32_t ring_space(struct ring *ring) {
+    return ring->size - ring_count(ring);
+}
+
+static inline int ring_empty(struct ring *ring) {
+    return ring->head == ring->tail;
+}
+
+static inline int ring_full(struct ring *ring) {
+    return ring_count(ring) == ring->size;
+}
+
+/*
+ * Get contiguous space to write in place (producer)
+ *
+ * @param ring  Ring to write to
+ * @param span  Set to the start of the space
+ * @returns bytes which may be written at span
+ */
+static inline uint32_t ring_write_span(struct ring *ring, uint8_t **span) {
+    uint32_t head = ring->head;
+    uint32_t offset = head & (ring->size - 1);
+    uint32_t space = ring->size - (head - ring->tail);
+    uint32_t contiguous = ring->size - offset;
+
+    *span = &ring->buf[offset];
+
+    return space < contiguous ? space : contiguous;
+}
+
+/*
+ * Make bytes written in place available to the consumer (producer)
+ *
+ * @param ring  Ring written to
+ * @param n     Bytes written, no more than ring_write_span() returned
+ */
+static inline void ring_write_commit(struct ring *ring, uint32_t n) {
+    /* Data must be visible before the consumer can see it */
+    data_memory_barrier();
+    ring->head += n;
+}
+
+/*
+ * Get contiguous data to read in place (consumer)
+ *
+ * @param ring  Ring to read from
+ * @param span  Set to the start of the data
+ * @returns bytes which may be read at span
+ */
+static inline uint32_t ring_read_span(struct ring *ring, uint8_t **span) {
+    uint32_t tail = ring->tail;
+    uint32_t offset = tail & (ring->size - 1);
+    uint32_t count = ring->head - tail;
+    uint32_t contiguous = ring->size - offset;
+
+    /* Don't read data before seeing that it was written */
+    data_memory_barrier();
+
+    *span = &ring->buf[offset];
+
+    return count < contiguous ? count : contiguous;
+}
+
+/*
+ * Release bytes read in place back to the producer (consumer)
+ *
+ * @param ring  Ring read from
+ * @param n     Bytes read, no more than ring_read_span() returned
+ */
+static inline void ring_read_commit(struct ring *ring, uint32_t n) {
+    /* Finish reading before the producer may overwrite */
+    data_memory_barrier();
+    ring->tail += n;
+}
+
+/*
+ * Discard all data in ring (consumer)
+ *
+ * @param ring  Ring to empty
+ */
+static inline void ring_flush(struct ring *ring) {
+    ring_read_commit(ring, ring->head - ring->tail);
+}
+
+/*
+ * Copy data into ring (producer)
+ *
+ * @param ring  Ring to write to
+ * @param data  Data to copy
+ * @param n     Bytes to copy
+ * @returns bytes copied, which is less than n if the ring filled
+ */
+static inline uint32_t ring_push_n(struct ring *ring, const void *data,
+                                   uint32_t n) {
+    const uint8_t *src = data;
+    uint32_t total = 0;
+
+    /* At most two spans, before and after the end of the buffer */
+    for (int i = 0; i < 2 && total < n; i++) {
+        uint8_t *span;
+        uint32_t len = ring_write_span(ring, &span);
+
+        if (len > n - total) {
+            len = n - total;
+        }
+
+        memcpy(span, &src[total], len);
+        ring_write_commit(ring, len);
+        total += len;
+    }
+
+    return total;
+}
+
+/*
+ * Copy data out of ring (consumer)
+ *
+ * @param ring  Ring to read from
+ * @param data  Buffer to copy to
+ * @param n     Bytes to copy
+ * @returns bytes copied, which is less than n if the ring emptied
+ */
+static inline uint32_t ring_pop_n(struct ring *ring, void *data, uint32_t n) {
+    uint8_t *dst = data;
+    uint32_t total = 0;
+
+    for (int i = 0; i < 2 && total < n; i++) {
+        uint8_t *span;
+        uint32_t len = ring_read_span(ring, &span);
+
+        if (len > n - total) {
+            len = n - total;
+        }
+
+        memcpy(&dst[total], span, len);
+        ring_read_commit(ring, len);
+        total += len;
+    }
+
+    return total;
+}
+
+/*
+ * Write one byte to ring (producer)
+ *
+ * @returns zero on success, negative if the ring is full
+ */
+static inline int ring_push(struct ring *ring, uint8_t c) {
+    uint32_t head = ring->head;
+
+    if (head - ring->tail == ring->size) {
+        return -1;
+    }
+
+    ring->buf[head & (ring->size - 1)] = c;
+    ring_write_commit(ring, 1);
+
+    return 0;
+}
+
+/*
+ * Read one byte from ring (consumer)
+ *
+ * @returns zero on success, negative if the ring is empty
+ */
+static inline int ring_pop(struct ring *ring, uint8_t *c) {
+    uint32_t tail = ring->tail;
+
+    if (ring->head == tail) {
+        return -1;
+    }
+
+    data_memory_barrier();
+    *c = ring->buf[tail & (ring->size - 1)];
+    ring_read_commit(ring, 1);
+
+    return 0;
+}
+
+#endif
@@ -46,6 +46,26 @@ int write_block(struct char_device *dev, const char *buf, int num);
 /* Print fmt into buf, writing at most n bytes.
  * Returns number of characters written to buffer. */
 int scnprintf(char *buf, uint32_t n, const char *fmt, ...);
+int vscnprintf(char *buf, uint32_t n, const char *fmt, va_list ap);
+
+/* Print fmt into buf, writing at most n bytes.
+ * Returns number of characters fmt expands to, even if truncated. */
+int snprintf(char *buf, uint32_t n, const char *fmt, ...);
+int vsnprintf(char *buf, uint32_t n, const char *fmt, va_list ap);
+
+/*
+ * Print fmt by passing runs of output to sink, which returns bytes consumed
+ * or negative on error.  Output is staged on the stack, so nothing is
+ * allocated.  Returns bytes output, negative on error.
+ */
+int vcbprintf(int (*sink)(void *arg, const char *buf, int num), void *arg,
+              const char *fmt, va_list ap);
+
+/*
+ * Write out output buffered by dev, if it is a buffered stream.
+ * Returns zero on success, negative on error.
+ */
+int fflush(struct char_device *dev);
 
 int fputs(struct char_device *dev, const char *s);
 int fputc(struct char_device *dev, const char letter);
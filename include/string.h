@@ -38,6 +38,7 @@ size_t strnlen(const char *s, int n);
 void strreverse(char *s);
 int strcmp(const char *s, const char *p);
 int strncmp(const char *s, const char *p, uint32_t n);
+uint32_t strhash(const char *s);
 char *strncpy(char *destination, const char *source, int num);
 int chrnlst(char c, const char *l);
 
@@ -22,16 +22,26 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <list.h>
 #include <kernel/class.h>
-#include <mm/mm.h>
+#include <kernel/fault.h>
+#include <mm/slab.h>
 
 struct obj *__instantiate(const char *name, struct class *class, void *ops,
                           size_t size) {
     struct obj *o;
     void *container;
 
-    container = kmalloc(size);
+    if (!class->cache.obj_size) {
+        class->cache.obj_size = size;
+    }
+    else if (size > class->cache.obj_size) {
+        WARN_ON(1);
+        return NULL;
+    }
+
+    container = slab_alloc(&class->cache);
 
     if(!container)
         return NULL;
@@ -47,6 +57,8 @@ struct obj *__instantiate(const char *name, struct class *class, void *ops,
         goto err;
     }
 
+    o->name_hash = strhash(o->name);
+
     list_init(&o->list);
 
     /* add to class collection of instances */
@@ -55,7 +67,7 @@ struct obj *__instantiate(const char *name, struct class *class, void *ops,
     return o;
 
 err:
-    kfree(container);
+    slab_free(&class->cache, container);
     return NULL;
 }
 
@@ -64,7 +76,7 @@ void class_deinstantiate(struct obj *obj) {
         free((char *)obj->name);
     }
 
-    kfree(get_container(obj));
+    slab_free(&to_class(obj->parent)->cache, get_container(obj));
 }
 
 int class_export_member(struct obj *o) {
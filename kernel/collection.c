@@ -20,8 +20,10 @@
  * SOFTWARE.
  */
 
+#include <stdint.h>
 #include <string.h>
 #include <kernel/collection.h>
+#include <kernel/hash_index.h>
 #include <kernel/fault.h>
 #include <kernel/reentrant_mutex.h>
 
@@ -112,6 +114,8 @@ int collection_add(struct collection *c, struct obj *o) {
 
     collection_lock(c);
     list_add(&o->list, &c->list);
+    /* On failure, lookups fall back to walking the list */
+    hash_index_add(&c->index, o, &c->list);
     collection_unlock(c);
 
     return 0;
@@ -125,6 +129,7 @@ int collection_del(struct collection *c, struct obj *o) {
     /* TODO: verify obj is actually in *this* collection's list */
 
     collection_lock(c);
+    hash_index_del(&c->index, o);
     list_remove(&o->list);
     collection_unlock(c);
 
@@ -134,14 +139,23 @@ int collection_del(struct collection *c, struct obj *o) {
 struct obj *collection_get_by_name(struct collection *c, const char *name) {
     struct obj *ret = NULL;
     struct obj *curr;
+    uint32_t hash;
 
     if (!name || !c) {
         return NULL;
     }
 
+    hash = strhash(name);
+
     collection_lock(c);
+
+    if (!hash_index_find(&c->index, name, hash, (void **) &ret)) {
+        goto out;
+    }
+
     list_for_each_entry(curr, &c->list, list) {
-        if(!strcmp(curr->name, name)) {
+        if (hash_index_entry_hash(&c->index, curr) == hash &&
+                !strcmp(curr->name, name)) {
             ret = curr;
             goto out;
         }
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic.h>
+#include <kernel/deferred.h>
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+
+/*
+ * Stack of queued work, pushed by interrupts with load-link/store-conditional,
+ * and emptied all at once by the kernel.
+ */
+static volatile uint32_t deferred_head = 0;
+
+void defer(struct deferred *work) {
+    uint32_t head;
+
+    /* Claim the work item, unless it is already queued */
+    do {
+        if (load_link32(&work->queued)) {
+            return;
+        }
+    } while (store_conditional32(&work->queued, 1));
+
+    do {
+        head = load_link32(&deferred_head);
+        work->next = (struct deferred *) head;
+    } while (store_conditional32(&deferred_head, (uint32_t) work));
+
+    arch_sched_request_deferred();
+}
+
+void run_deferred(void) {
+    struct deferred *work;
+    uint32_t head;
+
+    do {
+        head = load_link32(&deferred_head);
+    } while (store_conditional32(&deferred_head, 0));
+
+    work = (struct deferred *) head;
+
+    while (work) {
+        struct deferred *next = work->next;
+
+        /*
+         * Allow the item to be queued again before running it, so that
+         * nothing recorded after the work function looks is missed.
+         */
+        work->queued = 0;
+        work->func(work);
+
+        work = next;
+    }
+}
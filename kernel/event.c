@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic.h>
+#include <list.h>
+#include <kernel/class.h>
+#include <kernel/deferred.h>
+#include <kernel/event.h>
+#include <kernel/fault.h>
+#include <kernel/init.h>
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include <kernel/system.h>
+#include <kernel/wait.h>
+
+/* Wait request, on the waiting task's stack */
+struct event_waiter {
+    uint32_t flags;
+    uint32_t mode;
+    uint32_t timeout_us;
+    uint32_t result;    /* Flags that satisfied the wait */
+};
+
+static int svc_event_wait(struct event *ev, struct event_waiter *w) __attribute__((section(".kernel")));
+static task_ctrl *svc_event_set(struct event *ev, uint32_t flags) __attribute__((section(".kernel")));
+static void event_isr_work(struct deferred *work) __attribute__((section(".kernel")));
+
+static void event_dtor(struct obj *o);
+
+static struct obj_type event_type_s = {
+    .offset = offset_of(struct event, obj),
+    .dtor = event_dtor,
+};
+
+struct class event_class = INIT_CLASS(event_class, "event", &event_type_s);
+
+/* Only named events are destroyed, anonymous ones belong to their container */
+static void event_dtor(struct obj *o) {
+    struct event *ev;
+
+    assert_type(o, &event_type_s);
+    ev = to_event(o);
+
+    WARN_ON(!wait_queue_empty(&ev->waiters));
+
+    if (o->parent) {
+        class_unexport_member(o);
+        class_deinstantiate(o);
+    }
+}
+
+static void event_setup(struct event *ev) {
+    ev->flags = 0;
+    wait_queue_init(&ev->waiters);
+    ev->isr_set = 0;
+    deferred_init(&ev->isr_work, event_isr_work);
+}
+
+void event_init(struct event *ev) {
+    obj_init(&ev->obj, &event_type_s, "event");
+    ev->obj.parent = NULL;
+    ev->obj.ops = NULL;
+
+    event_setup(ev);
+}
+
+struct event *event_create(const char *name) {
+    struct obj *o;
+    struct event *ev;
+
+    o = instantiate(name, &event_class, NULL, struct event);
+    if (!o) {
+        return NULL;
+    }
+
+    ev = to_event(o);
+    event_setup(ev);
+
+    class_export_member(o);
+
+    return ev;
+}
+
+struct event *event_get(const char *name) {
+    struct obj *o = get_by_name_from_class(name, &event_class);
+
+    if (!o) {
+        return NULL;
+    }
+
+    obj_get(o);
+
+    return to_event(o);
+}
+
+void event_put(struct event *ev) {
+    obj_put(&ev->obj);
+}
+
+uint32_t event_wait(struct event *ev, uint32_t flags, uint32_t mode,
+                    uint32_t timeout_us) {
+    struct event_waiter w = {
+        .flags = flags,
+        .mode = mode,
+        .timeout_us = timeout_us,
+        .result = 0,
+    };
+    int ret;
+
+    /* Without task switching, there is nothing to wait for */
+    if (!task_switching) {
+        w.timeout_us = 0;
+        svc_event_wait(ev, &w);
+        return w.result;
+    }
+
+    if (!arch_svc_legal()) {
+        return 0;
+    }
+
+    ret = SVC_ARG2(SVC_EVENT_WAIT, ev, &w);
+
+    /* The waker fills in the result, unless we timed out */
+    if (ret == WAIT_BLOCKED && task_wait_timed_out()) {
+        return 0;
+    }
+
+    return w.result;
+}
+
+void event_set(struct event *ev, uint32_t flags) {
+    if (!task_switching) {
+        svc_event_set(ev, flags);
+    }
+    else if (arch_svc_legal()) {
+        SVC_ARG2(SVC_EVENT_SET, ev, flags);
+    }
+    /* Interrupt context, leave the wakeups to the kernel */
+    else {
+        atomic_or(&ev->isr_set, flags);
+        defer(&ev->isr_work);
+    }
+}
+
+void event_clear(struct event *ev, uint32_t flags) {
+    atomic_and(&ev->flags, ~flags);
+}
+
+/* Determine which flags satisfy the wait, if any */
+static uint32_t event_match(uint32_t set, struct event_waiter *w) {
+    uint32_t match = set & w->flags;
+
+    if (w->mode & EVENT_WAIT_ALL) {
+        return match == w->flags ? match : 0;
+    }
+
+    return match;
+}
+
+static int svc_event_wait(struct event *ev, struct event_waiter *w) {
+    uint32_t match = event_match(ev->flags, w);
+
+    if (match) {
+        if (w->mode & EVENT_CLEAR) {
+            atomic_and(&ev->flags, ~match);
+        }
+
+        w->result = match;
+        return 0;
+    }
+
+    if (!w->timeout_us) {
+        return -1;
+    }
+
+    svc_wait_queue_block(&ev->waiters, w, wait_timeout_ticks(w->timeout_us));
+
+    return WAIT_BLOCKED;
+}
+
+/* Returns the highest priority task woken, if any */
+static task_ctrl *svc_event_set(struct event *ev, uint32_t flags) {
+    task_ctrl *woken = NULL;
+    uint32_t consumed = 0;
+    uint32_t set = atomic_or(&ev->flags, flags);
+    struct list *pos = ev->waiters.tasks.next;
+
+    /*
+     * Every waiter sees the flags as they were set, even if an earlier
+     * waiter will consume them.
+     */
+    while (pos != &ev->waiters.tasks) {
+        task_ctrl *waiter = list_entry(pos, task_ctrl, wait_list);
+        struct event_waiter *w = waiter->wait_data;
+        uint32_t match = event_match(set, w);
+
+        /* Waking removes the waiter from the list */
+        pos = pos->next;
+
+        if (!match) {
+            continue;
+        }
+
+        if (w->mode & EVENT_CLEAR) {
+            consumed |= match;
+        }
+
+        w->result = match;
+        task_wake(waiter);
+
+        /* Waiters are in priority order */
+        if (!woken) {
+            woken = waiter;
+        }
+    }
+
+    if (consumed) {
+        atomic_and(&ev->flags, ~consumed);
+    }
+
+    return woken;
+}
+
+static void event_isr_work(struct deferred *work) {
+    struct event *ev = container_of(work, struct event, isr_work);
+    uint32_t flags;
+
+    /* Take every flag set so far, leaving none behind */
+    do {
+        flags = load_link32(&ev->isr_set);
+    } while (store_conditional32(&ev->isr_set, 0));
+
+    if (flags) {
+        svc_event_set(ev, flags);
+    }
+}
+
+int event_service_call(uint32_t svc_number, ...) {
+    int ret = 0;
+    va_list ap;
+    va_start(ap, svc_number);
+
+    switch (svc_number) {
+        case SVC_EVENT_WAIT: {
+            struct event *ev = va_arg(ap, struct event *);
+            struct event_waiter *w = va_arg(ap, struct event_waiter *);
+            ret = svc_event_wait(ev, w);
+            break;
+        }
+        case SVC_EVENT_SET: {
+            struct event *ev = va_arg(ap, struct event *);
+            uint32_t flags = va_arg(ap, uint32_t);
+            task_ctrl *woken = svc_event_set(ev, flags);
+
+            /* Run the woken task immediately if it outranks us */
+            if (woken && task_compare(get_task_t(woken), curr_task) > 0) {
+                task_switch(NULL);
+            }
+            break;
+        }
+        default:
+            panic_print("Unknown SVC: %d", svc_number);
+            break;
+    }
+
+    va_end(ap);
+
+    return ret;
+}
+
+static int event_class_setup(void) {
+    obj_init(&event_class.obj, system_class.type, "event");
+    register_with_system(&ipc_system, &event_class);
+    return 0;
+}
+CORE_INITIALIZER(event_class_setup)
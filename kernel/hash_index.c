@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <list.h>
+#include <kernel/hash_index.h>
+#include <mm/mm.h>
+
+/* Marks a slot whose entry was removed, so probing continues past it */
+#define HASH_INDEX_DELETED  ((void *) 1)
+
+#define entry_field(index, entry, field) \
+    ((void *) ((uintptr_t) (entry) + (index)->field))
+
+static inline const char *entry_name(struct hash_index *index, void *entry) {
+    return *(const char **) entry_field(index, entry, name_offset);
+}
+
+uint32_t hash_index_entry_hash(struct hash_index *index, void *entry) {
+    uint32_t *hash = entry_field(index, entry, hash_offset);
+
+    /* Zero is never a valid hash, but static entries start with it */
+    if (!*hash) {
+        *hash = strhash(entry_name(index, entry));
+    }
+
+    return *hash;
+}
+
+/*
+ * Append entry to the end of the probe sequence for its hash.  Deleted
+ * slots are not reused, so entries sharing a name stay in insertion
+ * order along the sequence.
+ */
+static void hash_index_insert(struct hash_index *index, void *entry) {
+    uint32_t mask = index->size - 1;
+    uint32_t i = hash_index_entry_hash(index, entry) & mask;
+
+    while (index->slots[i]) {
+        i = (i + 1) & mask;
+    }
+
+    index->slots[i] = entry;
+    index->used++;
+    index->count++;
+}
+
+/*
+ * Rebuild the table from every entry on the list
+ *
+ * The table is sized from the list, not index->count, which is zero if
+ * an earlier rebuild failed to allocate.
+ */
+static int hash_index_rebuild(struct hash_index *index, struct list *head) {
+    uint32_t size = HASH_INDEX_MIN_SIZE;
+    uint32_t count = 0;
+    struct list *node;
+    void **slots;
+
+    for (node = head->next; node != head; node = node->next) {
+        count++;
+    }
+
+    /* Keep the table at most half full */
+    while (size < 2*count) {
+        size *= 2;
+    }
+
+    slots = kmalloc(size * sizeof(*slots));
+
+    if (index->slots) {
+        kfree(index->slots);
+    }
+
+    index->slots = slots;
+    index->size = slots ? size : 0;
+    index->used = 0;
+    index->count = 0;
+
+    if (!slots) {
+        return -1;
+    }
+
+    memset(slots, 0, size * sizeof(*slots));
+
+    /* Oldest entries first, from the tail of the list */
+    for (node = head->prev; node != head; node = node->prev) {
+        hash_index_insert(index, (void *) ((uintptr_t) node -
+                                           index->list_offset));
+    }
+
+    return 0;
+}
+
+int hash_index_add(struct hash_index *index, void *entry, struct list *head) {
+    /* Rebuilding from the list picks up entry as well */
+    if (!index->size || 2*(index->used + 1) > index->size) {
+        return hash_index_rebuild(index, head);
+    }
+
+    hash_index_insert(index, entry);
+
+    return 0;
+}
+
+void hash_index_del(struct hash_index *index, void *entry) {
+    uint32_t mask = index->size - 1;
+    uint32_t i;
+
+    if (!index->size) {
+        return;
+    }
+
+    i = hash_index_entry_hash(index, entry) & mask;
+
+    while (index->slots[i]) {
+        if (index->slots[i] == entry) {
+            goto found;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    /* Renamed since it was added, so not on its probe sequence */
+    for (i = 0; i < index->size; i++) {
+        if (index->slots[i] == entry) {
+            goto found;
+        }
+    }
+
+    return;
+
+found:
+    index->slots[i] = HASH_INDEX_DELETED;
+    index->count--;
+}
+
+int hash_index_find(struct hash_index *index, const char *name, uint32_t hash,
+                    void **found) {
+    uint32_t mask = index->size - 1;
+    uint32_t i;
+
+    *found = NULL;
+
+    if (!index->size) {
+        return -1;
+    }
+
+    i = hash & mask;
+
+    /* The last match along the sequence is the most recently added */
+    while (index->slots[i]) {
+        void *entry = index->slots[i];
+
+        if (entry != HASH_INDEX_DELETED &&
+                *(uint32_t *) entry_field(index, entry, hash_offset) == hash &&
+                !strcmp(entry_name(index, entry), name)) {
+            *found = entry;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return 0;
+}
+
+void hash_index_destroy(struct hash_index *index) {
+    if (index->slots) {
+        kfree(index->slots);
+    }
+
+    index->slots = NULL;
+    index->size = 0;
+    index->used = 0;
+    index->count = 0;
+}
@@ -31,6 +31,7 @@
 #include <dev/arch.h>
 #include <dev/char.h>
 #include <dev/device.h>
+#include <dev/fdtparse.h>
 #include <dev/hw/perfcounter.h>
 #include <dev/hw/led.h>
 #include <dev/hw/usart.h>
@@ -50,7 +51,34 @@ const char banner[] = "Welcome to...\r\n"
 
 void os_start(void) __attribute__((section(".kernel")));
 
+/* Perfcounter count for timing boot phases, or 0 without a perfcounter */
+static inline uint64_t boot_timestamp(void) {
+#ifdef CONFIG_PERFCOUNTER
+    return perfcounter_getcount();
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Print how long device tree indexing and device probing took, so boots
+ * with and without CONFIG_FDTPARSE_INDEX can be compared.
+ */
+static void report_boot_times(uint64_t index_start, uint64_t probe_start,
+                              uint64_t probe_end) {
+#if defined(CONFIG_PERFCOUNTER) && defined(CONFIG_FDTPARSE_INDEX)
+    printf("Device probe: %u cycles, FDT index built in %u cycles\r\n",
+           (uint32_t) (probe_end - probe_start),
+           (uint32_t) (probe_start - index_start));
+#elif defined(CONFIG_PERFCOUNTER)
+    printf("Device probe: %u cycles, no FDT index\r\n",
+           (uint32_t) (probe_end - probe_start));
+#endif
+}
+
 void os_start(void) {
+    uint64_t index_start, probe_start, probe_end;
+
     init_arch();
     do_early_initializers();
 
@@ -64,14 +92,28 @@ void os_start(void) {
     init_power_led();
 #endif
 
+    index_start = boot_timestamp();
+
+#ifdef CONFIG_FDTPARSE_INDEX
+    /* Lookups fall back to scanning the blob if this fails */
+    fdtparse_index_init();
+#endif
+
+    /* Device probing, where most device tree lookups happen */
+    probe_start = boot_timestamp();
+
     do_core_initializers();
 
     device_driver_fdt_register();
 
+    probe_end = boot_timestamp();
+
     init_io();
 
     printf("\r\n%s\r\n", banner);
 
+    report_boot_times(index_start, probe_start, probe_end);
+
     if (!char_device_base_equal(stdout, stderr)) {
         fprintf(stderr, "\r\n%sStandard error terminal.\r\n", banner);
     }
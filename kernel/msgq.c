@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <kernel/class.h>
+#include <kernel/fault.h>
+#include <kernel/init.h>
+#include <kernel/msgq.h>
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include <kernel/system.h>
+#include <kernel/wait.h>
+#include <mm/mm.h>
+
+/* Send or receive request, on the calling task's stack */
+struct msgq_request {
+    void        *msg;
+    uint32_t    timeout_us;
+};
+
+static int svc_msgq_send(struct msgq *q, struct msgq_request *req,
+                         task_ctrl **woken) __attribute__((section(".kernel")));
+static int svc_msgq_receive(struct msgq *q, struct msgq_request *req,
+                            task_ctrl **woken) __attribute__((section(".kernel")));
+
+static void msgq_dtor(struct obj *o);
+
+static struct obj_type msgq_type_s = {
+    .offset = offset_of(struct msgq, obj),
+    .dtor = msgq_dtor,
+};
+
+struct class msgq_class = INIT_CLASS(msgq_class, "msgq", &msgq_type_s);
+
+/* Only named queues are destroyed, anonymous ones belong to their container */
+static void msgq_dtor(struct obj *o) {
+    struct msgq *q;
+
+    assert_type(o, &msgq_type_s);
+    q = to_msgq(o);
+
+    WARN_ON(!wait_queue_empty(&q->senders));
+    WARN_ON(!wait_queue_empty(&q->receivers));
+
+    if (o->parent) {
+        kfree(q->buf);
+        class_unexport_member(o);
+        class_deinstantiate(o);
+    }
+}
+
+static void msgq_setup(struct msgq *q, void *buf, uint32_t msg_size,
+                       uint32_t capacity) {
+    q->msg_size = msg_size;
+    q->capacity = capacity;
+    q->count = 0;
+    q->head = 0;
+    q->buf = buf;
+    wait_queue_init(&q->senders);
+    wait_queue_init(&q->receivers);
+}
+
+void msgq_init(struct msgq *q, void *buf, uint32_t msg_size,
+               uint32_t capacity) {
+    WARN_ON(!capacity);
+
+    obj_init(&q->obj, &msgq_type_s, "msgq");
+    q->obj.parent = NULL;
+    q->obj.ops = NULL;
+
+    msgq_setup(q, buf, msg_size, capacity);
+}
+
+struct msgq *msgq_create(const char *name, uint32_t msg_size,
+                         uint32_t capacity) {
+    struct obj *o;
+    struct msgq *q;
+    void *buf;
+
+    if (!capacity || !msg_size) {
+        return NULL;
+    }
+
+    buf = kmalloc(msg_size * capacity);
+    if (!buf) {
+        return NULL;
+    }
+
+    o = instantiate(name, &msgq_class, NULL, struct msgq);
+    if (!o) {
+        kfree(buf);
+        return NULL;
+    }
+
+    q = to_msgq(o);
+    msgq_setup(q, buf, msg_size, capacity);
+
+    class_export_member(o);
+
+    return q;
+}
+
+struct msgq *msgq_get(const char *name) {
+    struct obj *o = get_by_name_from_class(name, &msgq_class);
+
+    if (!o) {
+        return NULL;
+    }
+
+    obj_get(o);
+
+    return to_msgq(o);
+}
+
+void msgq_put(struct msgq *q) {
+    obj_put(&q->obj);
+}
+
+static int msgq_call(struct msgq *q, void *msg, uint32_t timeout_us,
+                     enum service_calls call) {
+    struct msgq_request req = {
+        .msg = msg,
+        .timeout_us = timeout_us,
+    };
+    task_ctrl *woken;
+    int ret;
+
+    /* Without task switching, there is nothing to wait for */
+    if (!task_switching) {
+        req.timeout_us = 0;
+
+        if (call == SVC_MSGQ_SEND) {
+            return svc_msgq_send(q, &req, &woken);
+        }
+        else {
+            return svc_msgq_receive(q, &req, &woken);
+        }
+    }
+
+    if (!arch_svc_legal()) {
+        return -1;
+    }
+
+    if (call == SVC_MSGQ_SEND) {
+        ret = SVC_ARG2(SVC_MSGQ_SEND, q, &req);
+    }
+    else {
+        ret = SVC_ARG2(SVC_MSGQ_RECEIVE, q, &req);
+    }
+
+    if (ret == WAIT_BLOCKED) {
+        ret = task_wait_timed_out() ? -1 : 0;
+    }
+
+    return ret;
+}
+
+int msgq_send(struct msgq *q, const void *msg, uint32_t timeout_us) {
+    return msgq_call(q, (void *) msg, timeout_us, SVC_MSGQ_SEND);
+}
+
+int msgq_receive(struct msgq *q, void *msg, uint32_t timeout_us) {
+    return msgq_call(q, msg, timeout_us, SVC_MSGQ_RECEIVE);
+}
+
+static void *msgq_slot(struct msgq *q, uint32_t index) {
+    return q->buf + ((q->head + index) % q->capacity) * q->msg_size;
+}
+
+static int svc_msgq_send(struct msgq *q, struct msgq_request *req,
+                         task_ctrl **woken) {
+    task_ctrl *receiver = wait_queue_head(&q->receivers);
+
+    *woken = NULL;
+
+    /* A waiting receiver means the queue is empty, hand it the message */
+    if (receiver) {
+        struct msgq_request *rx = receiver->wait_data;
+
+        memcpy(rx->msg, req->msg, q->msg_size);
+        task_wake(receiver);
+
+        *woken = receiver;
+        return 0;
+    }
+
+    if (q->count < q->capacity) {
+        memcpy(msgq_slot(q, q->count), req->msg, q->msg_size);
+        q->count++;
+        return 0;
+    }
+
+    if (!req->timeout_us) {
+        return -1;
+    }
+
+    svc_wait_queue_block(&q->senders, req, wait_timeout_ticks(req->timeout_us));
+
+    return WAIT_BLOCKED;
+}
+
+static int svc_msgq_receive(struct msgq *q, struct msgq_request *req,
+                            task_ctrl **woken) {
+    *woken = NULL;
+
+    if (q->count) {
+        task_ctrl *sender = wait_queue_head(&q->senders);
+
+        memcpy(req->msg, msgq_slot(q, 0), q->msg_size);
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+
+        /* Senders only wait on a full queue, so there is now room */
+        if (sender) {
+            struct msgq_request *tx = sender->wait_data;
+
+            memcpy(msgq_slot(q, q->count), tx->msg, q->msg_size);
+            q->count++;
+            task_wake(sender);
+
+            *woken = sender;
+        }
+
+        return 0;
+    }
+
+    if (!req->timeout_us) {
+        return -1;
+    }
+
+    svc_wait_queue_block(&q->receivers, req, wait_timeout_ticks(req->timeout_us));
+
+    return WAIT_BLOCKED;
+}
+
+int msgq_service_call(uint32_t svc_number, ...) {
+    int ret = 0;
+    task_ctrl *woken = NULL;
+    va_list ap;
+    va_start(ap, svc_number);
+
+    switch (svc_number) {
+        case SVC_MSGQ_SEND: {
+            struct msgq *q = va_arg(ap, struct msgq *);
+            struct msgq_request *req = va_arg(ap, struct msgq_request *);
+            ret = svc_msgq_send(q, req, &woken);
+            break;
+        }
+        case SVC_MSGQ_RECEIVE: {
+            struct msgq *q = va_arg(ap, struct msgq *);
+            struct msgq_request *req = va_arg(ap, struct msgq_request *);
+            ret = svc_msgq_receive(q, req, &woken);
+            break;
+        }
+        default:
+            panic_print("Unknown SVC: %d", svc_number);
+            break;
+    }
+
+    va_end(ap);
+
+    /*
+     * Run the woken task immediately if it outranks us.  If we blocked,
+     * we have already switched away, and woke no one.
+     */
+    if (woken && task_compare(get_task_t(woken), curr_task) > 0) {
+        task_switch(NULL);
+    }
+
+    return ret;
+}
+
+static int msgq_class_setup(void) {
+    obj_init(&msgq_class.obj, system_class.type, "msgq");
+    register_with_system(&ipc_system, &msgq_class);
+    return 0;
+}
+CORE_INITIALIZER(msgq_class_setup)
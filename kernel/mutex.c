@@ -24,27 +24,70 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+#include <atomic.h>
 #include <kernel/sched.h>
+#include <kernel/sched_internals.h>
 #include <kernel/fault.h>
 
 #include <kernel/mutex.h>
 
+/*
+ * Holder of mutexes acquired before task switching began.
+ * Must leave MUTEX_WAITERS clear.
+ */
+#define PRE_SCHED_HOLDER    ((task_t *) 0x0badf00c)
+
 static void held_mutexes_insert(struct mutex *list[], volatile struct mutex *mutex) __attribute__((section(".kernel")));
 void held_mutexes_remove(struct mutex *list[], volatile struct mutex *mutex) __attribute__((section(".kernel")));
 static void deadlock_check(volatile struct mutex *mut) __attribute__((section(".kernel")));
 
+static inline task_t *mutex_holder(volatile struct mutex *mutex) {
+    return (task_t *) (mutex->lock & ~MUTEX_WAITERS);
+}
+
+/*
+ * Replace lock with new, if it is currently old.
+ *
+ * Returns 1 on success, 0 if lock did not contain old.
+ */
+static inline int mutex_cmpxchg(volatile struct mutex *mutex, uint32_t old,
+                                uint32_t new) {
+    do {
+        if (load_link32(&mutex->lock) != old) {
+            return 0;
+        }
+    } while (store_conditional32(&mutex->lock, new));
+
+    return 1;
+}
+
+/*
+ * Unconditionally set lock.
+ *
+ * The kernel must update lock with a store-conditional as well, so that
+ * a task preempted within its fast path load-link/store-conditional pair
+ * sees the update and retries.
+ */
+static inline void mutex_set_lock(volatile struct mutex *mutex, uint32_t val) {
+    do {
+        load_link32(&mutex->lock);
+    } while (store_conditional32(&mutex->lock, val));
+}
+
 void acquire(volatile struct mutex *mutex) {
     if (!task_switching) {
-        mutex->lock = 1;
-        mutex->held_by = (task_t *) 0x0badf00d;
+        mutex->lock = (uint32_t) PRE_SCHED_HOLDER;
         return;
     }
 
-    int success = 0;
-
-    while (!success) {
-        success = SVC_ARG(SVC_ACQUIRE, (void *) mutex);
+    /* Fast path: claim a free mutex without entering the kernel */
+    if (mutex_cmpxchg(mutex, 0, (uint32_t) curr_task)) {
+        held_mutexes_insert(curr_task->mutex_data.held_mutexes, mutex);
+        return;
     }
+
+    /* If the mutex is held, this blocks until it is handed to us */
+    SVC_ARG(SVC_ACQUIRE, (void *) mutex);
 }
 
 /* Acquire mutex, but remove from held mutexes list so that it can be freed. */
@@ -56,52 +99,41 @@ void acquire_for_free(volatile struct mutex *mutex) {
 static int get_lock(volatile struct mutex *mutex) {
     struct task_mutex_data *curr_task_data = &curr_task->mutex_data;
 
-    /* TODO: Use a nicer name than this builtin */
-    if (__sync_bool_compare_and_swap(&mutex->lock, 0, 1)) {
-        mutex->held_by = curr_task;
+    if (mutex_cmpxchg(mutex, 0, (uint32_t) curr_task)) {
         held_mutexes_insert(curr_task_data->held_mutexes, mutex);
         curr_task_data->waiting = NULL;
         return 1;
     }
     else {
-        if (mutex->held_by != NULL) {
-            deadlock_check(mutex);
-
-            /* Add to waitlist if higher priority */
-            if (mutex->waiting) {
-                if (task_compare(mutex->waiting, curr_task) < 0) {
-                    mutex->waiting = curr_task;
-                    curr_task_data->waiting = (struct mutex *) mutex;
-                }
-            }
-            else {
-                mutex->waiting = curr_task;
-                curr_task_data->waiting = (struct mutex *) mutex;
-            }
-
-            return 0;
-        }
-        else {
-            panic_print("Semaphore (0x%x) not available, but held_by unset.", mutex);
-        }
+        deadlock_check(mutex);
+        return 0;
     }
-
-    return 0;
 }
 
 void release(volatile struct mutex *mutex) {
     if (!mutex->lock) { /* WTF, don't release an unlocked mutex */
-        mutex->held_by = NULL;
         mutex->waiting = NULL;
         return;
     }
 
     if (!task_switching) {
         mutex->lock = 0;
-        mutex->held_by = NULL;
         return;
     }
 
+    /*
+     * Fast path: with no waiters, just free the mutex.  If a task begins
+     * waiting before the store, it sets MUTEX_WAITERS, failing the
+     * exchange, and the kernel hands over the mutex instead.
+     */
+    if (mutex->lock == (uint32_t) curr_task) {
+        held_mutexes_remove(curr_task->mutex_data.held_mutexes, mutex);
+
+        if (mutex_cmpxchg(mutex, (uint32_t) curr_task, 0)) {
+            return;
+        }
+    }
+
     SVC_ARG(SVC_RELEASE, (void *) mutex);
 }
 
@@ -127,7 +159,7 @@ void held_mutexes_remove(struct mutex *list[], volatile struct mutex *mutex) {
 }
 
 static void deadlock_check(volatile struct mutex *mut) {
-    struct task_t *task = mut->held_by;
+    struct task_t *task = mutex_holder(mut);
     struct task_mutex_data *task_data = &task->mutex_data;
 
     if (task == curr_task) {
@@ -135,6 +167,10 @@ static void deadlock_check(volatile struct mutex *mut) {
                     curr_task, mut);
     }
 
+    if (task == PRE_SCHED_HOLDER) {
+        return;
+    }
+
     if (task_data->waiting) {
         for (int i = 0; i < HELD_MUTEXES_MAX; i++) {
             struct task_mutex_data *curr_task_data = &curr_task->mutex_data;
@@ -152,46 +188,139 @@ void task_mutex_setup(task_t *task) {
 
     memset(mut_data->held_mutexes, 0, sizeof(mut_data->held_mutexes));
     mut_data->waiting = NULL;
+    mut_data->next_waiter = NULL;
 }
 
-static int svc_acquire(struct mutex *mutex) {
-    int ret;
+static uint8_t task_priority(task_t *task) {
+    return get_task_ctrl(task)->priority;
+}
 
-    if (get_lock(mutex)) {
-        /* Success */
-        ret = 1;
+/* Add task to mutex wait queue, behind all tasks of equal or higher priority */
+static void waiters_insert(struct mutex *mutex, task_t *task) {
+    task_t **pos = &mutex->waiting;
+    uint8_t priority = task_priority(task);
+
+    while (*pos && task_priority(*pos) >= priority) {
+        pos = &(*pos)->mutex_data.next_waiter;
     }
-    else {
-        /* Failure */
-        ret = 0;
 
-        if (task_runnable(mutex->held_by)
-                && (task_compare(mutex->held_by, curr_task) <= 0)) {
-            task_switch(mutex->held_by);
+    task->mutex_data.next_waiter = *pos;
+    *pos = task;
+}
+
+static void waiters_remove(struct mutex *mutex, task_t *task) {
+    task_t **pos = &mutex->waiting;
+
+    while (*pos && *pos != task) {
+        pos = &(*pos)->mutex_data.next_waiter;
+    }
+
+    if (*pos) {
+        *pos = task->mutex_data.next_waiter;
+    }
+
+    task->mutex_data.next_waiter = NULL;
+}
+
+/*
+ * Boost the holder of mutex to the priority of task, which is waiting on
+ * it.  If the holder is itself waiting on a mutex, continue down the chain,
+ * so that every task standing between task and the mutex runs at (at least)
+ * task's priority.
+ */
+static void priority_inherit(struct mutex *mutex, task_t *task) {
+    uint8_t priority = task_priority(task);
+
+    while (mutex) {
+        task_t *holder = mutex_holder(mutex);
+
+        if (holder == PRE_SCHED_HOLDER || task_priority(holder) >= priority) {
+            break;
         }
-        else {
-            /* If task was not runnable, it was either a period task
-             * between runs, or it recently ended without releasing
-             * the mutex.  In that case, the kernel task will
-             * release the mutex on its next run. */
-            task_switch(NULL);
+
+        task_set_priority(get_task_ctrl(holder), priority);
+
+        /* Keep the queue the holder waits in ordered */
+        mutex = holder->mutex_data.waiting;
+        if (mutex) {
+            waiters_remove(mutex, holder);
+            waiters_insert(mutex, holder);
         }
     }
+}
 
-    return ret;
+/*
+ * Drop any inherited priority that task no longer needs, after it has
+ * given up a mutex.  The highest priority waiter of each mutex still held
+ * is at the head of its queue.
+ */
+static void priority_restore(task_t *task) {
+    task_ctrl *t = get_task_ctrl(task);
+    uint8_t priority = t->base_priority;
+
+    for (int i = 0; i < HELD_MUTEXES_MAX; i++) {
+        struct mutex *mut = task->mutex_data.held_mutexes[i];
+
+        if (mut && mut->waiting && task_priority(mut->waiting) > priority) {
+            priority = task_priority(mut->waiting);
+        }
+    }
+
+    task_set_priority(t, priority);
+}
+
+static void svc_acquire(struct mutex *mutex) {
+    if (get_lock(mutex)) {
+        return;
+    }
+
+    /* Force the holder to release through the kernel */
+    mutex_set_lock(mutex, mutex->lock | MUTEX_WAITERS);
+
+    /* Wait for release() to hand over the mutex */
+    waiters_insert(mutex, curr_task);
+    curr_task->mutex_data.waiting = mutex;
+
+    priority_inherit(mutex, curr_task);
+
+    svc_task_block(0);
 }
 
 static void svc_release(struct mutex *mutex) {
-    mutex->lock = 0;
-    mutex->held_by = NULL;
-    held_mutexes_remove(curr_task->mutex_data.held_mutexes, mutex);
+    task_t *holder = mutex_holder(mutex);
+    task_t *next = mutex->waiting;
+
+    /*
+     * The holder may not be the current task, as kernel_task releases
+     * mutexes on behalf of tasks that ended while holding them.
+     */
+    if (holder != PRE_SCHED_HOLDER) {
+        held_mutexes_remove(holder->mutex_data.held_mutexes, mutex);
+    }
 
-    if (mutex->waiting
-            && (task_compare(mutex->waiting, curr_task) >= 0)) {
-        task_t *task = mutex->waiting;
-        mutex->waiting = NULL;
+    if (next) {
+        /* Hand the mutex directly to the highest priority waiter */
+        mutex->waiting = next->mutex_data.next_waiter;
+        next->mutex_data.next_waiter = NULL;
+        next->mutex_data.waiting = NULL;
+
+        mutex_set_lock(mutex, (uint32_t) next |
+                       (mutex->waiting ? MUTEX_WAITERS : 0));
+        held_mutexes_insert(next->mutex_data.held_mutexes, mutex);
+
+        task_wake(get_task_ctrl(next));
+    }
+    else {
+        mutex_set_lock(mutex, 0);
+    }
+
+    if (holder != PRE_SCHED_HOLDER) {
+        priority_restore(holder);
+    }
 
-        task_switch(task);
+    /* Run the new holder immediately if it outranks us */
+    if (next && task_compare(next, curr_task) > 0) {
+        task_switch(NULL);
     }
 }
 
@@ -203,7 +332,7 @@ int mutex_service_call(uint32_t svc_number, ...) {
     switch (svc_number) {
         case SVC_ACQUIRE: {
             struct mutex *mut = va_arg(ap, struct mutex *);
-            ret = svc_acquire(mut);
+            svc_acquire(mut);
             break;
         }
         case SVC_RELEASE: {
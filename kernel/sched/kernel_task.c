@@ -46,6 +46,8 @@ void kernel_task(void) {
             }
         }
 
+        generic_task_cleanup(get_task_t(task));
+
         free_task(task);
     }
 }
@@ -53,6 +55,13 @@ void kernel_task(void) {
 void sleep_task(void) {
     /* Run when there is nothing else to run */
     while (1) {
+#ifdef CONFIG_SCHED_TICKLESS
+        /* Stop system ticks until there is something to do */
+        SVC(SVC_TICKLESS_ENTER);
+        arch_wait_for_interrupt();
+        SVC(SVC_TICKLESS_EXIT);
+#else
         arch_wait_for_interrupt();
+#endif
     }
 }
@@ -20,6 +20,8 @@
  * SOFTWARE.
  */
 
+#include <math.h>
+#include <time.h>
 #include <kernel/svc.h>
 #include <kernel/sched.h>
 #include <kernel/sched_internals.h>
@@ -51,16 +53,11 @@ int task_compare(task_t *task1, task_t *task2) {
 }
 
 uint8_t task_runnable(task_t *task) {
-    task_ctrl *match = get_task_ctrl(task);
-    task_ctrl *node;
-
-    list_for_each_entry(node, &runnable_task_list, runnable_task_list) {
-        if (node == match) {
-            return 1;
-        }
+    if (!task) {
+        return 0;
     }
 
-    return 0;
+    return get_task_ctrl(task)->runnable;
 }
 
 int task_switch(task_t *task) {
@@ -78,3 +75,20 @@ int task_switch(task_t *task) {
 
     return ret;
 }
+
+void task_sleep_until(uint64_t deadline) {
+    /* Tick period in usecs */
+    uint32_t period = 1000*1000 / CONFIG_SYSTICK_FREQ;
+
+    /* Blocking requires a task to block, and a service call to do it */
+    if (!task_switching || !arch_svc_legal()) {
+        while (system_time(0) < deadline);
+        return;
+    }
+
+    SVC_ARG(SVC_TASK_SLEEP, (uint32_t) DIV_ROUND_UP(deadline, period));
+}
+
+void task_sleep(uint32_t us) {
+    task_sleep_until(system_time(0) + us);
+}
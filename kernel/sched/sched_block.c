@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <list.h>
+#include <math.h>
+#include <time.h>
+#include <kernel/fault.h>
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include <kernel/timer.h>
+#include <kernel/wait.h>
+#include "sched_internals.h"
+
+/* Blocking and waking of tasks */
+
+void svc_task_block(uint32_t timeout) {
+    task_ctrl *task = get_task_ctrl(curr_task);
+
+    if (!task_switching) {
+        panic_print("Attempted to block before task switching began");
+    }
+
+    ready_queue_remove(task);
+    task->blocked = 1;
+    task->wake_timeout = 0;
+
+    if (timeout) {
+        svc_timer_start(&task->wake_timer, timeout);
+    }
+
+    task->stack_top = get_user_stack_pointer();
+    switch_task(NULL);
+}
+
+void task_wake(task_ctrl *task) {
+    if (!task->blocked) {
+        return;
+    }
+
+    svc_timer_stop(&task->wake_timer);
+
+    list_remove(&task->wait_list);
+    list_init(&task->wait_list);
+    task->wait_data = NULL;
+
+    task->blocked = 0;
+    ready_queue_insert(task);
+}
+
+void task_wake_timeout(void *data) {
+    task_ctrl *task = data;
+
+    task->wake_timeout = 1;
+    task_wake(task);
+}
+
+void svc_wait_queue_block(struct wait_queue *wq, void *data, uint32_t timeout) {
+    task_ctrl *task = get_task_ctrl(curr_task);
+    struct list *pos;
+
+    /* Behind all waiters of equal or higher priority */
+    list_for_each(pos, &wq->tasks) {
+        task_ctrl *waiter = list_entry(pos, task_ctrl, wait_list);
+
+        if (waiter->priority < task->priority) {
+            break;
+        }
+    }
+
+    list_insert_before(&task->wait_list, pos);
+    task->wait_data = data;
+
+    svc_task_block(timeout);
+}
+
+task_ctrl *wait_queue_head(struct wait_queue *wq) {
+    if (list_empty(&wq->tasks)) {
+        return NULL;
+    }
+
+    return list_entry(wq->tasks.next, task_ctrl, wait_list);
+}
+
+uint32_t wait_timeout_ticks(uint32_t timeout_us) {
+    /* Tick period in usecs */
+    uint32_t period = 1000*1000 / CONFIG_SYSTICK_FREQ;
+
+    if (timeout_us == WAIT_FOREVER) {
+        return 0;
+    }
+
+    return DIV_ROUND_UP((uint64_t) timeout_us, period);
+}
+
+int task_wait_timed_out(void) {
+    return get_task_ctrl(curr_task)->wake_timeout;
+}
+
+void svc_task_sleep_until(uint32_t wake_tick) {
+    /* Signed difference handles system_ticks wraparound */
+    int32_t delay = wake_tick - system_ticks;
+
+    if (delay <= 0) {
+        return;
+    }
+
+    svc_task_block(delay);
+}
@@ -22,7 +22,7 @@
 
 #include <stddef.h>
 #include <stdlib.h>
-#include <mm/mm.h>
+#include <mm/slab.h>
 #include <kernel/fault.h>
 
 #include <kernel/sched.h>
@@ -30,8 +30,11 @@
 #include "sched_internals.h"
 
 void free_task(task_ctrl *task) {
+    /* Stale task_t references must not look runnable */
+    task->runnable = 0;
+
     free(task->stack_limit);
-    kfree(task);
+    slab_free(&task_ctrl_cache, task);
 }
 
 /* Abort a periodic task */
@@ -56,11 +59,11 @@ void sched_svc_end_task(void) {
                     task, task->fptr, task->stack_top, task->stack_limit);
     }
 
-    list_remove(&task->runnable_task_list);
+    ready_queue_remove(task);
 
     /* Periodic (but only if aborted) */
     if (task->period && task->abort) {
-        list_remove(&task->periodic_task_list);
+        svc_timer_stop(&task->period_timer);
     }
 
     /* Periodic (but only if not aborted) */
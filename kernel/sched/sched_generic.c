@@ -48,8 +48,38 @@ static void task_io_setup(task_t *task) {
     task->_stderr = stderr;
 }
 
+/*
+ * Release ended task IO
+ *
+ * Buffered output is written out now, rather than whenever the last task
+ * sharing the stream puts it.
+ */
+static void task_io_cleanup(task_t *task) {
+    if (task->_stdout) {
+        fflush(task->_stdout);
+        obj_put(&task->_stdout->obj);
+        task->_stdout = NULL;
+    }
+
+    if (task->_stderr) {
+        fflush(task->_stderr);
+        obj_put(&task->_stderr->obj);
+        task->_stderr = NULL;
+    }
+
+    if (task->_stdin) {
+        obj_put(&task->_stdin->obj);
+        task->_stdin = NULL;
+    }
+}
+
 /* Do non-scheduler setup for new task */
 void generic_task_setup(task_t *task) {
     task_io_setup(task);
     task_mutex_setup(task);
 }
+
+/* Do non-scheduler cleanup for ended task */
+void generic_task_cleanup(task_t *task) {
+    task_io_cleanup(task);
+}
@@ -25,12 +25,60 @@
 
 #include <stdint.h>
 #include <list.h>
+#include <mm/slab.h>
 
 #define STKSIZE     CONFIG_TASK_STACK_SIZE      /* This is in words */
 
-struct list runnable_task_list;
-struct list periodic_task_list;
-struct list free_task_list;
+#define SCHED_PRIORITIES    CONFIG_SCHED_PRIORITIES
+
+/*
+ * Ready queue
+ *
+ * Runnable tasks are kept in one FIFO per priority level.  Bit n of bitmap
+ * is set whenever the FIFO for priority n is non-empty, so the highest
+ * priority runnable task is found with a single CLZ.  A FIFO whose bit is
+ * clear is considered empty, regardless of its contents.
+ */
+struct ready_queue {
+    uint32_t    bitmap;
+    struct list fifo[SCHED_PRIORITIES];
+};
+
+extern struct ready_queue ready_queue;
+
+extern struct list free_task_list;
+
+/* Task control blocks are allocated from this cache */
+extern struct slab_cache task_ctrl_cache;
+
+/*
+ * Add task to the back of the ready queue for its priority
+ *
+ * The task must not already be in the ready queue.
+ *
+ * @param task  Task to make runnable
+ */
+void ready_queue_insert(task_ctrl *task) __attribute__((section(".kernel")));
+
+/*
+ * Remove task from the ready queue
+ *
+ * The task must be in the ready queue.
+ *
+ * @param task  Task to make unrunnable
+ */
+void ready_queue_remove(task_ctrl *task) __attribute__((section(".kernel")));
+
+/*
+ * Select the next task to run
+ *
+ * Returns the task at the head of the highest priority non-empty FIFO,
+ * after moving it to the back of that FIFO, so that equal priority tasks
+ * are run round-robin.
+ *
+ * Returns NULL if no tasks are runnable.
+ */
+task_ctrl *ready_queue_next(void) __attribute__((section(".kernel")));
 
 void svc_register_task(task_ctrl *task, int periodic) __attribute__((section(".kernel")));
 
@@ -55,57 +103,53 @@ uint8_t task_exists(task_t *task) __attribute__((section(".kernel")));
 void kernel_task(void) __attribute__((section(".kernel")));
 void sleep_task(void) __attribute__((section(".kernel")));
 
-/* Place task in task list based on priority
- * Struct member and global task list have same name */
-#define DECLARE_INSERT_TASK_FUNC(task_list_name)                                    \
-    void _insert_task_##task_list_name(struct task_ctrl *new_task);                 \
-
-#define DEFINE_INSERT_TASK_FUNC(task_list_name)                                     \
-    void _insert_task_##task_list_name(struct task_ctrl *new_task) {                \
-        /* First task in list */                                                    \
-        struct task_ctrl *task = list_entry(task_list_name.next,                    \
-                struct task_ctrl, task_list_name);                                  \
-                                                                                    \
-        /* New task is the highest priority, add to front */                        \
-        if (list_empty(&task_list_name) || (new_task->priority > task->priority)) { \
-            list_add_head(&new_task->task_list_name, &task_list_name);              \
-            return;                                                                 \
-        }                                                                           \
-                                                                                    \
-        /* Last task in list */                                                     \
-        task = list_entry(list_tail(&task_list_name), struct task_ctrl,             \
-                task_list_name);                                                    \
-                                                                                    \
-        /* New task is the lowest priority, add to end */                           \
-        if (new_task->priority <= task->priority) {                                 \
-            list_add_tail(&new_task->task_list_name, &task_list_name);              \
-            return;                                                                 \
-        }                                                                           \
-                                                                                    \
-        /* New task is in the middle, add after last equal priority task */         \
-        struct list *element;                                                       \
-        struct list *insert_point = NULL;                                           \
-                                                                                    \
-        list_for_each(element, &task_list_name) {                                   \
-            struct task_ctrl *task = list_entry(element, struct task_ctrl,          \
-                    task_list_name);                                                \
-                                                                                    \
-            if (new_task->priority > task->priority) {                              \
-                insert_point = element;                                             \
-            }                                                                       \
-        }                                                                           \
-                                                                                    \
-        if (!insert_point) {                                                        \
-            panic_print("Unable to place priority %d task in %s",                   \
-                    new_task->priority, #task_list_name);                           \
-        }                                                                           \
-                                                                                    \
-        list_insert_before(&new_task->task_list_name, insert_point);                \
-    }
-
-#define insert_task(task_list_name, new_task)   _insert_task_##task_list_name(new_task)
-
-DECLARE_INSERT_TASK_FUNC(runnable_task_list);
-DECLARE_INSERT_TASK_FUNC(periodic_task_list);
+/*
+ * Release periodic task
+ *
+ * Timer function for periodic tasks, called at the start of each period.
+ *
+ * @param data  task_ctrl of periodic task
+ */
+void periodic_task_release(void *data) __attribute__((section(".kernel")));
+
+/*
+ * Wake task on timeout
+ *
+ * Timer function for the wake timer of blocked tasks.
+ *
+ * @param data  task_ctrl of blocked task
+ */
+void task_wake_timeout(void *data) __attribute__((section(".kernel")));
+
+/*
+ * Sleep current task until system tick
+ *
+ * Block the current task until system_ticks reaches wake_tick.  Returns
+ * immediately if wake_tick has already passed.
+ *
+ * @param wake_tick Value of system_ticks at which to wake the task
+ */
+void svc_task_sleep_until(uint32_t wake_tick) __attribute__((section(".kernel")));
+
+#ifdef CONFIG_SCHED_TICKLESS
+/* Boolean field indicating whether the system is in a tickless sleep */
+extern volatile uint8_t tickless_idle;
+
+/*
+ * Begin tickless sleep
+ *
+ * If the current task is the only runnable task, stop periodic system ticks
+ * until the next timer expiry.  Otherwise, do nothing.
+ */
+void sched_tickless_enter(void) __attribute__((section(".kernel")));
+
+/*
+ * End tickless sleep
+ *
+ * Resume periodic system ticks, and account for all ticks that passed
+ * while sleeping.  Does nothing if not in a tickless sleep.
+ */
+void sched_tickless_exit(void) __attribute__((section(".kernel")));
+#endif
 
 #endif
@@ -23,21 +23,46 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <time.h>
+#include <kernel/deferred.h>
 #include <kernel/fault.h>
 #include <kernel/sched.h>
 #include <kernel/sched_internals.h>
+#include <kernel/timer.h>
 #include "sched_internals.h"
 
 void sched_system_tick(void) {
+#ifdef CONFIG_SCHED_TICKLESS
+    /* Tickless sleep has ended, account for all of the skipped ticks */
+    if (tickless_idle) {
+        sched_tickless_exit();
+        run_deferred();
+        task_switch(NULL);
+        return;
+    }
+#endif
+
     system_ticks++;
 
-    /* Update periodic tasks */
-    rtos_tick();
+    run_deferred();
+
+    /* Expire timers, releasing periodic tasks */
+    timer_tick();
 
     /* Run the scheduler */
     task_switch(NULL);
 }
 
+void sched_deferred_work(void) {
+#ifdef CONFIG_SCHED_TICKLESS
+    /* The interrupt woke the system, account for the ticks slept */
+    sched_tickless_exit();
+#endif
+
+    run_deferred();
+
+    task_switch(NULL);
+}
+
 int sched_service_call(uint32_t svc_number, ...) {
     int ret = 0;
     va_list ap;
@@ -61,6 +86,21 @@ int sched_service_call(uint32_t svc_number, ...) {
             ret = svc_task_switch(task);
             break;
         }
+        case SVC_TASK_SLEEP: {
+            uint32_t wake_tick = va_arg(ap, uint32_t);
+            svc_task_sleep_until(wake_tick);
+            break;
+        }
+#ifdef CONFIG_SCHED_TICKLESS
+        case SVC_TICKLESS_ENTER:
+            sched_tickless_enter();
+            break;
+        case SVC_TICKLESS_EXIT:
+            sched_tickless_exit();
+            /* Periodic tasks may have been released */
+            svc_task_switch(NULL);
+            break;
+#endif
         default:
             panic_print("Unknown SVC: %d", svc_number);
             break;
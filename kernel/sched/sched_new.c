@@ -27,52 +27,61 @@
 #include <stdlib.h>
 #include <string.h>
 #include <list.h>
-#include <mm/mm.h>
+#include <mm/slab.h>
 #include <kernel/fault.h>
 
 #include <kernel/sched.h>
 #include <kernel/sched_internals.h>
 #include "sched_internals.h"
 
-struct list runnable_task_list = INIT_LIST(runnable_task_list);
-struct list periodic_task_list = INIT_LIST(periodic_task_list);
-
-DEFINE_INSERT_TASK_FUNC(runnable_task_list);
-DEFINE_INSERT_TASK_FUNC(periodic_task_list);
-
 volatile uint32_t total_tasks = 0;
 
+struct slab_cache task_ctrl_cache =
+    INIT_SLAB_CACHE(task_ctrl_cache, "task_ctrl", sizeof(task_ctrl),
+                    SLAB_KERNEL, NULL);
+
 static task_ctrl *create_task(void (*fptr)(void), uint8_t priority,
                               uint32_t period) {
     task_ctrl *task;
     uint32_t *memory;
     static uint32_t pid_source = 1;
-    task = (task_ctrl *) kmalloc(sizeof(task_ctrl));
+    task = slab_alloc(&task_ctrl_cache);
     if (task == NULL) {
         return NULL;
     }
 
     memory = (uint32_t *) malloc(STKSIZE*4);
     if (memory == NULL) {
-        kfree(task);
+        slab_free(&task_ctrl_cache, task);
         return NULL;
     }
 
+    /* Priorities above the highest level share the highest level */
+    if (priority >= SCHED_PRIORITIES) {
+        priority = SCHED_PRIORITIES - 1;
+    }
+
     task->stack_limit       = memory;
     task->stack_base        = memory + STKSIZE;
     task->stack_top         = memory + STKSIZE;
     task->fptr              = fptr;
     task->priority          = priority;
+    task->base_priority     = priority;
     task->running           = 0;
+    task->runnable          = 0;
+    task->blocked           = 0;
+    task->wake_timeout      = 0;
     task->abort             = 0;
 
     task->period            = period;
-    task->ticks_until_wake  = period;
     task->pid               = pid_source++;
 
     list_init(&task->runnable_task_list);
-    list_init(&task->periodic_task_list);
     list_init(&task->free_task_list);
+    list_init(&task->wait_list);
+    task->wait_data = NULL;
+    timer_init(&task->period_timer, &periodic_task_release, task);
+    timer_init(&task->wake_timer, &task_wake_timeout, task);
 
     generic_task_setup(get_task_t(task));
 
@@ -121,15 +130,16 @@ task_t *new_task(void (*fptr)(void), uint8_t priority, uint32_t period_us) {
 
 fail2:
     free(task->stack_limit);
-    kfree(task);
+    slab_free(&task_ctrl_cache, task);
 fail:
     panic_print("Could not allocate task with function pointer 0x%x", fptr);
 }
 
 void svc_register_task(task_ctrl *task, int periodic) {
-    insert_task(runnable_task_list, task);
+    ready_queue_insert(task);
 
     if (periodic) {
-        insert_task(periodic_task_list, task);
+        task->period_timer.period = task->period;
+        svc_timer_start(&task->period_timer, task->period);
     }
 }
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list.h>
+#include <kernel/fault.h>
+
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include "sched_internals.h"
+
+/*
+ * No initialization required: a FIFO is only valid while its bitmap
+ * bit is set, and it is reinitialized whenever that bit is set.
+ */
+struct ready_queue ready_queue;
+
+void ready_queue_insert(task_ctrl *task) {
+    uint8_t prio = task->priority;
+    struct list *fifo = &ready_queue.fifo[prio];
+
+    if (task->runnable) {
+        panic_print("Task (0x%x) is already runnable", task);
+    }
+
+    if (!(ready_queue.bitmap & (1 << prio))) {
+        list_init(fifo);
+        ready_queue.bitmap |= 1 << prio;
+    }
+
+    list_add_tail(&task->runnable_task_list, fifo);
+    task->runnable = 1;
+}
+
+void ready_queue_remove(task_ctrl *task) {
+    uint8_t prio = task->priority;
+
+    if (!task->runnable) {
+        panic_print("Task (0x%x) is not runnable", task);
+    }
+
+    list_remove(&task->runnable_task_list);
+    list_init(&task->runnable_task_list);
+    task->runnable = 0;
+
+    if (list_empty(&ready_queue.fifo[prio])) {
+        ready_queue.bitmap &= ~(1 << prio);
+    }
+}
+
+task_ctrl *ready_queue_next(void) {
+    struct list *fifo, *element;
+    uint8_t prio;
+
+    if (!ready_queue.bitmap) {
+        return NULL;
+    }
+
+    /* Highest set bit is the highest priority with runnable tasks */
+    prio = 31 - __builtin_clz(ready_queue.bitmap);
+    fifo = &ready_queue.fifo[prio];
+
+    /* Round-robin through equal priority tasks */
+    element = list_pop_head(fifo);
+    list_add_tail(element, fifo);
+
+    return list_entry(element, task_ctrl, runnable_task_list);
+}
+
+void task_set_priority(task_ctrl *task, uint8_t priority) {
+    if (task->priority == priority) {
+        return;
+    }
+
+    if (task->runnable) {
+        ready_queue_remove(task);
+        task->priority = priority;
+        ready_queue_insert(task);
+    }
+    else {
+        task->priority = priority;
+    }
+}
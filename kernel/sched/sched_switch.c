@@ -32,19 +32,17 @@ void switch_task(task_ctrl *task) {
 
     /* Rate monotonic scheduling
      * Always runs the highest priority task,
-     * which will be the head of the list, as
-     * it is kept sorted.  Round-robin through
-     * equal priority tasks. */
+     * which the ready queue finds in constant
+     * time.  Round-robin through equal
+     * priority tasks. */
 
     if (task == NULL) {
-        if (list_empty(&runnable_task_list)) {
+        task = ready_queue_next();
+        if (!task) {
             /* Uh-oh, no tasks! */
             panic_print("No tasks to run.");
         }
 
-        struct list *element = list_pop_head(&runnable_task_list);
-        task = list_entry(element, task_ctrl, runnable_task_list);
-
         curr_task = get_task_t(task);
 
         /* As a workaround for lack of MPU support, check if the
@@ -54,8 +52,6 @@ void switch_task(task_ctrl *task) {
                         "stack_top: 0x%x stack_limit: 0x%x", task, task->fptr,
                         task->stack_top, task->stack_limit);
         }
-
-        insert_task(runnable_task_list, task);
     }
     else {
         curr_task = get_task_t(task);
@@ -72,7 +68,7 @@ void switch_task(task_ctrl *task) {
 }
 
 int svc_task_switch(task_ctrl *task) {
-    if (task && !task_runnable(get_task_t(task))) {
+    if (task && !task->runnable) {
         return -1;
     }
 
@@ -102,24 +98,17 @@ int svc_task_switch(task_ctrl *task) {
     return 0;
 }
 
-/* Updates ticks in all periodic tasks */
-void rtos_tick(void) {
-    task_ctrl *task;
-
-    list_for_each_entry(task, &periodic_task_list, periodic_task_list) {
-        if (task->ticks_until_wake == 0) {
-            /*
-             * If this task hasn't finished (or even started) since the last
-             * period edge, it will still be in the runnable task list.  Don't
-             * add it again, as this will corrupt the list.
-             */
-            if (!task_runnable(get_task_t(task))) {
-                insert_task(runnable_task_list, task);
-            }
-            task->ticks_until_wake = task->period;
-        }
-        else {
-            task->ticks_until_wake--;
-        }
+/* Start a new period of a periodic task */
+void periodic_task_release(void *data) {
+    task_ctrl *task = data;
+
+    /*
+     * If this task hasn't finished (or even started) since the last
+     * period edge, it will still be in the ready queue, or blocked
+     * partway through its period.  Don't add it again, as this will
+     * corrupt the queue.
+     */
+    if (!task->runnable && !task->blocked) {
+        ready_queue_insert(task);
     }
 }
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <list.h>
+#include <time.h>
+
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include <kernel/timer.h>
+#include "sched_internals.h"
+
+/*
+ * Tickless idle
+ *
+ * When the idle task is the only runnable task, there is nothing for the
+ * system tick to do until the next periodic task release.  Rather than
+ * take an interrupt every tick, the system tick timer is programmed to fire
+ * once at that release (or any other kernel timer expiry), and the skipped
+ * ticks are accounted for on wakeup.
+ */
+
+volatile uint8_t tickless_idle = 0;
+
+void sched_tickless_enter(void) {
+    task_ctrl *task = get_task_ctrl(curr_task);
+    struct list *fifo = &ready_queue.fifo[task->priority];
+    uint32_t ticks;
+
+    if (tickless_idle) {
+        return;
+    }
+
+    /* Only sleep when the current task is the only runnable task */
+    if (ready_queue.bitmap != (1 << task->priority) ||
+            fifo->next != fifo->prev) {
+        return;
+    }
+
+    /* Sleep until the tick that expires the next timer */
+    ticks = timer_ticks_until_next();
+    if (ticks > arch_sched_tickless_max()) {
+        ticks = arch_sched_tickless_max();
+    }
+
+    /* Not worth it */
+    if (ticks < 2) {
+        return;
+    }
+
+    if (!arch_sched_tickless_start(ticks)) {
+        tickless_idle = 1;
+    }
+}
+
+void sched_tickless_exit(void) {
+    uint32_t elapsed, skip;
+
+    if (!tickless_idle) {
+        return;
+    }
+
+    tickless_idle = 0;
+
+    elapsed = arch_sched_tickless_stop();
+    if (!elapsed) {
+        return;
+    }
+
+    system_ticks += elapsed;
+
+    /*
+     * No timer was due before the final tick, unless the wakeup was late.
+     * Run the remaining ticks normally.
+     */
+    skip = elapsed - 1;
+    if (skip >= timer_ticks_until_next()) {
+        skip = timer_ticks_until_next() - 1;
+    }
+
+    timer_skip_ticks(skip);
+
+    for (uint32_t i = skip; i < elapsed; i++) {
+        timer_tick();
+    }
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic.h>
+#include <kernel/class.h>
+#include <kernel/deferred.h>
+#include <kernel/fault.h>
+#include <kernel/init.h>
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include <kernel/sem.h>
+#include <kernel/system.h>
+#include <kernel/wait.h>
+
+static int svc_sem_wait(struct semaphore *sem, uint32_t timeout_us) __attribute__((section(".kernel")));
+static task_ctrl *svc_sem_post(struct semaphore *sem) __attribute__((section(".kernel")));
+static void sem_isr_work(struct deferred *work) __attribute__((section(".kernel")));
+
+static void sem_dtor(struct obj *o);
+
+static struct obj_type semaphore_type_s = {
+    .offset = offset_of(struct semaphore, obj),
+    .dtor = sem_dtor,
+};
+
+struct class semaphore_class = INIT_CLASS(semaphore_class, "semaphore",
+                                          &semaphore_type_s);
+
+/* Only named semaphores are destroyed, anonymous ones belong to their container */
+static void sem_dtor(struct obj *o) {
+    struct semaphore *sem;
+
+    assert_type(o, &semaphore_type_s);
+    sem = to_semaphore(o);
+
+    WARN_ON(!wait_queue_empty(&sem->waiters));
+
+    if (o->parent) {
+        class_unexport_member(o);
+        class_deinstantiate(o);
+    }
+}
+
+static void sem_setup(struct semaphore *sem, uint32_t count) {
+    sem->count = count;
+    wait_queue_init(&sem->waiters);
+    atomic_set(&sem->isr_posts, 0);
+    deferred_init(&sem->isr_work, sem_isr_work);
+}
+
+void sem_init(struct semaphore *sem, uint32_t count) {
+    obj_init(&sem->obj, &semaphore_type_s, "semaphore");
+    sem->obj.parent = NULL;
+    sem->obj.ops = NULL;
+
+    sem_setup(sem, count);
+}
+
+struct semaphore *sem_create(const char *name, uint32_t count) {
+    struct obj *o;
+    struct semaphore *sem;
+
+    o = instantiate(name, &semaphore_class, NULL, struct semaphore);
+    if (!o) {
+        return NULL;
+    }
+
+    sem = to_semaphore(o);
+    sem_setup(sem, count);
+
+    class_export_member(o);
+
+    return sem;
+}
+
+struct semaphore *sem_get(const char *name) {
+    struct obj *o = get_by_name_from_class(name, &semaphore_class);
+
+    if (!o) {
+        return NULL;
+    }
+
+    obj_get(o);
+
+    return to_semaphore(o);
+}
+
+void sem_put(struct semaphore *sem) {
+    obj_put(&sem->obj);
+}
+
+int sem_wait(struct semaphore *sem, uint32_t timeout_us) {
+    int ret;
+
+    /* Without task switching, there is nothing to wait for */
+    if (!task_switching) {
+        return svc_sem_wait(sem, 0);
+    }
+
+    if (!arch_svc_legal()) {
+        return -1;
+    }
+
+    ret = SVC_ARG2(SVC_SEM_WAIT, sem, timeout_us);
+
+    if (ret == WAIT_BLOCKED) {
+        ret = task_wait_timed_out() ? -1 : 0;
+    }
+
+    return ret;
+}
+
+void sem_post(struct semaphore *sem) {
+    if (!task_switching) {
+        svc_sem_post(sem);
+    }
+    else if (arch_svc_legal()) {
+        SVC_ARG(SVC_SEM_POST, sem);
+    }
+    /* Interrupt context, leave the post to the kernel */
+    else {
+        atomic_inc(&sem->isr_posts);
+        defer(&sem->isr_work);
+    }
+}
+
+static int svc_sem_wait(struct semaphore *sem, uint32_t timeout_us) {
+    if (sem->count) {
+        sem->count--;
+        return 0;
+    }
+
+    if (!timeout_us) {
+        return -1;
+    }
+
+    svc_wait_queue_block(&sem->waiters, NULL, wait_timeout_ticks(timeout_us));
+
+    return WAIT_BLOCKED;
+}
+
+/* Returns the task woken by the post, if any */
+static task_ctrl *svc_sem_post(struct semaphore *sem) {
+    task_ctrl *waiter = wait_queue_head(&sem->waiters);
+
+    /* Hand the post directly to the first waiter */
+    if (waiter) {
+        task_wake(waiter);
+    }
+    else {
+        sem->count++;
+    }
+
+    return waiter;
+}
+
+static void sem_isr_work(struct deferred *work) {
+    struct semaphore *sem = container_of(work, struct semaphore, isr_work);
+    int posts = atomic_read(&sem->isr_posts);
+
+    atomic_sub(&sem->isr_posts, posts);
+
+    while (posts--) {
+        svc_sem_post(sem);
+    }
+}
+
+int sem_service_call(uint32_t svc_number, ...) {
+    int ret = 0;
+    va_list ap;
+    va_start(ap, svc_number);
+
+    switch (svc_number) {
+        case SVC_SEM_WAIT: {
+            struct semaphore *sem = va_arg(ap, struct semaphore *);
+            uint32_t timeout_us = va_arg(ap, uint32_t);
+            ret = svc_sem_wait(sem, timeout_us);
+            break;
+        }
+        case SVC_SEM_POST: {
+            struct semaphore *sem = va_arg(ap, struct semaphore *);
+            task_ctrl *woken = svc_sem_post(sem);
+
+            /* Run the woken task immediately if it outranks us */
+            if (woken && task_compare(get_task_t(woken), curr_task) > 0) {
+                task_switch(NULL);
+            }
+            break;
+        }
+        default:
+            panic_print("Unknown SVC: %d", svc_number);
+            break;
+    }
+
+    va_end(ap);
+
+    return ret;
+}
+
+static int sem_class_setup(void) {
+    obj_init(&semaphore_class.obj, system_class.type, "semaphore");
+    register_with_system(&ipc_system, &semaphore_class);
+    return 0;
+}
+CORE_INITIALIZER(sem_class_setup)
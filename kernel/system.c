@@ -42,6 +42,16 @@ int create_dev_system(void) {
 }
 CORE_INITIALIZER(create_dev_system)
 
+/* Named inter-task communication objects, such as semaphores */
+struct system ipc_system = INIT_SYSTEM(ipc_system, ipc);
+
+int create_ipc_system(void) {
+    obj_init(&ipc_system.obj, &system_type_s, "ipc");
+    collection_add(&systems, &ipc_system.obj);
+    return 0;
+}
+CORE_INITIALIZER(create_ipc_system)
+
 struct obj *get_by_name_from_system(struct system *sys, char *cls_name, char *inst_name) {
     struct obj *cls_obj = collection_get_by_name(&sys->classes, cls_name);
 
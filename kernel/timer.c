@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <list.h>
+#include <math.h>
+#include <kernel/fault.h>
+#include <kernel/sched.h>
+#include <kernel/sched_internals.h>
+#include <kernel/svc.h>
+
+#include <kernel/timer.h>
+
+/* Active timers, ordered by expiry */
+static struct list timer_queue = INIT_LIST(timer_queue);
+
+/* Convert microseconds to ticks, rounding up */
+static uint32_t us_to_ticks(uint32_t us) {
+    uint32_t tick_period_us = 1000*1000 / CONFIG_SYSTICK_FREQ;
+
+    return DIV_ROUND_UP(us, tick_period_us);
+}
+
+void timer_start(struct timer *timer, uint32_t delay_us, uint32_t period_us) {
+    uint32_t delay = us_to_ticks(delay_us);
+
+    timer->period = us_to_ticks(period_us);
+
+    /* If possible, make a service call */
+    if (task_switching && arch_svc_legal()) {
+        SVC_ARG2(SVC_TIMER_START, timer, delay);
+    }
+    /* Otherwise, start directly, keeping the system tick out */
+    else {
+        uint32_t state = arch_sched_mask();
+
+        if (timer->active) {
+            svc_timer_stop(timer);
+        }
+        svc_timer_start(timer, delay);
+
+        arch_sched_unmask(state);
+    }
+}
+
+void timer_stop(struct timer *timer) {
+    if (task_switching && arch_svc_legal()) {
+        SVC_ARG(SVC_TIMER_STOP, timer);
+    }
+    else {
+        uint32_t state = arch_sched_mask();
+
+        svc_timer_stop(timer);
+
+        arch_sched_unmask(state);
+    }
+}
+
+void svc_timer_start(struct timer *timer, uint32_t delay) {
+    struct list *element;
+
+    if (timer->active) {
+        panic_print("Timer (0x%x) already active", timer);
+    }
+
+    if (!delay) {
+        delay = 1;
+    }
+
+    /* Find the first timer that expires after this one */
+    list_for_each(element, &timer_queue) {
+        struct timer *curr = list_entry(element, struct timer, list);
+
+        if (delay < curr->delta) {
+            curr->delta -= delay;
+            break;
+        }
+
+        delay -= curr->delta;
+    }
+
+    timer->delta = delay;
+    timer->active = 1;
+    list_insert_before(&timer->list, element);
+}
+
+void svc_timer_stop(struct timer *timer) {
+    if (!timer->active) {
+        return;
+    }
+
+    /* The following timer inherits this timer's delta */
+    if (timer->list.next != &timer_queue) {
+        struct timer *next = list_entry(timer->list.next, struct timer, list);
+        next->delta += timer->delta;
+    }
+
+    list_remove(&timer->list);
+    list_init(&timer->list);
+    timer->active = 0;
+}
+
+void timer_tick(void) {
+    struct timer *timer;
+
+    if (list_empty(&timer_queue)) {
+        return;
+    }
+
+    timer = list_entry(timer_queue.next, struct timer, list);
+    timer->delta--;
+
+    while (!list_empty(&timer_queue)) {
+        timer = list_entry(timer_queue.next, struct timer, list);
+
+        if (timer->delta) {
+            break;
+        }
+
+        list_remove(&timer->list);
+        list_init(&timer->list);
+        timer->active = 0;
+
+        /* Requeue before calling, so the function may stop the timer */
+        if (timer->period) {
+            svc_timer_start(timer, timer->period);
+        }
+
+        timer->func(timer->data);
+    }
+}
+
+void timer_skip_ticks(uint32_t ticks) {
+    struct timer *timer;
+
+    if (list_empty(&timer_queue) || !ticks) {
+        return;
+    }
+
+    timer = list_entry(timer_queue.next, struct timer, list);
+
+    if (ticks >= timer->delta) {
+        panic_print("Skipped %d ticks past timer (0x%x) expiry", ticks, timer);
+    }
+
+    timer->delta -= ticks;
+}
+
+uint32_t timer_ticks_until_next(void) {
+    if (list_empty(&timer_queue)) {
+        return UINT32_MAX;
+    }
+
+    return list_entry(timer_queue.next, struct timer, list)->delta;
+}
+
+int timer_service_call(uint32_t svc_number, ...) {
+    int ret = 0;
+    va_list ap;
+    va_start(ap, svc_number);
+
+    switch (svc_number) {
+        case SVC_TIMER_START: {
+            struct timer *timer = va_arg(ap, struct timer *);
+            uint32_t delay = va_arg(ap, uint32_t);
+
+            if (timer->active) {
+                svc_timer_stop(timer);
+            }
+            svc_timer_start(timer, delay);
+            break;
+        }
+        case SVC_TIMER_STOP: {
+            struct timer *timer = va_arg(ap, struct timer *);
+            svc_timer_stop(timer);
+            break;
+        }
+        default:
+            panic_print("Unknown SVC: %d", svc_number);
+            break;
+    }
+
+    va_end(ap);
+
+    return ret;
+}
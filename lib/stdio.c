@@ -23,10 +23,10 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <dev/buf_stream.h>
 #include <dev/char.h>
 #include <dev/resource.h>
 
@@ -96,6 +96,22 @@ int write_block(struct char_device *dev, const char *buf, int num) {
     return ret;
 }
 
+int fflush(struct char_device *dev) {
+    struct char_ops *ops;
+
+    if (!dev) {
+        return -1;
+    }
+
+    ops = dev->obj.ops;
+
+    if (!ops->flush) {
+        return 0;
+    }
+
+    return ops->flush(dev);
+}
+
 int fputs(struct char_device *dev, const char *s) {
     return write_block(dev, s, strlen(s));
 }
@@ -118,269 +134,622 @@ int fgetc(struct char_device *dev) {
     return ret;
 }
 
-int scnprintf(char *buf, uint32_t n, const char *fmt, ...) {
-    va_list ap;
-    struct char_device *stream;
+/*
+ * Formatted output
+ *
+ * The formatter core stages output in a buffer, which is either the
+ * caller's memory itself (vsnprintf and friends), or a small buffer on the
+ * stack drained through a sink function (vcbprintf, vfprintf).  Nothing is
+ * allocated, and device output goes out in one write per PRINTF_BUF_SIZE
+ * bytes, which is usually once per call.
+ */
+
+#define PRINTF_BUF_SIZE     64
+
+struct printf_out {
+    char *buf;      /* Output staged here */
+    int size;       /* Capacity of buf */
+    int count;      /* Bytes staged in buf */
+    int total;      /* Bytes output, including any truncated */
+    /* Drains buf when full, or NULL to truncate */
+    int (*sink)(void *arg, const char *buf, int num);
+    void *arg;
+};
+
+/* Conversion flags */
+#define PRINTF_LEFT     (1 << 0)    /* '-' */
+#define PRINTF_ZERO     (1 << 1)    /* '0' */
+#define PRINTF_PLUS     (1 << 2)    /* '+' */
+#define PRINTF_SPACE    (1 << 3)    /* ' ' */
+#define PRINTF_ALT      (1 << 4)    /* '#' */
+#define PRINTF_UPPER    (1 << 5)    /* Upper case conversion */
+#define PRINTF_PTR      (1 << 6)    /* %p, always prefixed with 0x */
+
+/* Length modifiers */
+enum printf_length {
+    PRINTF_LEN_INT,
+    PRINTF_LEN_CHAR,    /* hh */
+    PRINTF_LEN_SHORT,   /* h */
+    PRINTF_LEN_LONG,    /* l */
+    PRINTF_LEN_LLONG,   /* ll, j */
+    PRINTF_LEN_SIZE,    /* z, t */
+};
+
+struct printf_spec {
+    uint32_t flags;
+    int width;
+    int precision;      /* Negative if not given */
+    enum printf_length length;
+};
+
+/* %f digits after the decimal point, beyond which a float has no precision */
+#define PRINTF_FLOAT_PRECISION  9
+
+static int printf_flush(struct printf_out *out) {
     int ret;
 
-    va_start(ap, fmt);
+    if (!out->sink || !out->count) {
+        return 0;
+    }
 
-    stream = buf_stream_create(buf, n);
-    if (!stream) {
-        ret = -1;
-        goto out;
+    ret = out->sink(out->arg, out->buf, out->count);
+    if (ret < 0) {
+        return ret;
     }
 
-    ret = vfprintf(stream, fmt, ap);
+    out->count = 0;
 
-    obj_put(&stream->obj);
-out:
-    va_end(ap);
-    return ret;
+    return 0;
 }
 
-int fprintf(struct char_device *dev, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    int ret = vfprintf(dev, fmt, ap);
-    va_end(ap);
+/* Output num bytes of s, or num copies of c if s is NULL */
+static int printf_emit(struct printf_out *out, const char *s, char c,
+                       int num) {
+    while (num > 0) {
+        int chunk = out->size - out->count;
 
-    return ret;
-}
+        if (!chunk) {
+            int ret;
 
-static inline int holding_flush(char *holding, int *hold_count,
-                                struct char_device *dev) {
-    if (*hold_count) {
-        int ret = fputs(dev, holding);
-        if (ret >= 0) {
-            *hold_count = 0;
-            holding[0] = '\0';
+            /* Memory output truncates, but still counts the full length */
+            if (!out->sink) {
+                out->total += num;
+                return 0;
+            }
+
+            ret = printf_flush(out);
+            if (ret < 0) {
+                return ret;
+            }
+
+            continue;
         }
-        return ret;
+
+        if (chunk > num) {
+            chunk = num;
+        }
+
+        if (s) {
+            memcpy(&out->buf[out->count], s, chunk);
+            s += chunk;
+        }
+        else {
+            memset(&out->buf[out->count], c, chunk);
+        }
+
+        out->count += chunk;
+        out->total += chunk;
+        num -= chunk;
+    }
+
+    return 0;
+}
+
+/*
+ * Output a field padded to the spec width, as
+ * [spaces][prefix][zeros][body][spaces]
+ */
+static int printf_field(struct printf_out *out, struct printf_spec *spec,
+                        const char *prefix, int prefix_len, int zeros,
+                        const char *body, int body_len) {
+    int pad = spec->width - (prefix_len + zeros + body_len);
+    int ret = 0;
+
+    if (pad < 0) {
+        pad = 0;
+    }
+
+    if (spec->flags & PRINTF_LEFT) {
+        ret |= printf_emit(out, prefix, 0, prefix_len);
+        ret |= printf_emit(out, NULL, '0', zeros);
+        ret |= printf_emit(out, body, 0, body_len);
+        ret |= printf_emit(out, NULL, ' ', pad);
+    }
+    else if (spec->flags & PRINTF_ZERO) {
+        ret |= printf_emit(out, prefix, 0, prefix_len);
+        ret |= printf_emit(out, NULL, '0', zeros + pad);
+        ret |= printf_emit(out, body, 0, body_len);
     }
     else {
-        return 0;
+        ret |= printf_emit(out, NULL, ' ', pad);
+        ret |= printf_emit(out, prefix, 0, prefix_len);
+        ret |= printf_emit(out, NULL, '0', zeros);
+        ret |= printf_emit(out, body, 0, body_len);
     }
+
+    return ret < 0 ? -1 : 0;
 }
 
-static inline int holding_push(char c, char *holding, int hold_len,
-                               int *hold_count, struct char_device *dev) {
-    int ret;
+/* Write value in base backward from end, returning the number of digits */
+static int printf_digits(char *end, uint64_t value, uint32_t base,
+                         uint32_t flags) {
+    const char *lookup = flags & PRINTF_UPPER ? "0123456789ABCDEF"
+                                              : "0123456789abcdef";
+    int n = 0;
+
+    /* Most values fit a word, and avoid 64-bit division */
+    while (value > UINT32_MAX) {
+        *--end = lookup[value % base];
+        value /= base;
+        n++;
+    }
+
+    uint32_t word = value;
+    do {
+        *--end = lookup[word % base];
+        word /= base;
+        n++;
+    } while (word);
+
+    return n;
+}
 
-    if (*hold_count >= hold_len - 1) {
-        ret = holding_flush(holding, hold_count, dev);
+static int printf_integer(struct printf_out *out, struct printf_spec *spec,
+                          uint64_t value, int negative, uint32_t base) {
+    char digits[24];
+    char prefix[2];
+    int prefix_len = 0;
+    int zeros = 0;
+    int n = 0;
+
+    /* Zero with zero precision has no digits */
+    if (value || spec->precision) {
+        n = printf_digits(&digits[sizeof(digits)], value, base, spec->flags);
     }
-    else {
-        ret = 0;
+
+    if (negative) {
+        prefix[prefix_len++] = '-';
+    }
+    else if (spec->flags & PRINTF_PLUS) {
+        prefix[prefix_len++] = '+';
+    }
+    else if (spec->flags & PRINTF_SPACE) {
+        prefix[prefix_len++] = ' ';
     }
 
-    holding[(*hold_count)++] = c;
-    holding[*hold_count] = '\0';
+    if (base == 16 && (spec->flags & PRINTF_PTR ||
+                       (spec->flags & PRINTF_ALT && value))) {
+        prefix[prefix_len++] = '0';
+        prefix[prefix_len++] = spec->flags & PRINTF_UPPER ? 'X' : 'x';
+    }
 
-    return ret;
+    if (spec->precision > n) {
+        zeros = spec->precision - n;
+    }
+    /* Octal alternate form always starts with a zero */
+    else if (base == 8 && spec->flags & PRINTF_ALT &&
+             (!n || digits[sizeof(digits) - n] != '0')) {
+        zeros = 1;
+    }
+
+    /* Precision overrides zero padding */
+    if (spec->precision >= 0) {
+        spec->flags &= ~PRINTF_ZERO;
+    }
+
+    return printf_field(out, spec, prefix, prefix_len, zeros,
+                        &digits[sizeof(digits) - n], n);
 }
 
-/* Returns bytes written, negative on error */
-int vfprintf(struct char_device *dev, const char *fmt, va_list ap) {
-    int total = 0;
+static int printf_float(struct printf_out *out, struct printf_spec *spec,
+                        float num) {
+    /* 20 integer digits, point, and fraction */
+    char body[20 + 1 + PRINTF_FLOAT_PRECISION];
+    char *end = &body[sizeof(body)];
+    char *p = end;
+    char sign = '\0';
+    int precision = spec->precision < 0 ? 6 : spec->precision;
+
+    if (precision > PRINTF_FLOAT_PRECISION) {
+        precision = PRINTF_FLOAT_PRECISION;
+    }
 
-    /*
-     * We buffer data here as long as possible, because the actual puts/putc
-     * functions tend to be slow and the fewer calls we can make, the better.
-     */
-    char holding[32];
-    int hold_count = 0;
-    const int hold_len = sizeof(holding)/sizeof(holding[0]);
+    if (!ispos(num) && !isnan(num)) {
+        sign = '-';
+        num = -num;
+    }
+    else if (spec->flags & PRINTF_PLUS) {
+        sign = '+';
+    }
+    else if (spec->flags & PRINTF_SPACE) {
+        sign = ' ';
+    }
 
-    holding[0] = '\0';
+    if (isnan(num) || isinf(num) || num >= 18446744073709551616.0f) {
+        const char *word;
 
-    int ret;
+        if (spec->flags & PRINTF_UPPER) {
+            word = isnan(num) ? "NAN" : "INF";
+        }
+        else {
+            word = isnan(num) ? "nan" : "inf";
+        }
 
-    while (*fmt) {
-        if (*fmt == '%') {
-            switch (*(++fmt)) {
-                case 'x': {
-                    /* Hex */
-                    uint32_t hex = va_arg(ap, uint32_t);
-                    char buf[12];
-
-                    uitoa(hex, buf, 9, 16);
-
-                    ret = holding_flush(holding, &hold_count, dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    ret = fputs(dev, buf);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    break;
-                }
-                case 'i': case 'd': {
-                    int num = va_arg(ap, int);
-                    char buf[9];    /* 7 digits in INT_MAX + '-' and '\0' */
-
-                    itoa(num, buf, 12, 10);
-
-                    ret = holding_flush(holding, &hold_count, dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    ret = fputs(dev, buf);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-                    break;
-                }
-                case 'u': {
-                    uint32_t num = va_arg(ap, uint32_t);
-                    char buf[9];    /* 7 digits in INT_MAX + '-' and '\0' */
-
-                    uitoa(num, buf, 12, 10);
-
-                    ret = holding_flush(holding, &hold_count, dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    ret = fputs(dev, buf);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-                    break;
-                }
-                case 'f': {
-                    float num = (float) va_arg(ap, double);
-                    char buf[20];
-
-                    ftoa(num, 0.0001f, buf, 20);
-
-                    ret = holding_flush(holding, &hold_count, dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    ret = fputs(dev, buf);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-                    break;
-                }
-                case 'c': {
-                    char letter = (char) va_arg(ap, uint32_t);
-
-                    ret = holding_push(letter, holding, hold_len, &hold_count,
-                                       dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    break;
-                }
-                case 's': {
-                    char *s = va_arg(ap, char*);
-
-                    ret = holding_flush(holding, &hold_count, dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    ret = fputs(dev, s);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    break;
-                }
-                case '%': { /* Just print a % */
-                    ret = holding_push('%', holding, hold_len, &hold_count,
-                                       dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    break;
-                }
-                default: {
-                    ret = holding_push('%', holding, hold_len, &hold_count,
-                                       dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-
-                    ret = holding_push(*fmt, holding, hold_len, &hold_count,
-                                       dev);
-                    if (ret >= 0) {
-                        total += ret;
-                    }
-                    else {
-                        return ret;
-                    }
-                }
-            }
+        if (!isnan(num) && !isinf(num)) {
+            /* Beyond 64-bit integers, fall back to the rough conversion */
+            ftoa(num, 0.0001f, body, sizeof(body));
+            word = body;
+        }
+
+        spec->flags &= ~PRINTF_ZERO;
+        return printf_field(out, spec, &sign, sign ? 1 : 0, 0, word,
+                            strlen(word));
+    }
+
+    uint32_t scale = 1;
+    for (int i = 0; i < precision; i++) {
+        scale *= 10;
+    }
+
+    uint64_t ipart = num;
+    float frac = (num - (float) ipart) * scale;
+    uint32_t fpart = frac;
+    float rem = frac - (float) fpart;
+
+    /* Round half to even on the last printed digit, as glibc does */
+    uint64_t last = precision ? fpart : ipart;
+    if (rem > 0.5f || (rem == 0.5f && (last & 1))) {
+        fpart++;
+    }
+
+    /* Rounding carried into the integer part */
+    if (fpart >= scale) {
+        fpart -= scale;
+        ipart++;
+    }
+
+    if (precision) {
+        int n = printf_digits(p, fpart, 10, 0);
+
+        p -= n;
+        while (n++ < precision) {
+            *--p = '0';
+        }
+    }
+
+    if (precision || spec->flags & PRINTF_ALT) {
+        *--p = '.';
+    }
+
+    p -= printf_digits(p, ipart, 10, 0);
+
+    return printf_field(out, spec, &sign, sign ? 1 : 0, 0, p, end - p);
+}
+
+static uint64_t printf_arg_unsigned(va_list *ap, enum printf_length length) {
+    switch (length) {
+    case PRINTF_LEN_CHAR:
+        return (unsigned char) va_arg(*ap, unsigned int);
+    case PRINTF_LEN_SHORT:
+        return (unsigned short) va_arg(*ap, unsigned int);
+    case PRINTF_LEN_LONG:
+        return va_arg(*ap, unsigned long);
+    case PRINTF_LEN_LLONG:
+        return va_arg(*ap, unsigned long long);
+    case PRINTF_LEN_SIZE:
+        return va_arg(*ap, size_t);
+    default:
+        return va_arg(*ap, unsigned int);
+    }
+}
+
+static int64_t printf_arg_signed(va_list *ap, enum printf_length length) {
+    switch (length) {
+    case PRINTF_LEN_CHAR:
+        return (signed char) va_arg(*ap, int);
+    case PRINTF_LEN_SHORT:
+        return (short) va_arg(*ap, int);
+    case PRINTF_LEN_LONG:
+        return va_arg(*ap, long);
+    case PRINTF_LEN_LLONG:
+        return va_arg(*ap, long long);
+    case PRINTF_LEN_SIZE:
+        return va_arg(*ap, ptrdiff_t);
+    default:
+        return va_arg(*ap, int);
+    }
+}
+
+/* Parse a decimal field, or '*' taking it from the arguments */
+static int printf_parse_int(const char **fmt, va_list *ap) {
+    int value = 0;
+
+    if (**fmt == '*') {
+        (*fmt)++;
+        return va_arg(*ap, int);
+    }
+
+    while (**fmt >= '0' && **fmt <= '9') {
+        value = 10*value + *(*fmt)++ - '0';
+    }
+
+    return value;
+}
+
+/* Format one conversion, with *fmt just past the '%' */
+static int printf_conversion(struct printf_out *out, const char **fmt,
+                             va_list *ap) {
+    struct printf_spec spec = {
+        .flags = 0,
+        .width = 0,
+        .precision = -1,
+        .length = PRINTF_LEN_INT,
+    };
+    const char *start = *fmt;
+    const char *f = *fmt;
+
+    /* Flags */
+    for (;; f++) {
+        if (*f == '-') {
+            spec.flags |= PRINTF_LEFT;
+        }
+        else if (*f == '0') {
+            spec.flags |= PRINTF_ZERO;
+        }
+        else if (*f == '+') {
+            spec.flags |= PRINTF_PLUS;
+        }
+        else if (*f == ' ') {
+            spec.flags |= PRINTF_SPACE;
+        }
+        else if (*f == '#') {
+            spec.flags |= PRINTF_ALT;
+        }
+        else {
+            break;
+        }
+    }
+
+    spec.width = printf_parse_int(&f, ap);
+    if (spec.width < 0) {
+        /* Negative '*' width is left justification */
+        spec.flags |= PRINTF_LEFT;
+        spec.width = -spec.width;
+    }
+
+    if (*f == '.') {
+        f++;
+        spec.precision = printf_parse_int(&f, ap);
+        if (spec.precision < 0) {
+            spec.precision = -1;
+        }
+    }
+
+    switch (*f) {
+    case 'h':
+        spec.length = PRINTF_LEN_SHORT;
+        if (*++f == 'h') {
+            spec.length = PRINTF_LEN_CHAR;
+            f++;
+        }
+        break;
+    case 'l':
+        spec.length = PRINTF_LEN_LONG;
+        if (*++f == 'l') {
+            spec.length = PRINTF_LEN_LLONG;
+            f++;
+        }
+        break;
+    case 'j':
+        spec.length = PRINTF_LEN_LLONG;
+        f++;
+        break;
+    case 'z': case 't':
+        spec.length = PRINTF_LEN_SIZE;
+        f++;
+        break;
+    }
 
+    *fmt = f + 1;
+
+    switch (*f) {
+    case 'd': case 'i': {
+        int64_t num = printf_arg_signed(ap, spec.length);
+        uint64_t mag = num < 0 ? -(uint64_t) num : (uint64_t) num;
+
+        return printf_integer(out, &spec, mag, num < 0, 10);
+    }
+    case 'u':
+        return printf_integer(out, &spec, printf_arg_unsigned(ap, spec.length),
+                              0, 10);
+    case 'o':
+        return printf_integer(out, &spec, printf_arg_unsigned(ap, spec.length),
+                              0, 8);
+    case 'X':
+        spec.flags |= PRINTF_UPPER;
+        /* Fall through */
+    case 'x':
+        return printf_integer(out, &spec, printf_arg_unsigned(ap, spec.length),
+                              0, 16);
+    case 'p':
+        spec.flags |= PRINTF_PTR;
+        return printf_integer(out, &spec,
+                              (uintptr_t) va_arg(*ap, void *), 0, 16);
+    case 'F':
+        spec.flags |= PRINTF_UPPER;
+        /* Fall through */
+    case 'f':
+        return printf_float(out, &spec, (float) va_arg(*ap, double));
+    case 'c': {
+        char letter = (char) va_arg(*ap, int);
+
+        spec.flags &= ~PRINTF_ZERO;
+        return printf_field(out, &spec, NULL, 0, 0, &letter, 1);
+    }
+    case 's': {
+        const char *s = va_arg(*ap, const char *);
+        const char *nul;
+        int n;
+
+        if (!s) {
+            s = "(null)";
+        }
+
+        /* Precision limits how much of s may be read */
+        if (spec.precision >= 0) {
+            nul = memchr(s, '\0', spec.precision);
+            n = nul ? nul - s : spec.precision;
+        }
+        else {
+            n = strlen(s);
+        }
+
+        spec.flags &= ~PRINTF_ZERO;
+        return printf_field(out, &spec, NULL, 0, 0, s, n);
+    }
+    case '%':
+        return printf_emit(out, "%", 0, 1);
+    case '\0':
+        /* Trailing '%', print it and stop at the terminator */
+        *fmt = f;
+        return printf_emit(out, "%", 0, 1);
+    default:
+        /* Unknown conversion, print it as is */
+        return printf_emit(out, start - 1, 0, f - start + 2);
+    }
+}
+
+/* Returns bytes output, including any truncated, negative on error */
+static int printf_format(struct printf_out *out, const char *fmt,
+                         va_list ap) {
+    va_list args;
+    int ret = 0;
+
+    va_copy(args, ap);
+
+    while (*fmt && ret >= 0) {
+        const char *start = fmt;
+
+        /* Literal text is output in runs */
+        while (*fmt && *fmt != '%') {
             fmt++;
         }
+
+        if (fmt != start) {
+            ret = printf_emit(out, start, 0, fmt - start);
+        }
         else {
-            ret = holding_push(*fmt++, holding, hold_len, &hold_count, dev);
-            if (ret >= 0) {
-                total += ret;
-            }
-            else {
-                return ret;
-            }
+            fmt++;
+            ret = printf_conversion(out, &fmt, &args);
         }
     }
 
-    ret = holding_flush(holding, &hold_count, dev);
+    va_end(args);
+
     if (ret >= 0) {
-        total += ret;
+        ret = printf_flush(out);
     }
-    else {
+
+    return ret < 0 ? ret : out->total;
+}
+
+int vcbprintf(int (*sink)(void *arg, const char *buf, int num), void *arg,
+              const char *fmt, va_list ap) {
+    char buf[PRINTF_BUF_SIZE];
+    struct printf_out out = {
+        .buf = buf,
+        .size = sizeof(buf),
+        .count = 0,
+        .total = 0,
+        .sink = sink,
+        .arg = arg,
+    };
+
+    return printf_format(&out, fmt, ap);
+}
+
+int vsnprintf(char *buf, uint32_t n, const char *fmt, va_list ap) {
+    /* Formatted straight into buf, leaving room for the NULL byte */
+    struct printf_out out = {
+        .buf = buf,
+        .size = n ? n - 1 : 0,
+        .count = 0,
+        .total = 0,
+        .sink = NULL,
+        .arg = NULL,
+    };
+    int ret;
+
+    ret = printf_format(&out, fmt, ap);
+
+    if (n) {
+        buf[out.count] = '\0';
+    }
+
+    return ret;
+}
+
+int snprintf(char *buf, uint32_t n, const char *fmt, ...) {
+    va_list ap;
+    int ret;
+
+    va_start(ap, fmt);
+    ret = vsnprintf(buf, n, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+int vscnprintf(char *buf, uint32_t n, const char *fmt, va_list ap) {
+    int ret = vsnprintf(buf, n, fmt, ap);
+
+    if (ret < 0) {
         return ret;
     }
 
-    return total;
+    /* Only count what fit */
+    if (ret >= (int) n) {
+        ret = n ? n - 1 : 0;
+    }
+
+    return ret;
+}
+
+int scnprintf(char *buf, uint32_t n, const char *fmt, ...) {
+    va_list ap;
+    int ret;
+
+    va_start(ap, fmt);
+    ret = vscnprintf(buf, n, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+int fprintf(struct char_device *dev, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = vfprintf(dev, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+static int printf_device_sink(void *arg, const char *buf, int num) {
+    return write_block(arg, buf, num);
+}
+
+/* Returns bytes written, negative on error */
+int vfprintf(struct char_device *dev, const char *fmt, va_list ap) {
+    return vcbprintf(printf_device_sink, dev, fmt, ap);
 }
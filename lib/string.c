@@ -26,11 +26,130 @@
 
 #include <kernel/fault.h>
 
+/*
+ * The memory and string functions work a 32-bit word at a time wherever
+ * alignment allows, only falling back to bytes for the unaligned head and
+ * tail of a buffer.  Word loads never cross the aligned word containing
+ * the last byte of the buffer, so they cannot fault past its end.
+ */
+
+#define WORD_SIZE   (sizeof(uint32_t))
+#define WORD_MASK   (WORD_SIZE - 1)
+#define BLOCK_SIZE  (4 * WORD_SIZE)
+
+/* Every byte of a word set to 0x01 and 0x80 */
+#define ONES        0x01010101UL
+#define HIGHS       0x80808080UL
+
+/* Nonzero if any byte of w is zero */
+#define HAS_ZERO(w) (((w) - ONES) & ~(w) & HIGHS)
+
+/*
+ * Combine the tail of aligned word a with the head of the following word
+ * b, for copies where the source and destination are misaligned relative
+ * to each other
+ */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MERGE(a, b, shift)  (((a) << (shift)) | ((b) >> (32 - (shift))))
+#else
+#define MERGE(a, b, shift)  (((a) >> (shift)) | ((b) << (32 - (shift))))
+#endif
+
+/* Word accesses may alias any type the caller's buffer holds */
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7A__)
+#define HAVE_LDM_STM
+#endif
+
+static inline int word_aligned(const void *p) {
+    return !((uintptr_t) p & WORD_MASK);
+}
+
+/* Copy blocks of four words between word aligned buffers */
+static inline void copy_blocks(word_t **dst, const word_t **src,
+                               size_t blocks) {
+    word_t *d = *dst;
+    const word_t *s = *src;
+
+    while (blocks--) {
+#ifdef HAVE_LDM_STM
+        asm volatile ("ldmia %1!, {r2-r5}\n\t"
+                      "stmia %0!, {r2-r5}"
+                      : "+r" (d), "+r" (s)
+                      :
+                      : "r2", "r3", "r4", "r5", "memory");
+#else
+        uint32_t a = s[0], b = s[1], c = s[2], e = s[3];
+
+        d[0] = a;
+        d[1] = b;
+        d[2] = c;
+        d[3] = e;
+        d += 4;
+        s += 4;
+#endif
+    }
+
+    *dst = d;
+    *src = s;
+}
+
+/* Fill blocks of four words in a word aligned buffer */
+static inline word_t *fill_blocks(word_t *d, uint32_t word,
+                                    size_t blocks) {
+#ifdef HAVE_LDM_STM
+    register uint32_t w0 asm("r2") = word;
+    register uint32_t w1 asm("r3") = word;
+    register uint32_t w2 asm("r4") = word;
+    register uint32_t w3 asm("r5") = word;
+
+    while (blocks--) {
+        asm volatile ("stmia %0!, {%1, %2, %3, %4}"
+                      : "+r" (d)
+                      : "r" (w0), "r" (w1), "r" (w2), "r" (w3)
+                      : "memory");
+    }
+#else
+    while (blocks--) {
+        d[0] = word;
+        d[1] = word;
+        d[2] = word;
+        d[3] = word;
+        d += 4;
+    }
+#endif
+
+    return d;
+}
+
 void *memchr(const void *ptr, int value, size_t num) {
     const unsigned char *p = ptr;
+    unsigned char c = value;
+
+    while (num && !word_aligned(p)) {
+        if (*p == c) {
+            return (void *) p;
+        }
+        p++;
+        num--;
+    }
+
+    if (num >= WORD_SIZE) {
+        const word_t *w = (const word_t *) p;
+        uint32_t pattern = c * ONES;
+
+        /* Stop at the first word containing c */
+        while (num >= WORD_SIZE && !HAS_ZERO(*w ^ pattern)) {
+            w++;
+            num -= WORD_SIZE;
+        }
+
+        p = (const unsigned char *) w;
+    }
 
     while (num--) {
-        if (*p == value) {
+        if (*p == c) {
             return (void *) p;
         }
         p++;
@@ -43,6 +162,21 @@ int memcmp(const void *ptr1, const void *ptr2, size_t num) {
     const unsigned char *p1 = ptr1;
     const unsigned char *p2 = ptr2;
 
+    /* Skip matching words, the differing byte is found below */
+    if (num >= WORD_SIZE && word_aligned(p1) && word_aligned(p2)) {
+        const word_t *w1 = (const word_t *) p1;
+        const word_t *w2 = (const word_t *) p2;
+
+        while (num >= WORD_SIZE && *w1 == *w2) {
+            w1++;
+            w2++;
+            num -= WORD_SIZE;
+        }
+
+        p1 = (const unsigned char *) w1;
+        p2 = (const unsigned char *) w2;
+    }
+
     while (num--) {
         if (*p1 != *p2) {
             if (*p1 > *p2) {
@@ -62,26 +196,48 @@ int memcmp(const void *ptr1, const void *ptr2, size_t num) {
 
 /* Set size bytes to value from p */
 void memset32(void *p, int32_t value, uint32_t size) {
-    uint32_t *end = (uint32_t *) ((uintptr_t) p + size);
+    word_t *d = p;
 
     /* Disallowed unaligned addresses */
     if ( (uintptr_t) p % 4 ) {
         panic_print("Attempt to memset unaligned address (0x%x).", p);
     }
 
-    while ( (uint32_t*) p < end ) {
-        *((uint32_t*)p) = value;
-        p++;
+    d = fill_blocks(d, value, size / BLOCK_SIZE);
+    size %= BLOCK_SIZE;
+
+    while (size >= WORD_SIZE) {
+        *d++ = value;
+        size -= WORD_SIZE;
     }
 }
 
 /* Set size bytes to value from p */
 void memset(void *p, uint8_t value, uint32_t size) {
-    uint8_t *end = (uint8_t *) ((uintptr_t) p + size);
+    uint8_t *d = p;
 
-    while ( (uint8_t*) p < end ) {
-        *((uint8_t*)p) = value;
-        p++;
+    if (size >= 2*WORD_SIZE) {
+        uint32_t word = value * ONES;
+        word_t *w;
+
+        while (!word_aligned(d)) {
+            *d++ = value;
+            size--;
+        }
+
+        w = fill_blocks((word_t *) d, word, size / BLOCK_SIZE);
+        size %= BLOCK_SIZE;
+
+        while (size >= WORD_SIZE) {
+            *w++ = word;
+            size -= WORD_SIZE;
+        }
+
+        d = (uint8_t *) w;
+    }
+
+    while (size--) {
+        *d++ = value;
     }
 }
 
@@ -89,19 +245,95 @@ void memcpy(void *dst, const void *src, int n) {
     const uint8_t *s = src;
     uint8_t *d = dst;
 
-    while(n--) {
+    if (n >= (int) (2*WORD_SIZE)) {
+        word_t *wd;
+
+        /* Align the destination, stores are always whole words */
+        while (!word_aligned(d)) {
+            *d++ = *s++;
+            n--;
+        }
+
+        wd = (word_t *) d;
+
+        if (word_aligned(s)) {
+            const word_t *ws = (const word_t *) s;
+
+            copy_blocks(&wd, &ws, n / BLOCK_SIZE);
+            n %= BLOCK_SIZE;
+
+            while (n >= (int) WORD_SIZE) {
+                *wd++ = *ws++;
+                n -= WORD_SIZE;
+            }
+
+            s = (const uint8_t *) ws;
+        }
+        else {
+            /* Load aligned source words, and shift them into place */
+            uint32_t offset = (uintptr_t) s & WORD_MASK;
+            uint32_t shift = 8 * offset;
+            const word_t *ws = (const word_t *) (s - offset);
+            uint32_t cur = *ws++;
+
+            while (n >= (int) WORD_SIZE) {
+                uint32_t next = *ws++;
+
+                *wd++ = MERGE(cur, next, shift);
+                cur = next;
+                n -= WORD_SIZE;
+            }
+
+            s = (const uint8_t *) ws - WORD_SIZE + offset;
+        }
+
+        d = (uint8_t *) wd;
+    }
+
+    while (n-- > 0) {
         *d++ = *s++;
     }
 }
 
 // Overlap-safe memcpy
 void memmove(void *dst, const void *src, size_t n) {
-    const char *s = src;
-    char *d = dst;
-    if ((uintptr_t)s < (uintptr_t)d)
-        while(n--) d[n] = s[n];
-    else
-        while(n--) *d++ = *s++;
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+
+    /* Copying forward is safe unless the source lies just below dst */
+    if ((uintptr_t) d <= (uintptr_t) s || (uintptr_t) d >= (uintptr_t) s + n) {
+        memcpy(d, s, n);
+        return;
+    }
+
+    s += n;
+    d += n;
+
+    /* Words backward from the end, when both ends align together */
+    if (n >= 2*WORD_SIZE && ((uintptr_t) s & WORD_MASK) == ((uintptr_t) d & WORD_MASK)) {
+        const word_t *ws;
+        word_t *wd;
+
+        while (!word_aligned(d)) {
+            *--d = *--s;
+            n--;
+        }
+
+        ws = (const word_t *) s;
+        wd = (word_t *) d;
+
+        while (n >= WORD_SIZE) {
+            *--wd = *--ws;
+            n -= WORD_SIZE;
+        }
+
+        s = (const uint8_t *) ws;
+        d = (uint8_t *) wd;
+    }
+
+    while (n--) {
+        *--d = *--s;
+    }
 }
 
 char *strchr(const char *s, int c) {
@@ -117,11 +349,28 @@ char *strchr(const char *s, int c) {
 }
 
 size_t strlen(const char *s) {
-    size_t len = 0;
-    while (*s++) {
-        len++;
+    const char *p = s;
+    const word_t *w;
+
+    while (!word_aligned(p)) {
+        if (!*p) {
+            return p - s;
+        }
+        p++;
     }
-    return len;
+
+    /* Find the word containing the terminator */
+    w = (const word_t *) p;
+    while (!HAS_ZERO(*w)) {
+        w++;
+    }
+
+    p = (const char *) w;
+    while (*p) {
+        p++;
+    }
+
+    return p - s;
 }
 
 size_t strnlen(const char *s, int n) {
@@ -184,6 +433,21 @@ int strncmp(const char *s, const char *p, uint32_t n) {
     }
 }
 
+/*
+ * 32-bit FNV-1a.  Zero is reserved to mean "not yet hashed", so a string
+ * which happens to hash to zero is given 1 instead.
+ */
+uint32_t strhash(const char *s) {
+    uint32_t hash = 2166136261u;
+
+    while (*s) {
+        hash ^= (uint8_t) *s++;
+        hash *= 16777619u;
+    }
+
+    return hash ? hash : 1;
+}
+
 char *strncpy(char *destination, const char *source, int num) {
     char *ret = destination;
 
@@ -27,12 +27,7 @@
 volatile uint32_t system_ticks = 0;
 
 int usleep(uint32_t usecs) {
-    uint64_t start = system_time(0);
-
-    while (system_time(start) < usecs) {
-        yield_if_possible();
-    }
-
+    task_sleep(usecs);
     return 0;
 }
 
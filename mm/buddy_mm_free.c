@@ -29,13 +29,28 @@
 #include <mm/mm.h>
 #include "buddy_mm_internals.h"
 
+#ifdef CONFIG_MM_PROFILING
+#include <dev/hw/perfcounter.h>
+uint64_t begin_free_timestamp, end_free_timestamp;
+#endif
+
 static void buddy_merge(struct heapnode *node, struct buddy *buddy) __attribute__((section(".kernel")));
 
 void free(void *address) {
     struct heapnode *node = (struct heapnode *) ((uint8_t *) address - MM_HEADER_SIZE);
 
     acquire(&user_buddy.mutex);
+
+#ifdef CONFIG_MM_PROFILING
+    begin_free_timestamp = perfcounter_getcount();
+#endif
+
     buddy_merge(node, &user_buddy);
+
+#ifdef CONFIG_MM_PROFILING
+    end_free_timestamp = perfcounter_getcount();
+#endif
+
     release(&user_buddy.mutex);
 }
 
@@ -47,101 +62,51 @@ void kfree(void *address) {
     release(&kernel_buddy.mutex);
 }
 
+/*
+ * Each step up an order checks the buddy's header to see if it is free,
+ * then unlinks it from its doubly linked list, so merging is O(max_order),
+ * regardless of how many nodes are free.
+ */
 void buddy_merge(struct heapnode *node, struct buddy *buddy) {
     if (node->header.magic != MM_MAGIC) {
         fprintf(stderr, "OOPS: mm: attempted to merge invalid node 0x%x\r\n", node);
         return;
     }
 
-    uint8_t order = node->header.order;
-
-    /* There is only one node of maximum size */
-    if (order == buddy->max_order) {
-        buddy->list[buddy->max_order] = node;
-        node->next = NULL;
+    if (node->header.free) {
+        fprintf(stderr, "OOPS: mm: attempted to free free node 0x%x\r\n", node);
         return;
     }
 
-    /* Our buddy node covers the other half of this order of memory,
-     * thus it will have the order bit in the opposite state of ours.
-     * Note: this is not necessarily free */
-    struct heapnode *buddy_node = (struct heapnode *) ((uintptr_t) node ^ (1 << order));
-    struct heapnode *curr_node = buddy->list[order];
-    struct heapnode *prev_node = NULL;
-
-    /* Look for node and buddy */
-    uint8_t found = 0;
-    struct heapnode *node_curr_node = NULL;
-    struct heapnode *node_prev_node = NULL;
-    struct heapnode *buddy_curr_node = NULL;
-    struct heapnode *buddy_prev_node = NULL;
-    while (found < 2 && curr_node != NULL) {
-        if (curr_node == node) {
-            node_curr_node = curr_node;
-            node_prev_node = prev_node;
-            found += 1;
-        }
-        else if (curr_node == buddy_node) {
-            buddy_curr_node = curr_node;
-            buddy_prev_node = prev_node;
-            found += 1;
-        }
-
-        prev_node = curr_node;
-        curr_node = curr_node->next;
-    }
+    uint8_t order = node->header.order;
 
+    while (order < buddy->max_order) {
+        /* Our buddy node covers the other half of this order of memory,
+         * thus it will have the order bit in the opposite state of ours.
+         * There is always a node header there, though the buddy may be
+         * split into smaller nodes, so check its order as well. */
+        struct heapnode *buddy_node = (struct heapnode *) ((uintptr_t) node ^ (1 << order));
 
-    /* Buddy not free */
-    if (buddy_curr_node == NULL) {
-        /* If node already in list, leave it,
-         * otherwise add it */
-        if (node_curr_node == NULL) {
-            node->next = buddy->list[order];
-            buddy->list[order] = node;
-        }
-        return;
-    }
-    else {  /* Buddy free */
-        if (buddy_node->header.order != order) {
-            panic_print("mm: node->header.order != buddy_node->header.order, "
-                        "node: 0x%x node->header.order: %d buddy_node: 0x%x, "
-                        "buddy_node->header.order: %d", node, node->header.order,
-                        buddy_node, buddy_node->header.order);
+        if (buddy_node->header.magic != MM_MAGIC) {
+            panic_print("mm: buddy node 0x%x of node 0x%x has invalid magic 0x%x",
+                        buddy_node, node, buddy_node->header.magic);
         }
 
-        /* Remove buddy from list */
-        if (buddy_prev_node == NULL) {
-            buddy->list[order] = buddy_curr_node->next;
-        }
-        else {
-            buddy_prev_node->next = buddy_curr_node->next;
+        /* Buddy not free */
+        if (!buddy_node->header.free || buddy_node->header.order != order) {
+            break;
         }
 
-        /* Remove node if found */
-        if (node_curr_node != NULL) {
-            /* Remove node from list */
-            if (node_prev_node == NULL) {
-                buddy->list[order] = node_curr_node->next;
-            }
-            else {
-                node_prev_node->next = node_curr_node->next;
-            }
-        }
+        buddy_list_remove(buddy_node, buddy);
 
         /* Set parent node as the less of the two buddies */
-        node = node < buddy_curr_node ? node : buddy_curr_node;
+        node = node < buddy_node ? node : buddy_node;
 
         /* Merge the nodes simply by increasing the order
          * of the smaller node. */
-        uint8_t new_order = order + 1;
-        node->header.order = new_order;
-
-        /* Put on higher order list */
-        node->next = buddy->list[new_order];
-        buddy->list[new_order] = node;
-
-        /* Recurse */
-        buddy_merge(node, buddy);
+        order++;
+        node->header.order = order;
     }
+
+    buddy_list_add(node, buddy);
 }
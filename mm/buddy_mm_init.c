@@ -53,12 +53,12 @@ void init_heap(void) {
 }
 
 static void init_buddy(struct buddy *buddy, void *address) {
-    for (int i = 0; i < buddy->max_order; i++) {
+    for (int i = 0; i <= buddy->max_order; i++) {
         buddy->list[i] = NULL;
     }
 
-    buddy->list[buddy->max_order] = (struct heapnode *) address;
-    buddy->list[buddy->max_order]->header.magic = MM_MAGIC;
-    buddy->list[buddy->max_order]->header.order = buddy->max_order;
-    buddy->list[buddy->max_order]->next = NULL;
+    struct heapnode *node = (struct heapnode *) address;
+    node->header.magic = MM_MAGIC;
+    node->header.order = buddy->max_order;
+    buddy_list_add(node, buddy);
 }
@@ -30,13 +30,18 @@
 struct heapnode_header {
     uint16_t magic;
     uint8_t order;
-    uint8_t padding;    /* Tasks won't take kindly to */
-                        /* getting unaligned addresses */
+    uint8_t free;       /* Node is in a free list.  Also keeps */
+                        /* addresses aligned for tasks. */
 } __attribute__((packed));
 
+/*
+ * Free nodes are doubly linked, so that a buddy found free by its header
+ * can be unlinked from its list without a search.
+ */
 struct heapnode {
     struct heapnode_header header;
     struct heapnode *next;
+    struct heapnode *prev;
 } __attribute__((packed));
 
 struct buddy {
@@ -56,4 +61,36 @@ extern struct heapnode *user_buddy_list[];
 extern struct buddy kernel_buddy;
 extern struct heapnode *kernel_buddy_list[];
 
+static inline void buddy_list_add(struct heapnode *node, struct buddy *buddy) {
+    uint8_t order = node->header.order;
+
+    node->header.free = 1;
+    node->prev = NULL;
+    node->next = buddy->list[order];
+
+    if (node->next) {
+        node->next->prev = node;
+    }
+
+    buddy->list[order] = node;
+}
+
+static inline void buddy_list_remove(struct heapnode *node,
+                                     struct buddy *buddy) {
+    if (node->prev) {
+        node->prev->next = node->next;
+    }
+    else {
+        buddy->list[node->header.order] = node->next;
+    }
+
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+
+    node->header.free = 0;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
 #endif
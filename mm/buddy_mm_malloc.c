@@ -83,30 +83,21 @@ void *alloc(uint8_t order, struct buddy *buddy) {
         return NULL;
     }
 
-    /* Node available in this list */
-    if (buddy->list[order] != NULL) {
-        node = buddy->list[order];
-        buddy->list[order] = buddy->list[order]->next;
-    }
-    else {
-        uint8_t new_order = order;
-
-        /* Find list with available nodes */
-        while (node == NULL && (new_order+1) <= buddy->max_order) {
-            node = buddy->list[++new_order];
-        }
-
-        if (node == NULL) {
+    /* Find smallest list with available nodes */
+    uint8_t new_order = order;
+    while (buddy->list[new_order] == NULL) {
+        if (++new_order > buddy->max_order) {
             return NULL;
         }
+    }
 
-        buddy->list[new_order] = buddy->list[new_order]->next;
+    node = buddy->list[new_order];
+    buddy_list_remove(node, buddy);
 
-        /* Split nodes down to size */
-        while (new_order > order) {
-            node = buddy_split(node, buddy);
-            new_order--;
-        }
+    /* Split nodes down to size */
+    while (new_order > order) {
+        node = buddy_split(node, buddy);
+        new_order--;
     }
 
     if (node->header.magic != MM_MAGIC) {
@@ -138,11 +129,9 @@ static struct heapnode *buddy_split(struct heapnode *node, struct buddy *buddy)
 
     split_node->header.magic = MM_MAGIC;
     split_node->header.order = new_order;
-    split_node->next = buddy->list[new_order];
-    buddy->list[new_order] = split_node;
+    buddy_list_add(split_node, buddy);
 
     node->header.order = new_order;
-    node->next = NULL;
 
     return node;
 }
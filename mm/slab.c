@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <list.h>
+#include <kernel/fault.h>
+#include <kernel/mutex.h>
+#include <mm/mm.h>
+#include <mm/slab.h>
+
+/* Header at the start of each slab, followed by its objects */
+struct slab {
+    struct slab *next;
+};
+
+/*
+ * Leave room for the heap's own block header, so that a slab fills a heap
+ * block, rather than rounding up to the next one.
+ */
+#define SLAB_HEAP_OVERHEAD  16
+#define SLAB_SIZE           (CONFIG_MM_SLAB_SIZE - SLAB_HEAP_OVERHEAD)
+
+/* Objects are word aligned, matching the heap */
+#define SLAB_ALIGN          sizeof(void *)
+
+static struct list slab_caches = INIT_LIST(slab_caches);
+static struct mutex slab_caches_lock = INIT_MUTEX;
+
+void slab_cache_init(struct slab_cache *cache, const char *name, size_t size,
+                     uint32_t flags, void (*ctor)(void *)) {
+    cache->name = name;
+    cache->obj_size = size;
+    cache->flags = flags;
+    cache->ctor = ctor;
+    cache->free_list = NULL;
+    cache->slabs = NULL;
+    init_mutex(&cache->lock);
+    list_init(&cache->list);
+    cache->stats = (struct slab_stats) { 0 };
+}
+
+/* Size of each object in the slab, which must be able to hold a free list link */
+static size_t slab_obj_size(struct slab_cache *cache) {
+    size_t size = cache->obj_size;
+
+    if (size < sizeof(void *)) {
+        size = sizeof(void *);
+    }
+
+    return (size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+}
+
+/* Add a slab of free objects to the cache.  Cache must be locked. */
+static int slab_grow(struct slab_cache *cache) {
+    size_t size = slab_obj_size(cache);
+    uint32_t count = (SLAB_SIZE - sizeof(struct slab)) / size;
+    struct slab *slab;
+    uint8_t *obj;
+
+    /* Objects larger than a slab get a slab each */
+    if (!count) {
+        count = 1;
+    }
+
+    if (cache->flags & SLAB_KERNEL) {
+        slab = kmalloc(sizeof(struct slab) + count * size);
+    }
+    else {
+        slab = malloc(sizeof(struct slab) + count * size);
+    }
+
+    if (!slab) {
+        return -1;
+    }
+
+    slab->next = cache->slabs;
+    cache->slabs = slab;
+
+    obj = (uint8_t *) (slab + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        *(void **) obj = cache->free_list;
+        cache->free_list = obj;
+        obj += size;
+    }
+
+    /* Make the cache visible once it holds memory */
+    if (!cache->stats.slabs) {
+        acquire(&slab_caches_lock);
+        list_add_tail(&cache->list, &slab_caches);
+        release(&slab_caches_lock);
+    }
+
+    cache->stats.slabs++;
+    cache->stats.objects += count;
+
+    return 0;
+}
+
+void *slab_alloc(struct slab_cache *cache) {
+    void *obj;
+
+    acquire(&cache->lock);
+
+    if (!cache->free_list && slab_grow(cache)) {
+        cache->stats.failures++;
+        release(&cache->lock);
+        return NULL;
+    }
+
+    obj = cache->free_list;
+    cache->free_list = *(void **) obj;
+
+    cache->stats.in_use++;
+    if (cache->stats.in_use > cache->stats.peak) {
+        cache->stats.peak = cache->stats.in_use;
+    }
+
+    release(&cache->lock);
+
+    if (cache->ctor) {
+        cache->ctor(obj);
+    }
+
+    return obj;
+}
+
+void slab_free(struct slab_cache *cache, void *obj) {
+    if (!obj) {
+        return;
+    }
+
+    acquire(&cache->lock);
+
+    WARN_ON(!cache->stats.in_use);
+
+    *(void **) obj = cache->free_list;
+    cache->free_list = obj;
+    cache->stats.in_use--;
+
+    release(&cache->lock);
+}
+
+struct slab_cache *slab_cache_next(struct slab_cache *prev) {
+    struct list *next = prev ? prev->list.next : slab_caches.next;
+
+    if (next == &slab_caches) {
+        return NULL;
+    }
+
+    return list_entry(next, struct slab_cache, list);
+}
+
+void slab_cache_stats(struct slab_cache *cache, struct slab_stats *stats) {
+    acquire(&cache->lock);
+    *stats = cache->stats;
+    release(&cache->lock);
+}
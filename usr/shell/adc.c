@@ -50,9 +50,52 @@ struct adc *get_adc(int gpio_num) {
     return to_adc(adc_obj);
 }
 
+/* Print the mean of each channel over one second of streamed blocks */
+static void adc_stream(struct adc *adc, uint32_t rate) {
+    struct adc_ops *ops = (struct adc_ops *) adc->obj.ops;
+    uint32_t frames = rate / 10 ? rate / 10 : 1;
+
+    if (!ops->stream_start || ops->stream_start(adc, rate, frames)) {
+        printf("Unable to start stream\r\n");
+        return;
+    }
+
+    for (int n = 0; n < 10; n++) {
+        struct adc_block block;
+
+        if (ops->stream_read(adc, &block, 1000000)) {
+            printf("Stream read failed\r\n");
+            break;
+        }
+
+        for (uint32_t i = 0; i < block.channels; i++) {
+            uint32_t sum = 0;
+
+            for (uint32_t f = 0; f < block.frames; f++) {
+                sum += block.samples[f * block.channels + i];
+            }
+
+            printf("%u\t", sum / block.frames);
+        }
+
+        printf("(%u overruns)\r\n", block.overruns);
+    }
+
+    ops->stream_stop(adc);
+}
+
 void adc(int argc, char **argv) {
+    const char *name = argv[0];
+    uint32_t rate = 0;
+
+    if (argc >= 3 && !strncmp(argv[1], "-s", 3)) {
+        rate = atoi(argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc < 2) {
-        printf("%s gpio_num1 [gpio_num2 ...]\r\n", argv[0]);
+        printf("%s [-s rate] gpio_num1 [gpio_num2 ...]\r\n", name);
         return;
     }
 
@@ -70,6 +113,17 @@ void adc(int argc, char **argv) {
         }
     }
 
+    if (rate) {
+        /* Initialize every channel, so they all join the scan */
+        for (int i = 0; i < argc; i++) {
+            struct adc_ops *ops = (struct adc_ops *) adc[i]->obj.ops;
+            ops->init(adc[i]);
+        }
+
+        adc_stream(adc[0], rate);
+        goto out;
+    }
+
     printf("Press any key to read, 'q' to quit\r\n");
 
     while (getc() != 'q') {
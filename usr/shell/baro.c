@@ -73,7 +73,8 @@ void baro(int argc, char **argv) {
                     printf("Temp: %fC\t", data.temperature);
                 }
 
-                printf("Pressure: %fPa\r\n", data.pressure);
+                printf("Pressure: %fPa\tReading: %u\r\n", data.pressure,
+                       data.sequence);
             }
             else {
                 printf("Unable to read barometer.\r\n");
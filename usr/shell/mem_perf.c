@@ -29,6 +29,55 @@
 
 #define ITERATIONS 10
 
+/* Maximum number of free fragments for free benchmark */
+#define MAX_FRAGMENTS   64
+
+static void *fragments[2*MAX_FRAGMENTS];
+
+/*
+ * Time free() with increasing numbers of unmergeable free blocks of the
+ * same order.  Free used to search the free list for the block's buddy,
+ * taking time proportional to the number of free blocks, but now checks
+ * the buddy's header, taking constant time at each order.
+ */
+static void free_perf(void) {
+    printf("Free with fragmentation\r\n");
+
+    for (int frags = 0; frags <= MAX_FRAGMENTS; frags = frags ? 2*frags : 1) {
+        uint32_t total = 0;
+
+        for (int i = 0; i < 2*MAX_FRAGMENTS; i++) {
+            fragments[i] = malloc(1);
+        }
+
+        /* Free every other block, so no free block's buddy is free */
+        for (int i = 0; i < 2*frags; i += 2) {
+            free(fragments[i]);
+            fragments[i] = NULL;
+        }
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            void *probe = malloc(1);
+            if (!probe) {
+                printf("Warning: no memory available\r\n");
+                continue;
+            }
+
+            free(probe);
+            total += (uint32_t)(end_free_timestamp - begin_free_timestamp);
+        }
+
+        printf("--%d free blocks: average %u cycles\r\n", frags,
+               total/ITERATIONS);
+
+        for (int i = 0; i < 2*MAX_FRAGMENTS; i++) {
+            if (fragments[i]) {
+                free(fragments[i]);
+            }
+        }
+    }
+}
+
 void mem_perf(int argc, char **argv) {
     uint32_t times[ITERATIONS];
     uint32_t total;
@@ -56,5 +105,7 @@ void mem_perf(int argc, char **argv) {
         }
         printf("--Average time %fus\r\n", (total/((float)ITERATIONS))/(CONFIG_SYS_CLOCK/1e6));
     }
+
+    free_perf();
 }
 DEFINE_APP(mem_perf)
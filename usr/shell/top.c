@@ -24,11 +24,31 @@
 #include <stdio.h>
 #include <kernel/mutex.h>
 #include <mm/mm.h>
+#include <mm/slab.h>
 #include "app.h"
 
 /* Display memory usage */
 void top(int argc, char **argv) {
     printf("User free memory: %d bytes\r\n", mm_space());
     printf("Kernel free memory: %d bytes\r\n", mm_kspace());
+
+    printf("Slab caches:\r\n");
+
+    for (struct slab_cache *cache = slab_cache_next(NULL); cache;
+            cache = slab_cache_next(cache)) {
+        struct slab_stats stats;
+
+        slab_cache_stats(cache, &stats);
+
+        printf("\t%s: %u/%u objects of %u bytes in use, peak %u, "
+               "%u slabs", cache->name, stats.in_use, stats.objects,
+               cache->obj_size, stats.peak, stats.slabs);
+
+        if (stats.failures) {
+            printf(", %u failed allocations", stats.failures);
+        }
+
+        printf("\r\n");
+    }
 }
 DEFINE_APP(top)
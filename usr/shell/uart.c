@@ -35,6 +35,7 @@ void uart(int argc, char **argv) {
     struct uart *uart;
     struct uart_ops *ops;
     struct char_device *dev;
+    struct uart_stats stats;
     int baud;
 
     if (argc < 2 || argc > 3) {
@@ -68,6 +69,11 @@ void uart(int argc, char **argv) {
 
     printf("Communicating at baud: %d\r\n", baud);
 
+    if (ops->get_stats && !ops->get_stats(uart, &stats)) {
+        printf("RX dropped: %u bytes, overruns: %u\r\n", stats.rx_dropped,
+               stats.rx_overruns);
+    }
+
     dev = char_device_cast(&uart->obj);
     if (!dev) {
         fprintf(stderr, "Failed to cast uart to char_device\r\n");
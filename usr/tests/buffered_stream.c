@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <dev/buf_stream.h>
+#include <dev/buffered_stream.h>
+#include <dev/char.h>
+#include "test.h"
+
+#define BUF_LEN         64
+#define STREAM_BUF_LEN  16
+
+/*
+ * Write through a buffered stream into a buffer stream, checking what has
+ * reached the buffer at each step.
+ */
+static int buffered_stream_check(char *message, int len,
+                                 enum stream_buffering mode,
+                                 const char *after_partial,
+                                 const char *after_newline) {
+    char buf[BUF_LEN] = "";
+    struct char_device *raw, *stream;
+    int ret = FAILED;
+
+    raw = buf_stream_create(buf, BUF_LEN);
+    if (!raw) {
+        strncpy(message, "Unable to open buf stream", len);
+        goto out;
+    }
+
+    stream = buffered_stream_create(raw, mode, STREAM_BUF_LEN);
+    if (!stream) {
+        strncpy(message, "Unable to create buffered stream", len);
+        goto out_put_raw;
+    }
+
+    if (fputs(stream, "abc") != 3 || strcmp(buf, after_partial)) {
+        strncpy(message, "Wrong contents after partial line", len);
+        goto out_put;
+    }
+
+    if (fputs(stream, "d\n") != 2 || strcmp(buf, after_newline)) {
+        strncpy(message, "Wrong contents after newline", len);
+        goto out_put;
+    }
+
+    if (fflush(stream) || strcmp(buf, "abcd\n")) {
+        strncpy(message, "Wrong contents after flush", len);
+        goto out_put;
+    }
+
+    ret = PASSED;
+
+out_put:
+    obj_put(&stream->obj);
+out_put_raw:
+    obj_put(&raw->obj);
+out:
+    return ret;
+}
+
+static int buffered_stream_unbuffered_test(char *message, int len) {
+    return buffered_stream_check(message, len, STREAM_UNBUFFERED,
+                                 "abc", "abcd\n");
+}
+DEFINE_TEST("Buffered stream unbuffered", buffered_stream_unbuffered_test);
+
+static int buffered_stream_line_test(char *message, int len) {
+    return buffered_stream_check(message, len, STREAM_LINE_BUFFERED,
+                                 "", "abcd\n");
+}
+DEFINE_TEST("Buffered stream line buffered", buffered_stream_line_test);
+
+static int buffered_stream_full_test(char *message, int len) {
+    return buffered_stream_check(message, len, STREAM_FULLY_BUFFERED,
+                                 "", "");
+}
+DEFINE_TEST("Buffered stream fully buffered", buffered_stream_full_test);
+
+/* Filling the buffer writes it out, and ordering is kept */
+static int buffered_stream_overflow_test(char *message, int len) {
+    char buf[BUF_LEN] = "";
+    char expected[BUF_LEN] = "";
+    struct char_device *raw, *stream;
+    int ret = FAILED;
+
+    raw = buf_stream_create(buf, BUF_LEN);
+    if (!raw) {
+        strncpy(message, "Unable to open buf stream", len);
+        goto out;
+    }
+
+    stream = buffered_stream_create(raw, STREAM_FULLY_BUFFERED,
+                                    STREAM_BUF_LEN);
+    if (!stream) {
+        strncpy(message, "Unable to create buffered stream", len);
+        goto out_put_raw;
+    }
+
+    /* Small writes filling the buffer, then one larger than it */
+    for (int i = 0; i < STREAM_BUF_LEN + 2; i++) {
+        fputc(stream, 'a' + i);
+        expected[i] = 'a' + i;
+    }
+    fputs(stream, "0123456789ABCDEFGHIJ");
+    strncpy(&expected[STREAM_BUF_LEN + 2], "0123456789ABCDEFGHIJ",
+            BUF_LEN - STREAM_BUF_LEN - 2);
+
+    if (strncmp(buf, expected, BUF_LEN)) {
+        strncpy(message, "Buffer written out of order", len);
+        goto out_put;
+    }
+
+    ret = PASSED;
+
+out_put:
+    obj_put(&stream->obj);
+out_put_raw:
+    obj_put(&raw->obj);
+out:
+    return ret;
+}
+DEFINE_TEST("Buffered stream overflow", buffered_stream_overflow_test);
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <kernel/collection.h>
+#include <kernel/hash_index.h>
+#include <kernel/obj.h>
+#include "test.h"
+
+/* Enough members to grow the index past its initial size a few times */
+#define COLLECTION_TEST_SIZE    40
+
+static char names[COLLECTION_TEST_SIZE][8];
+static struct obj objs[COLLECTION_TEST_SIZE];
+static uint8_t added[COLLECTION_TEST_SIZE];
+
+static int collection_lookup_test(char *message, int len) {
+    struct collection c;
+    struct obj dup;
+    int ret = PASSED;
+
+    init_collection(&c);
+
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        snprintf(names[i], sizeof(names[i]), "obj%d", i);
+        obj_init(&objs[i], NULL, names[i]);
+        collection_add(&c, &objs[i]);
+        added[i] = 1;
+    }
+
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        if (collection_get_by_name(&c, names[i]) != &objs[i]) {
+            scnprintf(message, len, "Lookup of %s failed", names[i]);
+            ret = FAILED;
+            goto out;
+        }
+    }
+
+    if (collection_get_by_name(&c, "obj") ||
+            collection_get_by_name(&c, "obj400")) {
+        strncpy(message, "Found nonexistent member", len);
+        ret = FAILED;
+        goto out;
+    }
+
+    /* The most recently added member wins */
+    obj_init(&dup, NULL, "obj7");
+    collection_add(&c, &dup);
+
+    if (collection_get_by_name(&c, "obj7") != &dup) {
+        strncpy(message, "Newest duplicate not found", len);
+        ret = FAILED;
+        goto out;
+    }
+
+    collection_del(&c, &dup);
+
+    if (collection_get_by_name(&c, "obj7") != &objs[7]) {
+        strncpy(message, "Older duplicate not found", len);
+        ret = FAILED;
+        goto out;
+    }
+
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i += 2) {
+        collection_del(&c, &objs[i]);
+        added[i] = 0;
+    }
+
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        struct obj *expected = (i % 2) ? &objs[i] : NULL;
+
+        if (collection_get_by_name(&c, names[i]) != expected) {
+            scnprintf(message, len, "Bad lookup of %s after removal",
+                      names[i]);
+            ret = FAILED;
+            goto out;
+        }
+    }
+
+out:
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        if (added[i]) {
+            collection_del(&c, &objs[i]);
+            added[i] = 0;
+        }
+    }
+
+    hash_index_destroy(&c.index);
+
+    return ret;
+}
+DEFINE_TEST("Collection name lookup", collection_lookup_test);
+
+/*
+ * A failed rebuild frees the table and zeroes the index, leaving every
+ * member on the list but none indexed.  The next addition must size the
+ * new table from the whole list.
+ */
+static int collection_index_recovery_test(char *message, int len) {
+    struct collection c;
+    int dropped = 2*HASH_INDEX_MIN_SIZE;
+    int ret = PASSED;
+
+    init_collection(&c);
+
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        snprintf(names[i], sizeof(names[i]), "obj%d", i);
+        obj_init(&objs[i], NULL, names[i]);
+    }
+
+    for (int i = 0; i < dropped; i++) {
+        collection_add(&c, &objs[i]);
+        added[i] = 1;
+    }
+
+    /* Leave the index as a failed allocation in a rebuild would */
+    hash_index_destroy(&c.index);
+
+    for (int i = 0; i < dropped; i++) {
+        if (collection_get_by_name(&c, names[i]) != &objs[i]) {
+            scnprintf(message, len, "Lookup of %s without index failed",
+                      names[i]);
+            ret = FAILED;
+            goto out;
+        }
+    }
+
+    for (int i = dropped; i < COLLECTION_TEST_SIZE; i++) {
+        collection_add(&c, &objs[i]);
+        added[i] = 1;
+    }
+
+    if (c.index.count != COLLECTION_TEST_SIZE ||
+            c.index.size < 2*COLLECTION_TEST_SIZE) {
+        scnprintf(message, len, "Rebuilt index has %u entries in %u slots",
+                  c.index.count, c.index.size);
+        ret = FAILED;
+        goto out;
+    }
+
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        if (collection_get_by_name(&c, names[i]) != &objs[i]) {
+            scnprintf(message, len, "Lookup of %s after rebuild failed",
+                      names[i]);
+            ret = FAILED;
+            goto out;
+        }
+    }
+
+out:
+    for (int i = 0; i < COLLECTION_TEST_SIZE; i++) {
+        if (added[i]) {
+            collection_del(&c, &objs[i]);
+            added[i] = 0;
+        }
+    }
+
+    hash_index_destroy(&c.index);
+
+    return ret;
+}
+DEFINE_TEST("Collection index recovery", collection_index_recovery_test);
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libfdt.h>
+#include <dev/fdtparse.h>
+#include "test.h"
+
+/* The indexed lookups must agree with libfdt for every node in the tree */
+
+#define FDTPARSE_TEST_PATH  128
+
+static const char *const fdtparse_test_props[] = {
+    "compatible",
+    "reg",
+    "regs",
+    "interrupts",
+    "interrupt-parent",
+    "status",
+};
+
+/* fdtparse_get_interrupt_parent(), with libfdt alone */
+static int fdtparse_test_interrupt_parent(const void *fdt, int offset) {
+    const fdt32_t *cell;
+    int len;
+
+    do {
+        cell = fdt_getprop(fdt, offset, "interrupt-parent", &len);
+    } while (len < 0 && (offset = fdt_parent_offset(fdt, offset)) >= 0);
+
+    if (len < 0) {
+        return len;
+    }
+
+    if (len < sizeof(fdt32_t)) {
+        return -FDT_ERR_BADPHANDLE;
+    }
+
+    return fdt_node_offset_by_phandle(fdt, fdt32_to_cpu(cell[0]));
+}
+
+static int fdtparse_node_test(const void *fdt, int offset, char *message,
+                              int len) {
+    char expected[FDTPARSE_TEST_PATH];
+    const char *compats, *compat;
+    char *path;
+    int err, compatlen;
+    uint32_t phandle;
+
+    err = fdt_get_path(fdt, offset, expected, sizeof(expected));
+    if (err) {
+        /* Path too long for the test buffer, nothing to compare */
+        return PASSED;
+    }
+
+    path = fdtparse_get_path(fdt, offset);
+    if (!path || strcmp(path, expected)) {
+        scnprintf(message, len, "Bad path for %s", expected);
+        free(path);
+        return FAILED;
+    }
+    free(path);
+
+    if (fdtparse_path_offset(fdt, expected) != offset) {
+        scnprintf(message, len, "Bad offset for %s", expected);
+        return FAILED;
+    }
+
+    if (fdtparse_parent_offset(fdt, offset) !=
+            fdt_parent_offset(fdt, offset)) {
+        scnprintf(message, len, "Bad parent for %s", expected);
+        return FAILED;
+    }
+
+    for (int i = 0; i < ARRAY_LENGTH(fdtparse_test_props); i++) {
+        int len1, len2;
+        const void *prop1 = fdtparse_getprop(fdt, offset,
+                                             fdtparse_test_props[i], &len1);
+        const void *prop2 = fdt_getprop(fdt, offset,
+                                        fdtparse_test_props[i], &len2);
+
+        if (prop1 != prop2 || len1 != len2) {
+            scnprintf(message, len, "Bad %s for %s", fdtparse_test_props[i],
+                      expected);
+            return FAILED;
+        }
+    }
+
+    phandle = fdt_get_phandle(fdt, offset);
+    if (phandle && fdtparse_node_offset_by_phandle(fdt, phandle) != offset) {
+        scnprintf(message, len, "Bad phandle lookup for %s", expected);
+        return FAILED;
+    }
+
+    if (fdtparse_get_interrupt_parent(fdt, offset) !=
+            fdtparse_test_interrupt_parent(fdt, offset)) {
+        scnprintf(message, len, "Bad interrupt parent for %s", expected);
+        return FAILED;
+    }
+
+    compats = fdt_getprop(fdt, offset, "compatible", &compatlen);
+    if (compatlen <= 0) {
+        return PASSED;
+    }
+
+    for (compat = compats; compat;
+         compat = fdtparse_stringlist_next(compats, compat, compatlen)) {
+        if (fdtparse_node_check_compatible(fdt, offset, compat) ||
+                fdtparse_node_offset_by_compatible(fdt, offset, compat) !=
+                fdt_node_offset_by_compatible(fdt, offset, compat)) {
+            scnprintf(message, len, "Bad compatible lookup for %s",
+                      expected);
+            return FAILED;
+        }
+    }
+
+    return PASSED;
+}
+
+static int fdtparse_index_test(char *message, int len) {
+    const void *fdt = fdtparse_get_blob();
+    int offset = 0;
+
+    do {
+        if (fdtparse_node_test(fdt, offset, message, len)) {
+            return FAILED;
+        }
+
+        offset = fdt_next_node(fdt, offset, NULL);
+    } while (offset >= 0);
+
+    if (fdtparse_path_offset(fdt, "/no-such-node") !=
+            fdt_path_offset(fdt, "/no-such-node") ||
+            fdtparse_path_offset(fdt, "no-such-alias") !=
+            fdt_path_offset(fdt, "no-such-alias")) {
+        strncpy(message, "Found nonexistent node", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("FDT index lookups", fdtparse_index_test);
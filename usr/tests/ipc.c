@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <kernel/event.h>
+#include <kernel/msgq.h>
+#include <kernel/sched.h>
+#include <kernel/sem.h>
+#include "test.h"
+
+static struct semaphore sem_test_sem;
+static volatile int sem_waiter_started = 0;
+static volatile int sem_waiter_done = 0;
+
+static void sem_waiter_task(void) {
+    sem_waiter_started = 1;
+    sem_wait(&sem_test_sem, WAIT_FOREVER);
+    sem_waiter_done = 1;
+}
+
+int sem_handoff_test(char *message, int len) {
+    sem_init(&sem_test_sem, 0);
+    sem_waiter_started = 0;
+    sem_waiter_done = 0;
+
+    new_task(&sem_waiter_task, 2, 0);
+
+    while (!sem_waiter_started) {
+        task_sleep(1000);
+    }
+
+    /* The waiter outranks us, so it should run before sem_post() returns */
+    sem_post(&sem_test_sem);
+
+    if (!sem_waiter_done) {
+        strncpy(message, "Waiter did not run on post", len);
+        return FAILED;
+    }
+
+    if (sem_wait(&sem_test_sem, 0) == 0) {
+        strncpy(message, "Post handed to waiter was also counted", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Semaphore handoff", sem_handoff_test);
+
+int sem_timeout_test(char *message, int len) {
+    struct semaphore sem;
+    uint64_t start;
+
+    sem_init(&sem, 1);
+
+    if (sem_wait(&sem, 0)) {
+        strncpy(message, "Failed to take available count", len);
+        return FAILED;
+    }
+
+    start = system_time(0);
+
+    if (sem_wait(&sem, 10000) == 0) {
+        strncpy(message, "Took count from empty semaphore", len);
+        return FAILED;
+    }
+
+    if (system_time(start) < 10000) {
+        strncpy(message, "Wait returned before timeout", len);
+        return FAILED;
+    }
+
+    sem_post(&sem);
+    sem_post(&sem);
+
+    if (sem_wait(&sem, 0) || sem_wait(&sem, 0) || !sem_wait(&sem, 0)) {
+        strncpy(message, "Count incorrect after posts", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Semaphore timeout", sem_timeout_test);
+
+static struct event event_test_ev;
+static volatile int event_waiter_started = 0;
+static volatile uint32_t event_waiter_result = 0;
+
+static void event_waiter_task(void) {
+    event_waiter_started = 1;
+    event_waiter_result = event_wait(&event_test_ev, 0x3,
+                                     EVENT_WAIT_ALL | EVENT_CLEAR,
+                                     WAIT_FOREVER);
+}
+
+int event_flags_test(char *message, int len) {
+    event_init(&event_test_ev);
+    event_waiter_started = 0;
+    event_waiter_result = 0;
+
+    new_task(&event_waiter_task, 2, 0);
+
+    while (!event_waiter_started) {
+        task_sleep(1000);
+    }
+
+    event_set(&event_test_ev, 0x1);
+
+    if (event_waiter_result) {
+        strncpy(message, "Waiter woken with only some flags set", len);
+        return FAILED;
+    }
+
+    event_set(&event_test_ev, 0x2);
+
+    if (event_waiter_result != 0x3) {
+        strncpy(message, "Waiter not woken with all flags set", len);
+        return FAILED;
+    }
+
+    if (event_test_ev.flags) {
+        strncpy(message, "Flags not cleared by waiter", len);
+        return FAILED;
+    }
+
+    event_set(&event_test_ev, 0x4);
+
+    if (event_wait(&event_test_ev, 0x6, EVENT_WAIT_ANY, 0) != 0x4) {
+        strncpy(message, "Any wait did not match", len);
+        return FAILED;
+    }
+
+    if (event_wait(&event_test_ev, 0x8, EVENT_WAIT_ANY, 1000)) {
+        strncpy(message, "Wait for unset flag did not time out", len);
+        return FAILED;
+    }
+
+    event_clear(&event_test_ev, 0x4);
+
+    if (event_test_ev.flags) {
+        strncpy(message, "Flags not cleared", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Event flags", event_flags_test);
+
+static struct msgq *msgq_test_q;
+static volatile int msgq_task_started = 0;
+static volatile int msgq_task_done = 0;
+static volatile uint32_t msgq_task_msg = 0;
+
+/* Sends to a full queue */
+static void msgq_sender_task(void) {
+    uint32_t msg = 3;
+
+    msgq_task_started = 1;
+    msgq_send(msgq_test_q, &msg, WAIT_FOREVER);
+    msgq_task_done = 1;
+}
+
+/* Receives from an empty queue */
+static void msgq_receiver_task(void) {
+    uint32_t msg;
+
+    msgq_task_started = 1;
+    msgq_receive(msgq_test_q, &msg, WAIT_FOREVER);
+    msgq_task_msg = msg;
+    msgq_task_done = 1;
+}
+
+int msgq_test(char *message, int len) {
+    int ret = FAILED;
+    uint32_t msg;
+
+    msgq_test_q = msgq_create("test_msgq", sizeof(uint32_t), 2);
+    if (!msgq_test_q) {
+        strncpy(message, "Unable to create queue", len);
+        return FAILED;
+    }
+
+    msg = 1;
+    msgq_send(msgq_test_q, &msg, 0);
+    msg = 2;
+    msgq_send(msgq_test_q, &msg, 0);
+
+    if (!msgq_send(msgq_test_q, &msg, 0)) {
+        strncpy(message, "Sent to full queue", len);
+        goto out;
+    }
+
+    msgq_task_started = 0;
+    msgq_task_done = 0;
+    new_task(&msgq_sender_task, 2, 0);
+
+    while (!msgq_task_started) {
+        task_sleep(1000);
+    }
+
+    /* Receiving makes room for the blocked sender */
+    if (msgq_receive(msgq_test_q, &msg, 0) || msg != 1) {
+        strncpy(message, "Received wrong message", len);
+        goto out;
+    }
+
+    if (!msgq_task_done) {
+        strncpy(message, "Blocked sender not woken", len);
+        goto out;
+    }
+
+    if (msgq_receive(msgq_test_q, &msg, 0) || msg != 2 ||
+            msgq_receive(msgq_test_q, &msg, 0) || msg != 3) {
+        strncpy(message, "Messages out of order", len);
+        goto out;
+    }
+
+    if (!msgq_receive(msgq_test_q, &msg, 1000)) {
+        strncpy(message, "Received from empty queue", len);
+        goto out;
+    }
+
+    msgq_task_started = 0;
+    msgq_task_done = 0;
+    new_task(&msgq_receiver_task, 2, 0);
+
+    while (!msgq_task_started) {
+        task_sleep(1000);
+    }
+
+    /* Handed directly to the blocked receiver */
+    msg = 42;
+    msgq_send(msgq_test_q, &msg, 0);
+
+    if (!msgq_task_done || msgq_task_msg != 42) {
+        strncpy(message, "Blocked receiver did not get message", len);
+        goto out;
+    }
+
+    ret = PASSED;
+
+out:
+    msgq_put(msgq_test_q);
+    return ret;
+}
+DEFINE_TEST("Message queue", msgq_test);
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mm/mm.h>
+#include <mm/slab.h>
 #include "test.h"
 #include <limits.h>
 
@@ -110,3 +111,81 @@ int kmalloc_toobig(char *message, int len) {
     return PASSED;
 }
 DEFINE_TEST("kmalloc too big", kmalloc_toobig);
+
+struct slab_test_obj {
+    uint32_t    magic;
+    uint8_t     data[13];
+};
+
+static void slab_test_ctor(void *obj) {
+    ((struct slab_test_obj *) obj)->magic = 0xC0FFEE;
+}
+
+static struct slab_cache slab_test_cache =
+    INIT_SLAB_CACHE(slab_test_cache, "test", sizeof(struct slab_test_obj),
+                    0, slab_test_ctor);
+
+#define SLAB_TEST_OBJS  40
+
+int slab_alloc_free(char *message, int len) {
+    struct slab_test_obj *objs[SLAB_TEST_OBJS];
+    struct slab_stats stats;
+    uint32_t slabs;
+
+    /* Enough objects to need several slabs */
+    for (int i = 0; i < SLAB_TEST_OBJS; i++) {
+        objs[i] = slab_alloc(&slab_test_cache);
+        if (!objs[i]) {
+            scnprintf(message, len, "Allocation %d failed", i);
+            return FAILED;
+        }
+
+        if (objs[i]->magic != 0xC0FFEE) {
+            scnprintf(message, len, "Object %d not constructed", i);
+            return FAILED;
+        }
+
+        /* Objects must not overlap */
+        for (int j = 0; j < i; j++) {
+            if (abs((uint8_t *) objs[i] - (uint8_t *) objs[j]) <
+                    sizeof(struct slab_test_obj)) {
+                scnprintf(message, len, "Objects %d and %d overlap", i, j);
+                return FAILED;
+            }
+        }
+    }
+
+    slab_cache_stats(&slab_test_cache, &stats);
+
+    if (stats.in_use != SLAB_TEST_OBJS || stats.slabs < 2) {
+        scnprintf(message, len, "Bad stats: %u in use, %u slabs",
+                  stats.in_use, stats.slabs);
+        return FAILED;
+    }
+
+    slabs = stats.slabs;
+
+    for (int i = 0; i < SLAB_TEST_OBJS; i++) {
+        slab_free(&slab_test_cache, objs[i]);
+    }
+
+    /* Freed objects are reused, rather than growing the cache */
+    for (int i = 0; i < SLAB_TEST_OBJS; i++) {
+        objs[i] = slab_alloc(&slab_test_cache);
+    }
+
+    for (int i = 0; i < SLAB_TEST_OBJS; i++) {
+        slab_free(&slab_test_cache, objs[i]);
+    }
+
+    slab_cache_stats(&slab_test_cache, &stats);
+
+    if (stats.in_use || stats.slabs != slabs) {
+        scnprintf(message, len, "Bad stats after free: %u in use, %u slabs",
+                  stats.in_use, stats.slabs);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Slab alloc/free", slab_alloc_free);
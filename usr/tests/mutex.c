@@ -21,8 +21,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <kernel/mutex.h>
 #include <kernel/reentrant_mutex.h>
+#include <kernel/sched.h>
 #include "test.h"
 
 int reentrant_mutex_basic_test(char *message, int len) {
@@ -67,3 +70,77 @@ int reentrant_mutex_task_test(char *message, int len) {
     return PASSED;
 }
 DEFINE_TEST("Reentrant mutex task", reentrant_mutex_task_test);
+
+static struct mutex pi_mutex = INIT_MUTEX;
+static volatile int pi_low_holding = 0;
+static volatile int pi_low_done = 0;
+static volatile int pi_medium_done = 0;
+static volatile int pi_medium_timed_out = 0;
+static volatile int pi_high_acquired = 0;
+
+/* Holds pi_mutex, then needs the CPU for a while before releasing it */
+static void pi_low_task(void) {
+    uint64_t start;
+
+    acquire(&pi_mutex);
+    pi_low_holding = 1;
+
+    task_sleep(20000);
+
+    start = system_time(0);
+    while (system_time(start) < 5000);
+
+    release(&pi_mutex);
+    pi_low_done = 1;
+}
+
+/* Never yields, starving pi_low_task unless it inherits a higher priority */
+static void pi_medium_task(void) {
+    uint64_t start = system_time(0);
+
+    while (!pi_high_acquired && system_time(start) < 500000);
+
+    /* Without inheritance, high only gets the mutex once we stop */
+    pi_medium_timed_out = !pi_high_acquired;
+    pi_medium_done = 1;
+}
+
+static void pi_high_task(void) {
+    acquire(&pi_mutex);
+    pi_high_acquired = 1;
+    release(&pi_mutex);
+}
+
+/*
+ * Classic priority inversion: a high priority task waits on a mutex held by
+ * a low priority task, while a medium priority task hogs the CPU.  The
+ * holder must inherit the waiter's priority for the waiter to get the mutex.
+ */
+int mutex_priority_inheritance_test(char *message, int len) {
+    pi_low_holding = 0;
+    pi_low_done = 0;
+    pi_medium_done = 0;
+    pi_medium_timed_out = 0;
+    pi_high_acquired = 0;
+
+    new_task(&pi_low_task, 2, 0);
+
+    while (!pi_low_holding) {
+        task_sleep(1000);
+    }
+
+    new_task(&pi_high_task, 4, 0);
+    new_task(&pi_medium_task, 3, 0);
+
+    while (!pi_medium_done || !pi_low_done) {
+        task_sleep(1000);
+    }
+
+    if (!pi_high_acquired || pi_medium_timed_out) {
+        strncpy(message, "Mutex holder did not inherit waiter priority", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Mutex priority inheritance", mutex_priority_inheritance_test);
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dev/hw/perfcounter.h>
+#include <kernel/mutex.h>
+#include <kernel/svc.h>
+#include "test.h"
+
+/* Uncontended mutex cost, as measured by the perfcounter */
+
+#define MUTEX_PERF_ITERATIONS   1000
+
+static struct mutex perf_mutex = INIT_MUTEX;
+
+/*
+ * Compare acquire()/release(), which take the uncontended fast path, with
+ * the kernel path they used to always take, through the service calls.
+ */
+static int mutex_uncontended_perf(char *message, int len) {
+    uint64_t start;
+    uint32_t fast, kernel;
+
+    start = perfcounter_getcount();
+    for (int i = 0; i < MUTEX_PERF_ITERATIONS; i++) {
+        acquire(&perf_mutex);
+        release(&perf_mutex);
+    }
+    fast = (perfcounter_getcount() - start) / MUTEX_PERF_ITERATIONS;
+
+    start = perfcounter_getcount();
+    for (int i = 0; i < MUTEX_PERF_ITERATIONS; i++) {
+        SVC_ARG(SVC_ACQUIRE, &perf_mutex);
+        SVC_ARG(SVC_RELEASE, &perf_mutex);
+    }
+    kernel = (perfcounter_getcount() - start) / MUTEX_PERF_ITERATIONS;
+
+    printf("%u cycles per acquire/release, %u through kernel...",
+           fast, kernel);
+
+    if (fast >= kernel) {
+        strncpy(message, "Fast path no faster than kernel path", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Mutex uncontended performance", mutex_uncontended_perf);
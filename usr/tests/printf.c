@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+
+/* Tests for the printf formatter */
+
+#define PRINTF_TEST_LEN     64
+
+static int printf_check(char *message, int len, const char *fmt,
+                        const char *expected, int ret, const char *buf) {
+    if (strcmp(buf, expected) || ret != strlen(expected)) {
+        /* Don't print buf with the formatter under test */
+        strncpy(message, fmt, len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+
+#define PRINTF_CASE(expected, fmt, args...) do {                            \
+        char buf[PRINTF_TEST_LEN];                                          \
+        int ret = snprintf(buf, sizeof(buf), fmt, ## args);                 \
+        if (printf_check(message, len, fmt, expected, ret, buf)) {          \
+            return FAILED;                                                  \
+        }                                                                   \
+    } while (0)
+
+static int printf_integer_test(char *message, int len) {
+    PRINTF_CASE("42|   42|42   |-0042", "%d|%5d|%-5d|%05d", 42, 42, 42, -42);
+    PRINTF_CASE("+42| 42|007|  -007", "%+d|% d|%.3d|%6.3d", 42, 42, 7, -7);
+    PRINTF_CASE("-2147483648", "%d", INT32_MIN);
+    PRINTF_CASE("4000000000", "%u", 4000000000u);
+    PRINTF_CASE("deadbeef BEEF 0x1f 0", "%x %X %#x %#x", 0xdeadbeef, 0xbeef,
+                0x1f, 0);
+    PRINTF_CASE("10 010 0", "%o %#o %#o", 8, 8, 0);
+    PRINTF_CASE("-1234567890123", "%lld", -1234567890123LL);
+    PRINTF_CASE("18446744073709551615", "%llu", UINT64_MAX);
+    PRINTF_CASE("123456789abc", "%llx", 0x123456789abcULL);
+    PRINTF_CASE("-5 -3 44 77", "%ld %hd %hhu %zu", -5L, -3, 300, (size_t) 77);
+    PRINTF_CASE("|    |", "|%.0d%4.0d|", 0, 0);
+    PRINTF_CASE("0x1234", "%p", (void *) 0x1234);
+
+    return PASSED;
+}
+DEFINE_TEST("printf integer conversions", printf_integer_test);
+
+static int printf_string_test(char *message, int len) {
+    PRINTF_CASE("hi|        hi|hi        |he", "%s|%10s|%-10s|%.2s", "hi",
+                "hi", "hi", "hello");
+    PRINTF_CASE("     3|3     |abc", "%*d|%-*d|%.*s", 6, 3, 6, 3, 3, "abcdef");
+    PRINTF_CASE("ab|  x|y  |%", "%c%c|%3c|%-3c|%%", 'a', 'b', 'x', 'y');
+    PRINTF_CASE("(null)", "%s", NULL);
+    PRINTF_CASE("%q", "%q");
+
+    return PASSED;
+}
+DEFINE_TEST("printf string conversions", printf_string_test);
+
+static int printf_float_test(char *message, int len) {
+    PRINTF_CASE("3.141590 1.50    1.500", "%f %.2f %8.3f", 3.14159, 1.5, 1.5);
+    PRINTF_CASE("-2.5 +3 0 3.", "%.1f %+.0f %.0f %#.0f", -2.5, 2.6, 0.4, 3.0);
+    PRINTF_CASE("0.000000 nan -inf", "%f %f %f", 0.0, 0.0f/0.0f, -1.0f/0.0f);
+    PRINTF_CASE("NAN -INF 1.000000", "%F %F %F", 0.0f/0.0f, -1.0f/0.0f, 1.0);
+    PRINTF_CASE("2 4 0.12 0.38", "%.0f %.0f %.2f %.2f", 2.5, 3.5, 0.125, 0.375);
+
+    return PASSED;
+}
+DEFINE_TEST("printf float conversions", printf_float_test);
+
+static int printf_truncate_test(char *message, int len) {
+    char buf[8];
+    int ret;
+
+    memset(buf, 'x', sizeof(buf));
+
+    ret = snprintf(buf, sizeof(buf), "hello world %d", 5);
+    if (ret != 13 || strcmp(buf, "hello w")) {
+        strncpy(message, "snprintf did not truncate", len);
+        return FAILED;
+    }
+
+    ret = scnprintf(buf, sizeof(buf), "hello world %d", 5);
+    if (ret != 7 || strcmp(buf, "hello w")) {
+        strncpy(message, "scnprintf did not count truncated output", len);
+        return FAILED;
+    }
+
+    ret = scnprintf(buf, 0, "hello");
+    if (ret != 0) {
+        strncpy(message, "scnprintf wrote to empty buffer", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("printf truncation", printf_truncate_test);
+
+struct printf_sink_state {
+    char buf[PRINTF_TEST_LEN];
+    int len;
+    int calls;
+};
+
+static int printf_test_sink(void *arg, const char *buf, int num) {
+    struct printf_sink_state *state = arg;
+
+    if (state->len + num >= sizeof(state->buf)) {
+        return -1;
+    }
+
+    memcpy(&state->buf[state->len], buf, num);
+    state->len += num;
+    state->buf[state->len] = '\0';
+    state->calls++;
+
+    return num;
+}
+
+static int printf_test_cbprintf(struct printf_sink_state *state,
+                                const char *fmt, ...) {
+    va_list ap;
+    int ret;
+
+    va_start(ap, fmt);
+    ret = vcbprintf(printf_test_sink, state, fmt, ap);
+    va_end(ap);
+
+    return ret;
+}
+
+/* A short line is batched into a single call of the sink */
+static int printf_sink_test(char *message, int len) {
+    struct printf_sink_state state = {
+        .len = 0,
+        .calls = 0,
+    };
+    int ret;
+
+    ret = printf_test_cbprintf(&state, "%s %d %x%c", "batched", 42, 0xf4, '!');
+    if (ret != 14 || strcmp(state.buf, "batched 42 f4!")) {
+        strncpy(message, "Sink received incorrect output", len);
+        return FAILED;
+    }
+
+    if (state.calls != 1) {
+        strncpy(message, "Output not batched into one sink call", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("printf sink batching", printf_sink_test);
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dev/hw/pwm.h>
+#include <kernel/class.h>
+#include "test.h"
+
+/*
+ * Fake PWM outputs, not exported, recording what the group functions ask
+ * of their driver.  Two op tables stand in for two drivers.
+ */
+#define PWM_TEST_NUM    (PWM_GROUP_MAX + 1)
+
+struct test_pwm {
+    uint32_t width;
+    int sets;
+    int fail;
+};
+
+static struct obj *test_pwms[PWM_TEST_NUM];
+static struct test_pwm test_state[PWM_TEST_NUM];
+static int commits;
+static uint32_t committed;
+
+static int32_t test_set_pulse_width(struct pwm *pwm, uint32_t width) {
+    struct test_pwm *state = pwm->priv;
+
+    if (state->fail) {
+        return -1;
+    }
+
+    state->width = width;
+    state->sets++;
+
+    return width;
+}
+
+static int test_commit_group(struct pwm_group *group) {
+    commits++;
+    committed = group->staged;
+
+    for (int i = 0; i < group->num; i++) {
+        if (group->staged & ((uint32_t) 1 << i)) {
+            struct test_pwm *state = to_pwm(group->pwms[i])->priv;
+            state->width = group->widths[i];
+        }
+    }
+
+    return 0;
+}
+
+static struct pwm_ops test_group_ops = {
+    .set_pulse_width = test_set_pulse_width,
+    .commit_group = test_commit_group,
+};
+
+/* A second driver, without commit_group */
+static struct pwm_ops test_single_ops = {
+    .set_pulse_width = test_set_pulse_width,
+};
+
+/* Create num fake outputs, those in single_mask from the second driver */
+static int test_pwms_create(int num, uint32_t single_mask) {
+    memset(test_state, 0, sizeof(test_state));
+    commits = 0;
+    committed = 0;
+
+    for (int i = 0; i < num; i++) {
+        void *ops = (single_mask & ((uint32_t) 1 << i)) ?
+                    &test_single_ops : &test_group_ops;
+
+        test_pwms[i] = instantiate("test_pwm", &pwm_class, ops, struct pwm);
+        if (!test_pwms[i]) {
+            return -1;
+        }
+
+        to_pwm(test_pwms[i])->priv = &test_state[i];
+    }
+
+    return 0;
+}
+
+/* The groups' references are gone, so no one else holds these */
+static void test_pwms_destroy(int num) {
+    for (int i = 0; i < num; i++) {
+        if (test_pwms[i]) {
+            class_deinstantiate(test_pwms[i]);
+            test_pwms[i] = NULL;
+        }
+    }
+}
+
+static int pwm_group_args_test(char *message, int len) {
+    struct pwm_group *group;
+    struct obj *bad[2];
+    int ret = FAILED;
+
+    if (test_pwms_create(PWM_TEST_NUM, 0)) {
+        strncpy(message, "Unable to create outputs", len);
+        goto out;
+    }
+
+    if (pwm_group_get(NULL, 1) || pwm_group_get(test_pwms, 0)) {
+        strncpy(message, "Created group without outputs", len);
+        goto out;
+    }
+
+    if (pwm_group_get(test_pwms, PWM_GROUP_MAX + 1)) {
+        strncpy(message, "Created group over PWM_GROUP_MAX", len);
+        goto out;
+    }
+
+    /* Every entry must be a PWM */
+    bad[0] = test_pwms[0];
+    bad[1] = &pwm_class.obj;
+    if (pwm_group_get(bad, 2)) {
+        strncpy(message, "Created group with non-PWM obj", len);
+        goto out;
+    }
+
+    bad[1] = NULL;
+    if (pwm_group_get(bad, 2)) {
+        strncpy(message, "Created group with NULL output", len);
+        goto out;
+    }
+
+    group = pwm_group_get(test_pwms, PWM_GROUP_MAX);
+    if (!group) {
+        strncpy(message, "Unable to create PWM_GROUP_MAX group", len);
+        goto out;
+    }
+
+    if (!pwm_group_set_pulse_width(group, PWM_GROUP_MAX, 100)) {
+        strncpy(message, "Staged output past end of group", len);
+        goto out_put;
+    }
+
+    /* Last output uses the top bit of the staged mask */
+    if (pwm_group_set_pulse_width(group, PWM_GROUP_MAX - 1, 100)) {
+        strncpy(message, "Unable to stage last output", len);
+        goto out_put;
+    }
+
+    if (pwm_group_commit(group) || commits != 1 ||
+            committed != ((uint32_t) 1 << (PWM_GROUP_MAX - 1)) ||
+            test_state[PWM_GROUP_MAX - 1].width != 100) {
+        strncpy(message, "Last output not committed", len);
+        goto out_put;
+    }
+
+    ret = PASSED;
+
+out_put:
+    pwm_group_put(group);
+out:
+    test_pwms_destroy(PWM_TEST_NUM);
+    return ret;
+}
+DEFINE_TEST("PWM group arguments", pwm_group_args_test);
+
+static int pwm_group_staging_test(char *message, int len) {
+    struct pwm_group *group;
+    int ret = FAILED;
+
+    if (test_pwms_create(3, 0)) {
+        strncpy(message, "Unable to create outputs", len);
+        goto out;
+    }
+
+    group = pwm_group_get(test_pwms, 3);
+    if (!group) {
+        strncpy(message, "Unable to create group", len);
+        goto out;
+    }
+
+    /* Nothing staged, nothing to do */
+    if (pwm_group_commit(group) || commits) {
+        strncpy(message, "Empty commit called driver", len);
+        goto out_put;
+    }
+
+    /* Restaging replaces the earlier width */
+    pwm_group_set_pulse_width(group, 0, 1000);
+    pwm_group_set_pulse_width(group, 2, 1500);
+    pwm_group_set_pulse_width(group, 2, 2000);
+
+    if (test_state[0].width || test_state[2].width) {
+        strncpy(message, "Staged width applied before commit", len);
+        goto out_put;
+    }
+
+    if (pwm_group_commit(group)) {
+        strncpy(message, "Commit failed", len);
+        goto out_put;
+    }
+
+    if (commits != 1 || committed != 0x5) {
+        scnprintf(message, len, "Committed 0x%x in %d calls, expected 0x5 "
+                  "in 1", committed, commits);
+        goto out_put;
+    }
+
+    if (test_state[0].width != 1000 || test_state[1].width ||
+            test_state[2].width != 2000) {
+        strncpy(message, "Wrong widths committed", len);
+        goto out_put;
+    }
+
+    /* Commit clears the staged widths */
+    if (group->staged || pwm_group_commit(group) || commits != 1) {
+        strncpy(message, "Widths still staged after commit", len);
+        goto out_put;
+    }
+
+    ret = PASSED;
+
+out_put:
+    pwm_group_put(group);
+out:
+    test_pwms_destroy(3);
+    return ret;
+}
+DEFINE_TEST("PWM group staging", pwm_group_staging_test);
+
+static int pwm_group_mixed_test(char *message, int len) {
+    struct pwm_group *group;
+    int ret = FAILED;
+
+    /* Output 1 is from the driver without commit_group */
+    if (test_pwms_create(3, 0x2)) {
+        strncpy(message, "Unable to create outputs", len);
+        goto out;
+    }
+
+    group = pwm_group_get(test_pwms, 3);
+    if (!group) {
+        strncpy(message, "Unable to create group", len);
+        goto out;
+    }
+
+    if (group->ops) {
+        strncpy(message, "Mixed group has shared ops", len);
+        goto out_put;
+    }
+
+    pwm_group_set_pulse_width(group, 0, 1000);
+    pwm_group_set_pulse_width(group, 1, 1100);
+
+    if (pwm_group_commit(group)) {
+        strncpy(message, "Commit failed", len);
+        goto out_put;
+    }
+
+    /* Each staged output set on its own, none through commit_group */
+    if (commits || test_state[0].sets != 1 || test_state[1].sets != 1 ||
+            test_state[2].sets) {
+        strncpy(message, "Outputs not set one at a time", len);
+        goto out_put;
+    }
+
+    if (test_state[0].width != 1000 || test_state[1].width != 1100) {
+        strncpy(message, "Wrong widths committed", len);
+        goto out_put;
+    }
+
+    /* A failing output reports an error, but the others are still set */
+    test_state[0].fail = 1;
+    pwm_group_set_pulse_width(group, 0, 1200);
+    pwm_group_set_pulse_width(group, 2, 1300);
+
+    if (!pwm_group_commit(group)) {
+        strncpy(message, "Failed output not reported", len);
+        goto out_put;
+    }
+
+    if (test_state[2].width != 1300 || group->staged) {
+        strncpy(message, "Commit stopped at failed output", len);
+        goto out_put;
+    }
+
+    ret = PASSED;
+
+out_put:
+    pwm_group_put(group);
+out:
+    test_pwms_destroy(3);
+    return ret;
+}
+DEFINE_TEST("PWM group mixed drivers", pwm_group_mixed_test);
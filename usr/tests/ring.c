@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <ring.h>
+#include "test.h"
+
+#define RING_TEST_SIZE  16
+
+int ring_wrap_test(char *message, int len) {
+    uint8_t storage[RING_TEST_SIZE];
+    uint8_t in[RING_TEST_SIZE], out[RING_TEST_SIZE];
+    struct ring ring;
+
+    if (!ring_init(&ring, storage, 12)) {
+        strncpy(message, "Accepted non-power of two size", len);
+        return FAILED;
+    }
+
+    ring_init(&ring, storage, RING_TEST_SIZE);
+
+    for (int i = 0; i < RING_TEST_SIZE; i++) {
+        in[i] = i + 1;
+    }
+
+    /* Move the indices partway around, so later copies wrap */
+    for (int offset = 0; offset < RING_TEST_SIZE; offset++) {
+        if (ring_push_n(&ring, in, RING_TEST_SIZE) != RING_TEST_SIZE ||
+                !ring_full(&ring)) {
+            strncpy(message, "Unable to fill ring", len);
+            return FAILED;
+        }
+
+        if (ring_push(&ring, 0) == 0) {
+            strncpy(message, "Pushed to full ring", len);
+            return FAILED;
+        }
+
+        memset(out, 0, sizeof(out));
+
+        if (ring_pop_n(&ring, out, sizeof(out)) != RING_TEST_SIZE ||
+                memcmp(in, out, sizeof(out)) || !ring_empty(&ring)) {
+            strncpy(message, "Data corrupted", len);
+            return FAILED;
+        }
+
+        ring_push(&ring, 0);
+        ring_pop(&ring, &out[0]);
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Ring buffer wraparound", ring_wrap_test);
+
+int ring_span_test(char *message, int len) {
+    uint8_t storage[RING_TEST_SIZE];
+    struct ring ring;
+    uint8_t *span;
+    uint32_t n;
+    uint8_t c;
+
+    ring_init(&ring, storage, RING_TEST_SIZE);
+
+    /* Leave the indices 4 bytes from the end of the buffer */
+    for (int i = 0; i < RING_TEST_SIZE - 4; i++) {
+        ring_push(&ring, 0);
+        ring_pop(&ring, &c);
+    }
+
+    /* Only the bytes up to the end of the buffer are contiguous */
+    n = ring_write_span(&ring, &span);
+    if (n != 4 || span != &storage[RING_TEST_SIZE - 4]) {
+        strncpy(message, "Bad write span", len);
+        return FAILED;
+    }
+
+    memset(span, 'a', n);
+    ring_write_commit(&ring, n);
+
+    n = ring_write_span(&ring, &span);
+    if (n != RING_TEST_SIZE - 4 || span != storage) {
+        strncpy(message, "Bad wrapped write span", len);
+        return FAILED;
+    }
+
+    memset(span, 'b', 2);
+    ring_write_commit(&ring, 2);
+
+    n = ring_read_span(&ring, &span);
+    if (n != 4 || span[0] != 'a' || span[3] != 'a') {
+        strncpy(message, "Bad read span", len);
+        return FAILED;
+    }
+
+    ring_read_commit(&ring, n);
+
+    n = ring_read_span(&ring, &span);
+    if (n != 2 || span[0] != 'b' || span[1] != 'b') {
+        strncpy(message, "Bad wrapped read span", len);
+        return FAILED;
+    }
+
+    ring_flush(&ring);
+
+    if (!ring_empty(&ring) || ring_space(&ring) != RING_TEST_SIZE) {
+        strncpy(message, "Flush did not empty ring", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Ring buffer spans", ring_span_test);
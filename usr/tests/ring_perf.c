@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ring.h>
+#include <dev/hw/perfcounter.h>
+#include "test.h"
+
+/* Ring buffer throughput, as measured by the perfcounter */
+
+#define RING_PERF_SIZE      512
+#define RING_PERF_CHUNK     64
+#define RING_PERF_BYTES     (64*1024)
+
+static uint8_t ring_perf_storage[RING_PERF_SIZE];
+static uint8_t ring_perf_chunk[RING_PERF_CHUNK];
+
+/*
+ * Compare moving data through the ring a chunk at a time, as a driver
+ * moves packets, with moving it a byte at a time.
+ */
+static int ring_throughput_perf(char *message, int len) {
+    struct ring ring;
+    uint64_t start;
+    uint32_t bulk, bytewise;
+
+    ring_init(&ring, ring_perf_storage, RING_PERF_SIZE);
+
+    start = perfcounter_getcount();
+    for (int i = 0; i < RING_PERF_BYTES / RING_PERF_CHUNK; i++) {
+        ring_push_n(&ring, ring_perf_chunk, RING_PERF_CHUNK);
+        ring_pop_n(&ring, ring_perf_chunk, RING_PERF_CHUNK);
+    }
+    bulk = perfcounter_getcount() - start;
+
+    start = perfcounter_getcount();
+    for (int i = 0; i < RING_PERF_BYTES / RING_PERF_CHUNK; i++) {
+        for (int j = 0; j < RING_PERF_CHUNK; j++) {
+            ring_push(&ring, ring_perf_chunk[j]);
+        }
+        for (int j = 0; j < RING_PERF_CHUNK; j++) {
+            ring_pop(&ring, &ring_perf_chunk[j]);
+        }
+    }
+    bytewise = perfcounter_getcount() - start;
+
+    printf("%u cycles per KB in %u byte chunks, %u byte at a time...",
+           bulk / (RING_PERF_BYTES / 1024), RING_PERF_CHUNK,
+           bytewise / (RING_PERF_BYTES / 1024));
+
+    if (bulk >= bytewise) {
+        strncpy(message, "Bulk copies no faster than single bytes", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Ring buffer throughput", ring_throughput_perf);
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <kernel/sched.h>
+#include "test.h"
+
+/* Tests for scheduler behavior */
+
+static volatile uint32_t rr_counts[2];
+static volatile int rr_stop = 0;
+static volatile int rr_done = 0;
+
+static void rr_task(volatile uint32_t *count) {
+    while (!rr_stop) {
+        (*count)++;
+    }
+
+    rr_done++;
+}
+
+static void rr_task1(void) {
+    rr_task(&rr_counts[0]);
+}
+
+static void rr_task2(void) {
+    rr_task(&rr_counts[1]);
+}
+
+/*
+ * Neither task ever yields, so both (and this task) only make progress
+ * if preemption round-robins through the equal priority ready queue.
+ */
+static int round_robin_test(char *message, int len) {
+    uint64_t start;
+
+    rr_counts[0] = rr_counts[1] = 0;
+    rr_stop = 0;
+    rr_done = 0;
+
+    new_task(&rr_task1, 1, 0);
+    new_task(&rr_task2, 1, 0);
+
+    start = system_time(0);
+    while (!(rr_counts[0] && rr_counts[1]) && system_time(start) < 500000);
+
+    rr_stop = 1;
+
+    if (!(rr_counts[0] && rr_counts[1])) {
+        strncpy(message, "Equal priority tasks did not share CPU", len);
+        return FAILED;
+    }
+
+    /* Let the tasks exit before returning */
+    while (rr_done < 2) {
+        yield_if_possible();
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Equal priority round-robin", round_robin_test);
+
+static volatile int high_ran = 0;
+
+static void high_task(void) {
+    high_ran = 1;
+}
+
+/* A higher priority task must preempt a lower priority task that never yields */
+static int priority_preempt_test(char *message, int len) {
+    uint64_t start;
+
+    high_ran = 0;
+
+    new_task(&high_task, 5, 0);
+
+    start = system_time(0);
+    while (!high_ran && system_time(start) < 500000);
+
+    if (!high_ran) {
+        strncpy(message, "Higher priority task never ran", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Higher priority preemption", priority_preempt_test);
+
+static volatile uint32_t low_count = 0;
+static volatile int low_stop = 0;
+static volatile int low_done = 0;
+
+static void low_task(void) {
+    while (!low_stop) {
+        low_count++;
+    }
+
+    low_done = 1;
+}
+
+/*
+ * A sleeping task must leave the ready queue, letting a lower priority
+ * task that never yields run until it wakes.
+ */
+static int blocking_sleep_test(char *message, int len) {
+    uint64_t deadline;
+    int ret = PASSED;
+
+    low_count = 0;
+    low_stop = 0;
+    low_done = 0;
+
+    new_task(&low_task, 0, 0);
+
+    deadline = system_time(0) + 20000;
+    task_sleep_until(deadline);
+
+    if (system_time(0) < deadline) {
+        strncpy(message, "Woke before deadline", len);
+        ret = FAILED;
+    }
+    else if (!low_count) {
+        strncpy(message, "Lower priority task did not run during sleep", len);
+        ret = FAILED;
+    }
+
+    low_stop = 1;
+
+    /* Sleep until the task exits */
+    while (!low_done) {
+        task_sleep(1000);
+    }
+
+    return ret;
+}
+DEFINE_TEST("Blocking sleep", blocking_sleep_test);
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <dev/accel.h>
+#include <dev/sensor_stream.h>
+#include "test.h"
+
+#define STREAM_TEST_DEPTH   5
+
+int sensor_stream_test(char *message, int len) {
+    struct accel_sample in[STREAM_TEST_DEPTH], out[STREAM_TEST_DEPTH];
+    struct sensor_stream stream;
+    uint32_t capacity, next = 0;
+    int ret = PASSED;
+
+    /* 5 entries of 24 bytes round up to 128 bytes, which holds 5 */
+    if (sensor_stream_init(&stream, sizeof(struct accel_sample),
+                           STREAM_TEST_DEPTH)) {
+        strncpy(message, "Unable to init stream", len);
+        return FAILED;
+    }
+
+    capacity = stream.ring.size / sizeof(struct accel_sample);
+
+    /* Entries straddle the end of the ring as it goes around */
+    for (int round = 0; round < 8; round++) {
+        uint32_t pushed, dropped = stream.dropped;
+        int n;
+
+        for (int i = 0; i < STREAM_TEST_DEPTH; i++) {
+            in[i].timestamp = next + i;
+            in[i].raw.x = next + i;
+            in[i].raw.y = -(next + i);
+            in[i].raw.z = round;
+        }
+
+        pushed = sensor_stream_push(&stream, in, STREAM_TEST_DEPTH);
+        if (pushed != STREAM_TEST_DEPTH || sensor_stream_count(&stream) !=
+                STREAM_TEST_DEPTH) {
+            strncpy(message, "Unable to push samples", len);
+            ret = FAILED;
+            goto out;
+        }
+
+        /* Fill up, then overflow by one */
+        for (uint32_t i = STREAM_TEST_DEPTH; i <= capacity; i++) {
+            sensor_stream_push(&stream, &in[0], 1);
+        }
+
+        if (stream.dropped != dropped + 1) {
+            strncpy(message, "Overflow not counted", len);
+            ret = FAILED;
+            goto out;
+        }
+
+        /* Oldest first, and whole entries only */
+        n = sensor_stream_read(&stream, out, 2, 0);
+        n += sensor_stream_read(&stream, &out[2], STREAM_TEST_DEPTH - 2, 0);
+        if (n != STREAM_TEST_DEPTH || memcmp(in, out, sizeof(out))) {
+            strncpy(message, "Samples corrupted", len);
+            ret = FAILED;
+            goto out;
+        }
+
+        sensor_stream_flush(&stream);
+
+        if (sensor_stream_read(&stream, out, STREAM_TEST_DEPTH, 0) != 0) {
+            strncpy(message, "Read from empty stream", len);
+            ret = FAILED;
+            goto out;
+        }
+
+        /* Move the indices partway around for the next round */
+        sensor_stream_push(&stream, in, 3);
+        sensor_stream_read(&stream, out, 3, 0);
+        next += STREAM_TEST_DEPTH;
+    }
+
+out:
+    sensor_stream_destroy(&stream);
+    return ret;
+}
+DEFINE_TEST("Sensor sample stream", sensor_stream_test);
@@ -419,3 +419,227 @@ int chrnlst_test(char *message, int len) {
     return PASSED;
 }
 DEFINE_TEST("chrnlst", chrnlst_test);
+
+/*
+ * Alignment fuzzing
+ *
+ * The word-at-a-time paths are only taken for some combinations of
+ * source and destination alignment and length, so compare against
+ * byte-at-a-time references over all of them.  Guard bytes around each
+ * destination catch writes past either end.
+ */
+
+#define FUZZ_ALIGN      8
+#define FUZZ_MAX_LEN    80
+#define FUZZ_GUARD      8
+#define FUZZ_SIZE       (FUZZ_GUARD + FUZZ_ALIGN + FUZZ_MAX_LEN + FUZZ_GUARD)
+
+static uint8_t fuzz_src[FUZZ_SIZE];
+static uint8_t fuzz_dst[FUZZ_SIZE];
+static uint8_t fuzz_ref[FUZZ_SIZE];
+
+static uint32_t fuzz_state = 0x12345678;
+
+/* xorshift32, good enough to scramble buffer contents */
+static uint8_t fuzz_rand(void) {
+    fuzz_state ^= fuzz_state << 13;
+    fuzz_state ^= fuzz_state >> 17;
+    fuzz_state ^= fuzz_state << 5;
+    return fuzz_state;
+}
+
+static void fuzz_fill(uint8_t *buf, int nonzero) {
+    for (int i = 0; i < FUZZ_SIZE; i++) {
+        buf[i] = fuzz_rand();
+        if (nonzero && !buf[i]) {
+            buf[i] = 1;
+        }
+    }
+}
+
+static int fuzz_compare(char *message, int len, const char *func,
+                        int src_align, int dst_align, int n) {
+    for (int i = 0; i < FUZZ_SIZE; i++) {
+        if (fuzz_dst[i] != fuzz_ref[i]) {
+            scnprintf(message, len, "%s(+%d, +%d, %d): byte %d is 0x%x, not 0x%x",
+                      func, dst_align, src_align, n, i, fuzz_dst[i],
+                      fuzz_ref[i]);
+            return FAILED;
+        }
+    }
+
+    return PASSED;
+}
+
+int memcpy_fuzz_test(char *message, int len) {
+    for (int s = 0; s < FUZZ_ALIGN; s++) {
+        for (int d = 0; d < FUZZ_ALIGN; d++) {
+            for (int n = 0; n <= FUZZ_MAX_LEN; n++) {
+                uint8_t *src = &fuzz_src[FUZZ_GUARD + s];
+                uint8_t *dst = &fuzz_dst[FUZZ_GUARD + d];
+
+                fuzz_fill(fuzz_src, 0);
+                fuzz_fill(fuzz_dst, 0);
+
+                for (int i = 0; i < FUZZ_SIZE; i++) {
+                    fuzz_ref[i] = fuzz_dst[i];
+                }
+                for (int i = 0; i < n; i++) {
+                    fuzz_ref[FUZZ_GUARD + d + i] = src[i];
+                }
+
+                memcpy(dst, src, n);
+
+                if (fuzz_compare(message, len, "memcpy", s, d, n)) {
+                    return FAILED;
+                }
+            }
+        }
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("memcpy alignment fuzz", memcpy_fuzz_test);
+
+int memmove_fuzz_test(char *message, int len) {
+    for (int s = 0; s < FUZZ_ALIGN; s++) {
+        /* Destinations from below to above the source */
+        for (int d = 0; d < 2*FUZZ_GUARD; d++) {
+            for (int n = 0; n <= FUZZ_MAX_LEN - FUZZ_GUARD; n++) {
+                uint8_t *src = &fuzz_dst[FUZZ_GUARD + s];
+                uint8_t *dst = &fuzz_dst[d];
+
+                fuzz_fill(fuzz_dst, 0);
+
+                for (int i = 0; i < FUZZ_SIZE; i++) {
+                    fuzz_ref[i] = fuzz_dst[i];
+                }
+                if (dst < src) {
+                    for (int i = 0; i < n; i++) {
+                        fuzz_ref[d + i] = src[i];
+                    }
+                }
+                else {
+                    for (int i = n - 1; i >= 0; i--) {
+                        fuzz_ref[d + i] = fuzz_ref[FUZZ_GUARD + s + i];
+                    }
+                }
+
+                memmove(dst, src, n);
+
+                if (fuzz_compare(message, len, "memmove", s, d, n)) {
+                    return FAILED;
+                }
+            }
+        }
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("memmove alignment fuzz", memmove_fuzz_test);
+
+int memset_fuzz_test(char *message, int len) {
+    for (int d = 0; d < FUZZ_ALIGN; d++) {
+        for (int n = 0; n <= FUZZ_MAX_LEN; n++) {
+            uint8_t value = fuzz_rand();
+
+            fuzz_fill(fuzz_dst, 0);
+
+            for (int i = 0; i < FUZZ_SIZE; i++) {
+                fuzz_ref[i] = fuzz_dst[i];
+            }
+            for (int i = 0; i < n; i++) {
+                fuzz_ref[FUZZ_GUARD + d + i] = value;
+            }
+
+            memset(&fuzz_dst[FUZZ_GUARD + d], value, n);
+
+            if (fuzz_compare(message, len, "memset", 0, d, n)) {
+                return FAILED;
+            }
+        }
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("memset alignment fuzz", memset_fuzz_test);
+
+int memcmp_fuzz_test(char *message, int len) {
+    for (int s = 0; s < FUZZ_ALIGN; s++) {
+        for (int d = 0; d < FUZZ_ALIGN; d++) {
+            for (int n = 0; n <= FUZZ_MAX_LEN; n++) {
+                uint8_t *p1 = &fuzz_src[FUZZ_GUARD + s];
+                uint8_t *p2 = &fuzz_dst[FUZZ_GUARD + d];
+                int expected = 0;
+                int ret;
+
+                fuzz_fill(fuzz_src, 0);
+                for (int i = 0; i < n; i++) {
+                    p2[i] = p1[i];
+                }
+
+                /* Differ at a random byte, half of the time */
+                if (n && (fuzz_rand() & 1)) {
+                    int pos = fuzz_rand() % n;
+
+                    p2[pos] = p1[pos] + 1 + fuzz_rand() % 255;
+                    expected = p1[pos] > p2[pos] ? 1 : -1;
+                }
+
+                ret = memcmp(p1, p2, n);
+                if (ret != expected) {
+                    scnprintf(message, len, "memcmp(+%d, +%d, %d) returned %d, not %d",
+                              s, d, n, ret, expected);
+                    return FAILED;
+                }
+            }
+        }
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("memcmp alignment fuzz", memcmp_fuzz_test);
+
+int memchr_strlen_fuzz_test(char *message, int len) {
+    for (int s = 0; s < FUZZ_ALIGN; s++) {
+        for (int n = 0; n <= FUZZ_MAX_LEN; n++) {
+            uint8_t *p = &fuzz_src[FUZZ_GUARD + s];
+            uint8_t value = fuzz_rand();
+            void *expected = NULL;
+            void *found;
+            size_t length;
+
+            fuzz_fill(fuzz_src, 1);
+
+            /* Terminate the string, then plant value somewhere before */
+            p[n] = '\0';
+            if (n && value && (fuzz_rand() & 1)) {
+                p[fuzz_rand() % n] = value;
+            }
+
+            for (int i = 0; i < n; i++) {
+                if (p[i] == value) {
+                    expected = &p[i];
+                    break;
+                }
+            }
+
+            found = memchr(p, value, n);
+            if (found != expected) {
+                scnprintf(message, len, "memchr(+%d, 0x%x, %d) returned 0x%x, not 0x%x",
+                          s, value, n, found, expected);
+                return FAILED;
+            }
+
+            length = strlen((char *) p);
+            if (length != n) {
+                scnprintf(message, len, "strlen(+%d) returned %d, not %d",
+                          s, length, n);
+                return FAILED;
+            }
+        }
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("memchr/strlen alignment fuzz", memchr_strlen_fuzz_test);
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dev/hw/perfcounter.h>
+#include "test.h"
+
+/* Memory function throughput, as measured by the perfcounter */
+
+#define STRING_PERF_SIZE    1024
+#define STRING_PERF_ITERS   64
+
+static uint8_t string_perf_src[STRING_PERF_SIZE + 4];
+static uint8_t string_perf_dst[STRING_PERF_SIZE + 4];
+
+/* Byte-at-a-time copy, as the baseline the library should beat */
+static void string_perf_bytecpy(uint8_t *d, const uint8_t *s, int n) {
+    while (n--) {
+        *d++ = *s++;
+    }
+}
+
+/* Print bytes per cycle, to two decimal places */
+static void string_perf_report(const char *name, uint32_t cycles) {
+    uint32_t bytes = STRING_PERF_SIZE * STRING_PERF_ITERS;
+    uint32_t hundredths = cycles ? (uint64_t) bytes * 100 / cycles : 0;
+
+    printf("\r\n\t%s: %u.%u%u bytes/cycle", name, hundredths / 100,
+           (hundredths / 10) % 10, hundredths % 10);
+}
+
+/* Run each function over a buffer at the given misalignment */
+static uint32_t string_perf_run(int func, int align) {
+    uint8_t *src = &string_perf_src[align];
+    uint8_t *dst = &string_perf_dst[func == 1 ? 0 : align];
+    uint64_t start = perfcounter_getcount();
+    volatile size_t sink = 0;
+
+    for (int i = 0; i < STRING_PERF_ITERS; i++) {
+        switch (func) {
+        case 0:
+        case 1:
+            memcpy(dst, src, STRING_PERF_SIZE);
+            break;
+        case 2:
+            string_perf_bytecpy(dst, src, STRING_PERF_SIZE);
+            break;
+        case 3:
+            memset(dst, 0xA5, STRING_PERF_SIZE);
+            break;
+        case 4:
+            sink += memcmp(dst, src, STRING_PERF_SIZE);
+            break;
+        case 5:
+            sink += strlen((char *) src);
+            break;
+        }
+    }
+
+    return perfcounter_getcount() - start;
+}
+
+static int string_throughput_perf(char *message, int len) {
+    const char *names[] = {
+        "memcpy (aligned)",
+        "memcpy (misaligned)",
+        "byte copy",
+        "memset",
+        "memcmp",
+        "strlen",
+    };
+    uint32_t cycles[ARRAY_LENGTH(names)];
+
+    /* Nonzero, so strlen covers the whole buffer */
+    memset(string_perf_src, 'x', STRING_PERF_SIZE + 4);
+    string_perf_src[STRING_PERF_SIZE] = '\0';
+    memcpy(string_perf_dst, string_perf_src, STRING_PERF_SIZE + 4);
+
+    for (int i = 0; i < ARRAY_LENGTH(names); i++) {
+        cycles[i] = string_perf_run(i, 0);
+    }
+
+    /* memcpy between buffers with different alignment */
+    cycles[1] = string_perf_run(1, 1);
+
+    for (int i = 0; i < ARRAY_LENGTH(names); i++) {
+        string_perf_report(names[i], cycles[i]);
+    }
+    printf("\r\n");
+
+    if (cycles[0] >= cycles[2]) {
+        strncpy(message, "memcpy no faster than a byte copy", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("String function throughput", string_throughput_perf);
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2015 F4OS Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <kernel/timer.h>
+#include "test.h"
+
+/* Tests for kernel software timers */
+
+static void count_func(void *data) {
+    volatile int *count = data;
+
+    (*count)++;
+}
+
+static int timer_oneshot_test(char *message, int len) {
+    volatile int count = 0;
+    struct timer timer;
+
+    int ret = PASSED;
+
+    timer_init(&timer, count_func, (void *) &count);
+    timer_start(&timer, 10000, 0);
+
+    usleep(50000);
+
+    if (count != 1) {
+        scnprintf(message, len, "One-shot timer fired %d times", count);
+        ret = FAILED;
+    }
+    else if (timer_active(&timer)) {
+        strncpy(message, "One-shot timer still active", len);
+        ret = FAILED;
+    }
+
+    /* The timer is on our stack, so it must not be left queued */
+    timer_stop(&timer);
+
+    return ret;
+}
+DEFINE_TEST("One-shot timer", timer_oneshot_test);
+
+static int timer_periodic_test(char *message, int len) {
+    volatile int count = 0;
+    struct timer timer;
+    int final;
+
+    timer_init(&timer, count_func, (void *) &count);
+    timer_start(&timer, 10000, 10000);
+
+    usleep(105000);
+
+    timer_stop(&timer);
+    final = count;
+
+    /* Allow a period of slack either way */
+    if (final < 9 || final > 11) {
+        scnprintf(message, len, "Periodic timer fired %d times, expected 10",
+                  final);
+        return FAILED;
+    }
+
+    usleep(30000);
+
+    if (count != final) {
+        strncpy(message, "Periodic timer fired after stop", len);
+        return FAILED;
+    }
+
+    return PASSED;
+}
+DEFINE_TEST("Periodic timer", timer_periodic_test);
+
+static int timer_order_test(char *message, int len) {
+    volatile int count[3] = {0};
+    struct timer timers[3];
+    int ret = PASSED;
+
+    /* Start out of order, to exercise queue insertion */
+    timer_init(&timers[0], count_func, (void *) &count[0]);
+    timer_init(&timers[1], count_func, (void *) &count[1]);
+    timer_init(&timers[2], count_func, (void *) &count[2]);
+
+    timer_start(&timers[2], 30000, 0);
+    timer_start(&timers[0], 10000, 0);
+    timer_start(&timers[1], 20000, 0);
+
+    /* Stopping the middle timer must not delay the last */
+    timer_stop(&timers[1]);
+
+    usleep(15000);
+
+    if (count[0] != 1 || count[2] != 0) {
+        strncpy(message, "Timers expired out of order", len);
+        ret = FAILED;
+        goto out;
+    }
+
+    usleep(30000);
+
+    if (count[1] != 0 || count[2] != 1) {
+        scnprintf(message, len, "Timer counts: %d %d %d", count[0], count[1],
+                  count[2]);
+        ret = FAILED;
+    }
+
+out:
+    /* The timers are on our stack, so none may be left queued */
+    for (int i = 0; i < ARRAY_LENGTH(timers); i++) {
+        timer_stop(&timers[i]);
+    }
+
+    return ret;
+}
+DEFINE_TEST("Timer ordering", timer_order_test);